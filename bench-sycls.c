@@ -0,0 +1,103 @@
+/* source: bench-sycls.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* microbenchmark of the system call wrappers in sycls.c: moves one byte
+   through a pipe with write()/read() and with Write()/Read(), and prints the
+   nanoseconds per pair of calls, the best of several alternating rounds. The
+   difference is what the wrappers add on the data path of socat when no
+   debug messages are printed.
+   usage: ./bench-sycls [-n pairs] [-d]... */
+
+#include "config.h"
+#include "xioconfig.h"
+#include "sysincludes.h"
+
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+#include "sycls.h"
+
+
+static double bench_now(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static double bench_libc(int fds[2], unsigned long pairs) {
+   unsigned long i;
+   char c = 'x';
+   double t0;
+
+   t0 = bench_now();
+   for (i = 0; i < pairs; ++i) {
+      if (write(fds[1], &c, 1) != 1 || read(fds[0], &c, 1) != 1) {
+	 Error1("pipe: %s", strerror(errno));
+	 exit(1);
+      }
+   }
+   return (bench_now() - t0) / pairs;
+}
+
+static double bench_sycls(int fds[2], unsigned long pairs) {
+   unsigned long i;
+   char c = 'x';
+   double t0;
+
+   t0 = bench_now();
+   for (i = 0; i < pairs; ++i) {
+      if (Write(fds[1], &c, 1) != 1 || Read(fds[0], &c, 1) != 1) {
+	 Error1("pipe: %s", strerror(errno));
+	 exit(1);
+      }
+   }
+   return (bench_now() - t0) / pairs;
+}
+
+int main(int argc, const char *argv[]) {
+   unsigned long pairs = 200000;
+   double libc = 0.0, wrapped = 0.0, t;
+   int fds[2];
+   int round;
+
+   diag_set('p', strchr(argv[0], '/') ? strrchr(argv[0], '/')+1 : argv[0]);
+   while (argc > 1 && argv[1][0] == '-') {
+      switch (argv[1][1]) {
+      case 'n':
+	 if (argc < 3) {
+	    Error("option -n requires an argument");
+	    exit(1);
+	 }
+	 pairs = strtoul(argv[2], NULL, 0);
+	 ++argv, --argc;
+	 break;
+      case 'd': diag_set('d', NULL); break;
+      default:
+	 Error1("unknown option \"%s\"; usage: bench-sycls [-n pairs] [-d]...",
+		argv[1]);
+	 exit(1);
+      }
+      ++argv, --argc;
+   }
+   if (pairs == 0) {
+      Error("number of pairs must be positive");
+      exit(1);
+   }
+
+   if (pipe(fds) < 0) {
+      Error1("pipe(): %s", strerror(errno));
+      exit(1);
+   }
+   /* the best of alternating rounds; scheduling noise only adds time */
+   for (round = 0; round < 5; ++round) {
+      t = bench_libc(fds, pairs);
+      if (round == 0 || t < libc)  libc = t;
+      t = bench_sycls(fds, pairs);
+      if (round == 0 || t < wrapped)  wrapped = t;
+   }
+   printf("write()/read(): %8.1f ns per pair\n", libc);
+   printf("Write()/Read(): %8.1f ns per pair (%+.1f ns)\n",
+	  wrapped, wrapped - libc);
+   return 0;
+}
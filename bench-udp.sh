@@ -0,0 +1,121 @@
+#! /usr/bin/env bash
+# source: bench-udp.sh
+# Copyright Gerhard Rieger and contributors (see file CHANGES)
+# Published under the GNU General Public License V.2, see file COPYING
+
+# measures how many UDP packets per second socat moves on the loopback
+# interface:
+#   sendto:  a socat instance that sends small packets from a file as fast as
+#            it can (the XIOWRITE_SENDTO path); with udp-gso it reads blocks of
+#            dgram-batch packets and lets the kernel cut them into datagrams
+#   relay:   packets that a socat relay (UDP4-RECV to UDP4-SENDTO) delivered to
+#            a sink, with and without option dgram-batch, and with dgram-batch
+#            and the UDP offloads udp-gro and udp-gso (Linux)
+# usage: ./bench-udp.sh [-n packets] [-s size] [-b dgram-batch] [socat-binary]
+# compare two builds by running the script with each binary; the numbers only
+# make sense relative to each other on the same host.
+
+PACKETS=200000
+SIZE=64
+BATCH=32
+PORT=${PORT:-47100}
+
+while [ "$1" ]; do
+    case "X$1" in
+    X-n) PACKETS="$2"; shift ;;
+    X-s) SIZE="$2"; shift ;;
+    X-b) BATCH="$2"; shift ;;
+    X-*) echo "usage: $0 [-n packets] [-s size] [-b dgram-batch] [socat-binary]" >&2; exit 1 ;;
+    *)   SOCAT="$1" ;;
+    esac
+    shift
+done
+SOCAT=${SOCAT:-./socat}
+
+TD=$(mktemp -d /tmp/bench-udp.XXXXXX) || exit 1
+trap 'rm -rf "$TD"' EXIT
+BYTES=$((PACKETS*SIZE))
+head -c $BYTES /dev/zero >"$TD/in"
+
+# time in microseconds
+now () {
+    date +%s%6N
+}
+
+# prints packets/s for the given number of packets and microseconds
+pps () {
+    if [ "$2" -le 0 ]; then echo 0; return; fi
+    echo $(( $1 * 1000000 / $2 ))
+}
+
+# true when the socat binary knows option $1
+hasopt () {
+    $SOCAT -hhh |grep -q "[[:space:]]$1[[:space:]]"
+}
+
+# the sink must not be the bottleneck; it uses the fastest receive options of
+# the binary
+SINKOPTS=
+if hasopt dgram-batch; then SINKOPTS="$SINKOPTS,dgram-batch=$BATCH"; fi
+if hasopt udp-gro; then SINKOPTS="$SINKOPTS,udp-gro"; fi
+
+# the sink writes all packets it receives on port $1 to file $2; start it in
+# background
+sink () {
+    exec $SOCAT -u -b 65536 UDP4-RECV:$1,so-rcvbuf=4194304$SINKOPTS \
+	OPEN:"$2",creat,trunc
+}
+
+# $1: block size, $2: options of the sending address
+bench_sendto () {
+    local pid t0 t1
+    sink $PORT "$TD/out" 2>/dev/null &
+    pid=$!
+    sleep 0.2
+    t0=$(now)
+    $SOCAT -u -b $1 OPEN:"$TD/in" UDP4-SENDTO:127.0.0.1:$PORT$2
+    t1=$(now)
+    kill $pid 2>/dev/null; wait $pid 2>/dev/null
+    printf "%-52s %10s pps sent\n" "sendto${2:+ ${2#,}}" $(pps $PACKETS $((t1-t0)))
+}
+
+# $1: options of the relay addresses; $2, $3: block size and options of the
+# sender (default: one packet per write)
+bench_relay () {
+    local pid0 pid1 t0 t1 got size
+    sink $((PORT+1)) "$TD/out" 2>/dev/null &
+    pid0=$!
+    $SOCAT -u -b 65536 UDP4-RECV:$PORT,so-rcvbuf=4194304$1 \
+	UDP4-SENDTO:127.0.0.1:$((PORT+1))$1 2>/dev/null &
+    pid1=$!
+    sleep 0.2
+    t0=$(now)
+    $SOCAT -u -b ${2:-$SIZE} OPEN:"$TD/in" UDP4-SENDTO:127.0.0.1:$PORT$3
+    # the relay is done when the sink stops growing
+    size=-1
+    while [ "$(wc -c <"$TD/out")" -ne "$size" ]; do
+	size=$(wc -c <"$TD/out");  t1=$(now)
+	sleep 0.05
+    done
+    kill $pid1 $pid0 2>/dev/null; wait $pid1 $pid0 2>/dev/null
+    got=$(( size / SIZE ))
+    printf "%-52s %10s pps delivered (%d of %d)\n" \
+	"relay${1:+ ${1#,}}${3:+ from ${3#,}}" \
+	$(pps $got $((t1-t0))) $got $PACKETS
+}
+
+echo "$($SOCAT -V |grep 'socat version')"
+echo "$PACKETS packets of $SIZE bytes"
+bench_sendto $SIZE
+if hasopt udp-gso; then
+    bench_sendto $((SIZE*BATCH)) ",udp-gso=$SIZE"
+fi
+bench_relay
+if hasopt dgram-batch; then
+    bench_relay ",dgram-batch=$BATCH"
+fi
+if hasopt udp-gso; then
+    bench_relay ",dgram-batch=$BATCH,udp-gro,udp-gso=$SIZE"
+    bench_relay ",dgram-batch=$BATCH,udp-gro,udp-gso=$SIZE" \
+	$((SIZE*BATCH)) ",udp-gso=$SIZE"
+fi
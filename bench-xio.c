@@ -0,0 +1,435 @@
+/* source: bench-xio.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* microbenchmarks of libxio code that runs per address or per transfer:
+   option keyword lookup and option parsing, address tokenizing, copying,
+   retrieving and applying options, and the newline conversion, escape
+   character scan and hex dump of the data path. Each case runs for a fixed
+   time (option -t, default 0.25s) and reports the nanoseconds and heap
+   allocations per call, and MB/s for the data cases; with -j as JSON lines.
+   Allocations are counted with glibc only.
+   usage: ./bench-xio [-t seconds] [-j] [case...] */
+
+#include "xiosysincludes.h"
+
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+#include "sycls.h"
+#include "nestlex.h"
+#include "xioopen.h"
+#include "xio-ascii.h"
+#include "xio-tcp.h"
+#if WITH_OPENSSL
+#include "xio-openssl.h"
+#endif
+
+
+/* libxio expects the program to provide the addresses */
+xiofile_t *sock1, *sock2;
+
+#define BENCH_DATALEN 8192	/* data chunk, as with the default -b */
+
+static unsigned long long bench_allocs;
+
+#if defined(__GLIBC__)
+/* count the allocations of the cases; glibc supports replacing malloc */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+   ++bench_allocs;
+   return __libc_malloc(size);
+}
+void *calloc(size_t nmemb, size_t size) {
+   ++bench_allocs;
+   return __libc_calloc(nmemb, size);
+}
+void *realloc(void *ptr, size_t size) {
+   ++bench_allocs;
+   return __libc_realloc(ptr, size);
+}
+void free(void *ptr) {
+   __libc_free(ptr);
+}
+#endif /* defined(__GLIBC__) */
+
+/* realistic option strings and the groups of their address types */
+static const char *bench_tcpopts =
+   "reuseaddr,fork,backlog=128,nodelay,keepalive,rcvbuf=262144,"
+   "sndbuf=262144,range=127.0.0.0/8,max-children=100,retry=3";
+static const char *bench_sslopts =
+   "reuseaddr,fork,cert=/etc/ssl/server.pem,key=/etc/ssl/server.key,"
+   "cafile=/etc/ssl/ca.pem,verify=1,cipher=HIGH:!aNULL,nodelay";
+static const char *bench_sockopts =
+   "nodelay,keepalive,rcvbuf=262144,sndbuf=262144,reuseaddr,tos=16,ttl=64,"
+   "cloexec";
+static const char *bench_address =
+   "OPENSSL-LISTEN:4443,reuseaddr,fork,cert=/etc/ssl/server.pem,"
+   "cafile=\"/etc/ssl/ca.pem\",cipher='HIGH:!aNULL',verify=1";
+static const char *bench_names[] = {
+   "reuseaddr", "fork", "nodelay", "rcvbuf", "sndbuf", "bind", "range",
+   "cert", "verify", "crlf", "ignoreeof", "su", "max-children", "retry",
+   "keepalive", "so-reuseport"
+} ;
+
+/* the phases of a TCP listen address, in order */
+static const enum e_phase bench_phases[] = {
+   PH_INIT, PH_EARLY, PH_PREOPEN, PH_PRESOCKET, PH_PASTSOCKET, PH_FD,
+   PH_PREBIND, PH_BIND, PH_PASTBIND, PH_PRELISTEN, PH_LISTEN, PH_PASTLISTEN,
+   PH_PASTACCEPT, PH_LATE
+} ;
+
+static struct {
+   size_t nkeys;
+   unsigned int i;		/* rotates through inputs */
+   struct opt *tcpopts;		/* parsed bench_tcpopts */
+   struct opt *sockopts;	/* parsed bench_sockopts */
+   unsigned int tcpgroups;
+   unsigned int sslgroups;
+   int fd;			/* TCP socket for applyopts() */
+   unsigned char text[BENCH_DATALEN];	/* lines with \n */
+   unsigned char crnltext[BENCH_DATALEN];	/* lines with \r\n */
+   unsigned char binary[BENCH_DATALEN];
+   unsigned char work[2*BENCH_DATALEN];
+   char dump[4*BENCH_DATALEN];
+   volatile unsigned long sink;	/* keeps the results alive */
+} bench;
+
+
+/* frees the option values that parseopts() allocated, and the array */
+static void bench_freeopts(struct opt *opts) {
+   struct opt *opt;
+
+   for (opt = opts; opt->desc != ODESC_END; ++opt) {
+      if (opt->desc == ODESC_DONE || opt->desc == ODESC_ERROR)  continue;
+      if (opt->desc->type == TYPE_STRING ||
+	  opt->desc->type == TYPE_STRING_NULL ||
+	  opt->desc->type == TYPE_FILENAME) {
+	 free(opt->value.u_string);
+      }
+   }
+   freeopts(opts);
+}
+
+static void bench_keyw_hit(void) {
+   const char *name =
+      bench_names[bench.i++ % (sizeof(bench_names)/sizeof(char *))];
+   bench.sink += (unsigned long)
+      keyw((struct wordent *)optionnames, name, bench.nkeys);
+}
+
+static void bench_keyw_miss(void) {
+   bench.sink += (unsigned long)
+      keyw((struct wordent *)optionnames, "nosuchoption", bench.nkeys);
+}
+
+static void bench_parseopts(const char *string, unsigned int groups) {
+   struct opt *opts;
+
+   if (parseopts(&string, groups, &opts) < 0) {
+      Error("parseopts() failed");
+      exit(1);
+   }
+   bench_freeopts(opts);
+}
+
+static void bench_parseopts_short(void) {
+   bench_parseopts("fork", bench.tcpgroups);
+}
+
+static void bench_parseopts_tcp(void) {
+   bench_parseopts(bench_tcpopts, bench.tcpgroups);
+}
+
+static void bench_parseopts_openssl(void) {
+   bench_parseopts(bench_sslopts, bench.sslgroups);
+}
+
+/* splits the address into its keyword, parameters and options, as
+   _xioopen_split() and parseopts() do */
+static void bench_nestlex(void) {
+   const char *ends[] = { "!!", ",", ":", NULL };
+   const char *hquotes[] = { "'", NULL };
+   const char *squotes[] = { "\"", NULL };
+   const char *nests[] = {
+      "'", "'", "(", ")", "[", "]", "{", "}", NULL
+   } ;
+   const char *addr = bench_address;
+   char token[512], *tokp;
+   size_t len;
+
+   while (*addr) {
+      len = sizeof(token);  tokp = token;
+      if (nestlex(&addr, &tokp, &len, ends, hquotes, squotes, nests,
+		  true, true, false) != 0) {
+	 Error("nestlex() failed");
+	 exit(1);
+      }
+      bench.sink += tokp - token;
+      if (*addr)  ++addr;	/* the separator */
+   }
+}
+
+static void bench_copyopts(void) {
+   freeopts(copyopts(bench.tcpopts, bench.tcpgroups));
+}
+
+/* what the retry and fork loops do for each new attempt */
+static void bench_recopyopts(void) {
+   static struct opt *opts;
+
+   opts = recopyopts(opts, bench.tcpopts, bench.tcpgroups);
+}
+
+/* what a TCP listen address retrieves before it applies the rest */
+static void bench_retropt(void) {
+   struct opt *opts = copyopts(bench.tcpopts, bench.tcpgroups);
+   bool dofork = false;
+   int backlog = 5, maxchildren = 0;
+   unsigned int retry = 0;
+   char *range = NULL;
+
+   retropt_bool(opts, OPT_FORK, &dofork);
+   retropt_int(opts, OPT_BACKLOG, &backlog);
+   retropt_int(opts, OPT_MAX_CHILDREN, &maxchildren);
+   retropt_uint(opts, OPT_RETRY, &retry);
+   retropt_string(opts, OPT_RANGE, &range);
+   retropt_int(opts, OPT_SO_RCVBUF, &backlog);
+   retropt_int(opts, OPT_MAX_CHILDREN, &maxchildren);	/* not there now */
+   retropt_bool(opts, OPT_TCP_NODELAY, &dofork);
+   bench.sink += backlog + maxchildren + retry + dofork;
+   free(range);
+   freeopts(opts);
+}
+
+/* all phases of a listen address, with setsockopt() for some options */
+static void bench_applyopts(void) {
+   struct opt *opts = copyopts(bench.sockopts, bench.tcpgroups);
+   unsigned int p;
+
+   for (p = 0; p < sizeof(bench_phases)/sizeof(bench_phases[0]); ++p) {
+      applyopts(bench.fd, opts, bench_phases[p]);
+   }
+   freeopts(opts);
+}
+
+/* a phase without options: just the scan */
+static void bench_applyopts_scan(void) {
+   applyopts(bench.fd, bench.tcpopts, PH_PREEXEC);
+}
+
+static void bench_cv_newline(const unsigned char *text, int from, int to) {
+   ssize_t bytes = BENCH_DATALEN;
+
+   memcpy(bench.work, text, BENCH_DATALEN);
+   cv_newline(bench.work, &bytes, from, to);
+   bench.sink += bytes;
+}
+
+static void bench_cv_raw2cr(void) {
+   bench_cv_newline(bench.text, LINETERM_RAW, LINETERM_CR);
+}
+
+static void bench_cv_crnl2raw(void) {
+   bench_cv_newline(bench.crnltext, LINETERM_CRNL, LINETERM_RAW);
+}
+
+static void bench_cv_raw2crnl(void) {
+   bench_cv_newline(bench.text, LINETERM_RAW, LINETERM_CRNL);
+}
+
+static void bench_escape(void) {
+   bench.sink += xiofindescape(bench.binary, BENCH_DATALEN, 0x1d);
+}
+
+static void bench_xiodump64(void) {
+   xiodump(bench.binary, 64, bench.dump, sizeof(bench.dump), 0);
+   bench.sink += bench.dump[1];
+}
+
+static void bench_xiodump8k(void) {
+   xiodump(bench.binary, BENCH_DATALEN, bench.dump, sizeof(bench.dump), 0);
+   bench.sink += bench.dump[1];
+}
+
+static const struct bench_case {
+   const char *name;
+   void (*func)(void);
+   size_t bytes;		/* data per call, for MB/s */
+} bench_cases[] = {
+   { "keyw-hit",		bench_keyw_hit,		0 },
+   { "keyw-miss",		bench_keyw_miss,	0 },
+   { "parseopts-short",		bench_parseopts_short,	0 },
+   { "parseopts-tcp",		bench_parseopts_tcp,	0 },
+   { "parseopts-openssl",	bench_parseopts_openssl, 0 },
+   { "nestlex-address",		bench_nestlex,		0 },
+   { "copyopts",		bench_copyopts,		0 },
+   { "recopyopts",		bench_recopyopts,	0 },
+   { "retropt-listen",		bench_retropt,		0 },
+   { "applyopts-phases",	bench_applyopts,	0 },
+   { "applyopts-scan",		bench_applyopts_scan,	0 },
+   { "cv_newline-raw2cr",	bench_cv_raw2cr,	BENCH_DATALEN },
+   { "cv_newline-crnl2raw",	bench_cv_crnl2raw,	BENCH_DATALEN },
+   { "cv_newline-raw2crnl",	bench_cv_raw2crnl,	BENCH_DATALEN },
+   { "escape-scan",		bench_escape,		BENCH_DATALEN },
+   { "xiodump-64",		bench_xiodump64,	64 },
+   { "xiodump-8k",		bench_xiodump8k,	BENCH_DATALEN },
+   { NULL }
+} ;
+
+
+static double bench_now(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static void bench_init(void) {
+   const char *a;
+   unsigned int i;
+
+   while (optionnames[bench.nkeys].name != NULL)  ++bench.nkeys;
+   bench.tcpgroups = addr_tcp4_listen.groups;
+#if WITH_OPENSSL
+   bench.sslgroups = xioaddr_openssl_listen.groups;
+#else
+   bench.sslgroups = addr_tcp4_listen.groups;
+   xioopts_ignoregroups = true;	/* the OpenSSL options still parse */
+#endif
+   a = bench_tcpopts;
+   if (parseopts(&a, bench.tcpgroups, &bench.tcpopts) < 0)  exit(1);
+   a = bench_sockopts;
+   if (parseopts(&a, bench.tcpgroups, &bench.sockopts) < 0)  exit(1);
+   if ((bench.fd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+      Error1("socket(): %s", strerror(errno));
+      exit(1);
+   }
+   /* lines of 63 characters, some with the escape character */
+   for (i = 0; i < BENCH_DATALEN; ++i) {
+      bench.text[i] = (i % 64 == 63) ? '\n' : 'a' + i % 26;
+      bench.crnltext[i] = (i % 64 == 63) ? '\n' :
+	 (i % 64 == 62) ? '\r' : 'a' + i % 26;
+      bench.binary[i] = (i * 131 + 7) & 0xff;
+      if (bench.binary[i] == 0x1d)  bench.binary[i] = 0x1c;
+   }
+}
+
+/* runs a case for about seconds; returns the ns per call, and the calls
+   and allocations */
+static double bench_run(const struct bench_case *bc, double seconds,
+			unsigned long *calls, double *allocs) {
+   unsigned long n = 1, i;
+   double t0, t;
+
+   /* warm up and find a count that takes about 1/10 of the time */
+   bc->func();
+   do {
+      n *= 2;
+      t0 = bench_now();
+      for (i = 0; i < n; ++i)  bc->func();
+      t = bench_now() - t0;
+   } while (t < seconds * 1e8);
+   n = n * (seconds * 1e9 / t);
+   if (n == 0)  n = 1;
+   bench_allocs = 0;
+   t0 = bench_now();
+   for (i = 0; i < n; ++i)  bc->func();
+   t = bench_now() - t0;
+   *calls = n;
+   *allocs = (double)bench_allocs / n;
+   return t / n;
+}
+
+static const char *bench_usage =
+   "usage: bench-xio [-t seconds] [-j] [case...]";
+
+int main(int argc, const char *argv[]) {
+   const struct bench_case *bc;
+   double seconds = 0.25, ns, allocs, mbs;
+   unsigned long calls;
+   bool json = false;
+   int i;
+
+   diag_set('p', strchr(argv[0], '/') ? strrchr(argv[0], '/')+1 : argv[0]);
+   while (argc > 1 && argv[1][0] == '-') {
+      switch (argv[1][1]) {
+      case 't':
+	 if (argc < 3) {
+	    Error("option -t requires an argument");
+	    exit(1);
+	 }
+	 seconds = strtod(argv[2], NULL);
+	 ++argv, --argc;
+	 break;
+      case 'j': json = true; break;
+      case 'h':
+	 puts(bench_usage);
+	 for (bc = bench_cases; bc->name; ++bc)  printf("   %s\n", bc->name);
+	 exit(0);
+      default:
+	 Error2("unknown option \"%s\"; %s", argv[1], bench_usage);
+	 exit(1);
+      }
+      ++argv, --argc;
+   }
+   if (seconds <= 0) {
+      Error("seconds must be positive");
+      exit(1);
+   }
+   for (i = 1; i < argc; ++i) {
+      for (bc = bench_cases; bc->name; ++bc) {
+	 if (!strcmp(argv[i], bc->name))  break;
+      }
+      if (bc->name == NULL) {
+	 Error2("unknown case \"%s\"; %s", argv[i], bench_usage);
+	 exit(1);
+      }
+   }
+   bench_init();
+
+   if (!json) {
+      printf("%-22s %12s %10s %10s %9s\n", "case", "calls", "ns/call",
+	     "allocs", "MB/s");
+   }
+   for (bc = bench_cases; bc->name; ++bc) {
+      if (argc > 1) {
+	 for (i = 1; i < argc; ++i) {
+	    if (!strcmp(argv[i], bc->name))  break;
+	 }
+	 if (i == argc)  continue;
+      }
+      ns = bench_run(bc, seconds, &calls, &allocs);
+      mbs = bc->bytes ? bc->bytes / ns * 1e3 : 0.0;
+      if (json) {
+	 printf("{\"case\":\"%s\",\"calls\":%lu,\"ns_per_call\":%.1f,",
+		bc->name, calls, ns);
+#if defined(__GLIBC__)
+	 printf("\"allocs_per_call\":%.2f,", allocs);
+#else
+	 printf("\"allocs_per_call\":null,");
+#endif
+	 if (bc->bytes) {
+	    printf("\"mb_per_s\":%.1f}\n", mbs);
+	 } else {
+	    printf("\"mb_per_s\":null}\n");
+	 }
+      } else {
+#if defined(__GLIBC__)
+	 printf("%-22s %12lu %10.1f %10.2f", bc->name, calls, ns, allocs);
+#else
+	 printf("%-22s %12lu %10.1f %10s", bc->name, calls, ns, "-");
+#endif
+	 if (bc->bytes) {
+	    printf(" %9.1f\n", mbs);
+	 } else {
+	    printf(" %9s\n", "-");
+	 }
+      }
+      fflush(stdout);
+   }
+   return 0;
+}
@@ -0,0 +1,59 @@
+/* source: benchutils.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* helpers of the benchmark programs socat-bench and socat-cps: the clock,
+   starting socat and proxy-stub, and the latency percentiles of their
+   histograms (struct xiohist of utils.h) */
+
+#include "config.h"
+#include "xioconfig.h"
+#include "sysincludes.h"
+
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+#include "utils.h"
+#include "benchutils.h"
+
+
+/* returns CLOCK_MONOTONIC in ns */
+unsigned long long bench_now(void) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* starts program (socat or proxy-stub) with the given arguments; stdin and
+   stdout are fd0 and fd1 when not -1, stderr goes to /dev/null when quiet.
+   returns the process id, or -1 */
+pid_t bench_spawn(const char *program, const char *args[], int fd0, int fd1,
+		  bool quiet) {
+   const char *argv[16];
+   pid_t pid;
+   int i = 0, null;
+
+   argv[i++] = program;
+   while (*args)  argv[i++] = *args++;
+   argv[i] = NULL;
+   if ((pid = fork()) < 0) {
+      Error1("fork(): %s", strerror(errno));
+      return -1;
+   }
+   if (pid > 0)  return pid;
+   if (fd0 >= 0)  dup2(fd0, 0);
+   if (fd1 >= 0)  dup2(fd1, 1);
+   if (quiet && (null = open("/dev/null", O_WRONLY)) >= 0) {
+      dup2(null, 2);
+   }
+   execvp(program, (char **)argv);
+   fprintf(stderr, "execvp(\"%s\"): %s\n", program, strerror(errno));
+   _exit(127);
+}
+
+/* the value in us below which the given per mille of the values of h are,
+   or 0 when h is empty */
+double bench_percentile(const struct xiohist *h, unsigned int permille) {
+   if (h->n == 0)  return 0.0;
+   return xiohist_percentile(h, permille) / 1e3;
+}
@@ -0,0 +1,16 @@
+/* source: benchutils.h */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+#ifndef __benchutils_h_included
+#define __benchutils_h_included 1
+
+/* helpers of the benchmark programs socat-bench and socat-cps */
+
+extern unsigned long long bench_now(void);
+extern pid_t bench_spawn(const char *program, const char *args[], int fd0,
+			 int fd1, bool quiet);
+extern double bench_percentile(const struct xiohist *h,
+			       unsigned int permille);
+
+#endif /* !defined(__benchutils_h_included) */
@@ -16,6 +16,10 @@
 #include "error.h"
 #include "sycls.h"
 
+/* asynchronous logging (option -la) needs a writer thread */
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_CREATE
+#  define WITH_DIAG_ASYNC 1
+#endif
 
 /* translate MSG level to SYSLOG level */
 int syslevel[] = {
@@ -28,12 +32,12 @@ int syslevel[] = {
 
 struct diag_opts {
    const char *progname;
-   int msglevel;
    int exitlevel;
    int syslog;
    FILE *logfile;
    int logfacility;
    bool micros;
+   bool relative;	/* time stamps relative to diag_start (-lr) */
    int exitstatus;	/* pass signal number to error exit */
    bool withhostname;	/* in custom logs add hostname */
    char *hostname;
@@ -45,7 +49,9 @@ static void _diag_exit(int status);
 
 
 struct diag_opts diagopts =
-  { NULL, E_ERROR, E_ERROR, 0, NULL, LOG_DAEMON, false, 0, false, NULL, true } ;
+  { NULL, E_ERROR, 0, NULL, LOG_DAEMON, false, false, 0, false, NULL, true } ;
+
+int diag_msglevel = E_ERROR;	/* messages below this level are suppressed */
 
 static void msg2(
 #if HAVE_CLOCK_GETTIME
@@ -55,10 +61,27 @@ static void msg2(
 #else
 		 time_t *now,
 #endif
-		 int level, int exitcode, int handler, const char *text);
-static void _msg(int level, const char *buff, const char *syslp);
+		 int level, int exitcode, int handler, bool batch,
+		 const char *text);
+static void _msg(int level, bool batch, const char *buff, const char *syslp);
+#if HAVE_CLOCK_GETTIME
+static void diag_gettime(struct timespec *now);
+#elif HAVE_PROTOTYPE_LIB_gettimeofday
+static void diag_gettime(struct timeval *now);
+#else
+static void diag_gettime(time_t *now);
+#endif
+#if WITH_DIAG_ASYNC
+static int diag_async_init(void);
+static int diag_async_put(struct diag_dgram *dgram);
+static void diag_async_stop(void);
+#else
+#  define diag_async_put(d) (-1)
+#  define diag_async_stop()
+#endif
 
 sig_atomic_t diag_in_handler;	/* !=0 indicates to msg() that in signal handler */
+volatile sig_atomic_t diag_msg_pending;	/* !=0: datagrams from signal handlers may be waiting in diag_sock_recv */
 sig_atomic_t diag_immediate_msg;	/* !=0 prints messages even from within signal handler instead of deferring them */
 sig_atomic_t diag_immediate_exit;	/* !=0 calls exit() from diag_exit() even when in signal handler. For system() */
 
@@ -108,7 +131,56 @@ struct sermsg {
 static int diaginitialized;
 static int diag_sock_send = -1;
 static int diag_sock_recv = -1;
-static int diag_msg_avail = 0;	/* !=0: messages from within signal handler may be waiting */
+
+/* time stamps of messages: without -lu a coarse clock suffices because only
+   seconds are printed; with -lr the monotonic clock measures from diag_start */
+#if HAVE_CLOCK_GETTIME
+#  ifdef CLOCK_REALTIME_COARSE
+static clockid_t diag_clock = CLOCK_REALTIME_COARSE;
+#  else
+static clockid_t diag_clock = CLOCK_REALTIME;
+#  endif
+static struct timespec diag_start;
+#elif HAVE_PROTOTYPE_LIB_gettimeofday
+static struct timeval diag_start;
+#else
+static time_t diag_start;
+#endif
+
+/* the date and time part of the last prefix; msg2() formats it again only
+   when the second changes */
+static time_t diag_cache_epoch = -1;
+static char diag_cache_text[24];
+static size_t diag_cache_len;
+
+#if WITH_DIAG_ASYNC
+/* asynchronous logging (option -la): msg() only stores the time stamp, level
+   and formatted text of a message in a ring; a writer thread adds the prefix
+   and writes the records in batches, so the data loop does not wait for the
+   log file or syslog. The main thread is the only producer and the writer
+   the only consumer; a record that does not fit into the ring is dropped and
+   counted. Messages from signal handlers keep going through diag_sock_send.
+   Messages that exit the program, and changes of the log destination, first
+   wait until the ring is empty. */
+#define DIAG_RING_SLOTS	1024
+
+struct diag_ring {
+   struct diag_dgram slot[DIAG_RING_SLOTS];
+   volatile unsigned int head;	/* next slot to fill; main thread */
+   volatile unsigned int tail;	/* next slot to write; writer thread */
+   volatile unsigned long dropped;	/* records lost because ring was full */
+   unsigned long reported;	/* dropped records already reported; writer */
+   volatile int sleeping;	/* writer waits on cond */
+   volatile int stop;		/* writer shall terminate when ring is empty */
+   bool running;		/* writer thread exists in this process */
+   bool sync;			/* exec() follows, do not start writer again */
+   pthread_t writer;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+} ;
+
+static struct diag_ring *diag_ring;	/* NULL unless option -la */
+#endif /* WITH_DIAG_ASYNC */
 
 
 static int diag_sock_pair(void) {
@@ -144,6 +216,21 @@ static int diag_init(void) {
 }
 #define DIAG_INIT ((void)(diaginitialized || diag_init()))
 
+/* async-signal-safe */
+#if HAVE_CLOCK_GETTIME
+static void diag_gettime(struct timespec *now) {
+   clock_gettime(diag_clock, now);
+}
+#elif HAVE_PROTOTYPE_LIB_gettimeofday
+static void diag_gettime(struct timeval *now) {
+   gettimeofday(now, NULL);
+}
+#else
+static void diag_gettime(time_t *now) {
+   *now = time(NULL);
+}
+#endif
+
 
 void diag_set(char what, const char *arg) {
    switch (what) {
@@ -157,6 +244,7 @@ void diag_set(char what, const char *arg) {
    }
 
    DIAG_INIT;
+   diag_async_stop();	/* the writer must not use the old destination */
    switch (what) {
       const struct wordent *keywd;
 
@@ -192,8 +280,29 @@ void diag_set(char what, const char *arg) {
    case 'p': diagopts.progname = arg;
       openlog(diagopts.progname, LOG_PID, diagopts.logfacility);
       break;
-   case 'd': --diagopts.msglevel; break;
-   case 'u': diagopts.micros = true; break;
+   case 'd': --diag_msglevel; break;
+   case 'u': diagopts.micros = true;
+#if HAVE_CLOCK_GETTIME
+      if (!diagopts.relative)  diag_clock = CLOCK_REALTIME;
+#endif
+      break;
+   case 'r': diagopts.relative = true;
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+      diag_clock = CLOCK_MONOTONIC;
+#elif HAVE_CLOCK_GETTIME
+      diag_clock = CLOCK_REALTIME;
+#endif
+      diag_gettime(&diag_start);
+      break;
+   case 'a':
+#if WITH_DIAG_ASYNC
+      if (diag_async_init() < 0) {
+	 Error("asynchronous logging: out of memory");
+      }
+#else
+      Warn("asynchronous logging (option -la) not available");
+#endif
+      break;
    default: msg(E_ERROR, "unknown diagnostic option %c", what);
    }
 }
@@ -201,10 +310,12 @@ void diag_set(char what, const char *arg) {
 void diag_set_int(char what, int arg) {
    DIAG_INIT;
    switch (what) {
-   case 'D': diagopts.msglevel = arg; break;
+   case 'D': diag_msglevel = arg; break;
    case 'e': diagopts.exitlevel = arg; break;
    case 'x': diagopts.exitstatus = arg; break;
-   case 'h': diagopts.withhostname = arg;
+   case 'h':
+      diag_async_stop();
+      diagopts.withhostname = arg;
       if ((diagopts.hostname = getenv("HOSTNAME")) == NULL) {
 	 struct utsname ubuf;
 	 uname(&ubuf);
@@ -220,7 +331,7 @@ int diag_get_int(char what) {
    switch (what) {
    case 'y': return diagopts.syslog;
    case 's': return diagopts.logfile == stderr;
-   case 'd': case 'D': return diagopts.msglevel;
+   case 'd': case 'D': return diag_msglevel;
    case 'e': return diagopts.exitlevel;
    }
    return -1;
@@ -266,7 +377,7 @@ void msg(int level, const char *format, ...) {
    struct diag_dgram diag_dgram;
    va_list ap;
 
-   /* does not perform a system call if nothing todo, thanks diag_msg_avail */
+   /* does not perform a system call if nothing todo, thanks diag_msg_pending */
 
    diag_dgram._errno = errno;	/* keep for passing from signal handler to sock.
 				   reason is that strerror is definitely not
@@ -275,25 +386,16 @@ void msg(int level, const char *format, ...) {
 
    /* in normal program flow (not in signal handler) */
    /* first flush the queue of datagrams from the socket */
-   if (diag_msg_avail && !diag_in_handler) {
-      diag_msg_avail = 0;	/* _before_ flush to prevent inconsistent state when signal occurs inbetween */
-      diag_flush();
-   }
+   diag_flush_pending();
 
-   if (level < diagopts.msglevel)  { return; }
+   if (level < diag_msglevel)  { return; }
    va_start(ap, format);
 
    /* we do only a minimum in the outer parts which may run in a signal handler
       these are: get actual time, level, serialized message  and write them to socket
    */
    diag_dgram.op = DIAG_OP_MSG;
-#if HAVE_CLOCK_GETTIME
-   clock_gettime(CLOCK_REALTIME, &diag_dgram.now);
-#elif HAVE_PROTOTYPE_LIB_gettimeofday
-   gettimeofday(&diag_dgram.now, NULL);
-#else
-   diag_dgram.now = time(NULL);
-#endif
+   diag_gettime(&diag_dgram.now);
    diag_dgram.level = level;
    diag_dgram.exitcode = diagopts.exitstatus;
    vsnprintf_r(diag_dgram.text, sizeof(diag_dgram.text), format, ap);
@@ -307,12 +409,21 @@ void msg(int level, const char *format, ...) {
 	   |MSG_NOSIGNAL
 #endif
 	   );
-      diag_msg_avail = 1;
+      ++diag_msg_pending;
       va_end(ap);
       return;
    }
 
-   msg2(&diag_dgram.now, diag_dgram.level, diagopts.exitstatus, 0, diag_dgram.text);
+   if (!diag_in_handler && level < diagopts.exitlevel &&
+       diag_async_put(&diag_dgram) == 0) {
+      va_end(ap);
+      return;
+   }
+   if (!diag_in_handler) {
+      diag_async_stop();
+   }
+   msg2(&diag_dgram.now, diag_dgram.level, diagopts.exitstatus, 0, false,
+	diag_dgram.text);
    va_end(ap); return;
 }
 
@@ -327,6 +438,7 @@ void msg2(
 	  int level,		/* E_INFO... */
 	  int exitcode,		/* on exit use this exit code */
 	  int handler,		/* message comes from signal handler */
+	  bool batch,		/* leave flushing the log file to the caller */
 	  const char *text) {
    time_t epoch;
    unsigned long micros;
@@ -336,35 +448,65 @@ void msg2(
 #define MSGLEN 512
    char buff[MSGLEN+2], *bufp = buff, *syslp;
    size_t bytes;
+   int i;
 
 #if HAVE_CLOCK_GETTIME
    epoch = now->tv_sec;
+   micros = now->tv_nsec/1000;
 #elif HAVE_PROTOTYPE_LIB_gettimeofday
    epoch = now->tv_sec;
+   micros = now->tv_usec;
 #else
    epoch = *now;
+   micros = 0;
 #endif
-   /*! consider caching instead of recalculating many times per second */
-#if HAVE_STRFTIME
-   bytes = strftime(bufp, 20, "%Y/%m/%d %H:%M:%S", localtime_r(&epoch, &struct_tm));
-#else
-   bytes = snprintf(bufp, 11, F_time, epoch);
-#endif
-   bufp += bytes;
-   *bufp = '\0';
-   if (diagopts.micros) {
+   if (diagopts.relative) {
+      /* seconds since -lr, always with microseconds */
 #if HAVE_CLOCK_GETTIME
-      micros = now->tv_nsec/1000;
+      epoch -= diag_start.tv_sec;
+      if (micros < diag_start.tv_nsec/1000) {
+	 --epoch;  micros += 1000000;
+      }
+      micros -= diag_start.tv_nsec/1000;
 #elif HAVE_PROTOTYPE_LIB_gettimeofday
-      micros = now->tv_usec;
+      epoch -= diag_start.tv_sec;
+      if (micros < diag_start.tv_usec) {
+	 --epoch;  micros += 1000000;
+      }
+      micros -= diag_start.tv_usec;
 #else
-      micros = 0;
+      epoch -= diag_start;
 #endif
-      bufp += sprintf(bufp, ".%06lu ", micros);
+      bufp += snprintf(bufp, 21, "%6lu", (unsigned long)epoch);
+   } else if (epoch == diag_cache_epoch && !diag_in_handler) {
+      memcpy(bufp, diag_cache_text, diag_cache_len);
+      bufp += diag_cache_len;
    } else {
-      *bufp++ = ' ';
-      *bufp = '\0';
+#if HAVE_STRFTIME
+      bytes = strftime(bufp, 20, "%Y/%m/%d %H:%M:%S", localtime_r(&epoch, &struct_tm));
+#else
+      bytes = snprintf(bufp, 11, F_time, epoch);
+#endif
+      /* a signal handler might interrupt us, or run besides the writer
+	 thread of -la: it must neither use nor update the cache */
+      if (!diag_in_handler) {
+	 diag_cache_epoch = -1;
+	 memcpy(diag_cache_text, bufp, bytes);
+	 diag_cache_len = bytes;
+	 diag_cache_epoch = epoch;
+      }
+      bufp += bytes;
+   }
+   if (diagopts.micros || diagopts.relative) {
+      *bufp++ = '.';
+      for (i = 5; i >= 0; --i) {
+	 bufp[i] = '0' + micros%10;
+	 micros /= 10;
+      }
+      bufp += 6;
    }
+   *bufp++ = ' ';
+   *bufp = '\0';
 
    if (diagopts.withhostname) {
       bytes = snprintf(bufp, MSGLEN-(bufp-buff), "%s ", diagopts.hostname);
@@ -387,35 +529,176 @@ void msg2(
    strncpy(bufp, text, MSGLEN-(bufp-buff));
    bufp = strchr(bufp, '\0');
    strcpy(bufp, "\n");
-   _msg(level, buff, syslp);
+   _msg(level, batch, buff, syslp);
    if (level >= diagopts.exitlevel) {
-      if (E_NOTICE >= diagopts.msglevel) {
+      if (E_NOTICE >= diag_msglevel) {
 	 if ((syslp - buff) + 16 > MSGLEN+1)
 	    syslp = buff + MSGLEN - 15;
 	 snprintf_r(syslp, 16, "N exit(%d)\n", exitcode?exitcode:(diagopts.exitstatus?diagopts.exitstatus:1));
-	 _msg(E_NOTICE, buff, syslp);
+	 _msg(E_NOTICE, batch, buff, syslp);
       }
       exit(exitcode?exitcode:(diagopts.exitstatus?diagopts.exitstatus:1));
    }
 }
 
 
-static void _msg(int level, const char *buff, const char *syslp) {
+static void _msg(int level, bool batch, const char *buff, const char *syslp) {
    if (diagopts.syslog) {
       /* prevent format string attacks (thanks to CoKi) */
       syslog(syslevel[level], "%s", syslp);
    }
    if (diagopts.logfile) {
-      fputs(buff, diagopts.logfile); fflush(diagopts.logfile);
+      fputs(buff, diagopts.logfile);
+      if (!batch)  fflush(diagopts.logfile);
+   }
+}
+
+
+#if WITH_DIAG_ASYNC
+/* reports records that were lost since the last report; in the writer
+   thread */
+static void diag_async_dropped(struct diag_ring *ring) {
+   unsigned long dropped = ring->dropped;
+   char text[64];
+#if HAVE_CLOCK_GETTIME
+   struct timespec now;
+#elif HAVE_PROTOTYPE_LIB_gettimeofday
+   struct timeval now;
+#else
+   time_t now;
+#endif
+
+   if (dropped == ring->reported)  return;
+   diag_gettime(&now);
+   if (E_WARN >= diag_msglevel && E_WARN < diagopts.exitlevel) {
+      snprintf(text, sizeof(text), "%lu log messages dropped, ring was full",
+	       dropped - ring->reported);
+      msg2(&now, E_WARN, 0, 0, true, text);
+   }
+   ring->reported = dropped;
+}
+
+/* the writer thread: formats and writes the records of the ring; flushes
+   the log file only when the ring is empty. Other threads, e.g. a signal
+   handler that writes directly, flush after each message */
+static void *diag_async_writer(void *arg) {
+   struct diag_ring *ring = arg;
+   struct diag_dgram *dgram;
+   unsigned int tail;
+
+   while (true) {
+      tail = ring->tail;
+      if (tail == ring->head) {
+	 diag_async_dropped(ring);
+	 if (diagopts.logfile)  fflush(diagopts.logfile);
+	 if (ring->stop)  break;
+	 pthread_mutex_lock(&ring->mutex);
+	 ring->sleeping = 1;
+	 __sync_synchronize();	/* pairs with the barrier in diag_async_put() */
+	 while (ring->tail == ring->head && !ring->stop) {
+	    pthread_cond_wait(&ring->cond, &ring->mutex);
+	 }
+	 ring->sleeping = 0;
+	 pthread_mutex_unlock(&ring->mutex);
+	 continue;
+      }
+      __sync_synchronize();	/* read the record after head */
+      dgram = &ring->slot[tail % DIAG_RING_SLOTS];
+      msg2(&dgram->now, dgram->level, dgram->exitcode, 0, true, dgram->text);
+      __sync_synchronize();	/* release the slot after reading it */
+      ring->tail = tail + 1;
    }
+   return NULL;
+}
+
+static void diag_async_wakeup(struct diag_ring *ring) {
+   pthread_mutex_lock(&ring->mutex);
+   pthread_cond_signal(&ring->cond);
+   pthread_mutex_unlock(&ring->mutex);
 }
 
+/* stores a message in the ring and starts the writer thread if necessary.
+   returns 0 when the message was stored or dropped, or -1 when it must be
+   written synchronously */
+static int diag_async_put(struct diag_dgram *dgram) {
+   struct diag_ring *ring = diag_ring;
+   unsigned int head;
 
-/* handle the messages in the queue */
+   if (ring == NULL || ring->sync) {
+      return -1;
+   }
+   if (!ring->running) {
+      sigset_t all, old;
+      int result;
+
+      /* signals must interrupt the main thread, so the writer blocks them */
+      sigfillset(&all);
+      pthread_sigmask(SIG_SETMASK, &all, &old);
+      ring->stop = 0;
+      result = pthread_create(&ring->writer, NULL, diag_async_writer, ring);
+      pthread_sigmask(SIG_SETMASK, &old, NULL);
+      if (result != 0) {
+	 return -1;
+      }
+      ring->running = true;
+   }
+   head = ring->head;
+   if (head - ring->tail >= DIAG_RING_SLOTS) {
+      ++ring->dropped;
+      return 0;
+   }
+   memcpy(&ring->slot[head % DIAG_RING_SLOTS], dgram,
+	  sizeof(*dgram) - TEXTLEN + strlen(dgram->text) + 1);
+   __sync_synchronize();	/* the record must be complete before head */
+   ring->head = head + 1;
+   __sync_synchronize();	/* head before sleeping, see writer */
+   if (ring->sleeping) {
+      diag_async_wakeup(ring);
+   }
+   return 0;
+}
+
+/* lets the writer write all records and terminate; the next message starts
+   a new one */
+static void diag_async_stop(void) {
+   struct diag_ring *ring = diag_ring;
+
+   if (ring == NULL || !ring->running) {
+      return;
+   }
+   ring->stop = 1;
+   __sync_synchronize();
+   diag_async_wakeup(ring);
+   pthread_join(ring->writer, NULL);
+   ring->running = false;
+}
+
+static int diag_async_init(void) {
+   if (diag_ring != NULL) {
+      return 0;
+   }
+   if ((diag_ring = calloc(1, sizeof(struct diag_ring))) == NULL) {
+      return -1;
+   }
+   pthread_mutex_init(&diag_ring->mutex, NULL);
+   pthread_cond_init(&diag_ring->cond, NULL);
+   /* the child shall neither inherit records nor a locked log file */
+   pthread_atfork(diag_async_stop, NULL, NULL);
+   atexit(diag_async_stop);
+   return 0;
+}
+#endif /* WITH_DIAG_ASYNC */
+
+
+/* handle the messages in the queue; usually called through
+   diag_flush_pending() */
 void diag_flush(void) {
    struct diag_dgram recv_dgram;
    char exitmsg[20];
 
+   /* _before_ the recv() loop: a signal occurring meanwhile queues another
+      datagram and sets the counter again */
+   diag_msg_pending = 0;
    if (!diagopts.signalsafe) {
       return;
    }
@@ -430,16 +713,11 @@ void diag_flush(void) {
       switch (recv_dgram.op) {
       case DIAG_OP_EXIT:
 	 /* we want the actual time, not when this dgram was sent */
-#if HAVE_CLOCK_GETTIME
-	 clock_gettime(CLOCK_REALTIME, &recv_dgram.now);
-#elif HAVE_PROTOTYPE_LIB_gettimeofday
-	 gettimeofday(&recv_dgram.now, NULL);
-#else
-	 recv_dgram.now = time(NULL);
-#endif
-	 if (E_NOTICE >= diagopts.msglevel) {
+	 diag_gettime(&recv_dgram.now);
+	 diag_async_stop();
+	 if (E_NOTICE >= diag_msglevel) {
 	    snprintf_r(exitmsg, sizeof(exitmsg), "exit(%d)", recv_dgram.exitcode?recv_dgram.exitcode:1);
-	    msg2(&recv_dgram.now, E_NOTICE, recv_dgram.exitcode?recv_dgram.exitcode:1, 1, exitmsg);
+	    msg2(&recv_dgram.now, E_NOTICE, recv_dgram.exitcode?recv_dgram.exitcode:1, 1, false, exitmsg);
 	 }
 	 exit(recv_dgram.exitcode?recv_dgram.exitcode:1);
       case DIAG_OP_MSG:
@@ -449,16 +727,31 @@ void diag_flush(void) {
 	    char text[TEXTLEN];
 	    errno = recv_dgram._errno;
 	    snprinterr(text, TEXTLEN, recv_dgram.text);
-	    msg2(&recv_dgram.now, recv_dgram.level, recv_dgram.exitcode, 1, text);
-	 } else {
-	    msg2(&recv_dgram.now, recv_dgram.level, recv_dgram.exitcode, 1, recv_dgram.text);
+	    strcpy(recv_dgram.text, text);
+	 }
+	 if (recv_dgram.level < diagopts.exitlevel &&
+	     diag_async_put(&recv_dgram) == 0) {
+	    break;
 	 }
+	 diag_async_stop();
+	 msg2(&recv_dgram.now, recv_dgram.level, recv_dgram.exitcode, 1, false, recv_dgram.text);
 	 break;
       }
    }
 }
 
 
+/* writes the queued messages and turns off asynchronous logging for this
+   process; call it before exec() */
+void diag_sync(void) {
+#if WITH_DIAG_ASYNC
+   if (diag_ring != NULL) {
+      diag_async_stop();
+      diag_ring->sync = true;
+   }
+#endif
+}
+
 /* use a new log output file descriptor that is dup'ed from the current one.
    this is useful when socat logs to stderr but fd 2 should be redirected to
    serve other purposes */
@@ -466,6 +759,7 @@ int diag_dup(void) {
    int newfd;
 
    DIAG_INIT;
+   diag_sync();	/* usually exec() follows */
    if (diagopts.logfile == NULL) {
       return -1;
    }
@@ -497,6 +791,7 @@ void diag_exit(int status) {
 	   |MSG_NOSIGNAL
 #endif
 	   );
+      ++diag_msg_pending;
       return;
    }
    _diag_exit(status);
@@ -141,26 +141,28 @@
 #define Info11(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11)
 #endif /* !(WITH_MSGLEVEL <= E_INFO) */
 
+/* debug messages test the level inline, so that the many Debug calls, e.g. in
+   the system call wrappers, cost only one branch when debugging is off */
 #if WITH_MSGLEVEL <= E_DEBUG
-#define Debug(m) msg(E_DEBUG,"%s",m)
-#define Debug1(m,a1) msg(E_DEBUG,m,a1)
-#define Debug2(m,a1,a2) msg(E_DEBUG,m,a1,a2)
-#define Debug3(m,a1,a2,a3) msg(E_DEBUG,m,a1,a2,a3)
-#define Debug4(m,a1,a2,a3,a4) msg(E_DEBUG,m,a1,a2,a3,a4)
-#define Debug5(m,a1,a2,a3,a4,a5) msg(E_DEBUG,m,a1,a2,a3,a4,a5)
-#define Debug6(m,a1,a2,a3,a4,a5,a6) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6)
-#define Debug7(m,a1,a2,a3,a4,a5,a6,a7) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7)
-#define Debug8(m,a1,a2,a3,a4,a5,a6,a7,a8) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8)
-#define Debug9(m,a1,a2,a3,a4,a5,a6,a7,a8,a9) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9)
-#define Debug10(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10)
-#define Debug11(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11)
-#define Debug12(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12)
-#define Debug13(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13)
-#define Debug14(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14)
-#define Debug15(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15)
-#define Debug16(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16)
-#define Debug17(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17)
-#define Debug18(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17,a18) msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17,a18)
+#define Debug(m) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,"%s",m))
+#define Debug1(m,a1) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1))
+#define Debug2(m,a1,a2) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2))
+#define Debug3(m,a1,a2,a3) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3))
+#define Debug4(m,a1,a2,a3,a4) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4))
+#define Debug5(m,a1,a2,a3,a4,a5) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5))
+#define Debug6(m,a1,a2,a3,a4,a5,a6) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6))
+#define Debug7(m,a1,a2,a3,a4,a5,a6,a7) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7))
+#define Debug8(m,a1,a2,a3,a4,a5,a6,a7,a8) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8))
+#define Debug9(m,a1,a2,a3,a4,a5,a6,a7,a8,a9) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9))
+#define Debug10(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10))
+#define Debug11(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11))
+#define Debug12(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12))
+#define Debug13(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13))
+#define Debug14(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14))
+#define Debug15(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15))
+#define Debug16(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16))
+#define Debug17(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17))
+#define Debug18(m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17,a18) (diag_msglevel > E_DEBUG ? (void)0 : msg(E_DEBUG,m,a1,a2,a3,a4,a5,a6,a7,a8,a9,a10,a11,a12,a13,a14,a15,a16,a17,a18))
 #else /* !(WITH_MSGLEVEL <= E_DEBUG) */
 #define Debug(m)
 #define Debug1(m,a1)
@@ -229,9 +231,20 @@ struct diag_dgram {
 } ;
 
 extern sig_atomic_t diag_in_handler;
+extern volatile sig_atomic_t diag_msg_pending;
+extern int diag_msglevel;
 extern sig_atomic_t diag_immediate_msg;
 extern sig_atomic_t diag_immediate_exit;
 
+/* true when messages of this level are printed; allows to skip expensive
+   preparation of message arguments */
+#define diag_level(l) (WITH_MSGLEVEL <= (l) && diag_msglevel <= (l))
+
+/* processes messages that signal handlers queued; only tests a counter when
+   there are none */
+#define diag_flush_pending() \
+   do { if (diag_msg_pending && !diag_in_handler)  diag_flush(); } while (0)
+
 extern void diag_set(char what, const char *arg);
 extern void diag_set_int(char what, int arg);
 extern int diag_get_int(char what);
@@ -240,6 +253,7 @@ extern int diag_reserve_fd(int fd);
 extern int diag_fork(void);
 extern int diag_dup(void);
 extern int diag_dup2(int newfd);
+extern void diag_sync(void);
 extern void msg(int level, const char *format, ...);
 extern void diag_flush(void);
 extern void diag_exit(int status);
@@ -0,0 +1,351 @@
+/* source: proxy-stub.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* stub servers for benchmarks: accepts the SOCKS4/SOCKS4a, SOCKS5 or HTTP
+   CONNECT request of a client, answers with success whatever the target is,
+   and then echoes the data, like socks4echo.sh and proxyecho.sh do for
+   test.sh. One process serves all connections with poll() instead of a
+   script per connection, so the stub does not limit the connection rate
+   of socat-cps; socat-bench uses it for its socks5 transport.
+   Modes:
+      echo     no handshake, just echo
+      socks4   SOCKS4 and SOCKS4a CONNECT; reply 90 (granted)
+      socks5   SOCKS5 CONNECT with method "no authentication" or
+	       username/password (any credentials); reply 0 (succeeded)
+      connect  HTTP CONNECT; reply "HTTP/1.0 200 OK"
+   Requests of other versions or commands get a failure reply and the
+   connection is closed.
+   usage: ./proxy-stub [-b address] [-v] echo|socks4|socks5|connect port */
+
+#include "config.h"
+#include "xioconfig.h"
+#include "sysincludes.h"
+
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+
+
+#define STUB_MAXCONNS 4096
+#define STUB_BUFLEN 65536	/* holds any request, and the echoed data */
+
+enum stub_mode {
+   STUB_ECHO, STUB_SOCKS4, STUB_SOCKS5, STUB_CONNECT, STUB_MODES
+} ;
+
+static const char *stub_modes[STUB_MODES] = {
+   "echo", "socks4", "socks5", "connect"
+} ;
+
+/* the steps of a connection */
+enum stub_state {
+   STUB_REQUEST,	/* SOCKS4 request, SOCKS5 method selection, or HTTP */
+   STUB_SOCKS5_AUTH,	/* SOCKS5 username/password */
+   STUB_SOCKS5_REQUEST,
+   STUB_ECHOING
+} ;
+
+struct stub_conn {
+   enum stub_state state;
+   size_t have;		/* bytes in buff */
+   size_t off;		/* bytes of buff already written (STUB_ECHOING) */
+   unsigned char buff[STUB_BUFLEN];
+} ;
+
+static bool stub_verbose = false;
+
+
+/* looks for a complete request of mode in c->buff. returns the length of
+   the request, puts the reply into reply and advances c->state; or returns
+   0 when the request is incomplete, or -1 when it is invalid (then reply is
+   a failure reply, or empty) */
+static ssize_t stub_request(enum stub_mode mode, struct stub_conn *c,
+			    unsigned char *reply, size_t *replylen) {
+   unsigned char *b = c->buff, *nul;
+   size_t len;
+
+   *replylen = 0;
+   switch (c->state) {
+   case STUB_REQUEST:
+      if (mode == STUB_SOCKS4) {
+	 /* VN CD DSTPORT DSTIP USERID\0 [HOSTNAME\0] */
+	 static const unsigned char granted[8] = { 0, 90 };
+	 static const unsigned char rejected[8] = { 0, 91 };
+	 if (c->have < 9)  return 0;
+	 if (b[0] != 4 || b[1] != 1) {
+	    memcpy(reply, rejected, *replylen = sizeof(rejected));
+	    return -1;
+	 }
+	 if ((nul = memchr(b+8, '\0', c->have-8)) == NULL)  return 0;
+	 len = nul+1 - b;
+	 if (b[4] == 0 && b[5] == 0 && b[6] == 0 && b[7] != 0) {
+	    /* SOCKS4a: the host name follows */
+	    if ((nul = memchr(b+len, '\0', c->have-len)) == NULL)  return 0;
+	    len = nul+1 - b;
+	 }
+	 memcpy(reply, granted, *replylen = sizeof(granted));
+	 c->state = STUB_ECHOING;
+	 return len;
+      }
+      if (mode == STUB_SOCKS5) {
+	 /* VER NMETHODS METHODS */
+	 if (c->have < 2)  return 0;
+	 if (b[0] != 5) {
+	    return -1;
+	 }
+	 if (c->have < 2u+b[1])  return 0;
+	 reply[0] = 5;
+	 *replylen = 2;
+	 if (memchr(b+2, 0, b[1])) {
+	    reply[1] = 0;
+	    c->state = STUB_SOCKS5_REQUEST;
+	 } else if (memchr(b+2, 2, b[1])) {
+	    reply[1] = 2;
+	    c->state = STUB_SOCKS5_AUTH;
+	 } else {
+	    reply[1] = 0xff;
+	    return -1;
+	 }
+	 return 2+b[1];
+      }
+      /* HTTP CONNECT: request line and headers up to an empty line */
+      for (len = 1; len < c->have; ++len) {
+	 if (b[len] == '\n' &&
+	     (b[len-1] == '\n' || (len >= 2 && b[len-1] == '\r' &&
+				   b[len-2] == '\n'))) {
+	    break;
+	 }
+      }
+      if (len >= c->have)  return 0;
+      if (c->have < 8 || memcmp(b, "CONNECT ", 8)) {
+	 static const char bad[] = "HTTP/1.0 500 Bad Request\r\n\r\n";
+	 memcpy(reply, bad, *replylen = sizeof(bad)-1);
+	 return -1;
+      } else {
+	 static const char ok[] = "HTTP/1.0 200 OK\r\n\r\n";
+	 memcpy(reply, ok, *replylen = sizeof(ok)-1);
+	 c->state = STUB_ECHOING;
+      }
+      return len+1;
+
+   case STUB_SOCKS5_AUTH:
+      /* VER ULEN UNAME PLEN PASSWD */
+      if (c->have < 2 || c->have < 3u+b[1] || c->have < 3u+b[1]+b[2+b[1]]) {
+	 return 0;
+      }
+      reply[0] = 1;  reply[1] = 0;
+      *replylen = 2;
+      c->state = STUB_SOCKS5_REQUEST;
+      return 3+b[1]+b[2+b[1]];
+
+   case STUB_SOCKS5_REQUEST: {
+      /* VER CMD RSV ATYP DST.ADDR DST.PORT */
+      static const unsigned char succeeded[10] = { 5, 0, 0, 1 };
+      static const unsigned char unsupported[10] = { 5, 7, 0, 1 };
+      if (c->have < 5)  return 0;
+      switch (b[3]) {
+      case 1: len = 4+4+2; break;
+      case 3: len = 4+1+b[4]+2; break;
+      case 4: len = 4+16+2; break;
+      default: len = 0;
+      }
+      if (b[0] != 5 || b[1] != 1 || len == 0) {
+	 memcpy(reply, unsupported, *replylen = sizeof(unsupported));
+	 return -1;
+      }
+      if (c->have < len)  return 0;
+      memcpy(reply, succeeded, *replylen = sizeof(succeeded));
+      c->state = STUB_ECHOING;
+      return len;
+   }
+   default:
+      return -1;
+   }
+}
+
+/* handles input on a connection; returns 0 when it remains open, or -1 when
+   it should be closed */
+static int stub_input(enum stub_mode mode, int fd, struct stub_conn *c) {
+   unsigned char reply[32];
+   size_t replylen;
+   ssize_t n, len;
+
+   if ((n = read(fd, c->buff+c->have, sizeof(c->buff)-c->have)) < 0) {
+      if (errno == EAGAIN || errno == EINTR)  return 0;
+      if (stub_verbose)  Warn2("read(%d): %s", fd, strerror(errno));
+      return -1;
+   }
+   if (n == 0)  return -1;
+   c->have += n;
+   while (c->state != STUB_ECHOING) {
+      if ((len = stub_request(mode, c, reply, &replylen)) == 0) {
+	 if (c->have == sizeof(c->buff)) {
+	    if (stub_verbose)  Warn1("fd %d: request too long", fd);
+	    return -1;
+	 }
+	 return 0;
+      }
+      if (len < 0 && replylen == 0)  return -1;
+      /* the replies are short, and the client waits for them */
+      if (write(fd, reply, replylen) != (ssize_t)replylen) {
+	 return -1;
+      }
+      if (len < 0) {
+	 if (stub_verbose)  Notice1("fd %d: request rejected", fd);
+	 return -1;
+      }
+      /* data that the client sent right after the request is echoed */
+      memmove(c->buff, c->buff+len, c->have-len);
+      c->have -= len;
+   }
+   c->off = 0;
+   return 0;
+}
+
+/* echoes what is in the buffer; returns 0, or -1 on error */
+static int stub_output(int fd, struct stub_conn *c) {
+   ssize_t n;
+
+   if ((n = write(fd, c->buff+c->off, c->have-c->off)) < 0) {
+      if (errno == EAGAIN || errno == EINTR)  return 0;
+      return -1;
+   }
+   c->off += n;
+   if (c->off == c->have) {
+      c->have = c->off = 0;
+   }
+   return 0;
+}
+
+static int stub_listen(const char *addr, int port) {
+   struct sockaddr_in sa;
+   int fd, one = 1;
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sin_family = AF_INET;
+   sa.sin_port = htons(port);
+   if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+      Error1("\"%s\": not an IPv4 address", addr);
+      return -1;
+   }
+   if ((fd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+      Error1("socket(): %s", strerror(errno));
+      return -1;
+   }
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+   if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+      Error4("bind(%d, %s:%d): %s", fd, addr, port, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   if (listen(fd, 1024) < 0) {
+      Error2("listen(%d): %s", fd, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   fcntl(fd, F_SETFL, O_NONBLOCK);
+   return fd;
+}
+
+static const char *stub_usage =
+   "usage: proxy-stub [-b address] [-v] echo|socks4|socks5|connect port";
+
+int main(int argc, const char *argv[]) {
+   static struct pollfd pfd[1+STUB_MAXCONNS];
+   static struct stub_conn *conn[1+STUB_MAXCONNS];
+   const char *addr = "127.0.0.1";
+   enum stub_mode mode;
+   int lfd, fd, nfds = 1, i, rc;
+
+   diag_set('p', strchr(argv[0], '/') ? strrchr(argv[0], '/')+1 : argv[0]);
+   while (argc > 1 && argv[1][0] == '-') {
+      switch (argv[1][1]) {
+      case 'b':
+	 if (argc < 3) {
+	    Error1("option %s requires an argument", argv[1]);
+	    exit(1);
+	 }
+	 addr = argv[2];
+	 argv += 2, argc -= 2;
+	 continue;
+      case 'v': stub_verbose = true; break;
+      case 'h': puts(stub_usage); exit(0);
+      default:
+	 Error2("unknown option \"%s\"; %s", argv[1], stub_usage);
+	 exit(1);
+      }
+      ++argv, --argc;
+   }
+   if (argc != 3) {
+      Error1("%s", stub_usage);
+      exit(1);
+   }
+   for (mode = 0; mode < STUB_MODES; ++mode) {
+      if (!strcmp(argv[1], stub_modes[mode]))  break;
+   }
+   if (mode == STUB_MODES) {
+      Error2("unknown mode \"%s\"; %s", argv[1], stub_usage);
+      exit(1);
+   }
+   if ((lfd = stub_listen(addr, strtoul(argv[2], NULL, 0))) < 0) {
+      exit(1);
+   }
+   signal(SIGPIPE, SIG_IGN);
+   pfd[0].fd = lfd;
+   pfd[0].events = POLLIN;
+
+   while (true) {
+      /* no new connections while the table is full */
+      pfd[0].fd = (nfds < 1+STUB_MAXCONNS) ? lfd : -1;
+      if (poll(pfd, nfds, -1) < 0) {
+	 if (errno == EINTR)  continue;
+	 Error1("poll(): %s", strerror(errno));
+	 exit(1);
+      }
+      for (i = nfds-1; i >= 1; --i) {
+	 if (pfd[i].revents == 0)  continue;
+	 if (pfd[i].revents & POLLOUT) {
+	    rc = stub_output(pfd[i].fd, conn[i]);
+	 } else {
+	    rc = stub_input(mode, pfd[i].fd, conn[i]);
+	 }
+	 if (rc == 0 && conn[i]->state == STUB_ECHOING && conn[i]->have) {
+	    /* echo right away; poll only when the peer does not read */
+	    rc = stub_output(pfd[i].fd, conn[i]);
+	 }
+	 if (rc < 0) {
+	    close(pfd[i].fd);
+	    free(conn[i]);
+	    /* the last entry was handled already and takes this place */
+	    --nfds;
+	    pfd[i] = pfd[nfds];
+	    conn[i] = conn[nfds];
+	    continue;
+	 }
+	 pfd[i].events =
+	    (conn[i]->state == STUB_ECHOING && conn[i]->have) ? POLLOUT : POLLIN;
+      }
+      if (!(pfd[0].revents & POLLIN))  continue;
+      while (nfds < 1+STUB_MAXCONNS) {
+	 if ((fd = accept(lfd, NULL, NULL)) < 0) {
+	    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+		errno != ECONNABORTED) {
+	       Warn2("accept(%d): %s", lfd, strerror(errno));
+	    }
+	    break;
+	 }
+	 fcntl(fd, F_SETFL, O_NONBLOCK);
+	 if ((conn[nfds] = calloc(1, sizeof(struct stub_conn))) == NULL) {
+	    Error("out of memory");
+	    close(fd);
+	    break;
+	 }
+	 conn[nfds]->state = (mode == STUB_ECHO) ? STUB_ECHOING : STUB_REQUEST;
+	 pfd[nfds].fd = fd;
+	 pfd[nfds].events = POLLIN;
+	 pfd[nfds].revents = 0;
+	 ++nfds;
+      }
+   }
+}
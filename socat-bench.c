@@ -0,0 +1,666 @@
+/* source: socat-bench.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* throughput benchmark of socat: for each transport and each buffer size
+   (option -b of socat) it starts socat between a local source and a local
+   sink, moves data through it, and reports MB/s, the CPU time of the socat
+   processes per GB, and percentiles of the chunk latency.
+   Transports:
+      tcp      TCP4-LISTEN to TCP4 on loopback
+      unix     UNIX-LISTEN to UNIX-CONNECT
+      pipe     STDIN to STDOUT with -u, both pipes
+      udp      UDP4-RECV to UDP4-SENDTO with -u, chunks are datagrams
+      openssl  two socat processes: TCP4-LISTEN to OPENSSL, OPENSSL-LISTEN
+	       with the test certificate testsrv.pem to TCP4
+      socks5   TCP4-LISTEN to SOCKS5 with proxy-stub as server; the stub
+	       echoes the data, so it passes socat in both directions and the
+	       sink reads it from the connection of the source
+   Workloads:
+      fixed    a fixed amount of data, then EOF
+      stream   as much data as possible for some seconds, then EOF
+   The source writes chunks that begin with their CLOCK_MONOTONIC send time;
+   the sink takes the latency of a chunk when its last byte arrived. Under
+   full load this includes the time a chunk waited in the socket buffers.
+   One line per run goes to stdout, with -j as JSON object (JSON lines) for
+   comparing builds over time.
+   usage: ./socat-bench [-s socat] [-t transports] [-b sizes] [-w workloads]
+			[-n bytes] [-T seconds] [-c chunk] [-e pemfile]
+			[-x proxy-stub] [-p port] [-j] [-v] */
+
+#include "config.h"
+#include "xioconfig.h"
+#include "sysincludes.h"
+#include <sys/resource.h>	/* wait4() */
+
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+#include "utils.h"
+#include "sycls.h"
+#include "benchutils.h"
+
+
+#define BENCH_MAXSIZES 16
+#define BENCH_HDRLEN 8		/* the send time in the chunks */
+#define BENCH_RDSIZE 262144	/* read buffer of the sink */
+
+enum bench_transport {
+   BENCH_TCP, BENCH_UNIX, BENCH_PIPE, BENCH_UDP, BENCH_OPENSSL, BENCH_SOCKS5,
+   BENCH_TRANSPORTS
+} ;
+
+static const char *bench_transports[BENCH_TRANSPORTS] = {
+   "tcp", "unix", "pipe", "udp", "openssl", "socks5"
+} ;
+
+/* what the source reports to the sink process when it is done */
+struct bench_sent {
+   unsigned long long start;	/* ns, CLOCK_MONOTONIC */
+   unsigned long long bytes;
+} ;
+
+/* one run */
+struct bench_run {
+   int transport;
+   bool stream;
+   size_t bufsiz;
+   size_t chunk;
+   /* results */
+   unsigned long long sent;
+   unsigned long long bytes;
+   unsigned long long chunks;
+   double seconds;
+   double cpu;
+   struct xiohist hist;		/* chunk latency */
+} ;
+
+static struct {
+   const char *socat;
+   const char *pemfile;
+   const char *stub;
+   unsigned long long total;	/* bytes of workload fixed */
+   double seconds;		/* duration of workload stream */
+   size_t chunk;
+   int port;
+   bool json;
+   bool verbose;
+   char dir[64];		/* for the UNIX sockets */
+} bench = {
+   "./socat", "testsrv.pem", "./proxy-stub", 64ULL<<20, 2.0, 8192, 47200,
+   false, false, ""
+} ;
+
+
+static void bench_sockaddr_in(struct sockaddr_in *sa, int port) {
+   memset(sa, 0, sizeof(*sa));
+   sa->sin_family = AF_INET;
+   sa->sin_port = htons(port);
+   sa->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static void bench_sockaddr_un(struct sockaddr_un *sa, const char *name) {
+   memset(sa, 0, sizeof(*sa));
+   sa->sun_family = AF_UNIX;
+   snprintf(sa->sun_path, sizeof(sa->sun_path), "%s/%s", bench.dir, name);
+}
+
+/* the listening socket of the sink */
+static int bench_listen(int transport, int port) {
+   union {
+      struct sockaddr sa;
+      struct sockaddr_in in;
+      struct sockaddr_un un;
+   } sa;
+   socklen_t salen;
+   int fd, one = 1;
+
+   if (transport == BENCH_UNIX) {
+      bench_sockaddr_un(&sa.un, "sink");
+      unlink(sa.un.sun_path);
+      salen = sizeof(sa.un);
+      fd = socket(PF_UNIX, SOCK_STREAM, 0);
+   } else {
+      bench_sockaddr_in(&sa.in, port);
+      salen = sizeof(sa.in);
+      fd = socket(PF_INET,
+		  transport == BENCH_UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+   }
+   if (fd < 0) {
+      Error1("socket(): %s", strerror(errno));
+      return -1;
+   }
+   fcntl(fd, F_SETFD, FD_CLOEXEC);
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+   if (bind(fd, &sa.sa, salen) < 0) {
+      Error2("bind(%d): %s", fd, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   if (transport != BENCH_UDP && listen(fd, 4) < 0) {
+      Error2("listen(%d): %s", fd, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   return fd;
+}
+
+/* connects the source to socat, or to proxy-stub, retrying while it starts
+   up. returns the socket, or -1 */
+static int bench_connect(int transport, int port) {
+   union {
+      struct sockaddr sa;
+      struct sockaddr_in in;
+      struct sockaddr_un un;
+   } sa;
+   socklen_t salen;
+   unsigned long long until = bench_now() + 5000000000ULL;
+   int fd;
+
+   if (transport == BENCH_UNIX) {
+      bench_sockaddr_un(&sa.un, "source");
+      salen = sizeof(sa.un);
+   } else {
+      bench_sockaddr_in(&sa.in, port);
+      salen = sizeof(sa.in);
+   }
+   do {
+      fd = socket(transport == BENCH_UNIX ? PF_UNIX : PF_INET,
+		  transport == BENCH_UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+      if (fd < 0)  return -1;
+      if (transport == BENCH_UDP) {
+	 /* without socat the probe byte comes back as ICMP port unreachable;
+	    the sink ignores datagrams shorter than a header */
+	 int err = 0;
+	 socklen_t errlen = sizeof(err);
+	 if (connect(fd, &sa.sa, salen) == 0 && send(fd, "", 1, 0) == 1) {
+	    usleep(20000);
+	    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == 0 &&
+		err == 0) {
+	       return fd;
+	    }
+	 }
+      } else if (connect(fd, &sa.sa, salen) == 0) {
+	 return fd;
+      }
+      close(fd);
+      usleep(10000);
+   } while (bench_now() < until);
+   return -1;
+}
+
+/* the source process: writes chunks with their send time to fd, and reports
+   its start time and the bytes written on pipe report */
+static void bench_source(struct bench_run *run, int fd, int report) {
+   struct bench_sent sent;
+   unsigned long long until = 0, ts;
+   char *buff;
+   size_t writt;
+   ssize_t n;
+
+   if ((buff = malloc(run->chunk)) == NULL)  _exit(1);
+   memset(buff, 'x', run->chunk);
+   sent.start = bench_now();
+   sent.bytes = 0;
+   if (run->stream) {
+      until = sent.start + (unsigned long long)(bench.seconds * 1e9);
+   }
+   while (run->stream ? bench_now() < until : sent.bytes < bench.total) {
+      ts = bench_now();
+      memcpy(buff, &ts, BENCH_HDRLEN);
+      if (run->transport == BENCH_UDP) {
+	 /* drops are counted by the sink */
+	 if (send(fd, buff, run->chunk, 0) < 0 && errno != ENOBUFS &&
+	     errno != ECONNREFUSED && errno != EINTR) {
+	    break;
+	 }
+	 sent.bytes += run->chunk;
+	 continue;
+      }
+      for (writt = 0; writt < run->chunk; writt += n) {
+	 if ((n = write(fd, buff+writt, run->chunk-writt)) < 0) {
+	    if (errno == EINTR) { n = 0; continue; }
+	    _exit(1);
+	 }
+      }
+      sent.bytes += run->chunk;
+   }
+   /* with socks5 the sink still reads from this connection */
+   if (run->transport == BENCH_SOCKS5)  shutdown(fd, SHUT_WR);
+   close(fd);
+   if (write(report, &sent, sizeof(sent)) < 0)  _exit(1);
+   _exit(0);
+}
+
+/* the sink: reads until EOF (UDP: until the source is done and nothing came
+   for 200ms), and records the latency of each complete chunk */
+static void bench_sink(struct bench_run *run, int fd, pid_t source,
+		       unsigned long long *last) {
+   unsigned char *buff, hdr[BENCH_HDRLEN];
+   unsigned long long ts, now;
+   struct pollfd pfd;
+   size_t pos = 0, take;
+   bool sourcedone = false;
+   ssize_t n;
+   unsigned char *p;
+
+   if ((buff = malloc(BENCH_RDSIZE)) == NULL)  return;
+   pfd.fd = fd;
+   pfd.events = POLLIN;
+   while (true) {
+      if (run->transport == BENCH_UDP) {
+	 if (poll(&pfd, 1, 200) == 0) {
+	    if (sourcedone)  break;
+	    sourcedone = (waitpid(source, NULL, WNOHANG) == source);
+	    continue;
+	 }
+      }
+      if ((n = read(fd, buff, BENCH_RDSIZE)) < 0) {
+	 if (errno == EINTR)  continue;
+	 break;
+      }
+      if (n == 0)  break;
+      now = bench_now();
+      if (run->transport == BENCH_UDP) {
+	 if (n >= BENCH_HDRLEN) {
+	    *last = now;
+	    run->bytes += n;
+	    memcpy(&ts, buff, BENCH_HDRLEN);
+	    xiohist_add(&run->hist, now - ts);
+	    ++run->chunks;
+	 }
+	 continue;
+      }
+      *last = now;
+      run->bytes += n;
+      /* the stream is cut into chunks again */
+      for (p = buff; n > 0; p += take, n -= take) {
+	 if (pos < BENCH_HDRLEN) {
+	    take = MIN((size_t)n, BENCH_HDRLEN-pos);
+	    memcpy(hdr+pos, p, take);
+	 } else {
+	    take = MIN((size_t)n, run->chunk-pos);
+	 }
+	 pos += take;
+	 if (pos == run->chunk) {
+	    memcpy(&ts, hdr, BENCH_HDRLEN);
+	    xiohist_add(&run->hist, now - ts);
+	    ++run->chunks;
+	    pos = 0;
+	 }
+      }
+   }
+   free(buff);
+}
+
+/* waits for a socat process that should terminate by itself, kills it when
+   it does not, and adds its CPU time to run */
+static void bench_reap(struct bench_run *run, pid_t pid) {
+   struct rusage ru;
+   pid_t got = 0;
+   int i, status;
+
+   for (i = 0; i < 100; ++i) {
+      if ((got = wait4(pid, &status, WNOHANG, &ru)) != 0)  break;
+      if (i == 99) {
+	 kill(pid, SIGTERM);
+	 do {
+	    got = wait4(pid, &status, 0, &ru);
+	 } while (got < 0 && errno == EINTR);
+	 break;
+      }
+      usleep(10000);
+   }
+   if (got != pid) {
+      Warn2("wait4("F_pid"): %s", pid,
+	    got < 0 ? strerror(errno) : "still running");
+      return;
+   }
+   run->cpu += ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+      ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/* performs one run; returns 0 on success, or -1 */
+static int bench_run(struct bench_run *run) {
+   char bufsiz[24], addr[2][2][256], sink[128], source[128], stubport[12];
+   const char *args[2][12], *stubargs[3];
+   int port = bench.port, lfd, fd = -1, sfd = -1, report[2], srcpipe[2],
+      snkpipe[2];
+   pid_t socat[2] = { -1, -1 }, stub = -1, src;
+   struct bench_sent sent;
+   struct pollfd pfd;
+   unsigned long long last = 0;
+   int i, n = 0;
+
+   snprintf(bufsiz, sizeof(bufsiz), F_Zu, run->bufsiz);
+   for (i = 0; i < 2; ++i) {
+      args[i][0] = "-b";  args[i][1] = bufsiz;
+   }
+   srcpipe[0] = srcpipe[1] = snkpipe[0] = snkpipe[1] = -1;
+   lfd = -1;
+   /* socat must not inherit the other ends, or it would not see EOF */
+   if (run->transport == BENCH_PIPE) {
+      if (pipe2(srcpipe, O_CLOEXEC) < 0 || pipe2(snkpipe, O_CLOEXEC) < 0) {
+	 Error1("pipe2(): %s", strerror(errno));
+	 return -1;
+      }
+   } else if (run->transport == BENCH_SOCKS5) {
+      /* proxy-stub takes the place of the sink */
+      snprintf(stubport, sizeof(stubport), "%d", port+1);
+      stubargs[0] = "socks5";  stubargs[1] = stubport;  stubargs[2] = NULL;
+      if ((stub = bench_spawn(bench.stub, stubargs, -1, -1, !bench.verbose)) < 0) {
+	 return -1;
+      }
+      if ((sfd = bench_connect(BENCH_TCP, port+1)) < 0) {
+	 Error1("%s: proxy-stub does not accept connections", bench.stub);
+	 kill(stub, SIGTERM);
+	 waitpid(stub, NULL, 0);
+	 return -1;
+      }
+      close(sfd);
+      sfd = -1;
+   } else if ((lfd = bench_listen(run->transport, port+1)) < 0) {
+      return -1;
+   }
+
+   snprintf(sink, sizeof(sink), "%s/sink", bench.dir);
+   snprintf(source, sizeof(source), "%s/source", bench.dir);
+   n = 2;
+   switch (run->transport) {
+   case BENCH_TCP:
+      snprintf(addr[0][0], 256, "TCP4-LISTEN:%d,reuseaddr", port);
+      snprintf(addr[0][1], 256, "TCP4:127.0.0.1:%d", port+1);
+      break;
+   case BENCH_UNIX:
+      unlink(source);
+      snprintf(addr[0][0], 256, "UNIX-LISTEN:%s", source);
+      snprintf(addr[0][1], 256, "UNIX-CONNECT:%s", sink);
+      break;
+   case BENCH_PIPE:
+      args[0][n++] = "-u";
+      strcpy(addr[0][0], "STDIN");
+      strcpy(addr[0][1], "STDOUT");
+      break;
+   case BENCH_UDP:
+      args[0][n++] = "-u";
+      snprintf(addr[0][0], 256, "UDP4-RECV:%d,reuseaddr", port);
+      snprintf(addr[0][1], 256, "UDP4-SENDTO:127.0.0.1:%d", port+1);
+      break;
+   case BENCH_OPENSSL:
+      snprintf(addr[0][0], 256, "TCP4-LISTEN:%d,reuseaddr", port);
+      snprintf(addr[0][1], 256, "OPENSSL:127.0.0.1:%d,verify=0", port+2);
+      snprintf(addr[1][0], 256,
+	       "OPENSSL-LISTEN:%d,reuseaddr,cert=%s,verify=0",
+	       port+2, bench.pemfile);
+      snprintf(addr[1][1], 256, "TCP4:127.0.0.1:%d", port+1);
+      args[1][2] = addr[1][0];  args[1][3] = addr[1][1];  args[1][4] = NULL;
+      break;
+   case BENCH_SOCKS5:
+      snprintf(addr[0][0], 256, "TCP4-LISTEN:%d,reuseaddr", port);
+      snprintf(addr[0][1], 256, "SOCKS5:127.0.0.1:bench:80,socks5port=%d",
+	       port+1);
+      break;
+   }
+   args[0][n] = addr[0][0];  args[0][n+1] = addr[0][1];  args[0][n+2] = NULL;
+
+   if (run->transport == BENCH_OPENSSL &&
+       (socat[1] = bench_spawn(bench.socat, args[1], -1, -1, !bench.verbose)) < 0) {
+      return -1;
+   }
+   if ((socat[0] = bench_spawn(bench.socat, args[0], srcpipe[0], snkpipe[1],
+				!bench.verbose))
+       < 0) {
+      return -1;
+   }
+   if (srcpipe[0] >= 0)  close(srcpipe[0]);
+   if (snkpipe[1] >= 0)  close(snkpipe[1]);
+
+   /* the echo of proxy-stub comes back on the connection of the source */
+   if (run->transport == BENCH_SOCKS5 &&
+       (sfd = bench_connect(run->transport, port)) < 0) {
+      Error1("%s: no connection to socat", bench_transports[run->transport]);
+   }
+   if (pipe(report) < 0) {
+      Error1("pipe(): %s", strerror(errno));
+      return -1;
+   }
+   if ((src = fork()) < 0) {
+      Error1("fork(): %s", strerror(errno));
+      return -1;
+   }
+   if (src == 0) {
+      close(report[0]);
+      if (lfd >= 0)  close(lfd);
+      if (snkpipe[0] >= 0)  close(snkpipe[0]);
+      if (run->transport == BENCH_PIPE) {
+	 sfd = srcpipe[1];
+      } else if (run->transport != BENCH_SOCKS5) {
+	 sfd = bench_connect(run->transport, port);
+      }
+      if (sfd < 0)  _exit(1);
+      bench_source(run, sfd, report[1]);
+   }
+   close(report[1]);
+   if (srcpipe[1] >= 0)  close(srcpipe[1]);
+
+   switch (run->transport) {
+   case BENCH_PIPE:
+      fd = snkpipe[0];
+      break;
+   case BENCH_UDP:
+      fd = lfd;  lfd = -1;
+      break;
+   case BENCH_SOCKS5:
+      fd = sfd;
+      break;
+   default:
+      /* socat might fail, e.g. with an option of another version */
+      pfd.fd = lfd;
+      pfd.events = POLLIN;
+      if (poll(&pfd, 1, 10000) <= 0 ||
+	  (fd = accept(lfd, NULL, NULL)) < 0) {
+	 Error1("%s: socat did not connect to the sink",
+		bench_transports[run->transport]);
+	 break;
+      }
+   }
+   if (fd >= 0) {
+      bench_sink(run, fd, src, &last);
+      close(fd);
+   }
+   if (lfd >= 0)  close(lfd);
+
+   waitpid(src, NULL, 0);
+   memset(&sent, 0, sizeof(sent));
+   if (read(report[0], &sent, sizeof(sent)) != sizeof(sent)) {
+      Error2("%s: source failed (b="F_Zu")",
+	     bench_transports[run->transport], run->bufsiz);
+   }
+   close(report[0]);
+   for (i = 0; i < 2; ++i) {
+      if (socat[i] > 0)  bench_reap(run, socat[i]);
+   }
+   if (stub > 0) {
+      kill(stub, SIGTERM);
+      waitpid(stub, NULL, 0);
+   }
+   run->sent = sent.bytes;
+   if (sent.start == 0 || last <= sent.start || run->bytes == 0) {
+      return -1;
+   }
+   run->seconds = (last - sent.start) / 1e9;
+   return 0;
+}
+
+static void bench_print(const struct bench_run *run, int failed) {
+   char bufsiz[24];
+   double mbs = run->seconds > 0 ? run->bytes / run->seconds / 1e6 : 0.0;
+   double cpugb = run->bytes > 0 ? run->cpu / (run->bytes / 1e9) : 0.0;
+
+   if (bench.json) {
+      printf("{\"transport\":\"%s\",\"workload\":\"%s\",\"bufsize\":"F_Zu","
+	     "\"chunk\":"F_Zu",\"ok\":%s,\"bytes\":%llu,\"lost_bytes\":%llu,"
+	     "\"seconds\":%.6f,\"mb_per_s\":%.1f,\"cpu_seconds\":%.6f,"
+	     "\"cpu_seconds_per_gb\":%.3f,\"chunks\":%llu,"
+	     "\"latency_p50_us\":%.1f,\"latency_p99_us\":%.1f}\n",
+	     bench_transports[run->transport],
+	     run->stream ? "stream" : "fixed", run->bufsiz, run->chunk,
+	     failed ? "false" : "true", run->bytes,
+	     run->sent > run->bytes ? run->sent - run->bytes : 0,
+	     run->seconds, mbs, run->cpu, cpugb, run->chunks,
+	     bench_percentile(&run->hist, 500),
+	     bench_percentile(&run->hist, 990));
+   } else {
+      snprintf(bufsiz, sizeof(bufsiz), F_Zu, run->bufsiz);
+      printf("%-8s %-6s %7s %9.1f %9.3f %10.1f %10.1f%s\n",
+	     bench_transports[run->transport],
+	     run->stream ? "stream" : "fixed", bufsiz, mbs, cpugb,
+	     bench_percentile(&run->hist, 500),
+	     bench_percentile(&run->hist, 990),
+	     failed ? "  FAILED" :
+	     run->sent > run->bytes ? "  (lost data)" : "");
+   }
+   fflush(stdout);
+}
+
+/* parses a comma separated list of names of table into the flags of want */
+static int bench_names(const char *list, const char **table, int n,
+		       bool *want) {
+   const char *p = list;
+   size_t len;
+   int i;
+
+   memset(want, 0, n * sizeof(bool));
+   while (*p) {
+      len = strcspn(p, ",");
+      for (i = 0; i < n; ++i) {
+	 if (strlen(table[i]) == len && !strncmp(p, table[i], len))  break;
+      }
+      if (i == n) {
+	 Error2("unknown name \"%.*s\"", (int)len, p);
+	 return -1;
+      }
+      want[i] = true;
+      p += len;
+      if (*p == ',')  ++p;
+   }
+   return 0;
+}
+
+static const char *bench_usage =
+   "usage: socat-bench [-s socat] [-t transports] [-b sizes] [-w workloads] [-n bytes] [-T seconds] [-c chunk] [-e pemfile] [-x proxy-stub] [-p port] [-j] [-v]";
+
+int main(int argc, const char *argv[]) {
+   static const char *workloads[2] = { "fixed", "stream" };
+   bool transports[BENCH_TRANSPORTS], work[2] = { true, true };
+   size_t sizes[BENCH_MAXSIZES] = { 512, 8192, 65536 };
+   int nsizes = 3;
+   struct bench_run run;
+   const char *p;
+   char *end, path[128];
+   int t, w, s, failed;
+
+   diag_set('p', strchr(argv[0], '/') ? strrchr(argv[0], '/')+1 : argv[0]);
+   diag_set_int('e', E_FATAL);	/* a failed run must not end the others */
+   for (t = 0; t < BENCH_TRANSPORTS; ++t)  transports[t] = true;
+   while (argc > 1 && argv[1][0] == '-') {
+      if (strchr("stbwnTcexp", argv[1][1]) && argc < 3) {
+	 Error1("option %s requires an argument", argv[1]);
+	 exit(1);
+      }
+      switch (argv[1][1]) {
+      case 's': bench.socat = argv[2]; break;
+      case 't':
+	 if (bench_names(argv[2], bench_transports, BENCH_TRANSPORTS,
+			 transports) < 0)
+	    exit(1);
+	 break;
+      case 'w':
+	 if (bench_names(argv[2], workloads, 2, work) < 0)  exit(1);
+	 break;
+      case 'b':
+	 for (nsizes = 0, p = argv[2]; *p && nsizes < BENCH_MAXSIZES; ) {
+	    sizes[nsizes++] = strtoul(p, &end, 0);
+	    p = (*end == ',') ? end+1 : end;
+	    if (end == p && *p) {
+	       Error1("bad size list \"%s\"", argv[2]);
+	       exit(1);
+	    }
+	 }
+	 break;
+      case 'n': bench.total = strtoull(argv[2], NULL, 0); break;
+      case 'T': bench.seconds = strtod(argv[2], NULL); break;
+      case 'c': bench.chunk = strtoul(argv[2], NULL, 0); break;
+      case 'e': bench.pemfile = argv[2]; break;
+      case 'x': bench.stub = argv[2]; break;
+      case 'p': bench.port = strtoul(argv[2], NULL, 0); break;
+      case 'j': bench.json = true; ++argv, --argc; continue;
+      case 'v': bench.verbose = true; ++argv, --argc; continue;
+      case 'h': puts(bench_usage); exit(0);
+      default:
+	 Error2("unknown option \"%s\"; %s", argv[1], bench_usage);
+	 exit(1);
+      }
+      argv += 2, argc -= 2;
+   }
+   if (argc > 1) {
+      Error1("%s", bench_usage);
+      exit(1);
+   }
+   if (bench.chunk < BENCH_HDRLEN || bench.total == 0 || bench.seconds <= 0) {
+      Error("chunk must be at least 8 bytes, bytes and seconds positive");
+      exit(1);
+   }
+   for (s = 0; s < nsizes; ++s) {
+      if (sizes[s] == 0) {
+	 Error("buffer sizes must be positive");
+	 exit(1);
+      }
+   }
+   if (transports[BENCH_OPENSSL] && access(bench.pemfile, R_OK) < 0) {
+      Warn2("%s: %s; skipping transport openssl (test.sh creates it)",
+	    bench.pemfile, strerror(errno));
+      transports[BENCH_OPENSSL] = false;
+   }
+   if (transports[BENCH_SOCKS5] && access(bench.stub, X_OK) < 0) {
+      Warn2("%s: %s; skipping transport socks5 "
+	    "(build it with \"make proxy-stub\")", bench.stub, strerror(errno));
+      transports[BENCH_SOCKS5] = false;
+   }
+   snprintf(bench.dir, sizeof(bench.dir), "/tmp/socat-bench.XXXXXX");
+   if (mkdtemp(bench.dir) == NULL) {
+      Error1("mkdtemp(): %s", strerror(errno));
+      exit(1);
+   }
+   signal(SIGPIPE, SIG_IGN);
+
+   if (!bench.json) {
+      printf("%-8s %-6s %7s %9s %9s %10s %10s\n", "address", "load", "-b",
+	     "MB/s", "CPUs/GB", "p50 us", "p99 us");
+   }
+   for (t = 0; t < BENCH_TRANSPORTS; ++t) {
+      if (!transports[t])  continue;
+      for (w = 0; w < 2; ++w) {
+	 if (!work[w])  continue;
+	 for (s = 0; s < nsizes; ++s) {
+	    memset(&run, 0, sizeof(run));
+	    run.transport = t;
+	    run.stream = (w == 1);
+	    run.bufsiz = sizes[s];
+	    run.chunk = bench.chunk;
+	    if (t == BENCH_UDP && run.chunk > run.bufsiz) {
+	       /* a datagram must fit into the buffer of socat */
+	       run.chunk = run.bufsiz;
+	    }
+	    failed = (bench_run(&run) < 0);
+	    bench_print(&run, failed);
+	    /* the next run uses other ports, TIME_WAIT does not matter */
+	    bench.port += 3;
+	 }
+      }
+   }
+   snprintf(path, sizeof(path), "%s/sink", bench.dir);    unlink(path);
+   snprintf(path, sizeof(path), "%s/source", bench.dir);  unlink(path);
+   rmdir(bench.dir);
+   return 0;
+}
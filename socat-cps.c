@@ -0,0 +1,490 @@
+/* source: socat-cps.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* connection rate benchmark of socat: for each target and each number of
+   concurrent clients it starts a socat fork listener in front of a
+   proxy-stub server, lets the clients open, use and close connections as
+   fast as they can for some seconds, and reports connections per second,
+   percentiles of the time from connect() to the first echoed byte, and the
+   CPU time of the socat parent process and of its children per connection.
+   Targets:
+      tcp      TCP4-LISTEN,fork to TCP4; the stub echoes
+      openssl  TCP4-LISTEN,fork to OPENSSL, and OPENSSL-LISTEN,fork with the
+	       test certificate testsrv.pem to TCP4; the CPU time of both
+	       socat processes is reported
+      socks4   TCP4-LISTEN,fork to SOCKS4 through the stub
+      socks5   TCP4-LISTEN,fork to SOCKS5 through the stub
+      connect  TCP4-LISTEN,fork to PROXY (HTTP CONNECT) through the stub
+   A client connects, sends one byte, waits for the echo, shuts the
+   connection down, and waits for EOF before it closes, so each connection
+   costs socat one complete child process. The CPU time is split into parent
+   and children from /proc/<pid>/stat; where that is not available, the sum
+   goes to parent.
+   One line per run goes to stdout, with -j as JSON object (JSON lines).
+   usage: ./socat-cps [-s socat] [-x proxy-stub] [-t targets] [-c clients]
+		      [-T seconds] [-e pemfile] [-p port] [-j] [-v] */
+
+#include "config.h"
+#include "xioconfig.h"
+#include "sysincludes.h"
+#include <sys/resource.h>	/* wait4() */
+
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+#include "utils.h"
+#include "benchutils.h"
+
+
+#define CPS_MAXCLIENTS 1024
+#define CPS_MAXCOUNTS 16
+#define CPS_TIMEOUT 5000	/* ms that a client waits for socat */
+
+enum cps_target {
+   CPS_TCP, CPS_OPENSSL, CPS_SOCKS4, CPS_SOCKS5, CPS_CONNECT, CPS_TARGETS
+} ;
+
+static const char *cps_targets[CPS_TARGETS] = {
+   "tcp", "openssl", "socks4", "socks5", "connect"
+} ;
+
+/* the mode of proxy-stub for each target */
+static const char *cps_stubmodes[CPS_TARGETS] = {
+   "echo", "echo", "socks4", "socks5", "connect"
+} ;
+
+/* what a client reports when it is done */
+struct cps_result {
+   unsigned long long conns;	/* complete connections */
+   unsigned long long failed;	/* connections that failed or timed out */
+   struct xiohist hist;		/* connect() to first byte */
+} ;
+
+/* one run */
+struct cps_run {
+   int target;
+   int clients;
+   struct cps_result res;
+   double seconds;
+   double cpu_parent;		/* seconds of the socat listeners */
+   double cpu_children;		/* seconds of their children, or -1 */
+} ;
+
+static struct {
+   const char *socat;
+   const char *stub;
+   const char *pemfile;
+   double seconds;
+   int port;	/* below the ephemeral range: the many TIME_WAIT client
+		   ports would make bind() fail in later runs */
+   bool json;
+   bool verbose;
+} cps = {
+   "./socat", "./proxy-stub", "testsrv.pem", 2.0, 17400, false, false
+} ;
+
+
+/* waits up to ms for fd to become readable; returns 0, or -1 */
+static int cps_wait(int fd, int ms) {
+   struct pollfd pfd;
+
+   pfd.fd = fd;
+   pfd.events = POLLIN;
+   return poll(&pfd, 1, ms) == 1 ? 0 : -1;
+}
+
+/* one connection through socat: connect, send a byte, receive it back,
+   shut down and wait for EOF. returns the connect() to first byte time in
+   ns, 0 when socat refused the connection, or -1 on error */
+static long long cps_connect(int port) {
+   struct sockaddr_in sa;
+   unsigned long long t0, t1;
+   char c = 'x', buff[64];
+   ssize_t n;
+   int fd;
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sin_family = AF_INET;
+   sa.sin_port = htons(port);
+   sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   if ((fd = socket(PF_INET, SOCK_STREAM, 0)) < 0)  return -1;
+   t0 = bench_now();
+   if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+      close(fd);
+      return errno == ECONNREFUSED ? 0 : -1;
+   }
+   if (write(fd, &c, 1) != 1 || cps_wait(fd, CPS_TIMEOUT) < 0 ||
+       read(fd, buff, 1) != 1) {
+      close(fd);
+      return -1;
+   }
+   t1 = bench_now();
+   shutdown(fd, SHUT_WR);
+   do {
+      if (cps_wait(fd, CPS_TIMEOUT) < 0) {
+	 close(fd);
+	 return -1;
+      }
+   } while ((n = read(fd, buff, sizeof(buff))) > 0);
+   close(fd);
+   return n == 0 ? (long long)(t1 - t0) : -1;
+}
+
+/* a client process: connects until the deadline and reports on pipe
+   report */
+static void cps_client(int port, unsigned long long until, int report) {
+   static struct cps_result res;
+   const char *p = (const char *)&res;
+   size_t writt;
+   ssize_t n;
+   long long ns;
+
+   while (bench_now() < until) {
+      if ((ns = cps_connect(port)) <= 0) {
+	 ++res.failed;
+	 continue;
+      }
+      ++res.conns;
+      xiohist_add(&res.hist, ns);
+   }
+   for (writt = 0; writt < sizeof(res); writt += n) {
+      if ((n = write(report, p+writt, sizeof(res)-writt)) < 0)  _exit(1);
+   }
+   _exit(0);
+}
+
+/* CPU seconds of process pid itself and of its waited for children from
+   /proc/<pid>/stat; returns 0, or -1 */
+static int cps_proccpu(pid_t pid, double *self, double *children) {
+   unsigned long utime, stime;
+   long cutime, cstime;
+   char path[64], buff[1024], *p;
+   ssize_t n;
+   int fd;
+
+   snprintf(path, sizeof(path), "/proc/"F_pid"/stat", pid);
+   if ((fd = open(path, O_RDONLY)) < 0)  return -1;
+   n = read(fd, buff, sizeof(buff)-1);
+   close(fd);
+   if (n <= 0)  return -1;
+   buff[n] = '\0';
+   /* the command name might contain spaces; fields 14 to 17 */
+   if ((p = strrchr(buff, ')')) == NULL ||
+       sscanf(p+1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld",
+	      &utime, &stime, &cutime, &cstime) != 4) {
+      return -1;
+   }
+   *self = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+   *children = (double)(cutime + cstime) / sysconf(_SC_CLK_TCK);
+   return 0;
+}
+
+/* stops a socat listener and adds its CPU time to run */
+static void cps_reap(struct cps_run *run, pid_t pid) {
+   struct rusage ru;
+   double self, children;
+   bool split;
+   int status;
+
+   /* the last children should be gone by now */
+   split = (cps_proccpu(pid, &self, &children) == 0);
+   kill(pid, SIGTERM);
+   if (wait4(pid, &status, 0, &ru) < 0)  return;
+   if (split) {
+      run->cpu_parent += self;
+      if (run->cpu_children >= 0)  run->cpu_children += children;
+   } else {
+      run->cpu_parent += ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	 ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+      run->cpu_children = -1;
+   }
+}
+
+/* performs one run; returns 0 on success, or -1 */
+static int cps_run(struct cps_run *run) {
+   static struct cps_result res;
+   char addr[2][2][256], stubport[16];
+   const char *args[2][8], *stubargs[3];
+   int port = cps.port, report[CPS_MAXCLIENTS], fds[2];
+   pid_t socat[2] = { -1, -1 }, stub, client[CPS_MAXCLIENTS];
+   unsigned long long start = 0, until = 0;
+   long long ns = 0;
+   size_t got;
+   ssize_t n;
+   int i, j, rc = 0;
+
+   snprintf(stubport, sizeof(stubport), "%d", port+1);
+   stubargs[0] = cps_stubmodes[run->target];
+   stubargs[1] = stubport;
+   stubargs[2] = NULL;
+   snprintf(addr[0][0], 256, "TCP4-LISTEN:%d,reuseaddr,fork,backlog=1024",
+	    port);
+   switch (run->target) {
+   case CPS_TCP:
+      snprintf(addr[0][1], 256, "TCP4:127.0.0.1:%d", port+1);
+      break;
+   case CPS_OPENSSL:
+      snprintf(addr[0][1], 256, "OPENSSL:127.0.0.1:%d,verify=0", port+2);
+      snprintf(addr[1][0], 256,
+	       "OPENSSL-LISTEN:%d,reuseaddr,fork,backlog=1024,cert=%s,"
+	       "verify=0", port+2, cps.pemfile);
+      snprintf(addr[1][1], 256, "TCP4:127.0.0.1:%d", port+1);
+      args[1][0] = addr[1][0];  args[1][1] = addr[1][1];  args[1][2] = NULL;
+      break;
+   case CPS_SOCKS4:
+      snprintf(addr[0][1], 256, "SOCKS4:127.0.0.1:127.0.0.1:80,socksport=%d",
+	       port+1);
+      break;
+   case CPS_SOCKS5:
+      snprintf(addr[0][1], 256, "SOCKS5:127.0.0.1:bench:80,socks5port=%d",
+	       port+1);
+      break;
+   case CPS_CONNECT:
+      snprintf(addr[0][1], 256, "PROXY:127.0.0.1:127.0.0.1:80,proxyport=%d",
+	       port+1);
+      break;
+   }
+   args[0][0] = addr[0][0];  args[0][1] = addr[0][1];  args[0][2] = NULL;
+
+   run->cpu_children = 0.0;
+   if ((stub = bench_spawn(cps.stub, stubargs, -1, -1, !cps.verbose)) < 0)  return -1;
+   if (run->target == CPS_OPENSSL &&
+       (socat[1] = bench_spawn(cps.socat, args[1], -1, -1, !cps.verbose)) < 0) {
+      kill(stub, SIGTERM);
+      waitpid(stub, NULL, 0);
+      return -1;
+   }
+   if ((socat[0] = bench_spawn(cps.socat, args[0], -1, -1, !cps.verbose)) < 0) {
+      rc = -1;
+   }
+
+   /* one connection through the whole chain before the clients start;
+      socat may be listening before proxy-stub is */
+   start = bench_now() + 5000000000ULL;
+   while (rc == 0 && (ns = cps_connect(port)) <= 0 && bench_now() < start) {
+      usleep(10000);
+   }
+   if (rc == 0 && ns <= 0) {
+      Error1("%s: no connection through socat and proxy-stub",
+	     cps_targets[run->target]);
+      rc = -1;
+   }
+
+   for (i = 0; rc == 0 && i < run->clients; ++i) {
+      if (pipe(fds) < 0) {
+	 Error1("pipe(): %s", strerror(errno));
+	 break;
+      }
+      if (i == 0) {
+	 start = bench_now();
+	 until = start + (unsigned long long)(cps.seconds * 1e9);
+      }
+      if ((client[i] = fork()) < 0) {
+	 Error1("fork(): %s", strerror(errno));
+	 close(fds[0]);  close(fds[1]);
+	 break;
+      }
+      if (client[i] == 0) {
+	 for (j = 0; j < i; ++j)  close(report[j]);
+	 close(fds[0]);
+	 cps_client(port, until, fds[1]);
+      }
+      close(fds[1]);
+      report[i] = fds[0];
+   }
+   if (rc == 0 && i < run->clients) {
+      rc = -1;
+   }
+   run->clients = i;
+   for (i = 0; i < run->clients; ++i) {
+      for (got = 0; got < sizeof(res); got += n) {
+	 if ((n = read(report[i], (char *)&res+got, sizeof(res)-got)) <= 0) {
+	    break;
+	 }
+      }
+      close(report[i]);
+      waitpid(client[i], NULL, 0);
+      if (got < sizeof(res)) {
+	 Error1("%s: client failed", cps_targets[run->target]);
+	 rc = -1;
+	 continue;
+      }
+      run->res.conns += res.conns;
+      run->res.failed += res.failed;
+      run->res.hist.n += res.hist.n;
+      run->res.hist.sum += res.hist.sum;
+      for (j = 0; j < XIOHIST_BUCKETS; ++j) {
+	 run->res.hist.count[j] += res.hist.count[j];
+      }
+   }
+   if (run->clients > 0) {
+      run->seconds = (bench_now() - start) / 1e9;
+   }
+
+   usleep(200000);	/* socat reaps its last children */
+   for (i = 0; i < 2; ++i) {
+      if (socat[i] > 0)  cps_reap(run, socat[i]);
+   }
+   kill(stub, SIGTERM);
+   waitpid(stub, NULL, 0);
+   return rc;
+}
+
+static void cps_print(const struct cps_run *run, int failed) {
+   double conns = run->res.conns;
+   double rate = run->seconds > 0 ? conns / run->seconds : 0.0;
+   double parent = conns > 0 ? run->cpu_parent / conns * 1e6 : 0.0;
+   double children = conns > 0 ? run->cpu_children / conns * 1e6 : 0.0;
+
+   if (cps.json) {
+      char cpuchildren[32], perchild[32];
+      if (run->cpu_children < 0) {
+	 strcpy(cpuchildren, "null");  strcpy(perchild, "null");
+      } else {
+	 snprintf(cpuchildren, sizeof(cpuchildren), "%.3f",
+		  run->cpu_children);
+	 snprintf(perchild, sizeof(perchild), "%.1f", children);
+      }
+      printf("{\"target\":\"%s\",\"clients\":%d,\"ok\":%s,\"seconds\":%.3f,"
+	     "\"connections\":%llu,\"failed\":%llu,\"conns_per_s\":%.1f,"
+	     "\"latency_p50_us\":%.1f,\"latency_p90_us\":%.1f,"
+	     "\"latency_p99_us\":%.1f,\"parent_cpu_seconds\":%.3f,"
+	     "\"child_cpu_seconds\":%s,\"parent_cpu_us_per_conn\":%.1f,"
+	     "\"child_cpu_us_per_conn\":%s}\n",
+	     cps_targets[run->target], run->clients,
+	     failed ? "false" : "true", run->seconds, run->res.conns,
+	     run->res.failed, rate,
+	     bench_percentile(&run->res.hist, 500),
+	     bench_percentile(&run->res.hist, 900),
+	     bench_percentile(&run->res.hist, 990),
+	     run->cpu_parent, cpuchildren, parent, perchild);
+   } else {
+      printf("%-8s %7d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f%s\n",
+	     cps_targets[run->target], run->clients, rate,
+	     bench_percentile(&run->res.hist, 500),
+	     bench_percentile(&run->res.hist, 900),
+	     bench_percentile(&run->res.hist, 990), parent,
+	     run->cpu_children < 0 ? 0.0 : children,
+	     failed ? "  FAILED" : run->res.failed ? "  (failed conns)" : "");
+   }
+   fflush(stdout);
+}
+
+/* parses a comma separated list of names of table into the flags of want */
+static int cps_names(const char *list, const char **table, int n,
+		     bool *want) {
+   const char *p = list;
+   size_t len;
+   int i;
+
+   memset(want, 0, n * sizeof(bool));
+   while (*p) {
+      len = strcspn(p, ",");
+      for (i = 0; i < n; ++i) {
+	 if (strlen(table[i]) == len && !strncmp(p, table[i], len))  break;
+      }
+      if (i == n) {
+	 Error2("unknown name \"%.*s\"", (int)len, p);
+	 return -1;
+      }
+      want[i] = true;
+      p += len;
+      if (*p == ',')  ++p;
+   }
+   return 0;
+}
+
+static const char *cps_usage =
+   "usage: socat-cps [-s socat] [-x proxy-stub] [-t targets] [-c clients] [-T seconds] [-e pemfile] [-p port] [-j] [-v]";
+
+int main(int argc, const char *argv[]) {
+   bool targets[CPS_TARGETS];
+   int counts[CPS_MAXCOUNTS] = { 1, 16, 64 };
+   int ncounts = 3;
+   struct cps_run run;
+   const char *p;
+   char *end;
+   int t, c, failed;
+
+   diag_set('p', strchr(argv[0], '/') ? strrchr(argv[0], '/')+1 : argv[0]);
+   diag_set_int('e', E_FATAL);	/* a failed run must not end the others */
+   for (t = 0; t < CPS_TARGETS; ++t)  targets[t] = true;
+   while (argc > 1 && argv[1][0] == '-') {
+      if (strchr("sxtcTep", argv[1][1]) && argc < 3) {
+	 Error1("option %s requires an argument", argv[1]);
+	 exit(1);
+      }
+      switch (argv[1][1]) {
+      case 's': cps.socat = argv[2]; break;
+      case 'x': cps.stub = argv[2]; break;
+      case 't':
+	 if (cps_names(argv[2], cps_targets, CPS_TARGETS, targets) < 0)
+	    exit(1);
+	 break;
+      case 'c':
+	 for (ncounts = 0, p = argv[2]; *p && ncounts < CPS_MAXCOUNTS; ) {
+	    counts[ncounts++] = strtoul(p, &end, 0);
+	    p = (*end == ',') ? end+1 : end;
+	    if (end == p && *p) {
+	       Error1("bad list of client counts \"%s\"", argv[2]);
+	       exit(1);
+	    }
+	 }
+	 break;
+      case 'T': cps.seconds = strtod(argv[2], NULL); break;
+      case 'e': cps.pemfile = argv[2]; break;
+      case 'p': cps.port = strtoul(argv[2], NULL, 0); break;
+      case 'j': cps.json = true; ++argv, --argc; continue;
+      case 'v': cps.verbose = true; ++argv, --argc; continue;
+      case 'h': puts(cps_usage); exit(0);
+      default:
+	 Error2("unknown option \"%s\"; %s", argv[1], cps_usage);
+	 exit(1);
+      }
+      argv += 2, argc -= 2;
+   }
+   if (argc > 1) {
+      Error1("%s", cps_usage);
+      exit(1);
+   }
+   if (cps.seconds <= 0) {
+      Error("seconds must be positive");
+      exit(1);
+   }
+   for (c = 0; c < ncounts; ++c) {
+      if (counts[c] <= 0 || counts[c] > CPS_MAXCLIENTS) {
+	 Error1("client counts must be from 1 to %d", CPS_MAXCLIENTS);
+	 exit(1);
+      }
+   }
+   if (access(cps.stub, X_OK) < 0) {
+      Error2("%s: %s (build it with \"make proxy-stub\")", cps.stub,
+	     strerror(errno));
+      exit(1);
+   }
+   if (targets[CPS_OPENSSL] && access(cps.pemfile, R_OK) < 0) {
+      Warn2("%s: %s; skipping target openssl (test.sh creates it)",
+	    cps.pemfile, strerror(errno));
+      targets[CPS_OPENSSL] = false;
+   }
+   signal(SIGPIPE, SIG_IGN);
+
+   if (!cps.json) {
+      printf("%-8s %7s %9s %9s %9s %9s %9s %9s\n", "address", "clients",
+	     "conns/s", "p50 us", "p90 us", "p99 us", "parentus", "childus");
+   }
+   for (t = 0; t < CPS_TARGETS; ++t) {
+      if (!targets[t])  continue;
+      for (c = 0; c < ncounts; ++c) {
+	 memset(&run, 0, sizeof(run));
+	 run.target = t;
+	 run.clients = counts[c];
+	 failed = (cps_run(&run) < 0);
+	 cps_print(&run, failed);
+	 /* the next run uses other ports, TIME_WAIT does not matter */
+	 cps.port += 3;
+      }
+   }
+   return 0;
+}
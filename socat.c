@@ -21,6 +21,8 @@
 #include "xio.h"
 #include "xioopts.h"
 #include "xiolockfile.h"
+#include "xiostats.h"
+#include "xio-ascii.h"
 
 
 /* command line options */
@@ -39,6 +41,9 @@ struct {
    int sniffleft;	/* -1 or an FD for teeing data arriving on xfd1 */
    int sniffright;	/* -1 or an FD for teeing data arriving on xfd2 */
    xiolock_t lock;	/* a lock file */
+   const char *stats;	/* NULL or the UNIX socket of the statistics */
+   bool hist;		/* log latency histograms */
+   const char *summary;	/* NULL or the file of connection summaries */
 } socat_opts = {
    8192,	/* bufsiz */
    false,	/* verbose */
@@ -54,6 +59,9 @@ struct {
    -1,		/* sniffleft */
    -1,		/* sniffright */
    { NULL, 0 },	/* lock */
+   NULL,	/* stats */
+   false,	/* hist */
+   NULL,	/* summary */
 };
 
 void socat_usage(FILE *fd);
@@ -61,7 +69,6 @@ void socat_opt_hint(FILE *fd, char a, char b);
 void socat_version(FILE *fd);
 int socat(const char *address1, const char *address2);
 int _socat(void);
-int cv_newline(unsigned char *buff, ssize_t *bytes, int lineterm1, int lineterm2);
 void socat_signal(int sig);
 static int socat_sigchild(struct single *file);
 
@@ -71,6 +78,8 @@ void crlftolf(char **in, ssize_t *len, size_t bufsiz);
 static int socat_lock(void);
 static void socat_unlock(void);
 static int socat_newchild(void);
+static bool socat_flushtimeout(struct timeval *timeout, struct timeval **to);
+static bool socat_flushdue(void);
 
 static const char socatversion[] =
 #include "./VERSION"
@@ -167,9 +176,15 @@ int main(int argc, const char *argv[]) {
 	 case 'u':
 	    diag_set('u', NULL);
 	    break;
+	 case 'r':
+	    diag_set('r', NULL);
+	    break;
 	 case 'h':
 	    diag_set_int('h', true);
 	    break;
+	 case 'a':
+	    diag_set('a', NULL);
+	    break;
 	 default:
 	    Error1("unknown log option \"%s\"; use option \"-h\" for help", arg1[0]);
 	    break;
@@ -303,6 +318,30 @@ int main(int argc, const char *argv[]) {
 	 socat_opts.lock.intervall.tv_sec  = 1;
 	 socat_opts.lock.intervall.tv_nsec = 0;
 	 break;
+#if WITH_STATS
+      case 'S': if (arg1[0][2]) {
+	    socat_opts.stats = *arg1+2;
+	 } else {
+	    ++arg1, --argc;
+	    if ((socat_opts.stats = *arg1) == NULL) {
+	       Error("option -S requires an argument; use option \"-h\" for help");
+	       Exit(1);
+	    }
+	 }
+	 break;
+      case 'H':  if (arg1[0][2])  { socat_opt_hint(stderr, arg1[0][1], arg1[0][2]); Exit(1); }
+	 socat_opts.hist = true; break;
+      case 'C': if (arg1[0][2]) {
+	    socat_opts.summary = *arg1+2;
+	 } else {
+	    ++arg1, --argc;
+	    if ((socat_opts.summary = *arg1) == NULL) {
+	       Error("option -C requires an argument; use option \"-h\" for help");
+	       Exit(1);
+	    }
+	 }
+	 break;
+#endif /* WITH_STATS */
 #if WITH_IP4 || WITH_IP6
 #if WITH_IP4
       case '4':
@@ -391,7 +430,20 @@ int main(int argc, const char *argv[]) {
 
    Atexit(socat_unlock);
 
+#if WITH_STATS
+   if ((socat_opts.stats != NULL || socat_opts.hist ||
+	socat_opts.summary != NULL) &&
+       xiostats_init(socat_opts.stats, socat_opts.hist) < 0) {
+      Exit(1);
+   }
+   if (socat_opts.summary != NULL &&
+       xiostats_summary(socat_opts.summary, arg1[0], arg1[1]) < 0) {
+      Exit(1);
+   }
+#endif /* WITH_STATS */
+
    result = socat(arg1[0], arg1[1]);
+   xiostats_reason(result & 0xff, result < 0 ? "error" : "eof");
    Notice1("exiting with status %d", result);
    Exit(result);
    return 0;	/* not reached, just for gcc -Wall */
@@ -419,7 +471,9 @@ void socat_usage(FILE *fd) {
    fputs("      -lm[facility]  mixed log mode (stderr during initialization, then syslog)\n", fd);
    fputs("      -lp<progname>  set the program name used for logging\n", fd);
    fputs("      -lu            use microseconds for logging timestamps\n", fd);
+   fputs("      -lr            logging timestamps are seconds since start (monotonic)\n", fd);
    fputs("      -lh            add hostname to log messages\n", fd);
+   fputs("      -la            asynchronous logging: messages are written by a separate thread\n", fd);
    fputs("      -v     verbose text dump of data traffic\n", fd);
    fputs("      -x     verbose hexadecimal dump of data traffic\n", fd);
    fputs("      -r <file>      raw dump of data flowing from left to right\n", fd);
@@ -433,6 +487,11 @@ void socat_usage(FILE *fd) {
    fputs("      -g     do not check option groups\n", fd);
    fputs("      -L <lockfile>  try to obtain lock, or fail\n", fd);
    fputs("      -W <lockfile>  try to obtain lock, or wait\n", fd);
+#if WITH_STATS
+   fputs("      -S <socket>    serve statistics on UNIX socket (Prometheus text or JSON)\n", fd);
+   fputs("      -H     log latency histograms at exit and on SIGUSR2\n", fd);
+   fputs("      -C <file>      append a JSON summary line per connection\n", fd);
+#endif
 #if WITH_IP4
    fputs("      -4     prefer IPv4 if version is not explicitly specified\n", fd);
 #endif
@@ -586,6 +645,16 @@ void socat_version(FILE *fd) {
 #else
    fputs("  #undef WITH_TUN\n", fd);
 #endif
+#ifdef WITH_PROBES
+   fprintf(fd, "  #define WITH_PROBES %d\n", WITH_PROBES);
+#else
+   fputs("  #undef WITH_PROBES\n", fd);
+#endif
+#ifdef WITH_STATS
+   fprintf(fd, "  #define WITH_STATS %d\n", WITH_STATS);
+#else
+   fputs("  #undef WITH_STATS\n", fd);
+#endif
 #ifdef WITH_PTY
    fprintf(fd, "  #define WITH_PTY %d\n", WITH_PTY);
 #else
@@ -678,7 +747,24 @@ int socat(const char *address1, const char *address2) {
    }
 #endif
 
+   /* the first address may have selected the second one, e.g. by SNI */
+   if (sock1->tag != XIO_TAG_DUAL && sock1->stream.route != NULL) {
+      Notice1("using address \"%s\" selected by first address",
+	      sock1->stream.route);
+      address2 = sock1->stream.route;
+   }
+
    mayexec = (sock1->common.flags&XIO_DOESCONVERT ? 0 : XIO_MAYEXEC);
+#if WITH_UDP
+   if (sock1->tag != XIO_TAG_DUAL && (sock1->stream.flags & XIO_DOESDEMUX)) {
+      /* one instance of the second address per peer */
+      return xiodemux(sock1, address2,
+		      (XIO_WRITABLE(sock1) ?
+		       (XIO_READABLE(sock1) ? XIO_RDWR : XIO_RDONLY) :
+		       XIO_WRONLY)|XIO_MAYCHILD|mayexec|XIO_MAYCONVERT,
+		      socat_opts.bufsiz);
+   }
+#endif /* WITH_UDP */
    if (XIO_WRITABLE(sock1)) {
       if (XIO_READABLE(sock1)) {
 	 if ((sock2 = xioopen(address2, XIO_RDWR|XIO_MAYFORK|XIO_MAYCHILD|mayexec|XIO_MAYCONVERT)) == NULL) {
@@ -720,6 +806,7 @@ int socat(const char *address1, const char *address2) {
    }
 #endif
 
+   xiostats_open(sock1, sock2);
    Info("resolved and opened all sock addresses");
    return 
       _socat();	/* nsocks, sockets are visible outside function */
@@ -792,6 +879,10 @@ int _socat(void) {
    ssize_t bytes1, bytes2;
    int polling = 0;	/* handling ignoreeof */
    int wasaction = 1;	/* last poll was active, do NOT sleep before next */
+   bool flushwait = false;	/* poll timeout shortened for xioflush() */
+   struct timeval flushdelay = { 0, 0 };	/* that shortened timeout */
+   struct timeval flushidle = { 0, 0 };	/* poll timeouts for xioflush()
+					   since the last activity */
    struct timeval total_timeout;	/* the actual total timeout timer */
 
 #if WITH_FILAN
@@ -893,8 +984,18 @@ int _socat(void) {
 	 to = &timeout;
       } else if (socat_opts.total_timeout.tv_sec != 0 ||
 		 socat_opts.total_timeout.tv_usec != 0) {
-	 /* there might occur a total inactivity timeout */
+	 /* there might occur a total inactivity timeout; poll timeouts for
+	    flushing do not restart it */
 	 timeout = socat_opts.total_timeout;
+	 if (timeout.tv_usec < flushidle.tv_usec) {
+	    timeout.tv_usec += 1000000;
+	    timeout.tv_sec  -= 1;
+	 }
+	 timeout.tv_sec  -= flushidle.tv_sec;
+	 timeout.tv_usec -= flushidle.tv_usec;
+	 if (timeout.tv_sec < 0) {
+	    timeout.tv_sec = timeout.tv_usec = 0;
+	 }
 	 to = &timeout;
       } else {
 	 to = NULL;
@@ -970,6 +1071,10 @@ int _socat(void) {
 	     fd1out->fd = -1;
 	     fd2in->fd = -1;
 	 }
+	 /* data held back by an address must not wait beyond its budget */
+	 flushwait = socat_flushtimeout(&timeout, &to);
+	 if (flushwait)  flushdelay = timeout;	/* select() may change it */
+
 	 /* frame 0: innermost part of the transfer loop: check FD status */
 	 retval = xiopoll(fds, 4, to);
 	 if (retval >= 0 || errno != EINTR) {
@@ -979,12 +1084,30 @@ int _socat(void) {
 	 Info1("poll(): %s", strerror(errno));
 	 errno = _errno;
       } while (true);
+      xiostats_polled();
 
       /* attention:
 	 when an exec'd process sends data and terminates, it is unpredictable
 	 whether the data or the sigchild arrives first.
 	 */
 
+      if (retval >= 0) {
+	 socat_flushdue();
+	 if (retval == 0 && flushwait) {
+	    /* this timeout was not about inactivity, but counts towards it */
+	    flushidle.tv_sec  += flushdelay.tv_sec;
+	    flushidle.tv_usec += flushdelay.tv_usec;
+	    if (flushidle.tv_usec >= 1000000) {
+	       flushidle.tv_usec -= 1000000;
+	       flushidle.tv_sec  += 1;
+	    }
+	    continue;
+	 }
+	 if (retval > 0) {
+	    flushidle.tv_sec = flushidle.tv_usec = 0;
+	 }
+      }
+
       if (retval < 0) {
 	 Error11("xiopoll({%d,%0o}{%d,%0o}{%d,%0o}{%d,%0o}, 4, {"F_tv_sec"."F_tv_usec"}): %s",
 		 fds[0].fd, fds[0].events, fds[1].fd, fds[1].events,
@@ -1012,6 +1135,7 @@ int _socat(void) {
 		    socat_opts.total_timeout.tv_usec != 0) {
 	    /* there was a total inactivity timeout */
 	    Notice("inactivity timeout triggered");
+	    xiostats_reason(-1, "timeout");
 		  free(buff);
 	    return 0;
 	 }
@@ -1066,9 +1190,13 @@ int _socat(void) {
 	 mayrd1 = false;
 	 if ((bytes1 = xiotransfer(sock1, sock2, buff, socat_opts.bufsiz, false))
 	     < 0) {
-	    if (errno != EAGAIN) {
+	    if (errno == EAGAIN) {
+	       /* e.g.packet dropped; the rest of a batch is still there */
+	       mayrd1 = (xiopending(sock1) > 0);
+	    } else {
 	       closing = MAX(closing, 1);
 	       Notice("socket 1 to socket 2 is in error");
+	       xiostats_reason(-1, "error");
 	       if (socat_opts.lefttoright) {
 		  break;
 	       }
@@ -1098,9 +1226,13 @@ int _socat(void) {
 	 mayrd2 = false;
 	 if ((bytes2 = xiotransfer(sock2, sock1, buff, socat_opts.bufsiz, true))
 	     < 0) {
-	    if (errno != EAGAIN) {
+	    if (errno == EAGAIN) {
+	       /* e.g.packet dropped; the rest of a batch is still there */
+	       mayrd2 = (xiopending(sock2) > 0);
+	    } else {
 	       closing = MAX(closing, 1);
 	       Notice("socket 2 to socket 1 is in error");
+	       xiostats_reason(-1, "error");
 	       if (socat_opts.righttoleft) {
 		  break;
 	       }
@@ -1140,6 +1272,7 @@ int _socat(void) {
 	    polling = 1;	/* do not hook this eof fd to poll for pollintv*/
 	 } else if (XIO_RDSTREAM(sock1)->eof <= 2) {
 	    Notice1("socket 1 (fd %d) is at EOF", XIO_GETRDFD(sock1));
+	    xiostats_eof(0);
 	    xioshutdown(sock2, SHUT_WR);
 	    XIO_RDSTREAM(sock1)->eof = 3;
 	    XIO_RDSTREAM(sock1)->ignoreeof = false;
@@ -1163,6 +1296,7 @@ int _socat(void) {
 	    polling = 1;	/* do not hook this eof fd to poll for pollintv*/
 	 } else if (XIO_RDSTREAM(sock2)->eof <= 2) {
 	    Notice1("socket 2 (fd %d) is at EOF", XIO_GETRDFD(sock2));
+	    xiostats_eof(1);
 	    xioshutdown(sock1, SHUT_WR);
 	    XIO_RDSTREAM(sock2)->eof = 3;
 	    XIO_RDSTREAM(sock2)->ignoreeof = false;
@@ -1279,15 +1413,20 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
    ssize_t bytes, writt = 0;
 
 	 bytes = xioread(inpipe, buff, bufsiz);
+	 ++xiostats_cur->reads[righttoleft];
+	 XIOPROBE3(transfer_read, XIO_GETRDFD(inpipe), bytes, righttoleft);
 	 if (bytes < 0) {
 	    if (errno != EAGAIN)
 	       XIO_RDSTREAM(inpipe)->eof = 2;
+	    else
+	       ++xiostats_cur->rdagain;
 	    /*xioshutdown(inpipe, SHUT_RD);*/
 	    return -1;
 	 }
 	 if (bytes == 0 && XIO_RDSTREAM(inpipe)->ignoreeof && !closing) {
 	    ;
 	 } else if (bytes == 0) {
+	    XIOPROBE2(eof, XIO_GETRDFD(inpipe), righttoleft);
 	    XIO_RDSTREAM(inpipe)->eof = 2;
 	    closing = MAX(closing, 1);
 	 }
@@ -1296,20 +1435,13 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 	    /* handle escape char */
 	    if (XIO_RDSTREAM(inpipe)->escape != -1) {
 	       /* check input data for escape char */
-	       unsigned char *ptr = buff;
-	       size_t ctr = 0;
-	       while (ctr < bytes) {
-		  if (*ptr == XIO_RDSTREAM(inpipe)->escape) {
-		     /* found: set flag, truncate input data */
-		     XIO_RDSTREAM(inpipe)->actescape = true;
-		     bytes = ctr;
-		     Info("escape char found in input");
-		     break;
-		  }
-		  ++ptr; ++ctr;
-	       }
-	       if (ctr != bytes) {
-		  XIO_RDSTREAM(inpipe)->eof = 2;
+	       size_t ctr = xiofindescape(buff, bytes,
+					  XIO_RDSTREAM(inpipe)->escape);
+	       if (ctr < (size_t)bytes) {
+		  /* found: set flag, truncate input data */
+		  XIO_RDSTREAM(inpipe)->actescape = true;
+		  bytes = ctr;
+		  Info("escape char found in input");
 	       }
 	    }
 	 }
@@ -1416,6 +1548,8 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 	    }
 
 	    writt = xiowrite(outpipe, buff, bytes);
+	    ++xiostats_cur->writes[righttoleft];
+	    XIOPROBE3(transfer_write, XIO_GETWRFD(outpipe), writt, righttoleft);
 	    if (writt < 0) {
 	       /* EAGAIN when nonblocking but a mandatory lock is on file.
 		  the problem with EAGAIN is that the read cannot be repeated,
@@ -1428,6 +1562,9 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 #endif
 	       return -1;
 	    } else {
+	       xiostats_cur->bytes[righttoleft] += writt;
+	       ++xiostats_cur->chunks[righttoleft];
+	       xiostats_relayed();
 	       Info3("transferred "F_Zu" bytes from %d to %d",
 		     writt, XIO_GETRDFD(inpipe), XIO_GETWRFD(outpipe));
 	    }
@@ -1435,90 +1572,71 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
    return writt;
 }
 
-#define CR '\r'
-#define LF '\n'
-
-
-/* converts the newline characters (or character sequences) from the one
-   specified in lineterm1 to that of lineterm2. Possible values are
-   LINETERM_CR, LINETERM_CRNL, LINETERM_RAW.
-   bytes specifies the number of bytes input and output */
-int cv_newline(unsigned char *buff, ssize_t *bytes,
-	       int lineterm1, int lineterm2) {
-   /* must perform newline changes */
-   if (lineterm1 <= LINETERM_CR && lineterm2 <= LINETERM_CR) {
-      /* no change in data length */
-      unsigned char from, to,  *p, *z;
-      if (lineterm1 == LINETERM_RAW) {
-	 from = '\n'; to = '\r';
-      } else {
-	 from = '\r'; to = '\n';
-      }
-      z = buff + *bytes;
-      p = buff;
-      while (p < z) {
-	 if (*p == from)  *p = to;
-	 ++p;
-      }
+/* while a read side still has data that already passed poll() (e.g.the rest
+   of a recvmmsg() batch), held back write data waits for it so it leaves in
+   one batch.
+   returns true when flushing should be deferred */
+static bool socat_flushdefer(void) {
+   return (XIO_READABLE(sock1) && xiopending(sock1) > 0) ||
+      (XIO_READABLE(sock2) && xiopending(sock2) > 0);
+}
 
-   } else if (lineterm1 == LINETERM_CRNL) {
-      /* buffer might become shorter */
-      unsigned char to,  *s, *t, *z;
-      if (lineterm2 == LINETERM_RAW) {
-	 to = '\n';
-      } else {
-	 to = '\r';
-      }
-      z = buff + *bytes;
-      s = t = buff;
-      while (s < z) {
-	 if (*s == '\r') {
-	    ++s;
-	    continue;
-	 }
-	 if (*s == '\n') {
-	    *t++ = to; ++s;
-	 } else {
-	    *t++ = *s++;
-	 }
+/* shortens the poll timeout when an address holds back write data that must
+   be flushed earlier (e.g.OpenSSL option coalesce).
+   returns true when *to was changed */
+static bool socat_flushtimeout(struct timeval *timeout, struct timeval **to) {
+   xiofile_t *socks[2];
+   struct timeval delay;
+   bool shortened = false;
+   int i;
+
+   if (socat_flushdefer())  return false;
+   socks[0] = sock1;  socks[1] = sock2;
+   for (i = 0; i < 2; ++i) {
+      if (!XIO_WRITABLE(socks[i]) || xioflushdelay(socks[i], &delay) <= 0)
+	 continue;
+      if (*to == NULL ||
+	  delay.tv_sec < (*to)->tv_sec ||
+	  (delay.tv_sec == (*to)->tv_sec && delay.tv_usec < (*to)->tv_usec)) {
+	 *timeout = delay;
+	 *to = timeout;
+	 shortened = true;
       }
-      *bytes = t - buff;
-   } else {
-      /* buffer becomes longer (up to double length), must alloc another space */
-      static unsigned char *buf2;	/*! not threadsafe */
-      unsigned char from;  unsigned char *s, *t, *z;
+   }
+   return shortened;
+}
 
-      if (lineterm1 == LINETERM_RAW) {
-	 from = '\n';
-      } else {
-	 from = '\r';
-      }
-      if (buf2 == NULL) {
-	 if ((buf2 = Malloc(socat_opts.bufsiz)) == NULL) {
-	    return -1;
-	 }
-      }
-      memcpy(buf2, buff, *bytes);
-      s = buf2;  t = buff;  z = buf2 + *bytes;
-      while (s < z) {
-	 if (*s == from) {
-	    *t++ = '\r'; *t++ = '\n';
-	    ++s;
-	    continue;
-	 } else {
-	    *t++ = *s++;
+/* writes out held back data whose latency budget has expired.
+   returns true when something was flushed */
+static bool socat_flushdue(void) {
+   xiofile_t *socks[2];
+   struct timeval delay;
+   bool flushed = false;
+   int i;
+
+   if (socat_flushdefer())  return false;
+   socks[0] = sock1;  socks[1] = sock2;
+   for (i = 0; i < 2; ++i) {
+      if (!XIO_WRITABLE(socks[i]) || xioflushdelay(socks[i], &delay) <= 0)
+	 continue;
+      if (delay.tv_sec == 0 && delay.tv_usec == 0) {
+	 if (xioflush(socks[i]) < 0) {
+	    Notice1("flushing socket %d is in error", i+1);
+	    closing = MAX(closing, 1);
 	 }
+	 flushed = true;
       }
-      *bytes = t - buff;;
    }
-   return 0;
+   return flushed;
 }
 
+
 void socat_signal(int signum) {
    int _errno;
    _errno = errno;
    diag_in_handler = 1;
    Notice1("socat_signal(): handling signal %d", signum);
+   xiostats_reason(128+signum, "signal");
    switch (signum) {
    case SIGILL:
    case SIGABRT:
@@ -49,13 +49,13 @@ mode_t Umask(mode_t mask) {
 
 int Open(const char *pathname, int flags, mode_t mode) {
    int result, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug3("open(\"%s\", 0%o, 0%03o)", pathname, flags, mode);
 #endif /* WITH_SYCLS */
    result = open(pathname, flags, mode);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Info4("open(\"%s\", 0%o, 0%03o) -> %d", pathname, flags, mode, result);
 #endif /* WITH_SYCLS */
@@ -539,13 +539,13 @@ int Pipe(int filedes[2]) {
 ssize_t Read(int fd, void *buf, size_t count) {
    ssize_t result;
    int _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug3("read(%d, %p, "F_Zu")", fd, buf, count);
 #endif /* WITH_SYCLS */
    result = read(fd, buf, count);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("read -> "F_Zd, result);
 #endif /* WITH_SYCLS */
@@ -556,13 +556,13 @@ ssize_t Read(int fd, void *buf, size_t count) {
 ssize_t Write(int fd, const void *buf, size_t count) {
    ssize_t result;
    int _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug3("write(%d, %p, "F_Zu")", fd, buf, count);
 #endif /* WITH_SYCLS */
    result = write(fd, buf, count);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("write -> "F_Zd, result);
 #endif /* WITH_SYCLS */
@@ -572,12 +572,12 @@ ssize_t Write(int fd, const void *buf, size_t count) {
 
 int Fcntl(int fd, int cmd) {
    int result, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug2("fcntl(%d, %d)", fd, cmd);
 #endif /* WITH_SYCLS */
    result = fcntl(fd, cmd);
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    _errno = errno;
    Debug1("fcntl() -> %d", result);
@@ -588,13 +588,13 @@ int Fcntl(int fd, int cmd) {
 
 int Fcntl_l(int fd, int cmd, long arg) {
    int result, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug3("fcntl(%d, %d, %ld)", fd, cmd, arg);
 #endif /* WITH_SYCLS */
    result = fcntl(fd, cmd, arg);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("fcntl() -> %d", result);
 #endif /* WITH_SYCLS */
@@ -604,14 +604,14 @@ int Fcntl_l(int fd, int cmd, long arg) {
 
 int Fcntl_lock(int fd, int cmd, struct flock *l) {
    int result, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug7("fcntl(%d, %d, {type=%hd,whence=%hd,start="F_off",len="F_off",pid="F_pid"})",
 	  fd, cmd, l->l_type, l->l_whence, l->l_start, l->l_len, l->l_pid);
 #endif /* WITH_SYCLS */
    result = fcntl(fd, cmd, l);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("fcntl() -> %d", result);
 #endif /* WITH_SYCLS */
@@ -648,13 +648,13 @@ int Ftruncate64(int fd, off64_t length) {
 #if HAVE_FLOCK
 int Flock(int fd, int operation) {
    int retval, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug2("flock(%d, %d)", fd, operation);
 #endif /* WITH_SYCLS */
    retval = flock(fd, operation);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("flock() -> %d", retval);
 #endif /* WITH_SYCLS */
@@ -665,7 +665,7 @@ int Flock(int fd, int operation) {
 
 int Ioctl(int d, int request, void *argp) {
    int retval, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    if (argp > (void *)0x10000) {	/* fuzzy...*/
       Debug4("ioctl(%d, 0x%x, %p{%lu})", d, request, argp, *(unsigned long *)argp);
@@ -675,7 +675,7 @@ int Ioctl(int d, int request, void *argp) {
 #endif /* WITH_SYCLS */
    retval = ioctl(d, request, argp);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    if (retval < 0)
       Debug2("ioctl() -> %d, errno=%d", retval, _errno);
@@ -688,13 +688,13 @@ int Ioctl(int d, int request, void *argp) {
 
 int Ioctl_int(int d, int request, int arg) {
    int retval, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug3("ioctl(%d, 0x%x, %d)", d, request, arg);
 #endif /* WITH_SYCLS */
    retval = ioctl(d, request, arg);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("ioctl() -> %d", retval);
 #endif /* WITH_SYCLS */
@@ -790,7 +790,7 @@ int Chmod(const char *path, mode_t mode) {
 /* we only show the first struct pollfd; hope this is enough for most cases. */
 int Poll(struct pollfd *ufds, unsigned int nfds, int timeout) {
    int _errno, result;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    if (nfds == 4) {
       Debug10("poll({%d,0x%02hx,}{%d,0x%02hx,}{%d,0x%02hx,}{%d,0x%02hx,}, %u, %d)",
@@ -803,7 +803,7 @@ int Poll(struct pollfd *ufds, unsigned int nfds, int timeout) {
 #endif /* WITH_SYCLS */
    result = poll(ufds, nfds, timeout);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    if (nfds == 4) {
       Debug5("poll(, {,,0x%02hx}{,,0x%02hx}{,,0x%02hx}{,,0x%02hx}) -> %d",
@@ -822,7 +822,7 @@ int Poll(struct pollfd *ufds, unsigned int nfds, int timeout) {
 int Select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
 	   struct timeval *timeout) {
    int result, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
 #if HAVE_FDS_BITS
    Debug7("select(%d, &0x%lx, &0x%lx, &0x%lx, %s%lu."F_tv_usec")",
@@ -840,7 +840,7 @@ int Select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
 #endif /* WITH_SYCLS */
    result = select(n, readfds, writefds, exceptfds, timeout);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
 #if HAVE_FDS_BITS
    Debug7("select -> (, 0x%lx, 0x%lx, 0x%lx, %s%lu."F_tv_usec"), %d",
@@ -867,7 +867,7 @@ int Select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
 int Pselect(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
 	    const struct timespec *timeout, const sigset_t *sigmask) {
    int result, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
 #if HAVE_FDS_BITS
    Debug8("pselect(%d, &0x%lx, &0x%lx, &0x%lx, %s%lu."F_tv_nsec", "F_sigset")",
@@ -885,7 +885,7 @@ int Pselect(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
 #endif /* WITH_SYCLS */
    result = pselect(n, readfds, writefds, exceptfds, timeout, sigmask);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
 #if HAVE_FDS_BITS
    Debug5("pselect -> (, 0x%lx, 0x%lx, 0x%lx), "F_sigset", %d",
@@ -923,13 +923,13 @@ pid_t Fork(void) {
 pid_t Waitpid(pid_t pid, int *status, int options) {
    int _errno;
    pid_t retval;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug3("waitpid("F_pid", %p, %d)", pid, status, options);
 #endif /* WITH_SYCLS */
    retval = waitpid(pid, status, options);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug2("waitpid(, {%d}, ) -> "F_pid, *status, retval);
 #endif /* WITH_SYCLS */
@@ -1089,7 +1089,7 @@ int Connect(int sockfd, const struct sockaddr *serv_addr, socklen_t addrlen) {
    int result, _errno;
    char infobuff[256];
 
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    /*sockaddr_info(serv_addr, infobuff, sizeof(infobuff));
    Debug3("connect(%d, %s, "F_Zd")", sockfd, infobuff, addrlen);*/
@@ -1114,7 +1114,7 @@ int Connect(int sockfd, const struct sockaddr *serv_addr, socklen_t addrlen) {
 #endif /* WITH_SYCLS */
    result = connect(sockfd, serv_addr, addrlen);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("connect() -> %d", result);
 #endif /* WITH_SYCLS */
@@ -1144,7 +1144,7 @@ int Listen(int s, int backlog) {
 int Accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
    int result, _errno;
    fd_set accept_s;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
    FD_ZERO(&accept_s);
    FD_SET(s, &accept_s);
    if (diag_select(s+1, &accept_s, NULL, NULL, NULL) < 0) {
@@ -1155,15 +1155,16 @@ int Accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
 #endif /* WITH_SYCLS */
    result = accept(s, addr, addrlen);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    if (result >= 0) {
-      char infobuff[256];
-      sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff));
-      Info5("accept(%d, {%d, %s}, "F_socklen") -> %d", s,
-	    addr->sa_family,
-	    sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff)),
-	    *addrlen, result);
+      if (diag_level(E_INFO)) {
+	 char infobuff[256];
+	 Info5("accept(%d, {%d, %s}, "F_socklen") -> %d", s,
+	       addr->sa_family,
+	       sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff)),
+	       *addrlen, result);
+      }
    } else {
       Debug1("accept(,,) -> %d", result);
    }
@@ -1175,6 +1176,34 @@ int Accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
 
 #if WITH_SYCLS
 
+#if _WITH_SOCKET && HAVE_ACCEPT4
+/* unlike Accept() this does not wait for a connection; use it with
+   nonblocking listening sockets */
+int Accept4(int s, struct sockaddr *addr, socklen_t *addrlen, int flags) {
+   int result, _errno;
+   Debug4("accept4(%d, %p, %p, 0x%x)", s, addr, addrlen, flags);
+   result = accept4(s, addr, addrlen, flags);
+   _errno = errno;
+   if (result >= 0) {
+      if (diag_level(E_INFO)) {
+	 char infobuff[256];
+	 Info6("accept4(%d, {%d, %s}, "F_socklen", 0x%x) -> %d", s,
+	       addr->sa_family,
+	       sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff)),
+	       *addrlen, flags, result);
+      }
+   } else {
+      Debug1("accept4(,,,) -> %d", result);
+   }
+   errno = _errno;
+   return result;
+}
+#endif /* _WITH_SOCKET && HAVE_ACCEPT4 */
+
+#endif /* WITH_SYCLS */
+
+#if WITH_SYCLS
+
 #if _WITH_SOCKET
 int Getsockname(int s, struct sockaddr *name, socklen_t *namelen) {
    int result, _errno;
@@ -1248,13 +1277,13 @@ int Setsockopt(int s, int level, int optname, const void *optval, int optlen) {
 #if _WITH_SOCKET
 int Recv(int s, void *buf, size_t len, int flags) {
    int retval, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug4("recv(%d, %p, "F_Zu", %d)", s, buf, len, flags);
 #endif /* WITH_SYCLS */
    retval = recv(s, buf, len, flags);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("recv() -> %d", retval);
 #endif /* WITH_SYCLS */
@@ -1268,21 +1297,21 @@ int Recvfrom(int s, void *buf, size_t len, int flags, struct sockaddr *from,
 	     socklen_t *fromlen) {
    int retval, _errno;
    char infobuff[256];
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug6("recvfrom(%d, %p, "F_Zu", %d, %p, "F_socklen")",
 	  s, buf, len, flags, from, *fromlen);
 #endif /* WITH_SYCLS */
    retval = recvfrom(s, buf, len, flags, from, fromlen);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
-   if (from) {
+   if (from && diag_level(E_DEBUG)) {
       Debug4("recvfrom(,,,, {%d,%s}, "F_socklen") -> %d",
 	     from->sa_family,
 	     sockaddr_info(from, *fromlen, infobuff, sizeof(infobuff)),
 	     *fromlen, retval);
-   } else {
+   } else if (!from) {
       Debug1("recvfrom(,,,, NULL, NULL) -> %d", retval);
    }
 #endif /* WITH_SYCLS */
@@ -1294,7 +1323,7 @@ int Recvfrom(int s, void *buf, size_t len, int flags, struct sockaddr *from,
 #if _WITH_SOCKET
 int Recvmsg(int s, struct msghdr *msgh, int flags) {
    int retval, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    char infobuff[256];
 #if defined(HAVE_STRUCT_MSGHDR_MSGCONTROL) && defined(HAVE_STRUCT_MSGHDR_MSGCONTROLLEN) && defined(HAVE_STRUCT_MSGHDR_MSGFLAGS)
@@ -1309,36 +1338,56 @@ int Recvmsg(int s, struct msghdr *msgh, int flags) {
 #endif /* WITH_SYCLS */
    retval = recvmsg(s, msgh, flags);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
+   if (diag_level(E_DEBUG)) {
 #if defined(HAVE_STRUCT_MSGHDR_MSGCONTROLLEN)
-   Debug5("recvmsg(, {%s,%u,,"F_Zu",,"F_Zu",}, ) -> %d",
-	  msgh->msg_name?sockaddr_info(msgh->msg_name, msgh->msg_namelen, infobuff, sizeof(infobuff)):"NULL",
-	  msgh->msg_namelen, msgh->msg_iovlen, msgh->msg_controllen,
-	  retval);
+      Debug5("recvmsg(, {%s,%u,,"F_Zu",,"F_Zu",}, ) -> %d",
+	     msgh->msg_name?sockaddr_info(msgh->msg_name, msgh->msg_namelen, infobuff, sizeof(infobuff)):"NULL",
+	     msgh->msg_namelen, msgh->msg_iovlen, msgh->msg_controllen,
+	     retval);
 #else
-   Debug4("recvmsg(, {%s,%u,,%u,,}, ) -> %d",
-	  msgh->msg_name?sockaddr_info(msgh->msg_name, msgh->msg_namelen, infobuff, sizeof(infobuff)):"NULL",
-	  msgh->msg_namelen, msgh->msg_iovlen,
-	  retval);
+      Debug4("recvmsg(, {%s,%u,,%u,,}, ) -> %d",
+	     msgh->msg_name?sockaddr_info(msgh->msg_name, msgh->msg_namelen, infobuff, sizeof(infobuff)):"NULL",
+	     msgh->msg_namelen, msgh->msg_iovlen,
+	     retval);
 #endif
+   }
 #endif /* WITH_SYCLS */
    errno = _errno;
    return retval;
 }
 #endif /* _WITH_SOCKET */
 
+#if _WITH_SOCKET && HAVE_RECVMMSG
+int Recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+   int retval, _errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug4("recvmmsg(%d, %p, %u, 0x%x)", s, msgvec, vlen, flags);
+#endif /* WITH_SYCLS */
+   retval = recvmmsg(s, msgvec, vlen, flags, NULL);
+   _errno = errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug1("recvmmsg() -> %d", retval);
+#endif /* WITH_SYCLS */
+   errno = _errno;
+   return retval;
+}
+#endif /* _WITH_SOCKET && HAVE_RECVMMSG */
+
 #if _WITH_SOCKET
 int Send(int s, const void *mesg, size_t len, int flags) {
    int retval, _errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug5("send(%d, %p[%08x...], "F_Zu", %d)",
 	  s, mesg, ntohl(*(unsigned long *)mesg), len, flags);
 #endif /* WITH_SYCLS */
    retval = send(s, mesg, len, flags);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("send() -> %d", retval);
 #endif /* WITH_SYCLS */
@@ -1353,15 +1402,17 @@ int Sendto(int s, const void *mesg, size_t len, int flags,
    int retval, _errno;
    char infobuff[256];
 
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
-   sockaddr_info(to, tolen, infobuff, sizeof(infobuff));
-   Debug7("sendto(%d, %p[%08x...], "F_Zu", %d, {%s}, %d)",
-	  s, mesg, htonl(*(unsigned long *)mesg), len, flags, infobuff, tolen);
+   if (diag_level(E_DEBUG)) {
+      sockaddr_info(to, tolen, infobuff, sizeof(infobuff));
+      Debug7("sendto(%d, %p[%08x...], "F_Zu", %d, {%s}, %d)",
+	     s, mesg, htonl(*(unsigned long *)mesg), len, flags, infobuff, tolen);
+   }
 #endif /* WITH_SYCLS */
    retval = sendto(s, mesg, len, flags, to, tolen);
    _errno = errno;
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("sendto() -> %d", retval);
 #endif /* WITH_SYCLS */
@@ -1370,6 +1421,61 @@ int Sendto(int s, const void *mesg, size_t len, int flags,
 }
 #endif /* _WITH_SOCKET */
 
+#if _WITH_SOCKET && HAVE_SENDMMSG
+int Sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+   int retval, _errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug4("sendmmsg(%d, %p, %u, 0x%x)", s, msgvec, vlen, flags);
+#endif /* WITH_SYCLS */
+   retval = sendmmsg(s, msgvec, vlen, flags);
+   _errno = errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug1("sendmmsg() -> %d", retval);
+#endif /* WITH_SYCLS */
+   errno = _errno;
+   return retval;
+}
+#endif /* _WITH_SOCKET && HAVE_SENDMMSG */
+
+#if HAVE_SYS_MMAN_H
+void *Mmap(void *addr, size_t length, int prot, int flags, int fd,
+	   off_t offset) {
+   void *retval;
+   int _errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug6("mmap(%p, "F_Zu", 0x%x, 0x%x, %d, "F_off")",
+	  addr, length, prot, flags, fd, offset);
+#endif /* WITH_SYCLS */
+   retval = mmap(addr, length, prot, flags, fd, offset);
+   _errno = errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug1("mmap() -> %p", retval);
+#endif /* WITH_SYCLS */
+   errno = _errno;
+   return retval;
+}
+
+int Munmap(void *addr, size_t length) {
+   int retval, _errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug2("munmap(%p, "F_Zu")", addr, length);
+#endif /* WITH_SYCLS */
+   retval = munmap(addr, length);
+   _errno = errno;
+   diag_flush_pending();
+#if WITH_SYCLS
+   Debug1("munmap() -> %d", retval);
+#endif /* WITH_SYCLS */
+   errno = _errno;
+   return retval;
+}
+#endif /* HAVE_SYS_MMAN_H */
+
 #if WITH_SYCLS
 
 #if _WITH_SOCKET
@@ -1691,7 +1797,7 @@ int Atexit(void (*func)(void)) {
 #endif /* WITH_SYCLS */
 
 void Exit(int status) {
-   if (!diag_in_handler) diag_flush();
+   diag_flush_pending();
 #if WITH_SYCLS
    Debug1("exit(%d)", status);
 #endif /* WITH_SYCLS */
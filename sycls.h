@@ -119,6 +119,9 @@ int Listen(int s, int backlog);
 #endif /* WITH_SYCLS */
 int Accept(int s, struct sockaddr *addr, socklen_t *addrlen);
 #if WITH_SYCLS
+#if HAVE_ACCEPT4
+int Accept4(int s, struct sockaddr *addr, socklen_t *addrlen, int flags);
+#endif
 int Getsockname(int s, struct sockaddr *name, socklen_t *namelen);
 int Getpeername(int s, struct sockaddr *name, socklen_t *namelen);
 int Getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen);
@@ -128,13 +131,24 @@ int Recv(int s, void *buf, size_t len, int flags);
 int Recvfrom(int s, void *buf, size_t len, int flags, struct sockaddr *from,
 	     socklen_t *fromlen);
 int Recvmsg(int s, struct msghdr *msg, int flags);
+#if HAVE_RECVMMSG
+int Recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
 int Send(int s, const void *mesg, size_t len, int flags);
 int Sendto(int s, const void *msg, size_t len, int flags,
 	   const struct sockaddr *to, socklen_t tolen);
+#if HAVE_SENDMMSG
+int Sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
 #if WITH_SYCLS
 int Shutdown(int fd, int how);
 #endif /* WITH_SYCLS */
 #endif /* _WITH_SOCKET */
+#if HAVE_SYS_MMAN_H
+void *Mmap(void *addr, size_t length, int prot, int flags, int fd,
+	   off_t offset);
+int Munmap(void *addr, size_t length);
+#endif /* HAVE_SYS_MMAN_H */
 #if WITH_SYCLS
 unsigned int Sleep(unsigned int seconds);
 unsigned int Nanosleep(const struct timespec *req, struct timespec *rem);
@@ -241,6 +255,9 @@ void Add_history(const char *string);
 #define Socket(d,t,p) socket(d,t,p)
 #define Bind(s,m,a) bind(s,m,a)
 #define Listen(s,b) listen(s,b)
+#if HAVE_ACCEPT4
+#define Accept4(s,a,l,f) accept4(s,a,l,f)
+#endif
 #define Getsockname(s,n,l) getsockname(s,n,l)
 #define Getpeername(s,n,l) getpeername(s,n,l)
 #define Getsockopt(s,d,n,v,l) getsockopt(s,d,n,v,l)
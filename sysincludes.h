@@ -75,6 +75,9 @@
 #if HAVE_SYS_WAIT_H
 #include <sys/wait.h>	/* WNOHANG */
 #endif
+#if HAVE_SYS_SIGNALFD_H
+#include <sys/signalfd.h>	/* signalfd() */
+#endif
 #if HAVE_FCNTL_H
 #include <fcntl.h>	/* open(), O_RDWR */
 #endif
@@ -93,6 +96,15 @@
 #if HAVE_SYS_FILE_H
 #include <sys/file.h>	/* LOCK_EX, on AIX directly included */
 #endif
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>	/* mmap() */
+#endif
+#if HAVE_PTHREAD_H
+#include <pthread.h>	/* threads of -la logging and -S statistics */
+#endif
+#if WITH_PROBES
+#include <sys/sdt.h>	/* DTRACE_PROBE() */
+#endif
 #if WITH_IP4 || WITH_IP6
 #  if HAVE_NETINET_IN_H
 #include <netinet/in.h>	/* struct sockaddr_in, htonl() */
@@ -108,6 +120,9 @@
 #  if HAVE_NETINET_TCP_H
 #include <netinet/tcp.h>	/* TCP_RFC1323 */
 #  endif
+#  if HAVE_NETINET_UDP_H
+#include <netinet/udp.h>	/* UDP_SEGMENT, UDP_GRO */
+#  endif
 #  if HAVE_NETINET_IP6_H && _WITH_IP6
 #include <netinet/ip6.h>
 #  endif
@@ -136,7 +151,9 @@
 #if HAVE_LINUX_ERRQUEUE_H
 #include <linux/errqueue.h>	/* struct sock_extended_err */
 #endif
-#if HAVE_NETPACKET_PACKET_H
+#if HAVE_LINUX_IF_PACKET_H
+#include <linux/if_packet.h>	/* netpacket/packet.h with PACKET_MMAP */
+#elif HAVE_NETPACKET_PACKET_H
 #include <netpacket/packet.h>
 #endif
 #if HAVE_NETINET_IF_ETHER_H
@@ -172,6 +189,9 @@
 #if HAVE_LINUX_EXT2_FS_H
 #include <linux/ext2_fs.h>	/* Linux ext2 filesystem definitions */
 #endif
+#if HAVE_LINUX_FILTER_H
+#include <linux/filter.h>	/* struct sock_filter, SKF_NET_OFF */
+#endif
 #if WITH_READLINE
 #  if HAVE_READLINE_READLINE_H
 #include <readline/readline.h>
@@ -16,6 +16,9 @@
 #include "utils.h"
 #include "sysutils.h"
 
+static struct writefull_stat writefull_stat0;
+struct writefull_stat *writefull_stat = &writefull_stat0;
+
 /* Substitute for Write():
    Try to write all bytes before returning; this handles EINTR,
    EAGAIN/EWOULDBLOCK, and partial write situations. The drawback is that this
@@ -35,11 +38,17 @@ ssize_t writefull(int fd, const void *buff, size_t bytes) {
 #if EAGAIN != EWOULDBLOCK
 	 case EWOULDBLOCK:
 #endif
+	    ++writefull_stat->again;
+	    if (bytes-writt > writefull_stat->backlog)
+	       writefull_stat->backlog = bytes-writt;
 	    Warn4("write(%d, %p, "F_Zu"): %s", fd, (const char *)buff+writt, bytes-writt, strerror(errno));
 	    Sleep(1); continue;
 	 default: return -1;
 	 }
       } else if (writt+chk < bytes) {
+	 ++writefull_stat->partial;
+	 if (bytes-writt-chk > writefull_stat->backlog)
+	    writefull_stat->backlog = bytes-writt-chk;
 	 Warn4("write(%d, %p, "F_Zu"): only wrote "F_Zu" bytes, trying to continue ",
 	       fd, (const char *)buff+writt, bytes-writt, chk);
 	 writt += chk;
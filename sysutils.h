@@ -43,6 +43,15 @@ struct xiorange {
 } ;
 #endif /* _WITH_SOCKET */
 
+/* writefull() counts its retries here; the statistics (option -S) let it point
+   into their table */
+struct writefull_stat {
+   unsigned long partial;	/* write() wrote only part of the data */
+   unsigned long again;		/* write() failed with EINTR or EAGAIN */
+   size_t backlog;	/* most bytes left after a short or failed write() */
+} ;
+
+extern struct writefull_stat *writefull_stat;
 extern ssize_t writefull(int fd, const void *buff, size_t bytes);
 
 #if _WITH_SOCKET
@@ -15728,6 +15728,1641 @@ esac
 N=$((N+1))
 
 
+# Test the OpenSSL options dynamic-records and coalesce: data written in small
+# and large chunks must arrive unmodified
+NAME=OPENSSL_DYNAMIC_RECORDS
+case "$TESTS" in
+*%$N%*|*%functions%*|*%openssl%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%$NAME%*)
+TEST="$NAME: OpenSSL with dynamic record sizing and write coalescing"
+# Start an OpenSSL echo server, send it about 200kB with client options
+# dynamic-records,coalesce; success when the echoed data is identical.
+if ! eval $NUMCOND; then :;
+elif ! testfeats openssl >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}OPENSSL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions dynamic-records coalesce); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats listen tcp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+gentestcert testsrv
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+ti="$td/test$N.input"
+seq 1 30000 >"$ti"
+CMD0="$TRACE $SOCAT $opts OPENSSL-LISTEN:$PORT,pf=ip4,$REUSEADDR,$SOCAT_EGD,cert=testsrv.crt,key=testsrv.key,verify=0,dynamic-records PIPE"
+CMD1="$TRACE $SOCAT $opts -b 3000 -t 1 - OPENSSL:$LOCALHOST:$PORT,pf=ip4,verify=0,$SOCAT_EGD,dynamic-records,coalesce=0.01"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+$CMD1 <"$ti" >"$tf" 2>"${te}1"
+rc1=$?
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! diff "$ti" "$tf" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    head -n 20 "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# Test option openssl-reload: after the certificate file of an OPENSSL-LISTEN
+# server has been replaced, new connections must use the new certificate
+NAME=OPENSSL_RELOAD
+case "$TESTS" in
+*%$N%*|*%functions%*|*%openssl%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: OpenSSL server reloads replaced certificate"
+# Start an OpenSSL echo server with fork,reload and the testsrv certificate;
+# connect with client verifying testsrv. Then replace the certificate file
+# with testcli and connect with client verifying testcli. Success when both
+# transfers succeed.
+if ! eval $NUMCOND; then :;
+elif ! testfeats openssl >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}OPENSSL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions openssl-reload); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats listen tcp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+gentestcert testsrv
+gentestcert testcli
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+tc="$td/test$N.pem"
+da="test$N $(date) $RANDOM"
+cp testsrv.pem "$tc"
+CMD0="$TRACE $SOCAT $opts OPENSSL-LISTEN:$PORT,pf=ip4,$REUSEADDR,fork,reload,$SOCAT_EGD,cert=$tc,verify=0 PIPE"
+CMD1="$TRACE $SOCAT $opts - OPENSSL:$LOCALHOST:$PORT,pf=ip4,cafile=testsrv.crt,$SOCAT_EGD"
+CMD2="$TRACE $SOCAT $opts - OPENSSL:$LOCALHOST:$PORT,pf=ip4,cafile=testcli.crt,$SOCAT_EGD"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+sleep 1	# let the file modification time differ
+cp testcli.pem "$tc"
+echo "$da" |$CMD2 >"${tf}2" 2>"${te}2"
+rc2=$?
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ $rc2 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "cp testcli.pem $tc"
+    echo "$CMD2"
+    cat "${te}0"
+    cat "${te}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "$da" |diff - "${tf}2" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD2"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+	echo "cp testcli.pem $tc"
+	echo "$CMD2"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1" "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# Test option openssl-snitable: the server name sent by the client selects
+# certificate and second address
+NAME=OPENSSL_SNITABLE
+case "$TESTS" in
+*%$N%*|*%functions%*|*%openssl%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: OpenSSL server selects certificate and address by SNI"
+# Start an OpenSSL server with certificate testsrv, address PIPE, and an SNI
+# table that maps *.example.test to certificate testcli and an echo command.
+# Connect with SNI name x.example.test verifying testcli. Success when the
+# command output arrives.
+if ! eval $NUMCOND; then :;
+elif ! testfeats openssl >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}OPENSSL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions openssl-snitable openssl-snihost); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats listen tcp ip4 system >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+gentestcert testsrv
+gentestcert testcli
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tt="$td/test$N.table"
+cat >"$tt" <<EOT
+# SNI table of test $N
+*.example.test	testcli.pem	-	SYSTEM:echo \$SOCAT_OPENSSL_SNI test$N
+EOT
+CMD0="$TRACE $SOCAT $opts OPENSSL-LISTEN:$PORT,pf=ip4,$REUSEADDR,$SOCAT_EGD,cert=testsrv.pem,verify=0,snitable=$tt PIPE"
+CMD1="$TRACE $SOCAT $opts - OPENSSL:$LOCALHOST:$PORT,pf=ip4,cafile=testcli.crt,snihost=x.example.test,$SOCAT_EGD"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+$CMD1 </dev/null >"$tf" 2>"${te}1"
+rc1=$?
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "x.example.test test$N" |diff - "$tf" >/dev/null; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    echo "x.example.test test$N" |diff - "$tf"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# Test option accept-batch: a forking listener gets a burst of connections and
+# must serve every one of them
+NAME=TCP4_ACCEPT_BATCH
+case "$TESTS" in
+*%$N%*|*%functions%*|*%fork%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: forking listener serves burst of connections with accept-batch"
+# Start a TCP4 listener with fork and accept-batch=8 that answers with an echo
+# command; start 20 clients at the same time. Success when each client received
+# its answer.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions accept-batch); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats listen tcp ip4 system >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+CMD0="$TRACE $SOCAT $opts TCP4-LISTEN:$PORT,$REUSEADDR,fork,accept-batch=8 SYSTEM:'echo test$N'"
+CMD1="$TRACE $SOCAT $opts -u TCP4:$LOCALHOST:$PORT -"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waittcp4port $PORT 1
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+    $CMD1 </dev/null >"$tf$i" 2>"${te}1.$i" &
+done
+wait $(jobs -p |grep -v "^$pid0\$") 2>/dev/null
+sleep 1
+kill $pid0 2>/dev/null; wait
+ok=0
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+    if [ "$(cat "$tf$i")" = "test$N" ]; then ok=$((ok+1)); fi
+done
+if [ $ok -ne 20 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (20 times)"
+    echo "only $ok of 20 clients were served"
+    cat "${te}0"
+    cat "${te}1".*
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 (20 times)"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1".*; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# Test option demux: one process relays the datagrams of each peer to its own
+# instance of the second address
+NAME=UDP4_DEMUX
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%ip4%*|*%recvfrom%*|*%$NAME%*)
+TEST="$NAME: UDP4-RECVFROM with demux keeps one flow per peer"
+# Start UDP4-RECVFROM with demux and a shell loop that prefixes each line with
+# its process id; two clients send two datagrams each. Success when each
+# client gets both answers from the same process, and the two clients from
+# different processes.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions demux); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats udp ip4 system >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}UDP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+CMD0="$TRACE $SOCAT $opts UDP4-RECVFROM:$PORT,demux SYSTEM:'while read l; do echo \$\$ \$l; done'"
+CMD1="$TRACE $SOCAT $opts -t 0.5 - UDP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waitudp4port $PORT 1
+(echo a; sleep 0.1; echo b) |$CMD1 >"${tf}1" 2>"${te}1" &
+pid1=$!
+(echo c; sleep 0.1; echo d) |$CMD1 >"${tf}2" 2>"${te}2"
+wait $pid1
+kill $pid0 2>/dev/null; wait
+p1a=$(head -n 1 "${tf}1" |cut -d' ' -f1); p1b=$(tail -n 1 "${tf}1" |cut -d' ' -f1)
+p2a=$(head -n 1 "${tf}2" |cut -d' ' -f1); p2b=$(tail -n 1 "${tf}2" |cut -d' ' -f1)
+if [ "$(cut -d' ' -f2 "${tf}1" |tr '\n' ' ')" != "a b " ] ||
+   [ "$(cut -d' ' -f2 "${tf}2" |tr '\n' ' ')" != "c d " ] ||
+   [ "$p1a" != "$p1b" -o "$p2a" != "$p2b" -o "$p1a" = "$p2a" ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (2 times)"
+    cat "${te}0" "${te}1" "${te}2"
+    cat "${tf}1" "${tf}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 (2 times)"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1" "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=UDP4_DGRAM_BATCH
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%ip4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP4 relay with dgram-batch keeps datagram boundaries"
+# A sender writes 100 datagrams of 100 bytes to a relay that reads and writes
+# them with dgram-batch; the receiver logs each datagram with -v. Success when
+# the data arrives unchanged and as 100 blocks of 100 bytes.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions dgram-batch); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats udp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}UDP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+ti="$td/test$N.datain"
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tsl=$PORT
+PORT=$((PORT+1))
+tsr=$PORT
+seq -w 1 2000 >"$ti"
+CMD0="$TRACE $SOCAT $opts -u -v -b 1000 UDP4-RECV:$tsr -"
+CMD1="$TRACE $SOCAT $opts -u -b 1000 UDP4-RECV:$tsl,dgram-batch=16 UDP4-SENDTO:$LOCALHOST:$tsr,dgram-batch=16"
+CMD2="$TRACE $SOCAT $opts -u -b 100 OPEN:$ti UDP4-SENDTO:$LOCALHOST:$tsl"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>"${te}0" &
+pid0=$!
+$CMD1 2>"${te}1" &
+pid1=$!
+waitudp4port $tsr 1
+waitudp4port $tsl 1
+$CMD2 2>"${te}2"
+sleep 0.5
+kill $pid1 $pid0 2>/dev/null; wait
+if ! cmp "$ti" "$tf" >/dev/null 2>&1 ||
+   [ "$(grep -c 'length=100 ' "${te}0")" -ne 100 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2"
+    cat "${te}1" "${te}2"
+    grep -v '^[0-9]' "${te}0" |head -n 20
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 &"
+	echo "$CMD2"
+    fi
+    if [ -n "$debug" ]; then cat "${te}1" "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=UDP4_GSO_GRO
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%ip4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP4 relay with udp-gro and udp-gso keeps datagram boundaries"
+# A sender writes datagrams of 100 bytes with udp-gso=100 and dgram-batch, so
+# they are joined to packets that the kernel cuts again; then another sender
+# writes one block of 1000 bytes with udp-gso=100 that must stay one datagram.
+# A relay reads them with udp-gro and writes them with udp-gso and
+# dgram-batch; the receiver logs each datagram with -v.
+# Success when the data arrives unchanged, as 100 blocks of 100 bytes and one
+# of 1000 bytes.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions udp-gso udp-gro dgram-batch); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats udp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}UDP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+ti="$td/test$N.datain"
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tsl=$PORT
+PORT=$((PORT+1))
+tsr=$PORT
+seq -w 1 2000 >"$ti"
+seq 1001 1200 >"${ti}3"
+CMD0="$TRACE $SOCAT $opts -u -v -b 1000 UDP4-RECV:$tsr -"
+CMD1="$TRACE $SOCAT $opts -u -b 1000 UDP4-RECV:$tsl,udp-gro,dgram-batch=16 UDP4-SENDTO:$LOCALHOST:$tsr,udp-gso=100,dgram-batch=16"
+CMD2="$TRACE $SOCAT $opts -u -b 100 OPEN:$ti UDP4-SENDTO:$LOCALHOST:$tsl,udp-gso=100,dgram-batch=64"
+CMD3="$TRACE $SOCAT $opts -u -b 1000 OPEN:${ti}3 UDP4-SENDTO:$LOCALHOST:$tsl,udp-gso=100"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>"${te}0" &
+pid0=$!
+$CMD1 2>"${te}1" &
+pid1=$!
+waitudp4port $tsr 1
+waitudp4port $tsl 1
+$CMD2 2>"${te}2"
+sleep 0.2
+$CMD3 2>"${te}3"
+sleep 0.5
+kill $pid1 $pid0 2>/dev/null; wait
+if ! cat "$ti" "${ti}3" |cmp - "$tf" >/dev/null 2>&1 ||
+   [ "$(grep -c 'length=100 ' "${te}0")" -ne 100 ] ||
+   [ "$(grep -c 'length=1000 ' "${te}0")" -ne 1 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2"
+    echo "$CMD3"
+    cat "${te}1" "${te}2" "${te}3"
+    grep -v '^[0-9]' "${te}0" |head -n 20
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 &"
+	echo "$CMD2"
+	echo "$CMD3"
+    fi
+    if [ -n "$debug" ]; then cat "${te}1" "${te}2" "${te}3"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=UDP4_RECV_WORKERS
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%ip4%*|*%recv%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: UDP4-RECV with workers and workers-bpf"
+# UDP4-RECV with workers=2 and workers-bpf appends the packets to a file.
+# With workers-bpf, a packet from 127.0.0.1 goes to worker 1 when its source
+# port is odd and to worker 2 when it is even. Two packets are sent from
+# consecutive source ports.
+# Success when both packets arrive and each worker reports one packet.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions workers workers-bpf); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats udp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}UDP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+ts=$PORT
+PORT=$((PORT+1))
+tsp1=$PORT
+PORT=$((PORT+1))
+tsp2=$PORT
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -u UDP4-RECV:$ts,workers=2,workers-bpf OPEN:$tf,creat,append"
+CMD1="$TRACE $SOCAT $opts -u - UDP4-SENDTO:$LOCALHOST:$ts,sourceport=$tsp1"
+CMD2="$TRACE $SOCAT $opts -u - UDP4-SENDTO:$LOCALHOST:$ts,sourceport=$tsp2"
+printf "test $F_n $TEST... " $N
+rm -f "$tf"
+$CMD0 2>"${te}0" &
+pid0=$!
+waitudp4port $ts 1
+sleep 0.2	# the second worker binds after the first one
+echo "$da 1" |$CMD1 2>"${te}1"
+echo "$da 2" |$CMD2 2>"${te}2"
+sleep 0.2
+kill $pid0 2>/dev/null; wait $pid0 2>/dev/null
+sleep 0.2
+if ! echo -e "$da 1\n$da 2" |diff - <(sort "$tf") >"$tdiff" ||
+   ! grep -q "worker 1: received 1 packets" "${te}0" ||
+   ! grep -q "worker 2: received 1 packets" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    echo "$CMD2"
+    cat "${te}0" "${te}1" "${te}2"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+	echo "$CMD2"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1" "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=UDP4_FRAMING_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%framing%*|*%$NAME%*)
+TEST="$NAME: UDP4 datagrams over TCP4 with framing=len16"
+# A client relays datagrams from UDP4-RECV to a TCP connection with option
+# framing=len16; the server relays the records to UDP4-SENDTO, and a receiver
+# logs each datagram with -v. The sender writes 200 datagrams of 120 bytes.
+# Success when the data arrives unchanged and as 200 blocks of 120 bytes.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions framing); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats udp tcp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}UDP/TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+ti="$td/test$N.datain"
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tsr=$PORT
+PORT=$((PORT+1))
+tst=$PORT
+PORT=$((PORT+1))
+tsc=$PORT
+seq -w 1 4800 >"$ti"
+CMD0="$TRACE $SOCAT $opts -u -v -b 1000 UDP4-RECV:$tsr,so-rcvbuf=1048576 -"
+CMD1="$TRACE $SOCAT $opts -u TCP4-LISTEN:$tst,$REUSEADDR,framing=len16 UDP4-SENDTO:$LOCALHOST:$tsr"
+CMD2="$TRACE $SOCAT $opts -u UDP4-RECV:$tsc,so-rcvbuf=1048576 TCP4:$LOCALHOST:$tst,framing=len16"
+CMD3="$TRACE $SOCAT $opts -u -b 120 OPEN:$ti UDP4-SENDTO:$LOCALHOST:$tsc"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>"${te}0" &
+pid0=$!
+$CMD1 2>"${te}1" &
+pid1=$!
+waitudp4port $tsr 1
+waittcp4port $tst 1
+$CMD2 2>"${te}2" &
+pid2=$!
+waitudp4port $tsc 1
+$CMD3 2>"${te}3"
+sleep 0.5
+kill $pid2 2>/dev/null; wait $pid2 $pid1 2>/dev/null
+kill $pid0 2>/dev/null; wait
+if ! cmp "$ti" "$tf" >/dev/null 2>&1 ||
+   [ "$(grep -c 'length=120 ' "${te}0")" -ne 200 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2 &"
+    echo "$CMD3"
+    cat "${te}1" "${te}2" "${te}3"
+    grep -v '^[0-9]' "${te}0" |head -n 20
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 &"
+	echo "$CMD2 &"
+	echo "$CMD3"
+    fi
+    if [ -n "$debug" ]; then cat "${te}1" "${te}2" "${te}3"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=TUN_QUEUES
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tun%*|*%root%*|*%$NAME%*)
+TEST="$NAME: TUN interface with tun-queues=2 and tun-vnet-hdr"
+# Create a TUN interface with two queues, each read by a worker process that
+# appends the packets to a file. Send datagrams from eight source ports to an
+# address of its network. Success when all datagrams arrive and both workers
+# report; with tun-vnet-hdr the packets have a header but the payload is still
+# at their end.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats ip4 tun) || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions tun-queues tun-vnet-hdr); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif [ $(id -u) -ne 0 -a "$withroot" -eq 0 ]; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}must be root${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tl="$td/test$N.lock"
+da="test$N $(date) $RANDOM"
+TUNNET=10.255.254
+CMD0="$TRACE $SOCAT $opts -d -d -u -L $tl TUN:$TUNNET.1/24,iff-up,iff-no-pi,tun-queues=2,tun-vnet-hdr OPEN:$tf,creat,append"
+printf "test $F_n $TEST... " $N
+$CMD0 2>"${te}0" &
+sleep 1
+rc1=0
+for i in 1 2 3 4 5 6 7 8; do
+    echo "$da $i" |$TRACE $SOCAT $opts -u - UDP4-SENDTO:$TUNNET.2:$PORT,sourceport=$((PORT+i)) 2>>"${te}1" || rc1=1
+done
+sleep 1
+kill "$(cat $tl 2>/dev/null)" 2>/dev/null
+wait
+ok=1
+for i in 1 2 3 4 5 6 7 8; do
+    grep -a -q "$da $i" "$tf" || ok=0
+done
+if [ "$rc1" -ne 0 ]; then
+    $PRINTF "$FAILED: $TRACE $SOCAT:\n"
+    echo "$CMD0 &"
+    cat "${te}0" "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$ok" -ne 1 ] ||
+     ! grep -q "worker 1: received" "${te}0" ||
+     ! grep -q "worker 2: received" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    cat "${te}0" "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+10))
+N=$((N+1))
+
+# use the INTERFACE address with PACKET_MMAP rings on a tun device and transfer
+# data fully transparent
+NAME=INTERFACE_PACKET_RING
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tun%*|*%interface%*|*%root%*|*%$NAME%*)
+TEST="$NAME: INTERFACE with packet-rx-ring, packet-tx-ring, packet-fanout"
+# Like TUNINTERFACE, but the INTERFACE address writes the packet into its
+# transmit ring and reads the echo from its receive ring. Success when the
+# data come back unmodified and socat reports the mapped rings.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats ip4 tun interface) || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions packet-rx-ring packet-tx-ring packet-fanout); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif [ $(id -u) -ne 0 -a "$withroot" -eq 0 ]; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}must be root${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+tl="$td/test$N.lock"
+da="test$N $(date) $RANDOM"
+TUNNET=10.255.253
+TUNNAME=tun8
+CMD1="$TRACE $SOCAT $opts -L $tl TUN:$TUNNET.1/24,iff-up=1,tun-type=tun,tun-name=$TUNNAME echo"
+CMD="$TRACE $SOCAT $opts -d -d -d - INTERFACE:$TUNNAME,packet-rx-ring,packet-tx-ring,packet-fanout=hash"
+printf "test $F_n $TEST... " $N
+$CMD1 2>"${te}1" &
+pid1="$!"
+sleep 1
+echo "$da" |$CMD >"$tf" 2>"${te}"
+rc=$?
+kill $pid1 2>/dev/null
+wait
+if [ $rc -ne 0 ]; then
+    $PRINTF "$FAILED: $TRACE $SOCAT:\n"
+    echo "$CMD1 &"
+    echo "$CMD"
+    cat "${te}1" "${te}"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "$da" |diff - "$tf" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD1 &"
+    echo "$CMD"
+    cat "$tdiff"
+    cat "${te}1" "${te}"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q "mapped receive and transmit ring" "${te}"; then
+    $PRINTF "$FAILED (no rings)\n"
+    echo "$CMD1 &"
+    echo "$CMD"
+    cat "${te}"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1" "${te}"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=IP4_DGRAM_BATCH
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%rawip%*|*%rawip4%*|*%recv%*|*%root%*|*%$NAME%*)
+TEST="$NAME: raw IPv4 relay with dgram-batch keeps packet boundaries"
+# Like UDP4_DGRAM_BATCH, but over raw IPv4: a sender writes 100 packets of 100
+# bytes to a relay that reads and writes them with dgram-batch; the receiver
+# logs each packet with -v. Both raw receivers strip the IP header. Success
+# when the data arrives unchanged and as 100 blocks of 100 bytes.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats ip4 rawip) || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions dgram-batch); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif [ $(id -u) -ne 0 -a "$withroot" -eq 0 ]; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}must be root${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+ti="$td/test$N.datain"
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+# PROTO is reused as a name by earlier tests; take the protocol numbers for
+# experimentation (RFC 3692)
+tpl=253
+tpr=254
+seq -w 1 2000 >"$ti"
+CMD0="$TRACE $SOCAT $opts -u -v -b 1000 IP4-RECV:$tpr -"
+CMD1="$TRACE $SOCAT $opts -u -b 1000 IP4-RECV:$tpl,dgram-batch=16 IP4-SENDTO:127.0.0.1:$tpr,dgram-batch=16"
+CMD2="$TRACE $SOCAT $opts -u -b 100 OPEN:$ti IP4-SENDTO:127.0.0.1:$tpl"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>"${te}0" &
+pid0=$!
+$CMD1 2>"${te}1" &
+pid1=$!
+waitip4proto $tpr 1
+waitip4proto $tpl 1
+$CMD2 2>"${te}2"
+sleep 0.5
+kill $pid1 $pid0 2>/dev/null; wait
+if ! cmp "$ti" "$tf" >/dev/null 2>&1 ||
+   [ "$(grep -c 'length=100 ' "${te}0")" -ne 100 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2"
+    cat "${te}1" "${te}2"
+    grep -v '^[0-9]' "${te}0" |head -n 20
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 &"
+	echo "$CMD2"
+    fi
+    if [ -n "$debug" ]; then cat "${te}1" "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+N=$((N+1))
+
+# Test if option -la (asynchronous logging) writes the same messages as
+# synchronous logging
+NAME=ASYNCLOG
+case "$TESTS" in
+*%$N%*|*%functions%*|*%$NAME%*)
+TEST="$NAME: asynchronous logging with option -la"
+# Transfer data with -d -d -d, once without and once with option -la; the
+# data must arrive, and the log messages without time and process id must be
+# identical and in the same order
+if ! eval $NUMCOND; then :; else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d - PIPE"
+CMD1="$TRACE $SOCAT $opts -d -d -d -la - PIPE"
+printf "test $F_n $TEST... " $N
+echo "$da" |$CMD0 >${tf}0 2>"${te}0"
+rc0=$?
+echo "$da" |$CMD1 >${tf}1 2>"${te}1"
+rc1=$?
+if grep -q "option -la) not available" "${te}1"; then
+    $PRINTF "$CANT (no POSIX threads)\n"
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif [ $rc0 -ne 0 -o $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0"
+    cat "${te}0"
+    echo "$CMD1"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "$da" |diff - ${tf}1 >$tdiff; then
+    $PRINTF "$FAILED (data)\n"
+    echo "$CMD1"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif sed 's/^[^]]*\] //' "${te}0" >"${te}0.text" &&
+     sed 's/^[^]]*\] //' "${te}1" >"${te}1.text" &&
+     ! diff "${te}0.text" "${te}1.text" >$tdiff; then
+    $PRINTF "$FAILED (log messages)\n"
+    echo "$CMD0"
+    echo "$CMD1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+# Test the formats of the time stamps of log messages: date and time, with
+# option -lu plus microseconds, with option -lr seconds since start
+NAME=LOG_TIMESTAMPS
+case "$TESTS" in
+*%$N%*|*%functions%*|*%$NAME%*)
+TEST="$NAME: log time stamp formats with options -lu and -lr"
+if ! eval $NUMCOND; then :; else
+te="$td/test$N.stderr"
+CMD0="$TRACE $SOCAT $opts -d -d /dev/null /dev/null"
+CMD1="$TRACE $SOCAT $opts -d -d -lu /dev/null /dev/null"
+CMD2="$TRACE $SOCAT $opts -d -d -lr /dev/null /dev/null"
+printf "test $F_n $TEST... " $N
+$CMD0 2>"${te}0"
+rc0=$?
+$CMD1 2>"${te}1"
+rc1=$?
+$CMD2 2>"${te}2"
+rc2=$?
+if [ $rc0 -ne 0 -o $rc1 -ne 0 -o $rc2 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0"; cat "${te}0"
+    echo "$CMD1"; cat "${te}1"
+    echo "$CMD2"; cat "${te}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif grep -v -E '^[0-9]{4}/[0-9]{2}/[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2} socat\[' "${te}0" >/dev/null ||
+     grep -v -E '^[0-9]{4}/[0-9]{2}/[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}\.[0-9]{6} socat\[' "${te}1" >/dev/null ||
+     grep -v -E '^ *[0-9]+\.[0-9]{6} socat\[' "${te}2" >/dev/null; then
+    $PRINTF "$FAILED (format)\n"
+    cat "${te}0" "${te}1" "${te}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+# Test that the socat executable carries the static tracepoints (USDT) that
+# doc/socat.yo lists: readelf -n shows one stapsdt note per probe site
+NAME=USDT_PROBES
+case "$TESTS" in
+*%$N%*|*%functions%*|*%$NAME%*)
+TEST="$NAME: static tracepoints of provider socat"
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats probes); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! type readelf >/dev/null 2>&1; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}readelf not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+CMD0="readelf -n $(type -p $SOCAT)"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>&1
+rc0=$?
+missing=
+for p in transfer_read transfer_write eof accept connect_start connect_done \
+	 socks4_request socks4_reply socks5_method socks5_select \
+	 socks5_request socks5_reply proxy_request proxy_reply shutdown \
+	 child_exit; do
+    grep -q "Name: $p\$" "$tf" || missing="$missing $p"
+done
+if [ $rc0 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0"
+    cat "$tf"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$missing" ]; then
+    $PRINTF "$FAILED (missing:$missing)\n"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+# Test the statistics socket (option -S) of a forking listener: the children
+# report their counters to the parent, which serves them as JSON and as
+# Prometheus text
+NAME=STATS_FORK
+case "$TESTS" in
+*%$N%*|*%functions%*|*%fork%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%unix%*|*%$NAME%*)
+TEST="$NAME: statistics of a forking listener with option -S"
+# An echo server listens on one port; a relay with -S listens on another port
+# with fork and connects to the echo server. One client stays connected while
+# another one transfers its data and terminates. The JSON form must show two
+# connections, one of them active, with both data and two timed connect()
+# calls; the Prometheus form must list the remaining connection.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats stats tcp ip4 unix); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+ts="$td/test$N.sock"
+tse=$PORT
+PORT=$((PORT+1))
+tsr=$PORT
+CMD0="$TRACE $SOCAT $opts TCP4-LISTEN:$tse,$REUSEADDR,fork PIPE"
+CMD1="$TRACE $SOCAT $opts -S $ts TCP4-LISTEN:$tsr,$REUSEADDR,fork TCP4:$LOCALHOST:$tse"
+CMD2="$TRACE $SOCAT $opts - TCP4:$LOCALHOST:$tsr"
+CMD3="$TRACE $SOCAT $opts - UNIX-CONNECT:$ts"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waittcp4port $tse 1
+waittcp4port $tsr 1
+(echo ABC; sleep 3) |$CMD2 >"${tf}2a" 2>"${te}2a" &
+pid2=$!
+echo DEFGH |$CMD2 >"${tf}2b" 2>"${te}2b"
+sleep 1
+echo json |$CMD3 >"${tf}3j" 2>"${te}3j"
+$CMD3 </dev/null >"${tf}3p" 2>"${te}3p"
+kill $pid2 $pid1 $pid0 2>/dev/null; wait
+if ! grep -q '"connections":{"total":2,"active":1},"bytes":{"left_to_right":10,"right_to_left":10}' "${tf}3j" ||
+   ! grep -q '"connect":{"count":2,' "${tf}3j"; then
+    $PRINTF "$FAILED (JSON)\n"
+    echo "$CMD1 &"
+    echo "echo json |$CMD3"
+    cat "${te}1" "${te}3j" "${tf}3j"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q '^socat_connections_active 1$' "${tf}3p" ||
+     ! grep -q '^socat_connection_bytes{pid="[0-9]*",direction="right_to_left"} 4$' "${tf}3p"; then
+    $PRINTF "$FAILED (Prometheus)\n"
+    echo "$CMD1 &"
+    echo "$CMD3 </dev/null"
+    cat "${te}1" "${te}3p" "${tf}3p"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 &"
+	echo "$CMD2"
+	echo "$CMD3"
+    fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test the latency histograms (option -H): a forking listener logs the
+# histograms of its child processes on SIGUSR2 and at exit; the client logs
+# its own ones with the connect phase
+NAME=LATENCY_HIST
+case "$TESTS" in
+*%$N%*|*%functions%*|*%fork%*|*%signal%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%$NAME%*)
+TEST="$NAME: latency histograms with option -H"
+# A listener with -H and fork echoes the data of one client, that also has
+# option -H. Then the listener gets SIGUSR2 and afterwards SIGTERM; it must
+# have logged the relay delays of its child twice, the client its connect
+# phase.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats stats tcp ip4); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -H TCP4-LISTEN:$PORT,$REUSEADDR,fork PIPE"
+CMD1="$TRACE $SOCAT $opts -d -d -H - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+sleep 1
+kill -USR2 $pid0 2>/dev/null
+sleep 1
+kill $pid0 2>/dev/null; wait
+if [ "$rc1" -ne 0 ] || ! echo "$da" |diff - "${tf}1" >"$tdiff"; then
+    $PRINTF "$FAILED (transfer)\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0" "${te}1" "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$(grep -c "socat\[$pid0\] N latency relay: n=2 " "${te}0")" -ne 2 ] ||
+     ! grep -q "socat\[$pid0\] N latency fork: n=1 " "${te}0"; then
+    $PRINTF "$FAILED (listener)\n"
+    echo "$CMD0 &"
+    cat "${te}0"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q " N latency connect: n=1 mean=[0-9]*ns p50=" "${te}1"; then
+    $PRINTF "$FAILED (client)\n"
+    echo "$CMD1"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+    fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test the connection summary records (option -C) of a forking listener and
+# of a client
+NAME=CONN_SUMMARY
+case "$TESTS" in
+*%$N%*|*%functions%*|*%fork%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%$NAME%*)
+TEST="$NAME: connection summary records with option -C"
+# A listener with option -C and fork echoes the data of a client that also has
+# option -C with the same file. Both records must be complete JSON lines with
+# the byte counts and the EOF order; the client record has timed the connect
+# phase.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testfeats stats tcp ip4); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+ts="$td/test$N.jsonl"
+CMD0="$TRACE $SOCAT $opts -C $ts TCP4-LISTEN:$PORT,$REUSEADDR,fork PIPE"
+CMD1="$TRACE $SOCAT $opts -C $ts - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo ABCDEFG |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+sleep 1
+kill $pid0 2>/dev/null; wait
+if [ "$rc1" -ne 0 ] || [ "$(wc -l <"$ts")" -ne 2 ]; then
+    $PRINTF "$FAILED (records)\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0" "${te}1" "$ts"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q '"address2":"PIPE",.*"bytes":{"left_to_right":8,"right_to_left":8},"chunks":{"left_to_right":1,"right_to_left":1},"avg_chunk":{"left_to_right":8.0,.*"eof":\["left_to_right","right_to_left"\],"exit":{"status":0,"reason":"eof"}}$' "$ts" ||
+     ! grep -q '"address1":"-",.*"phases":{"resolve":[0-9.]*,"connect":[0-9.]*},.*"exit":{"status":0,"reason":"eof"}}$' "$ts"; then
+    $PRINTF "$FAILED (contents)\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "$ts"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+    fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test the supervision of the children of a forking listener: they must be
+# reaped while the listener waits for the next client, and their lifetimes
+# are logged
+NAME=FORK_CHILD_REAP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%fork%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: forking listener reaps its children and logs their lifetime"
+# Start a TCP4 listener with fork and -d -d -d that answers with an echo
+# command; connect five clients one after the other. Success when the listener
+# logged the lifetime of five children, the last one with no children left,
+# and has no zombie children.
+if ! eval $NUMCOND; then :;
+elif ! testfeats listen tcp ip4 system >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+CMD0="$TRACE $SOCAT $opts -d -d -d TCP4-LISTEN:$PORT,$REUSEADDR,fork SYSTEM:'echo test$N'"
+CMD1="$TRACE $SOCAT $opts -u TCP4:$LOCALHOST:$PORT -"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waittcp4port $PORT 1
+for i in 1 2 3 4 5; do
+    $CMD1 </dev/null >>"$tf" 2>>"${te}1"
+done
+sleep 1
+zombies=$(ps -e -o ppid= -o stat= |grep -c "^ *$pid0 *Z")
+kill $pid0 2>/dev/null; wait
+# the SYSTEM sub processes are socat too and log into the same file
+nlived=$(grep -c "socat\[$pid0\] I child [0-9]* lived [0-9.]*s, [0-9]* children left" "${te}0")
+if [ "$(grep -c "^test$N\$" "$tf")" -ne 5 ]; then
+    $PRINTF "$FAILED (clients)\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (5 times)"
+    cat "${te}0" "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$nlived" -ne 5 ] || [ "$zombies" -ne 0 ] ||
+     ! grep "socat\[$pid0\] I child [0-9]* lived " "${te}0" |tail -n 1 |grep -q ", 0 children left"; then
+    $PRINTF "$FAILED (reaping)\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (5 times)"
+    echo "$nlived children logged, $zombies zombies"
+    grep " I child " "${te}0"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 (5 times)"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test option demux while a new flow takes long to open: the flows are opened
+# synchronously, so established flows stall meanwhile, but none of their
+# datagrams may get lost
+NAME=UDP4_DEMUX_SLOWOPEN
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%ip4%*|*%recvfrom%*|*%proxy%*|*%$NAME%*)
+TEST="$NAME: UDP4-RECVFROM with demux keeps established flows while a flow opens"
+# Start UDP4-RECVFROM with demux and PROXY as second address; the proxy echo
+# server waits 2s before it answers a CONNECT request. A first client sends ten
+# datagrams in 5s; after 3s a second client opens another flow. Success when
+# the first client gets all its datagrams back, and the second its one.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions demux); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testfeats udp tcp ip4 listen proxy system); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$(echo "$feat" |tr 'a-z' 'A-Z') not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+PORT2=$((PORT+1))
+CMD2="$TRACE $SOCAT $opts TCP4-L:$PORT2,$REUSEADDR,fork,crlf SYSTEM:'sleep 2; exec /usr/bin/env bash proxyecho.sh'"
+CMD0="$TRACE $SOCAT $opts UDP4-RECVFROM:$PORT,demux PROXY:$LOCALHOST:127.0.0.1:80,proxyport=$PORT2"
+CMD1="$TRACE $SOCAT $opts -t 4 - UDP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+eval "$CMD2 >/dev/null 2>\"${te}2\" &"
+pid2=$!
+waittcp4port $PORT2 1
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waitudp4port $PORT 1
+(for i in 1 2 3 4 5 6 7 8 9 10; do echo A$i; sleep 0.5; done) |$CMD1 >"${tf}1" 2>"${te}1" &
+pid1=$!
+sleep 3
+echo B |$CMD1 >"${tf}3" 2>"${te}3"
+wait $pid1
+kill $pid0 $pid2 2>/dev/null; wait
+if [ "$(tr -d '\r' <"${tf}1" |tr '\n' ' ')" != "A1 A2 A3 A4 A5 A6 A7 A8 A9 A10 " ] ||
+   [ "$(tr -d '\r' <"${tf}3")" != "B" ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD2 &"
+    echo "$CMD0 &"
+    echo "$CMD1 (2 times)"
+    cat "${te}2" "${te}0" "${te}1" "${te}3"
+    cat "${tf}1" "${tf}3"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD2 &"
+	echo "$CMD0 &"
+	echo "$CMD1 (2 times)"
+    fi
+    if [ -n "$debug" ]; then cat "${te}2" "${te}0" "${te}1" "${te}3"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+2))
+N=$((N+1))
+
+# Test that options are applied in the order of the old linear scan of the
+# options array: an option given twice is applied twice in the given order, and
+# an option of a later phase (rcvbuf-late) follows one of an earlier phase
+# (rcvbuf) even when it was given first; also in each child of fork
+NAME=OPTS_ORDER_FORK
+case "$TESTS" in
+*%$N%*|*%functions%*|*%fork%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%listen%*|*%socket%*|*%$NAME%*)
+TEST="$NAME: options given twice and of several phases keep their order with fork"
+# Start a TCP4 listener with fork and -d -d -d -d with options rcvbuf-late and
+# rcvbuf given twice, in mixed order, and sndbuf in between; connect two
+# clients one after the other. Success when the setsockopt() calls logged
+# come in the order: rcvbuf, sndbuf, rcvbuf on the listening socket, then
+# rcvbuf-late twice in each child.
+if ! eval $NUMCOND; then :;
+elif ! testfeats listen tcp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+# 20001=0x4e21 12001=0x2ee1 9001=0x2329 16001=0x3e81 24001=0x5dc1
+CMD0="$TRACE $SOCAT $opts -d -d -d -d -u TCP4-LISTEN:$PORT,$REUSEADDR,fork,rcvbuf-late=20001,rcvbuf=12001,sndbuf=9001,rcvbuf=16001,rcvbuf-late=24001 /dev/null"
+CMD1="$TRACE $SOCAT $opts -u - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "test$N" |$CMD1 >"$tf" 2>"${te}1"
+rc1=$?
+sleep 0.5
+echo "test$N" |$CMD1 >>"$tf" 2>>"${te}1"
+rc2=$?
+sleep 0.5
+kill $pid0 2>/dev/null; wait
+order="$(sed -n 's/.* D setsockopt([0-9]*, [0-9]*, [0-9]*, {0x\([0-9a-f]*\)}, .*/\1/p' "${te}0" |grep -E '^(4e21|2ee1|2329|3e81|5dc1)$' |tr '\n' ' ')"
+expect="2ee1 2329 3e81 4e21 5dc1 4e21 5dc1 "
+if [ "$rc1" -ne 0 ] || [ "$rc2" -ne 0 ]; then
+    $PRINTF "$FAILED (clients)\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (2 times)"
+    cat "${te}0" "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$order" != "$expect" ]; then
+    $PRINTF "$FAILED (order)\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (2 times)"
+    echo "setsockopt() values: $order"
+    echo "expected:            $expect"
+    grep " D setsockopt(" "${te}0"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 (2 times)"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test that each retry of a client applies the options again, in the order of
+# the old linear scan, from a fresh copy of the options
+NAME=OPTS_ORDER_RETRY
+case "$TESTS" in
+*%$N%*|*%functions%*|*%retry%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%socket%*|*%$NAME%*)
+TEST="$NAME: options given twice keep their order in each retry"
+# Connect with TCP4, retry=2, and options rcvbuf given twice with sndbuf in
+# between to a port where no one listens. Success when socat fails after three
+# connect attempts, each preceded by the setsockopt() calls rcvbuf, sndbuf,
+# rcvbuf.
+if ! eval $NUMCOND; then :;
+elif ! testfeats tcp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+te="$td/test$N.stderr"
+# 12002=0x2ee2 9002=0x232a 16002=0x3e82
+CMD0="$TRACE $SOCAT $opts -d -d -d -d -u /dev/null TCP4:$LOCALHOST:$PORT,retry=2,interval=0.1,rcvbuf=12002,sndbuf=9002,rcvbuf=16002"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0"
+rc0=$?
+order="$(sed -n 's/.* D setsockopt([0-9]*, [0-9]*, [0-9]*, {0x\([0-9a-f]*\)}, .*/\1/p; s/.* D \(connect\)([0-9].*/\1/p' "${te}0" |grep -E '^(2ee2|232a|3e82|connect)$' |tr '\n' ' ')"
+expect="2ee2 232a 3e82 connect 2ee2 232a 3e82 connect 2ee2 232a 3e82 connect "
+if [ "$rc0" -eq 0 ]; then
+    $PRINTF "$FAILED (connected)\n"
+    echo "$CMD0"
+    cat "${te}0"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$order" != "$expect" ]; then
+    $PRINTF "$FAILED (order)\n"
+    echo "$CMD0"
+    echo "calls:    $order"
+    echo "expected: $expect"
+    grep -E " D (setsockopt|connect)\(" "${te}0"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then echo "$CMD0"; fi
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test option openssl-snitable with verify=1: the connection keeps the verify
+# settings and cafile of the listener when SNI switches the certificate
+NAME=OPENSSL_SNITABLE_VERIFY
+case "$TESTS" in
+*%$N%*|*%functions%*|*%openssl%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: OpenSSL server with SNI table verifies client certificate"
+# Start an OpenSSL server with certificate testsrv, verify=1, cafile testsrv,
+# and an SNI table that maps x.example.test to certificate testcli. Connect
+# with SNI name x.example.test verifying testcli, once with client certificate
+# testsrv, once without one. Success when the first client gets its data
+# echoed and the second is rejected.
+if ! eval $NUMCOND; then :;
+elif ! testfeats openssl >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}OPENSSL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! feat=$(testoptions openssl-snitable openssl-snihost); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats listen tcp ip4 >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+gentestcert testsrv
+gentestcert testcli
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tt="$td/test$N.table"
+cat >"$tt" <<EOT
+# SNI table of test $N
+x.example.test	testcli.pem
+EOT
+CMD0="$TRACE $SOCAT $opts OPENSSL-LISTEN:$PORT,pf=ip4,$REUSEADDR,fork,$SOCAT_EGD,cert=testsrv.pem,verify=1,cafile=testsrv.crt,snitable=$tt PIPE"
+CMD1="$TRACE $SOCAT $opts - OPENSSL:$LOCALHOST:$PORT,pf=ip4,cert=testsrv.pem,cafile=testcli.crt,snihost=x.example.test,$SOCAT_EGD"
+CMD2="$TRACE $SOCAT $opts - OPENSSL:$LOCALHOST:$PORT,pf=ip4,cafile=testcli.crt,snihost=x.example.test,$SOCAT_EGD"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "test$N" |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+echo "test$N" |$CMD2 >"${tf}2" 2>"${te}2"
+rc2=$?
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ] || ! echo "test$N" |diff - "${tf}1" >/dev/null; then
+    $PRINTF "$FAILED (client with certificate)\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ $rc2 -eq 0 ] && [ -s "${tf}2" ]; then
+    $PRINTF "$FAILED (client without certificate)\n"
+    echo "$CMD0 &"
+    echo "$CMD2"
+    cat "${te}0"
+    cat "${te}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+	echo "$CMD2"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1" "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi ;; # NUMCOND, feats
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+# Test that empty datagrams do not open or close flows of option demux
+NAME=UDP4_DEMUX_EMPTY
+case "$TESTS" in
+*%$N%*|*%functions%*|*%udp%*|*%udp4%*|*%ip4%*|*%recvfrom%*|*%$NAME%*)
+TEST="$NAME: UDP4-RECVFROM with demux ignores empty datagrams"
+# Start UDP4-RECVFROM with demux and a shell loop that prefixes each line with
+# its process id; a client sends "a", an empty datagram, and "b" from the same
+# source port, and another client only an empty datagram. Success when both
+# answers come from the same process, and only one flow was opened.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions demux); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats udp ip4 system >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}UDP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+PORT1=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts -d -d UDP4-RECVFROM:$PORT,demux SYSTEM:'while read l; do echo \$\$ \$l; done'"
+CMD1="$TRACE $SOCAT $opts -t 0.5 - UDP4:$LOCALHOST:$PORT,sourceport=$PORT1,$REUSEADDR"
+CMD2="$TRACE $SOCAT $opts -u /dev/null UDP4:$LOCALHOST:$PORT,sourceport=$PORT1,$REUSEADDR,shut-null"
+CMD3="$TRACE $SOCAT $opts -u /dev/null UDP4:$LOCALHOST:$PORT,shut-null"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waitudp4port $PORT 1
+echo a |$CMD1 >"${tf}1" 2>"${te}1"
+$CMD2 2>"${te}2"
+$CMD3 2>"${te}3"
+sleep 0.2
+echo b |$CMD1 >>"${tf}1" 2>>"${te}1"
+kill $pid0 2>/dev/null; wait
+p1a=$(head -n 1 "${tf}1" |cut -d' ' -f1); p1b=$(tail -n 1 "${tf}1" |cut -d' ' -f1)
+nflows=$(grep -c "socat\[$pid0\] N new flow" "${te}0")
+if [ "$(cut -d' ' -f2 "${tf}1" |tr '\n' ' ')" != "a b " ] ||
+   [ "$p1a" != "$p1b" ] || [ "$nflows" != 1 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 (2 times)"
+    echo "$CMD2"
+    echo "$CMD3"
+    cat "${te}0" "${te}1" "${te}2" "${te}3"
+    cat "${tf}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1 (2 times)"
+	echo "$CMD2"
+	echo "$CMD3"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1" "${te}2" "${te}3"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+2))
+N=$((N+1))
+
+# Test that the empty record of option shut-null passes EOF over a framed stream
+NAME=TCP4_FRAMING_SHUT_NULL
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%ip4%*|*%framing%*|*%$NAME%*)
+TEST="$NAME: shut-null passes EOF over TCP4 with framing=len16"
+# A server with framing=len16 runs cat and then echoes "done"; a client with
+# framing=len16 and shut-null sends one line and keeps the connection open for
+# a few seconds after its EOF. Success when the client gets the line and
+# "done" back, i.e. the empty record ended the input of cat.
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions framing shut-null); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+elif ! testfeats tcp ip4 system >/dev/null || ! runsip4 >/dev/null; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}TCP/IPv4 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+    listCANT="$listCANT $N"
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+CMD0="$TRACE $SOCAT $opts TCP4-LISTEN:$PORT,$REUSEADDR,framing=len16 SYSTEM:'cat; echo done'"
+CMD1="$TRACE $SOCAT $opts -t 3 - TCP4:$LOCALHOST:$PORT,framing=len16,shut-null"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waittcp4port $PORT 1
+echo abc |$CMD1 >"$tf" 2>"${te}1"
+kill $pid0 2>/dev/null; wait
+if [ "$(tr '\n' ' ' <"$tf")" != "abc done " ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0" "${te}1"
+    cat "$tf"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ "$VERBOSE" ]; then
+	echo "$CMD0 &"
+	echo "$CMD1"
+    fi
+    if [ -n "$debug" ]; then cat "${te}0" "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND, feats
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
 echo "Used temp directory $TD - you might want to remove it after analysis"
 echo "Summary: $((N-1)) tests, $((numOK+numFAIL+numCANT)) selected; $numOK ok, $numFAIL failed, $numCANT could not be performed"
 
@@ -68,6 +68,47 @@ const struct wordent *keyw(const struct wordent *keywds, const char *name, unsig
 }
 
 /* Linux: setenv(), AIX (4.3?): putenv() */
+/* the bucket of a duration in ns in struct xiohist */
+unsigned int xiohist_bucket(unsigned long long ns) {
+   unsigned int e;
+
+   if (ns < (1ULL<<XIOHIST_SUBBITS))  return ns;
+   if (ns >= (1ULL<<XIOHIST_MAXBITS))  return XIOHIST_BUCKETS-1;
+   e = 63 - __builtin_clzll(ns);	/* ns >= 2^e */
+   return ((e-XIOHIST_SUBBITS+1) << XIOHIST_SUBBITS) +
+      ((ns >> (e-XIOHIST_SUBBITS)) & ((1<<XIOHIST_SUBBITS)-1));
+}
+
+/* the largest value of bucket i */
+unsigned long long xiohist_upper(unsigned int i) {
+   unsigned int k;
+
+   ++i;
+   k = i >> XIOHIST_SUBBITS;
+   if (k == 0)  return i - 1;
+   return (((1ULL<<XIOHIST_SUBBITS) + (i & ((1<<XIOHIST_SUBBITS)-1)))
+	   << (k-1)) - 1;
+}
+
+void xiohist_add(struct xiohist *h, unsigned long long ns) {
+   ++h->n;  h->sum += ns;  ++h->count[xiohist_bucket(ns)];
+}
+
+/* the value below which the given per mille of the values are */
+unsigned long long xiohist_percentile(const struct xiohist *h,
+				      unsigned int permille) {
+   unsigned long long want, have = 0;
+   unsigned int i;
+
+   want = (h->n * permille + 999) / 1000;
+   for (i = 0; i < XIOHIST_BUCKETS; ++i) {
+      have += h->count[i];
+      if (have >= want && have > 0)  return xiohist_upper(i);
+   }
+   return xiohist_upper(XIOHIST_BUCKETS-1);
+}
+
+
 #if !HAVE_SETENV
 int setenv(const char *name, const char *value, int overwrite) {
    int result;
@@ -21,6 +21,25 @@ extern int setenv(const char *name, const char *value, int overwrite);
 
 extern const struct wordent *keyw(const struct wordent *keywds, const char *name, unsigned int nkeys);
 
+/* log-linear histogram of durations in nanoseconds: values below
+   2^XIOHIST_SUBBITS have their own buckets, above each power of two is
+   divided into 2^XIOHIST_SUBBITS buckets, so a bucket is at most 3% wide */
+#define XIOHIST_SUBBITS 5
+#define XIOHIST_MAXBITS 40	/* larger values (18 minutes) are clamped */
+#define XIOHIST_BUCKETS ((XIOHIST_MAXBITS-XIOHIST_SUBBITS+1)<<XIOHIST_SUBBITS)
+
+struct xiohist {
+   unsigned long long n;
+   unsigned long long sum;
+   unsigned long count[XIOHIST_BUCKETS];
+} ;
+
+extern unsigned int xiohist_bucket(unsigned long long ns);
+extern unsigned long long xiohist_upper(unsigned int i);
+extern void xiohist_add(struct xiohist *h, unsigned long long ns);
+extern unsigned long long xiohist_percentile(const struct xiohist *h,
+					     unsigned int permille);
+
 
 #define XIOSAN_ZERO_MASK                  0x000f
 #define XIOSAN_ZERO_DEFAULT               0x0000
@@ -5,9 +5,12 @@
 /* this file contains functions for text encoding, decoding, and conversions */
 
 
-#include <stddef.h>
-#include <ctype.h>
-#include <stdio.h>
+#include "xiosysincludes.h"
+#include "mytypes.h"
+#include "compat.h"
+#include "error.h"
+#include "sycls.h"
+#include "xio.h"
 
 #include "xio-ascii.h"
 
@@ -156,3 +159,99 @@ xiodump(const unsigned char *data, size_t bytes, char *codbuff, size_t codlen,
    *result = '\0';
    return codbuff;
 }
+
+
+/* converts the newline characters (or character sequences) from the one
+   specified in lineterm1 to that of lineterm2. Possible values are
+   LINETERM_CR, LINETERM_CRNL, LINETERM_RAW.
+   bytes specifies the number of bytes input and output; for LINETERM_CRNL
+   as lineterm2 buff must have space for twice the input bytes */
+int cv_newline(unsigned char *buff, ssize_t *bytes,
+	       int lineterm1, int lineterm2) {
+   /* must perform newline changes */
+   if (lineterm1 <= LINETERM_CR && lineterm2 <= LINETERM_CR) {
+      /* no change in data length */
+      unsigned char from, to,  *p, *z;
+      if (lineterm1 == LINETERM_RAW) {
+	 from = '\n'; to = '\r';
+      } else {
+	 from = '\r'; to = '\n';
+      }
+      z = buff + *bytes;
+      p = buff;
+      while (p < z) {
+	 if (*p == from)  *p = to;
+	 ++p;
+      }
+
+   } else if (lineterm1 == LINETERM_CRNL) {
+      /* buffer might become shorter */
+      unsigned char to,  *s, *t, *z;
+      if (lineterm2 == LINETERM_RAW) {
+	 to = '\n';
+      } else {
+	 to = '\r';
+      }
+      z = buff + *bytes;
+      s = t = buff;
+      while (s < z) {
+	 if (*s == '\r') {
+	    ++s;
+	    continue;
+	 }
+	 if (*s == '\n') {
+	    *t++ = to; ++s;
+	 } else {
+	    *t++ = *s++;
+	 }
+      }
+      *bytes = t - buff;
+   } else {
+      /* buffer becomes longer (up to double length), must alloc another space */
+      static unsigned char *buf2;	/*! not threadsafe */
+      static ssize_t buf2len;
+      unsigned char from;  unsigned char *s, *t, *z;
+
+      if (lineterm1 == LINETERM_RAW) {
+	 from = '\n';
+      } else {
+	 from = '\r';
+      }
+      if (*bytes > buf2len) {
+	 free(buf2);
+	 if ((buf2 = Malloc(*bytes)) == NULL) {
+	    buf2len = 0;
+	    return -1;
+	 }
+	 buf2len = *bytes;
+      }
+      memcpy(buf2, buff, *bytes);
+      s = buf2;  t = buff;  z = buf2 + *bytes;
+      while (s < z) {
+	 if (*s == from) {
+	    *t++ = '\r'; *t++ = '\n';
+	    ++s;
+	    continue;
+	 } else {
+	    *t++ = *s++;
+	 }
+      }
+      *bytes = t - buff;
+   }
+   return 0;
+}
+
+/* returns the position of the first escape character in data, or bytes
+   when there is none */
+size_t xiofindescape(const unsigned char *data, size_t bytes, int escape) {
+   const unsigned char *ptr = data;
+   size_t ctr = 0;
+
+   while (ctr < bytes) {
+      if (*ptr == escape) {
+	 break;
+      }
+      ++ptr; ++ctr;
+   }
+   return ctr;
+}
@@ -21,4 +21,9 @@ extern char *
 xiodump(const unsigned char *data, size_t bytes, char *coded, size_t codlen,
 	int coding);
 
+extern int cv_newline(unsigned char *buff, ssize_t *bytes,
+		      int lineterm1, int lineterm2);
+extern size_t xiofindescape(const unsigned char *data, size_t bytes,
+			    int escape);
+
 #endif /* !defined(__xio_ascii_h_included) */
@@ -117,6 +117,7 @@ static int xioopen_exec(int argc, const char *argv[], struct opt *opts,
 	 return STAT_NORETRY;
       }
 
+      diag_sync();	/* queued log messages would be lost on exec() */
       /* only now redirect stderr */
       if (duptostderr >= 0) {
 	 diag_dup();
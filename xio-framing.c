@@ -0,0 +1,178 @@
+/* source: xio-framing.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* this file contains the layer of option framing: it passes datagrams over
+   stream addresses as records with a length prefix. xiowrite() collects the
+   records of consecutive writes and xioflush() writes them out with one
+   call; xioread() reads as much of the stream as it gets and hands out one
+   record per call */
+
+#include "xiosysincludes.h"
+#include "xioopen.h"
+
+#include "xio-framing.h"
+
+
+#define XIOFRAME_MAX	65535			/* longest record of len16 */
+#define XIOFRAME_HEAD	2			/* length of its prefix */
+#define XIOFRAME_BUFSIZ	(4*(XIOFRAME_HEAD+XIOFRAME_MAX))	/* per direction */
+
+struct xioframe {
+   unsigned char *rbuf;		/* stream data read ahead */
+   size_t rhead, rtail;		/* the unparsed data is rbuf[rhead..rtail) */
+   unsigned char *wbuf;		/* records not yet written */
+   size_t wused;
+} ;
+
+
+/* returns the framing type for the value of option framing, or -1 */
+int xioframing_type(const char *name) {
+   if (!strcasecmp(name, "len16"))  return XIOFRAMING_LEN16;
+   return -1;
+}
+
+static struct xioframe *xioframe_get(struct single *pipe) {
+   struct xioframe *fr;
+
+   if (pipe->frame != NULL)  return pipe->frame;
+   if ((fr = Calloc(1, sizeof(struct xioframe))) == NULL) {
+      return NULL;
+   }
+   if ((fr->rbuf = Malloc(XIOFRAME_BUFSIZ)) == NULL ||
+       (fr->wbuf = Malloc(XIOFRAME_BUFSIZ)) == NULL) {
+      free(fr->rbuf);  free(fr);
+      return NULL;
+   }
+   pipe->frame = fr;
+   return fr;
+}
+
+/* returns the length of the complete record at the start of the read ahead
+   data, or -1 when it is not complete yet */
+static ssize_t xioframe_complete(struct xioframe *fr) {
+   size_t len;
+
+   if (fr->rtail - fr->rhead < XIOFRAME_HEAD)  return -1;
+   len = (fr->rbuf[fr->rhead] << 8) | fr->rbuf[fr->rhead+1];
+   if (fr->rtail - fr->rhead < XIOFRAME_HEAD + len)  return -1;
+   return len;
+}
+
+/* reads one record from the stream into buff and returns its length.
+   returns 0 on EOF of the stream or on an empty record, or -1 with errno
+   EAGAIN when the stream had no complete record yet */
+ssize_t xioread_framing(struct single *pipe, void *buff, size_t bufsiz) {
+   struct xioframe *fr;
+   ssize_t len, bytes;
+
+   if ((fr = xioframe_get(pipe)) == NULL) {
+      errno = ENOMEM;  return -1;
+   }
+   while ((len = xioframe_complete(fr)) < 0) {
+      if (fr->rhead > 0) {
+	 /* keep the incomplete record at the start of the buffer */
+	 memmove(fr->rbuf, fr->rbuf + fr->rhead, fr->rtail - fr->rhead);
+	 fr->rtail -= fr->rhead;  fr->rhead = 0;
+      }
+      if ((bytes = _xioread(pipe, fr->rbuf + fr->rtail,
+			    XIOFRAME_BUFSIZ - fr->rtail)) < 0) {
+	 return -1;
+      }
+      if (bytes == 0) {
+	 if (fr->rtail > 0) {
+	    Warn1("framing: dropping incomplete record of "F_Zu" bytes at EOF",
+		  fr->rtail);
+	    fr->rtail = 0;
+	 }
+	 return 0;
+      }
+      fr->rtail += bytes;
+      if (xioframe_complete(fr) < 0) {
+	 /* the next read could block */
+	 errno = EAGAIN;  return -1;
+      }
+   }
+
+   fr->rhead += XIOFRAME_HEAD;
+   if (len == 0) {
+      /* socat writes empty blocks only with shut-null; like null-eof with
+	 datagrams, the empty record carries the EOF */
+      Info("framing: empty record, EOF");
+      return 0;
+   }
+   if ((size_t)len > bufsiz) {
+      Warn2("framing: record of "F_Zd" bytes truncated to "F_Zu" bytes",
+	    len, bufsiz);
+   }
+   memcpy(buff, fr->rbuf + fr->rhead, Min((size_t)len, bufsiz));
+   fr->rhead += len;
+   if (fr->rhead == fr->rtail) {
+      fr->rhead = fr->rtail = 0;
+   }
+   return Min((size_t)len, bufsiz);
+}
+
+/* returns 1 when a complete record is waiting in the read ahead data */
+ssize_t xiopending_framing(struct single *pipe) {
+   if (pipe->frame == NULL)  return 0;
+   return xioframe_complete(pipe->frame) >= 0 ? 1 : 0;
+}
+
+/* appends one datagram as record to the write buffer; xioflush() writes it
+   out, or the next call when the buffer is full */
+ssize_t xiowrite_framing(struct single *pipe, const void *buff, size_t bytes) {
+   struct xioframe *fr;
+
+   if (bytes > XIOFRAME_MAX) {
+      Error2("framing: block of "F_Zu" bytes exceeds record size of %u bytes",
+	     bytes, XIOFRAME_MAX);
+      errno = EMSGSIZE;  return -1;
+   }
+   if ((fr = xioframe_get(pipe)) == NULL) {
+      errno = ENOMEM;  return -1;
+   }
+   if (fr->wused + XIOFRAME_HEAD + bytes > XIOFRAME_BUFSIZ) {
+      if (xioflush_framing(pipe) < 0) {
+	 return -1;
+      }
+   }
+   fr->wbuf[fr->wused++] = (bytes >> 8) & 0xff;
+   fr->wbuf[fr->wused++] = bytes & 0xff;
+   memcpy(fr->wbuf + fr->wused, buff, bytes);
+   fr->wused += bytes;
+   return bytes;
+}
+
+/* returns the number of bytes of records waiting for xioflush() */
+int xioqueued_framing(struct single *pipe) {
+   if (pipe->frame == NULL)  return 0;
+   return pipe->frame->wused;
+}
+
+/* writes out the collected records with one call.
+   returns 0 on success, or -1 on error */
+int xioflush_framing(struct single *pipe) {
+   struct xioframe *fr = pipe->frame;
+   ssize_t writt;
+
+   if (fr == NULL || fr->wused == 0)  return 0;
+   Debug2("framing: writing "F_Zu" bytes of records to fd %d",
+	  fr->wused, pipe->fd);
+   writt = _xiowrite(pipe, fr->wbuf, fr->wused);
+   fr->wused = 0;
+   if (writt < 0) {
+      return -1;
+   }
+   return 0;
+}
+
+/* writes out remaining records and frees the buffers */
+void xioclose_framing(struct single *pipe) {
+   if (pipe->frame == NULL)  return;
+   xioflush_framing(pipe);
+   free(pipe->frame->rbuf);
+   free(pipe->frame->wbuf);
+   free(pipe->frame);
+   pipe->frame = NULL;
+}
@@ -0,0 +1,17 @@
+/* source: xio-framing.h */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+#ifndef __xio_framing_h_included
+#define __xio_framing_h_included 1
+
+extern int xioframing_type(const char *name);
+extern ssize_t xioread_framing(struct single *pipe, void *buff, size_t bufsiz);
+extern ssize_t xiopending_framing(struct single *pipe);
+extern ssize_t xiowrite_framing(struct single *pipe, const void *buff,
+				size_t bytes);
+extern int xioflush_framing(struct single *pipe);
+extern int xioqueued_framing(struct single *pipe);
+extern void xioclose_framing(struct single *pipe);
+
+#endif /* !defined(__xio_framing_h_included) */
@@ -14,6 +14,330 @@
 #include "xio-interface.h"
 
 
+#if _WITH_PACKETRING
+const struct optdesc opt_packet_rx_ring     = { "packet-rx-ring",     NULL, OPT_PACKET_RX_RING,     GROUP_SOCKET, PH_INIT, TYPE_BOOL, OFUNC_SPEC };
+const struct optdesc opt_packet_tx_ring     = { "packet-tx-ring",     NULL, OPT_PACKET_TX_RING,     GROUP_SOCKET, PH_INIT, TYPE_BOOL, OFUNC_SPEC };
+const struct optdesc opt_packet_block_size  = { "packet-block-size",  NULL, OPT_PACKET_BLOCK_SIZE,  GROUP_SOCKET, PH_INIT, TYPE_UINT, OFUNC_SPEC };
+const struct optdesc opt_packet_blocks      = { "packet-blocks",      NULL, OPT_PACKET_BLOCKS,      GROUP_SOCKET, PH_INIT, TYPE_UINT, OFUNC_SPEC };
+const struct optdesc opt_packet_frame_size  = { "packet-frame-size",  NULL, OPT_PACKET_FRAME_SIZE,  GROUP_SOCKET, PH_INIT, TYPE_UINT, OFUNC_SPEC };
+#endif /* _WITH_PACKETRING */
+#ifdef PACKET_FANOUT
+const struct optdesc opt_packet_fanout      = { "packet-fanout",      NULL, OPT_PACKET_FANOUT,      GROUP_SOCKET, PH_INIT, TYPE_STRING, OFUNC_SPEC };
+const struct optdesc opt_packet_fanout_group= { "packet-fanout-group",NULL, OPT_PACKET_FANOUT_GROUP,GROUP_SOCKET, PH_INIT, TYPE_UINT, OFUNC_SPEC };
+#endif /* PACKET_FANOUT */
+
+#if _WITH_PACKETRING
+/* PACKET_MMAP (options packet-rx-ring, packet-tx-ring): the kernel writes the
+   received frames into a ring of TPACKET_V3 blocks that is mapped into
+   socat's memory, so reading a block of frames costs no system call. Frames
+   written go to a second ring that one send() call passes to the kernel when
+   it is full or the data loop flushes it. */
+#define XIOPACKET_BLOCK_SIZE	262144
+#define XIOPACKET_BLOCKS	16
+#define XIOPACKET_FRAME_SIZE	2048
+#define XIOPACKET_RETIRE_MS	1	/* hand out partly filled blocks after */
+
+/* the data of a frame of the transmit ring follow its header */
+#define XIOPACKET_TXDATA	TPACKET_ALIGN(sizeof(struct tpacket3_hdr))
+
+/* sets up the rings on the bound packet socket and maps them.
+   returns STAT_OK or STAT_NORETRY */
+static int xiopacketring_open(struct single *sfd, bool rx, bool tx,
+			      unsigned int blocksize, unsigned int blocks,
+			      unsigned int framesize) {
+   struct xiopacketring *ring;
+   struct tpacket_req3 req = { 0 };
+   int version = TPACKET_V3;
+   unsigned char *map;
+
+   if (framesize < TPACKET3_HDRLEN || framesize % TPACKET_ALIGNMENT != 0) {
+      Error2("packet-frame-size=%u: must be a multiple of %d",
+	     framesize, TPACKET_ALIGNMENT);
+      return STAT_NORETRY;
+   }
+   if (blocks == 0 ||
+       blocksize % getpagesize() != 0 || blocksize % framesize != 0) {
+      Error3("packet-block-size=%u: must be a multiple of the page size (%d) and of packet-frame-size (%u)",
+	     blocksize, getpagesize(), framesize);
+      return STAT_NORETRY;
+   }
+   if (Setsockopt(sfd->fd, SOL_PACKET, PACKET_VERSION,
+		  &version, sizeof(version)) < 0) {
+      Error4("setsockopt(%d, SOL_PACKET, PACKET_VERSION, {%d}, "F_Zu"): %s",
+	     sfd->fd, version, sizeof(version), strerror(errno));
+      return STAT_NORETRY;
+   }
+   if ((ring = Calloc(1, sizeof(struct xiopacketring))) == NULL) {
+      return STAT_NORETRY;
+   }
+   req.tp_block_size = blocksize;
+   req.tp_block_nr   = blocks;
+   req.tp_frame_size = framesize;
+   req.tp_frame_nr   = blocksize / framesize * blocks;
+   if (rx) {
+      req.tp_retire_blk_tov = XIOPACKET_RETIRE_MS;
+      if (Setsockopt(sfd->fd, SOL_PACKET, PACKET_RX_RING,
+		     &req, sizeof(req)) < 0) {
+	 Error4("setsockopt(%d, SOL_PACKET, PACKET_RX_RING, {%u*%u}): %s",
+		sfd->fd, blocks, blocksize, strerror(errno));
+	 free(ring);
+	 return STAT_NORETRY;
+      }
+      ring->rblocks    = blocks;
+      ring->rblocksize = blocksize;
+      ring->mapsize   += (size_t)blocks * blocksize;
+   }
+   if (tx) {
+      /* the transmit ring does not know block timeouts */
+      req.tp_retire_blk_tov = 0;
+      if (Setsockopt(sfd->fd, SOL_PACKET, PACKET_TX_RING,
+		     &req, sizeof(req)) < 0) {
+	 Error4("setsockopt(%d, SOL_PACKET, PACKET_TX_RING, {%u*%u}): %s",
+		sfd->fd, blocks, blocksize, strerror(errno));
+	 free(ring);
+	 return STAT_NORETRY;
+      }
+      ring->tframes    = req.tp_frame_nr;
+      ring->tperblock  = blocksize / framesize;
+      ring->tblocksize = blocksize;
+      ring->tframesize = framesize;
+      ring->mapsize   += (size_t)blocks * blocksize;
+   }
+   if ((map = Mmap(NULL, ring->mapsize, PROT_READ|PROT_WRITE, MAP_SHARED,
+		   sfd->fd, 0)) == MAP_FAILED) {
+      Error3("mmap(NULL, "F_Zu", PROT_READ|PROT_WRITE, MAP_SHARED, %d, 0): %s",
+	     ring->mapsize, sfd->fd, strerror(errno));
+      free(ring);
+      return STAT_NORETRY;
+   }
+   ring->map = map;
+   if (rx) {
+      ring->rbase = map;
+      map += ring->rblocks * ring->rblocksize;
+   }
+   if (tx) {
+      ring->tbase = map;
+   }
+   sfd->packetring = ring;
+   Info5("fd %d: mapped %s%s%s ring of %u blocks",
+	 sfd->fd, rx?"receive":"", rx&&tx?" and ":"", tx?"transmit":"",
+	 blocks);
+   return STAT_OK;
+}
+
+/* returns the start of frame i of the transmit ring */
+static struct tpacket3_hdr *xiopacketring_txframe(struct xiopacketring *ring,
+						  unsigned int i) {
+   return (struct tpacket3_hdr *)
+      (ring->tbase + (i / ring->tperblock) * ring->tblocksize +
+       (i % ring->tperblock) * ring->tframesize);
+}
+
+/* hands out the next frame of the receive ring; msg_name of msgh gets its
+   sockaddr_ll. A block goes back to the kernel when all its frames were
+   handed out.
+   returns the length of the frame, or -1 with errno EAGAIN when no block is
+   ready */
+ssize_t xiorecv_packetring(struct single *pipe, void *buff, size_t bufsiz,
+			   struct msghdr *msgh) {
+   struct xiopacketring *ring = pipe->packetring;
+   struct tpacket_block_desc *block;
+   struct tpacket3_hdr *frame;
+   size_t bytes;
+
+   block = (struct tpacket_block_desc *)
+      (ring->rbase + ring->rblock * ring->rblocksize);
+   if (ring->rframe == NULL) {
+      if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+	 errno = EAGAIN;  return -1;
+      }
+      __sync_synchronize();	/* read the frames after the status */
+      ring->rleft  = block->hdr.bh1.num_pkts;
+      ring->rframe = (struct tpacket3_hdr *)
+	 ((unsigned char *)block + block->hdr.bh1.offset_to_first_pkt);
+      Debug3("fd %d: block %u of receive ring holds %u frames",
+	     pipe->fd, ring->rblock, ring->rleft);
+   }
+
+   frame = ring->rframe;
+   bytes = 0;
+   if (ring->rleft > 0) {
+      bytes = Min(frame->tp_snaplen, bufsiz);
+      memcpy(buff, (unsigned char *)frame + frame->tp_mac, bytes);
+      msgh->msg_namelen = Min(sizeof(struct sockaddr_ll), msgh->msg_namelen);
+      memcpy(msgh->msg_name,
+	     (unsigned char *)frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)),
+	     msgh->msg_namelen);
+#if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
+      msgh->msg_controllen = 0;
+#endif
+#if HAVE_STRUCT_MSGHDR_MSGFLAGS
+      msgh->msg_flags = 0;
+#endif
+      --ring->rleft;
+   }
+   if (ring->rleft > 0) {
+      ring->rframe = (struct tpacket3_hdr *)
+	 ((unsigned char *)frame + frame->tp_next_offset);
+   } else {
+      /* give the block back to the kernel */
+      __sync_synchronize();
+      block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+      ring->rframe = NULL;
+      ring->rblock = (ring->rblock + 1) % ring->rblocks;
+      if (bytes == 0) {
+	 errno = EAGAIN;  return -1;	/* empty block */
+      }
+   }
+   return bytes;
+}
+
+/* copies a packet into the next frame of the transmit ring; sends the ring
+   when it is full. Packets that do not fit into a frame are sent with
+   sendto() after the ring.
+   returns bytes, or -1 when sending failed (errno set) */
+ssize_t xiosend_packetring(struct single *pipe, const void *buff,
+			   size_t bytes) {
+   struct xiopacketring *ring = pipe->packetring;
+   struct tpacket3_hdr *frame;
+   ssize_t writt;
+
+   if (bytes > ring->tframesize - XIOPACKET_TXDATA) {
+      if (xioflush_packetring(pipe) < 0) {
+	 return -1;
+      }
+      do {
+	 writt = Sendto(pipe->fd, buff, bytes, 0,
+			&pipe->peersa.soa, pipe->salen);
+      } while (writt < 0 && errno == EINTR);
+      if (writt < 0) {
+	 Error4("sendto(%d, %p, "F_Zu", 0, ...): %s",
+		pipe->fd, buff, bytes, strerror(errno));
+      }
+      return writt;
+   }
+
+   frame = xiopacketring_txframe(ring, ring->tnext);
+   if (frame->tp_status != TP_STATUS_AVAILABLE) {
+      /* send() returns when the kernel has sent all frames */
+      if (xioflush_packetring(pipe) < 0) {
+	 return -1;
+      }
+      if (frame->tp_status == TP_STATUS_WRONG_FORMAT) {
+	 Warn2("fd %d: kernel rejected frame %u of transmit ring",
+	       pipe->fd, ring->tnext);
+      } else if (frame->tp_status != TP_STATUS_AVAILABLE) {
+	 Error1("fd %d: transmit ring is full", pipe->fd);
+	 errno = EAGAIN;
+	 return -1;
+      }
+   }
+   memcpy((unsigned char *)frame + XIOPACKET_TXDATA, buff, bytes);
+   frame->tp_len         = bytes;
+   frame->tp_snaplen     = bytes;
+   frame->tp_next_offset = 0;
+   __sync_synchronize();	/* the kernel must see the data first */
+   frame->tp_status = TP_STATUS_SEND_REQUEST;
+   ring->tnext = (ring->tnext + 1) % ring->tframes;
+   if (++ring->tqueued >= ring->tframes) {
+      if (xioflush_packetring(pipe) < 0) {
+	 return -1;
+      }
+   }
+   return bytes;
+}
+
+/* passes the filled frames of the transmit ring to the kernel.
+   returns 0 on success, or -1 on error (errno set) */
+int xioflush_packetring(struct single *pipe) {
+   struct xiopacketring *ring = pipe->packetring;
+   int result;
+
+   if (ring == NULL || ring->tqueued == 0) {
+      return 0;
+   }
+   do {
+      /* the kernel takes the frames from the ring, the buffer is not used */
+      result = Send(pipe->fd, ring->tbase, 0, 0);
+   } while (result < 0 && errno == EINTR);
+   if (result < 0) {
+      int _errno = errno;
+      Error2("send(%d, NULL, 0, 0) on transmit ring: %s",
+	     pipe->fd, strerror(_errno));
+      ring->tqueued = 0;
+      errno = _errno;
+      return -1;
+   }
+   Debug2("fd %d: sent %u frames from transmit ring",
+	  pipe->fd, ring->tqueued);
+   ring->tqueued = 0;
+   return 0;
+}
+
+/* sends frames that are still in the transmit ring and unmaps the rings */
+void xioclose_packetring(struct single *pipe) {
+   struct xiopacketring *ring = pipe->packetring;
+
+   if (ring == NULL) {
+      return;
+   }
+   if (pipe->fd >= 0) {
+      xioflush_packetring(pipe);
+   }
+   Munmap(ring->map, ring->mapsize);
+   free(ring);
+   pipe->packetring = NULL;
+}
+#endif /* _WITH_PACKETRING */
+
+#ifdef PACKET_FANOUT
+/* values of option packet-fanout */
+static const struct {
+   const char *name;
+   int type;
+} xiofanout_types[] = {
+   { "hash",     PACKET_FANOUT_HASH },
+   { "lb",       PACKET_FANOUT_LB },
+   { "cpu",      PACKET_FANOUT_CPU },
+#ifdef PACKET_FANOUT_ROLLOVER
+   { "rollover", PACKET_FANOUT_ROLLOVER },
+#endif
+#ifdef PACKET_FANOUT_RND
+   { "random",   PACKET_FANOUT_RND },
+#endif
+#ifdef PACKET_FANOUT_QM
+   { "qm",       PACKET_FANOUT_QM },
+#endif
+   { NULL }
+} ;
+
+/* joins the bound packet socket to fanout group. returns STAT_OK or
+   STAT_NORETRY */
+static int xiopacket_fanout(struct single *sfd, const char *mode,
+			    unsigned int group) {
+   int i, arg;
+
+   for (i = 0; xiofanout_types[i].name != NULL; ++i) {
+      if (!strcasecmp(mode, xiofanout_types[i].name))  break;
+   }
+   if (xiofanout_types[i].name == NULL) {
+      Error1("packet-fanout=%s: unknown mode", mode);
+      return STAT_NORETRY;
+   }
+   arg = (group & 0xffff) | (xiofanout_types[i].type << 16);
+   if (Setsockopt(sfd->fd, SOL_PACKET, PACKET_FANOUT,
+		  &arg, sizeof(arg)) < 0) {
+      Error4("setsockopt(%d, SOL_PACKET, PACKET_FANOUT, {0x%x}, "F_Zu"): %s",
+	     sfd->fd, arg, sizeof(arg), strerror(errno));
+      return STAT_NORETRY;
+   }
+   Info3("fd %d: member of packet fanout group %u (%s)",
+	 sfd->fd, group & 0xffff, xiofanout_types[i].name);
+   return STAT_OK;
+}
+#endif /* PACKET_FANOUT */
+
+
 static
 int xioopen_interface(int argc, const char *argv[], struct opt *opts,
 		      int xioflags, xiofile_t *xfd, unsigned groups, int pf,
@@ -34,6 +358,17 @@ int _xioopen_interface(const char *ifname,
    bool needbind = false;
    char *bindstring = NULL;
    struct sockaddr_ll sall = { 0 };
+#if _WITH_PACKETRING
+   bool rxring = false, txring = false;
+   unsigned int blocksize = XIOPACKET_BLOCK_SIZE;
+   unsigned int blocks = XIOPACKET_BLOCKS;
+   unsigned int framesize = XIOPACKET_FRAME_SIZE;
+#endif
+#ifdef PACKET_FANOUT
+   char *fanout = NULL;
+   unsigned int fanoutgroup;
+#endif
+   int result;
 
    if (ifindex(ifname, &ifidx, -1) < 0) {
       Error1("unknown interface \"%s\"", ifname);
@@ -42,6 +377,18 @@ int _xioopen_interface(const char *ifname,
 
    xfd->howtoend = END_SHUTDOWN;
    retropt_int(opts, OPT_SO_TYPE, &socktype);
+#if _WITH_PACKETRING
+   retropt_bool(opts, OPT_PACKET_RX_RING, &rxring);
+   retropt_bool(opts, OPT_PACKET_TX_RING, &txring);
+   retropt_uint(opts, OPT_PACKET_BLOCK_SIZE, &blocksize);
+   retropt_uint(opts, OPT_PACKET_BLOCKS, &blocks);
+   retropt_uint(opts, OPT_PACKET_FRAME_SIZE, &framesize);
+#endif
+#ifdef PACKET_FANOUT
+   fanoutgroup = ifidx;
+   retropt_string(opts, OPT_PACKET_FANOUT, &fanout);
+   retropt_uint(opts, OPT_PACKET_FANOUT_GROUP, &fanoutgroup);
+#endif
 
    retropt_socket_pf(opts, &pf);
 
@@ -67,9 +414,29 @@ int _xioopen_interface(const char *ifname,
    needbind = true;
    xfd->peersa = (union sockaddr_union)us;
 
-   return
+   result =
       _xioopen_dgram_sendto(needbind?&us:NULL, uslen,
 			    opts, xioflags, xfd, groups, pf, socktype, 0, 0);
+   if (result != STAT_OK) {
+      return result;
+   }
+
+#if _WITH_PACKETRING
+   if (rxring || txring) {
+      result = xiopacketring_open(xfd, rxring, txring,
+				  blocksize, blocks, framesize);
+      if (result != STAT_OK) {
+	 return result;
+      }
+   }
+#endif
+#ifdef PACKET_FANOUT
+   if (fanout != NULL) {
+      result = xiopacket_fanout(xfd, fanout, fanoutgroup);
+      free(fanout);
+   }
+#endif
+   return result;
 }
 
 static
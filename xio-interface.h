@@ -7,4 +7,42 @@
 
 extern const struct addrdesc xioaddr_interface;
 
+extern const struct optdesc opt_packet_rx_ring;
+extern const struct optdesc opt_packet_tx_ring;
+extern const struct optdesc opt_packet_block_size;
+extern const struct optdesc opt_packet_blocks;
+extern const struct optdesc opt_packet_frame_size;
+extern const struct optdesc opt_packet_fanout;
+extern const struct optdesc opt_packet_fanout_group;
+
+#if _WITH_PACKETRING
+/* the mapped rings of options packet-rx-ring and packet-tx-ring */
+struct xiopacketring {
+   unsigned char *map;		/* both rings, receive ring first */
+   size_t mapsize;
+   /* receive ring */
+   unsigned char *rbase;	/* NULL without packet-rx-ring */
+   unsigned int rblocks;
+   size_t rblocksize;
+   unsigned int rblock;		/* block that is read or waited for */
+   struct tpacket3_hdr *rframe;	/* next frame of this block, or NULL */
+   unsigned int rleft;		/* frames left in this block */
+   /* transmit ring */
+   unsigned char *tbase;	/* NULL without packet-tx-ring */
+   unsigned int tframes;	/* frames in the ring */
+   unsigned int tperblock;	/* frames per block */
+   size_t tblocksize;
+   size_t tframesize;
+   unsigned int tnext;		/* next frame to fill */
+   unsigned int tqueued;	/* frames filled since the last send() */
+} ;
+
+extern ssize_t xiorecv_packetring(struct single *pipe, void *buff,
+				  size_t bufsiz, struct msghdr *msgh);
+extern ssize_t xiosend_packetring(struct single *pipe, const void *buff,
+				  size_t bytes);
+extern int xioflush_packetring(struct single *pipe);
+extern void xioclose_packetring(struct single *pipe);
+#endif /* _WITH_PACKETRING */
+
 #endif /* !defined(__xio_interface_h_included) */
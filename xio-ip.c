@@ -15,6 +15,7 @@
 #include "xio-ip.h"
 #include "xio-ip6.h"
 #include "nestlex.h"
+#include "xiostats.h"
 
 
 #if WITH_IP4 || WITH_IP6
@@ -148,6 +149,7 @@ int xiogetaddrinfo(const char *node, const char *service,
    struct hostent *host;
 #endif
    int error_num;
+   struct timespec t0;
 
 #if HAVE_RESOLV_H
    if (res_opts0 | res_opts1) {
@@ -229,6 +231,7 @@ int xiogetaddrinfo(const char *node, const char *service,
       hints.ai_canonname = NULL;
       hints.ai_next = NULL;
 
+      xiostats_begin(&t0);
       do {
 	error_num = Getaddrinfo(node, service, &hints, &res);
 	if (error_num == 0)  break;
@@ -270,6 +273,7 @@ int xiogetaddrinfo(const char *node, const char *service,
 	 return STAT_RETRYLATER;
 	}
       } while (1);
+      xiostats_end(XIOSTATS_RESOLVE, &t0);
       service = NULL;	/* do not resolve later again */
 
       record = res;
@@ -92,13 +92,13 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
-	    dropopts(opts, PH_ALL); free(opts); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    continue;
 	 }
 	 return STAT_NORETRY;
 #endif /* WITH_RETRY */
       default:
-	  free(opts0);free(opts);
+	  freeopts(opts0);freeopts(opts);
 	 return result;
       }
 
@@ -114,7 +114,7 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
 	    if (xfd->forever || --xfd->retry) {
 	       Nanosleep(&xfd->intervall, NULL); continue;
 	    }
-	  free(opts0);
+	  freeopts(opts0);
 	    return STAT_RETRYLATER;
 	 }
 
@@ -127,7 +127,7 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
 	 Close(xfd->fd);
 	 /* with and without retry */
 	 Nanosleep(&xfd->intervall, NULL);
-	 dropopts(opts, PH_ALL); free(opts); opts = copyopts(opts0, GROUP_ALL);
+	 opts = recopyopts(opts, opts0, GROUP_ALL);
 	 continue;	/* with next socket() bind() connect() */
       } else
 #endif /* WITH_RETRY */
@@ -138,10 +138,10 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
    /* only "active" process breaks (master without fork, or child) */
 
    if ((result = _xio_openlate(xfd, opts)) < 0) {
-	   free(opts0);free(opts);
+	   freeopts(opts0);freeopts(opts);
       return result;
    }
-   free(opts0);free(opts);
+   freeopts(opts0);freeopts(opts);
    return 0;
 }
 
@@ -25,6 +25,12 @@ const struct optdesc opt_max_children = { "max-children",      NULL, OPT_MAX_CHI
 const struct optdesc opt_range   = { "range",     NULL, OPT_RANGE,       GROUP_RANGE,  PH_ACCEPT, TYPE_STRING, OFUNC_SPEC };
 #endif
 const struct optdesc opt_accept_timeout = { "accept-timeout", "listen-timeout", OPT_ACCEPT_TIMEOUT, GROUP_LISTEN, PH_LISTEN, TYPE_TIMEVAL, OFUNC_OFFSET, XIO_OFFSETOF(para.socket.accept_timeout) };
+const struct optdesc opt_accept_batch = { "accept-batch", NULL, OPT_ACCEPT_BATCH, GROUP_LISTEN, PH_LISTEN, TYPE_INT, OFUNC_SPEC };
+
+#define XIO_ACCEPT_BATCH	16	/* default with fork */
+#define XIO_ACCEPT_BATCH_MAX	64
+
+static int xio_somaxconn(void);
 
 
 /*
@@ -63,11 +69,11 @@ int
       case STAT_RETRYLATER:
       case STAT_RETRYNOW:
 	 if (xfd->forever || xfd->retry) {
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    --xfd->retry;
 	    continue;
 	 }
@@ -105,19 +111,25 @@ int
  */
 int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, socklen_t uslen,
 		 struct opt *opts, int pf, int socktype, int proto, int level) {
-   struct sockaddr sa;
-   socklen_t salen;
    int backlog = 5;	/* why? 1 seems to cause problems under some load */
    char *rangename;
    bool dofork = false;
    int maxchildren = 0;
+   int batch = 1;	/* connections to accept per wakeup */
+   struct {
+      int fd;
+      union sockaddr_union pa;	/* peer address */
+      socklen_t pas;
+   } pend[XIO_ACCEPT_BATCH_MAX];	/* accepted, not yet handled */
+   int ipend = 0, npend = 0;
+   bool usknown;	/* us is the local address of connections */
+   bool docloexec = true;
    char infobuff[256];
    char lisname[256];
-   union sockaddr_union _peername;
    union sockaddr_union _sockname;
-   union sockaddr_union *pa = &_peername;	/* peer address */
+   union sockaddr_union *pa;			/* peer address */
    union sockaddr_union *la = &_sockname;	/* local address */
-   socklen_t pas = sizeof(_peername);	/* peer address size */
+   socklen_t pas;				/* peer address size */
    socklen_t las = sizeof(_sockname);	/* local address size */
    int result;
 
@@ -141,7 +153,10 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
    if (applyopts_single(xfd, opts, PH_INIT) < 0)  return -1;
 
    if (dofork) {
-      xiosetchilddied();	/* set SIGCHLD handler */
+      /* reap children in the accept loop; or else by SIGCHLD handler */
+      if (xiosetchildfd() < 0) {
+	 xiosetchilddied();	/* set SIGCHLD handler */
+      }
    }
 
    if ((xfd->fd = xiosocket(opts, us->sa_family, socktype, proto, level)) < 0) {
@@ -173,7 +188,6 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 #endif
    /* under some circumstances (e.g., TCP listen on port 0) bind() fills empty
       fields that we want to know. */
-   salen = sizeof(sa);
    if (Getsockname(xfd->fd, us, &uslen) < 0) {
       Warn4("getsockname(%d, %p, {%d}): %s",
 	    xfd->fd, &us, uslen, strerror(errno));
@@ -217,13 +231,73 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 #endif /* WITH_TCP || WITH_UDP */
 
    applyopts(xfd->fd, opts, PH_PRELISTEN);
+   if (dofork) {
+      /* accept bursts of connections without drops */
+      backlog = xio_somaxconn();
+   }
    retropt_int(opts, OPT_BACKLOG, &backlog);
+#if HAVE_ACCEPT4
+   if (dofork) {
+      batch = XIO_ACCEPT_BATCH;
+   }
+   retropt_int(opts, OPT_ACCEPT_BATCH, &batch);
+#else
+   {
+      int dummy;
+      if (retropt_int(opts, OPT_ACCEPT_BATCH, &dummy) >= 0) {
+	 Warn("option accept-batch requires accept4(), ignored");
+      }
+   }
+#endif /* HAVE_ACCEPT4 */
    applyopts(xfd->fd, opts, PH_LISTEN);
    if (Listen(xfd->fd, backlog) < 0) {
       Error3("listen(%d, %d): %s", xfd->fd, backlog, strerror(errno));
       return STAT_RETRYLATER;
    }
 
+#if HAVE_ACCEPT4
+   if (batch > XIO_ACCEPT_BATCH_MAX) {
+      Warn2("accept-batch=%d: reduced to %d", batch, XIO_ACCEPT_BATCH_MAX);
+      batch = XIO_ACCEPT_BATCH_MAX;
+   }
+   if (batch > 1 && dofork) {
+      /* further connections of a batch are taken without waiting */
+      int flags;
+      if ((flags = Fcntl(xfd->fd, F_GETFL)) < 0 ||
+	  Fcntl_l(xfd->fd, F_SETFL, flags|O_NONBLOCK) < 0) {
+	 Warn2("fcntl(%d, F_SETFL, O_NONBLOCK): %s",
+	       xfd->fd, strerror(errno));
+	 batch = 1;
+      }
+   } else {
+      batch = 1;
+   }
+#endif /* HAVE_ACCEPT4 */
+
+   /* with a specific local address getsockname() is not needed per
+      connection */
+   switch (us->sa_family) {
+#if WITH_IP4
+   case AF_INET:
+      usknown = ((struct sockaddr_in *)us)->sin_addr.s_addr != htonl(INADDR_ANY);
+      break;
+#endif
+#if WITH_IP6
+   case AF_INET6:
+      usknown = !IN6_IS_ADDR_UNSPECIFIED(&((struct sockaddr_in6 *)us)->sin6_addr);
+      break;
+#endif
+#if WITH_UNIX
+   case AF_UNIX:
+      usknown = true;
+      break;
+#endif
+   default:
+      usknown = false;
+   }
+
+   retropt_bool(opts, OPT_CLOEXEC, &docloexec);
+
    if (xioopts.logopt == 'm') {
       Info("starting accept loop, switching to syslog");
       diag_set('y', xioopts.syslogfac);  xioopts.logopt = 'y';
@@ -235,93 +309,146 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
       char sockname[256];
       int ps;		/* peer socket */
 
-      pa = &_peername;
-      la = &_sockname;
-      salen = sizeof(struct sockaddr);
-      do {
-	 /*? int level = E_ERROR;*/
-	 Notice1("listening on %s", sockaddr_info(us, uslen, lisname, sizeof(lisname)));
-	 if (xfd->para.socket.accept_timeout.tv_sec > 0 ||
-	     xfd->para.socket.accept_timeout.tv_usec > 0) {
-	    fd_set rfd;
-	    struct timeval tmo;
-	    FD_ZERO(&rfd);
-	    FD_SET(xfd->fd, &rfd);
-	    tmo.tv_sec = xfd->para.socket.accept_timeout.tv_sec;
-	    tmo.tv_usec = xfd->para.socket.accept_timeout.tv_usec;
-	    while (1) {
-	       if (Select(xfd->fd+1, &rfd, NULL, NULL, &tmo) < 0) {
-		  if (errno != EINTR) {
-		     Error5("Select(%d, &0x%lx, NULL, NULL, {%ld.%06ld}): %s", xfd->fd+1, 1L<<(xfd->fd+1),
-			    xfd->para.socket.accept_timeout.tv_sec, xfd->para.socket.accept_timeout.tv_usec,
-			    strerror(errno));
-		  }
-	       } else {
-		  break;
-	       }
+      if (ipend == npend) {
+	 /* wait for a connection */
+	 ipend = npend = 0;
+	 pa = &pend[0].pa;
+	 pas = sizeof(pend[0].pa);
+	 do {
+	    /*? int level = E_ERROR;*/
+	    if (diag_level(E_NOTICE)) {
+	       Notice1("listening on %s", sockaddr_info(us, uslen, lisname, sizeof(lisname)));
 	    }
-	    if (!FD_ISSET(xfd->fd, &rfd)) {
-	       struct sigaction act;
-
-	       Warn1("accept: %s", strerror(ETIMEDOUT));
-	       Close(xfd->fd);
-	       Notice("Waiting for child processes to terminate");
-	       memset(&act, 0, sizeof(struct sigaction));
-	       act.sa_flags   = SA_NOCLDSTOP/*|SA_RESTART*/
+	    if (xfd->para.socket.accept_timeout.tv_sec > 0 ||
+		xfd->para.socket.accept_timeout.tv_usec > 0 ||
+		xiochildfd >= 0) {
+	       /* wait for a client, reaping terminated children meanwhile */
+	       bool dotimeout =
+		  xfd->para.socket.accept_timeout.tv_sec > 0 ||
+		  xfd->para.socket.accept_timeout.tv_usec > 0;
+	       if ((result =
+		    xiochild_wait(xfd->fd,
+				  dotimeout?&xfd->para.socket.accept_timeout:NULL))
+		   < 0) {
+		  Msg2(level, "poll({%d,POLLIN}, ...): %s",
+		       xfd->fd, strerror(errno));
+		  Close(xfd->fd);
+		  return STAT_RETRYLATER;
+	       }
+	       if (result == 0) {
+		  struct sigaction act;
+
+		  Warn1("accept: %s", strerror(ETIMEDOUT));
+		  Close(xfd->fd);
+		  Notice("Waiting for child processes to terminate");
+		  memset(&act, 0, sizeof(struct sigaction));
+		  act.sa_flags   = SA_NOCLDSTOP/*|SA_RESTART*/
 #ifdef SA_SIGINFO /* not on Linux 2.0(.33) */
-		  |SA_SIGINFO
+		     |SA_SIGINFO
 #endif
 #ifdef SA_NOMASK
-		  |SA_NOMASK
+		     |SA_NOMASK
 #endif
-		  ;
+		     ;
 #if HAVE_STRUCT_SIGACTION_SA_SIGACTION && defined(SA_SIGINFO)
-	       act.sa_sigaction = 0;
+		  act.sa_sigaction = 0;
 #else /* Linux 2.0(.33) does not have sigaction.sa_sigaction */
-	       act.sa_handler = 0;
+		  act.sa_handler = 0;
 #endif
-	       sigemptyset(&act.sa_mask);
-	       Sigaction(SIGCHLD, &act, NULL);
-	       wait(NULL);
-	       Exit(0);
+		  sigemptyset(&act.sa_mask);
+		  Sigaction(SIGCHLD, &act, NULL);
+		  wait(NULL);
+		  Exit(0);
+	       }
 	    }
+#if HAVE_ACCEPT4
+	    if (batch > 1) {
+	       /* the listener is nonblocking: wait for it like Accept() does,
+		  and take the connection with accept4() because accept() on
+		  BSD passes O_NONBLOCK on to the new socket */
+	       fd_set accept_s;
+	       FD_ZERO(&accept_s);
+	       FD_SET(xfd->fd, &accept_s);
+	       ps = diag_select(xfd->fd+1, &accept_s, NULL, NULL, NULL);
+	       if (ps >= 0) {
+		  ps = Accept4(xfd->fd, &pa->soa, &pas,
+			       docloexec?SOCK_CLOEXEC:0);
+	       }
+	    } else
+#endif /* HAVE_ACCEPT4 */
+	    ps = Accept(xfd->fd, &pa->soa, &pas);
+	    if (ps >= 0) {
+	       /*0 Info4("accept(%d, %p, {"F_Zu"}) -> %d", xfd->fd, &sa, salen, ps);*/
+	       break;	/* success, break out of loop */
+	    }
+	    if (errno == EINTR) {
+	       pas = sizeof(pend[0].pa);
+	       continue;
+	    }
+	    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	       /* nonblocking listener (accept-batch): Accept() waits in
+		  select(), but another process might have taken the client */
+	       pas = sizeof(pend[0].pa);
+	       continue;
+	    }
+	    if (errno == ECONNABORTED) {
+	       Notice4("accept(%d, %p, {"F_socklen"}): %s",
+		       xfd->fd, pa, pas, strerror(errno));
+	       pas = sizeof(pend[0].pa);
+	       continue;
+	    }
+	    Msg4(level, "accept(%d, %p, {"F_socklen"}): %s",
+		 xfd->fd, pa, pas, strerror(errno));
+	    Close(xfd->fd);
+	    return STAT_RETRYLATER;
+	 } while (true);
+	 if (docloexec && batch == 1 && Fcntl_l(ps, F_SETFD, FD_CLOEXEC) < 0) {
+	    Warn2("fcntl(%d, F_SETFD, FD_CLOEXEC): %s", ps, strerror(errno));
 	 }
-	 ps = Accept(xfd->fd, (struct sockaddr *)&sa, &salen);
-	 if (ps >= 0) {
-	    /*0 Info4("accept(%d, %p, {"F_Zu"}) -> %d", xfd->fd, &sa, salen, ps);*/
-	    break;	/* success, break out of loop */
-	 }
-	 if (errno == EINTR) {
-	    continue;
+	 pend[0].fd = ps;
+	 pend[0].pas = pas;
+	 npend = 1;
+#if HAVE_ACCEPT4
+	 /* take more pending connections from the queue before the forks */
+	 while (npend < batch) {
+	    pend[npend].pas = sizeof(pend[npend].pa);
+	    ps = Accept4(xfd->fd, &pend[npend].pa.soa, &pend[npend].pas,
+			 docloexec?SOCK_CLOEXEC:0);
+	    if (ps < 0) {
+	       /* EAGAIN: queue is empty; other errors appear on next Accept() */
+	       break;
+	    }
+	    pend[npend++].fd = ps;
 	 }
-	 if (errno == ECONNABORTED) {
-	    Notice4("accept(%d, %p, {"F_socklen"}): %s",
-		    xfd->fd, &sa, salen, strerror(errno));
-	    continue;
+	 if (npend > 1) {
+	    Info1("accepted %d connections in one batch", npend);
 	 }
-	 Msg4(level, "accept(%d, %p, {"F_socklen"}): %s",
-	      xfd->fd, &sa, salen, strerror(errno));
-	 Close(xfd->fd);
-	 return STAT_RETRYLATER;
-      } while (true);
-      applyopts_cloexec(ps, opts);
-      if (Getpeername(ps, &pa->soa, &pas) < 0) {
-	 Warn4("getpeername(%d, %p, {"F_socklen"}): %s",
-	       ps, pa, pas, strerror(errno));
-	 pa = NULL;
+#endif /* HAVE_ACCEPT4 */
       }
-      if (Getsockname(ps, &la->soa, &las) < 0) {
+      ps  = pend[ipend].fd;
+      pa  = &pend[ipend].pa;
+      pas = pend[ipend].pas;
+      ++ipend;
+      XIOPROBE3(accept, xfd->fd, ps, pa->soa.sa_family);
+
+      la = &_sockname;
+      las = sizeof(_sockname);
+      if (usknown) {
+	 memcpy(la, us, uslen);
+	 las = uslen;
+      } else if (Getsockname(ps, &la->soa, &las) < 0) {
 	 Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
 	       ps, la, las, strerror(errno));
 	 la = NULL;
       }
-      Notice2("accepting connection from %s on %s",
-	      pa?
-	      sockaddr_info(&pa->soa, pas, peername, sizeof(peername)):"NULL",
-	      la?
-	      sockaddr_info(&la->soa, las, sockname, sizeof(sockname)):"NULL");
+      if (diag_level(E_NOTICE)) {
+	 Notice2("accepting connection from %s on %s",
+		 sockaddr_info(&pa->soa, pas, peername, sizeof(peername)),
+		 la?
+		 sockaddr_info(&la->soa, las, sockname, sizeof(sockname)):"NULL");
+      }
 
-      if (pa != NULL && la != NULL && xiocheckpeer(xfd, pa, la) < 0) {
+      if (la != NULL && xiocheckpeer(xfd, pa, la) < 0) {
 	 if (Shutdown(ps, 2) < 0) {
 	    Info2("shutdown(%d, 2): %s", ps, strerror(errno));
 	 }
@@ -329,14 +456,19 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 	 continue;
       }
 
-      if (pa != NULL)
+      if (diag_level(E_INFO)) {
 	 Info1("permitting connection from %s",
 	       sockaddr_info((struct sockaddr *)pa, pas,
 			     infobuff, sizeof(infobuff)));
+      }
 
       if (dofork) {
 	 pid_t pid;	/* mostly int; only used with fork */
-         sigset_t mask_sigchld;
+         sigset_t mask_sigchld, oldmask;
+
+	 if (xfd->prefork != NULL) {
+	    (*xfd->prefork)(xfd);	/* e.g. reload certificates */
+	 }
 
          /* we must prevent that the current packet triggers another fork;
             therefore we wait for a signal from the recent child: USR1
@@ -345,11 +477,13 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
          /* block SIGCHLD and SIGUSR1 until parent is ready to react */
          sigemptyset(&mask_sigchld);
          sigaddset(&mask_sigchld, SIGCHLD);
-         Sigprocmask(SIG_BLOCK, &mask_sigchld, NULL);
+         Sigprocmask(SIG_BLOCK, &mask_sigchld, &oldmask);
 
 	 if ((pid = xio_fork(false, level==E_ERROR?level:E_WARN)) < 0) {
 	    Close(xfd->fd);
-	    Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+	    Close(ps);
+	    while (ipend < npend)  Close(pend[ipend++].fd);
+	    Sigprocmask(SIG_SETMASK, &oldmask, NULL);
 	    return STAT_RETRYLATER;
 	 }
 	 if (pid == 0) {	/* child */
@@ -362,6 +496,10 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 	    if (Close(xfd->fd) < 0) {
 	       Info2("close(%d): %s", xfd->fd, strerror(errno));
 	    }
+	    /* connections of the batch that belong to later children */
+	    while (ipend < npend) {
+	       Close(pend[ipend++].fd);
+	    }
 	    xfd->fd = ps;
 
 #if WITH_RETRY
@@ -380,15 +518,19 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 	    Info2("close(%d): %s", ps, strerror(errno));
 	 }
 
-         /* now we are ready to handle signals */
-         Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+         /* now we are ready to handle signals (with signalfd SIGCHLD stays
+	    blocked) */
+         Sigprocmask(SIG_SETMASK, &oldmask, NULL);
 
-	 while (maxchildren) {
-	    if (num_child < maxchildren) break;
+	 if (maxchildren && num_child >= maxchildren) {
 	    Notice("maxchildren are active, waiting");
-	    /* UINT_MAX would even be nicer, but Openindiana works only
-	       with 31 bits */
-	    while (!Sleep(INT_MAX)) ;	/* any signal lets us continue */
+	    /* wakes up when a child terminated */
+	    while (num_child >= maxchildren) {
+	       if (xiochild_wait(-1, NULL) < 0) {
+		  Warn1("poll(): %s", strerror(errno));
+		  Sleep(1);
+	       }
+	    }
 	 }
 	 Info("still listening");
       } else {
@@ -413,4 +555,19 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
    return 0;
 }
 
+/* returns the system limit for the listen backlog, on Linux from
+   /proc/sys/net/core/somaxconn */
+static int xio_somaxconn(void) {
+   int somaxconn = SOMAXCONN;
+   FILE *fp;
+
+   if ((fp = fopen("/proc/sys/net/core/somaxconn", "r")) != NULL) {
+      if (fscanf(fp, "%d", &somaxconn) != 1 || somaxconn <= 0) {
+	 somaxconn = SOMAXCONN;
+      }
+      fclose(fp);
+   }
+   return somaxconn;
+}
+
 #endif /* WITH_LISTEN */
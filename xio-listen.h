@@ -10,6 +10,7 @@ extern const struct optdesc opt_fork;
 extern const struct optdesc opt_max_children;
 extern const struct optdesc opt_range;
 extern const struct optdesc opt_accept_timeout;
+extern const struct optdesc opt_accept_batch;
 
 int
    xioopen_listen(struct single *xfd, int xioflags,
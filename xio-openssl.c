@@ -19,6 +19,7 @@
 #include "xio-ip6.h"
 
 #include "xio-openssl.h"
+#include "xiostats.h"
 
 /* the openssl library requires a file descriptor for external communications.
    so our best effort is to provide any possible kind of un*x file descriptor 
@@ -58,6 +59,16 @@ static int openssl_handle_peer_certificate(struct single *xfd,
 static int xioSSL_set_fd(struct single *xfd, int level);
 static int xioSSL_connect(struct single *xfd, const char *opt_commonname, bool opt_ver, int level);
 static int openssl_delete_cert_info(void);
+static void xioSSL_rec_init(struct single *xfd);
+static int xioSSL_reload_setup(struct single *xfd, struct opt *opts);
+static int xioSSL_reload(struct single *xfd);
+static struct xio_openssl_snitab *xioSSL_sni_load(const char *filename, SSL_CTX *basectx);
+static void xioSSL_sni_free(struct xio_openssl_snitab *tab);
+static int xioSSL_sni_attach(SSL_CTX *ctx, struct xio_openssl_snitab *tab);
+static void xioSSL_sni_route(struct single *xfd);
+
+static struct sigaction xioSSL_sighup_old;	/* restored for connections */
+static volatile sig_atomic_t xioSSL_sighup_seen;	/* option openssl-reload */
 
 
 /* description record for ssl connect */
@@ -133,6 +144,13 @@ const struct optdesc opt_openssl_compress    = { "openssl-compress",   "compress
 const struct optdesc opt_openssl_fips        = { "openssl-fips",       "fips",   OPT_OPENSSL_FIPS,        GROUP_OPENSSL, PH_SPEC, TYPE_BOOL,     OFUNC_SPEC };
 #endif
 const struct optdesc opt_openssl_commonname  = { "openssl-commonname", "cn",     OPT_OPENSSL_COMMONNAME,  GROUP_OPENSSL, PH_SPEC, TYPE_STRING,   OFUNC_SPEC };
+const struct optdesc opt_openssl_dynamic_records = { "openssl-dynamic-records", "dynamic-records", OPT_OPENSSL_DYNAMIC_RECORDS, GROUP_OPENSSL, PH_INIT, TYPE_BOOL, OFUNC_OFFSET, XIO_OFFSETOF(para.openssl.rec.dynamic) };
+const struct optdesc opt_openssl_record_size = { "openssl-record-size", "record-size", OPT_OPENSSL_RECORD_SIZE, GROUP_OPENSSL, PH_INIT, TYPE_INT, OFUNC_OFFSET, XIO_OFFSETOF(para.openssl.rec.minsize) };
+const struct optdesc opt_openssl_record_max  = { "openssl-record-max",  "record-max",  OPT_OPENSSL_RECORD_MAX,  GROUP_OPENSSL, PH_INIT, TYPE_INT, OFUNC_OFFSET, XIO_OFFSETOF(para.openssl.rec.maxsize) };
+const struct optdesc opt_openssl_record_idle = { "openssl-record-idle", "record-idle", OPT_OPENSSL_RECORD_IDLE, GROUP_OPENSSL, PH_INIT, TYPE_TIMEVAL, OFUNC_OFFSET, XIO_OFFSETOF(para.openssl.rec.idle) };
+const struct optdesc opt_openssl_coalesce    = { "openssl-coalesce",    "coalesce",    OPT_OPENSSL_COALESCE,    GROUP_OPENSSL, PH_INIT, TYPE_TIMEVAL, OFUNC_OFFSET, XIO_OFFSETOF(para.openssl.rec.coalesce) };
+const struct optdesc opt_openssl_reload      = { "openssl-reload",      "reload",      OPT_OPENSSL_RELOAD,      GROUP_OPENSSL, PH_INIT, TYPE_BOOL,    OFUNC_OFFSET, XIO_OFFSETOF(para.openssl.reload.enable) };
+const struct optdesc opt_openssl_snitable    = { "openssl-snitable",    "snitable",    OPT_OPENSSL_SNITABLE,    GROUP_OPENSSL, PH_SPEC, TYPE_FILENAME, OFUNC_SPEC };
 #if defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name)
 const struct optdesc opt_openssl_no_sni      = { "openssl-no-sni",    "nosni",   OPT_OPENSSL_NO_SNI,      GROUP_OPENSSL, PH_SPEC, TYPE_BOOL,     OFUNC_SPEC };
 const struct optdesc opt_openssl_snihost     = { "openssl-snihost",   "snihost", OPT_OPENSSL_SNIHOST,     GROUP_OPENSSL, PH_SPEC, TYPE_STRING,   OFUNC_SPEC };
@@ -325,7 +343,7 @@ static int
       case STAT_RETRYLATER:
       case STAT_RETRYNOW:
 	 if (xfd->forever || xfd->retry) {
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
@@ -352,7 +370,7 @@ static int
       case STAT_RETRYNOW:
 	 if (xfd->forever || xfd->retry) {
 	    Close(xfd->fd);
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
@@ -392,7 +410,7 @@ static int
 	 xfd->para.openssl.ssl = NULL;
 	 /* with and without retry */
 	 Nanosleep(&xfd->intervall, NULL);
-	 dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	 opts = recopyopts(opts, opts0, GROUP_ALL);
 	 continue;	/* with next socket() bind() connect() */
       }
 #endif /* WITH_RETRY */
@@ -400,6 +418,7 @@ static int
    } while (true);	/* drop out on success */
 
    openssl_conn_loginfo(xfd->para.openssl.ssl);
+   xioSSL_rec_init(xfd);
 
    free((void *)opt_commonname);
    free((void *)opt_snihost);
@@ -532,18 +551,32 @@ static int
    if (applyopts_single(xfd, opts, PH_INIT) < 0)  return -1;
    applyopts(-1, opts, PH_INIT);
 
+   if (xfd->para.openssl.reload.enable) {
+      if (xioSSL_reload_setup(xfd, opts) < 0)  return STAT_NORETRY;
+   }
+
    retropt_string(opts, OPT_OPENSSL_CERTIFICATE, &opt_cert);
    if (opt_cert == NULL) {
       Warn("no certificate given; consider option \"cert\"");
    }
 
    retropt_string(opts, OPT_OPENSSL_COMMONNAME, (char **)&opt_commonname);
+   retropt_string(opts, OPT_OPENSSL_SNITABLE, &xfd->para.openssl.snitable);
 
    applyopts(-1, opts, PH_EARLY);
 
    result =
       _xioopen_openssl_prepare(opts, xfd, true, &opt_ver, opt_cert, &ctx, &use_dtls);
    if (result != STAT_OK)  return STAT_NORETRY;
+   xfd->para.openssl.reload.dtls = use_dtls;
+
+   if (xfd->para.openssl.snitable != NULL) {
+      xfd->para.openssl.snitab =
+	 xioSSL_sni_load(xfd->para.openssl.snitable, ctx);
+      if (xfd->para.openssl.snitab == NULL)  return STAT_NORETRY;
+      if (xioSSL_sni_attach(ctx, xfd->para.openssl.snitab) < 0)
+	 return STAT_NORETRY;
+   }
 
    if (use_dtls) {
       socktype = SOCK_DGRAM;
@@ -596,11 +629,11 @@ static int
       case STAT_RETRYLATER:
       case STAT_RETRYNOW:
 	 if (xfd->forever || xfd->retry) {
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    --xfd->retry;
 	    continue;
 	 }
@@ -610,6 +643,12 @@ static int
 	 return result;
       }
 
+      if (xfd->para.openssl.reload.enable) {
+	 /* this process serves the connection, stop reacting on SIGHUP */
+	 Sigaction(SIGHUP, &xioSSL_sighup_old, NULL);
+	 /* ctx might have been replaced before fork */
+	 ctx = xfd->para.openssl.ctx;
+      }
       result = _xioopen_openssl_listen(xfd, opt_ver, opt_commonname, ctx, level);
       switch (result) {
       case STAT_OK: break;
@@ -617,11 +656,11 @@ static int
       case STAT_RETRYLATER:
       case STAT_RETRYNOW:
 	 if (xfd->forever || xfd->retry) {
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    --xfd->retry;
 	    continue;
 	 }
@@ -632,6 +671,10 @@ static int
       }
 
       openssl_conn_loginfo(xfd->para.openssl.ssl);
+      xioSSL_rec_init(xfd);
+      if (xfd->para.openssl.snitab != NULL) {
+	 xioSSL_sni_route(xfd);
+      }
       break;
 
    }	/* drop out on success */
@@ -649,6 +692,7 @@ int _xioopen_openssl_listen(struct single *xfd,
 			     int level) {
    char error_string[120];
    unsigned long err;
+   struct timespec t0;
    int errint, ret;
 
    /* create an SSL object */
@@ -685,7 +729,12 @@ int _xioopen_openssl_listen(struct single *xfd,
 #endif /* WITH_DEBUG */
 
    /* connect via SSL by performing handshake */
-   if ((ret = sycSSL_accept(xfd->para.openssl.ssl)) <= 0) {
+   XIOPROBE2(tls_handshake_start, xfd->fd, 1);
+   xiostats_begin(&t0);
+   ret = sycSSL_accept(xfd->para.openssl.ssl);
+   XIOPROBE2(tls_handshake_done, xfd->fd, ret);
+   if (ret == 1)  xiostats_end(XIOSTATS_TLS, &t0);
+   if (ret <= 0) {
       /*if (ERR_peek_error() == 0) Msg(level, "SSL_accept() failed");*/
       errint = SSL_get_error(xfd->para.openssl.ssl, ret);
       switch (errint) {
@@ -1857,9 +1906,15 @@ static int xioSSL_connect(struct single *xfd, const char *opt_commonname,
    char error_string[120];
    int errint, status, ret;
    unsigned long err;
+   struct timespec t0;
 
    /* connect via SSL by performing handshake */
-   if ((ret = sycSSL_connect(xfd->para.openssl.ssl)) <= 0) {
+   XIOPROBE2(tls_handshake_start, xfd->fd, 0);
+   xiostats_begin(&t0);
+   ret = sycSSL_connect(xfd->para.openssl.ssl);
+   XIOPROBE2(tls_handshake_done, xfd->fd, ret);
+   if (ret == 1)  xiostats_end(XIOSTATS_TLS, &t0);
+   if (ret <= 0) {
       /*if (ERR_peek_error() == 0) Msg(level, "SSL_connect() failed");*/
       errint = SSL_get_error(xfd->para.openssl.ssl, ret);
       switch (errint) {
@@ -1974,7 +2029,7 @@ ssize_t xiopending_openssl(struct single *pipe) {
 }
 
 /* on result < 0: errno is set (at least to EIO) */
-ssize_t xiowrite_openssl(struct single *pipe, const void *buff, size_t bufsiz) {
+static ssize_t xioSSL_write(struct single *pipe, const void *buff, size_t bufsiz) {
    unsigned long err;
    char error_string[120];
    int _errno = EIO;	/* if we have no better idea about nature of error */
@@ -2027,10 +2082,225 @@ ssize_t xiowrite_openssl(struct single *pipe, const void *buff, size_t bufsiz) {
    return ret;
 }
 
+
+/* returns the current time for record sizing decisions; a monotonic clock is
+   preferred because wall clock steps must not trigger idle resets */
+static void xioSSL_rec_now(struct timespec *now) {
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+   clock_gettime(CLOCK_MONOTONIC, now);
+#else
+   struct timeval tv;
+   Gettimeofday(&tv, NULL);
+   now->tv_sec = tv.tv_sec;  now->tv_nsec = tv.tv_usec*1000;
+#endif
+}
+
+/* returns the time from then to now in microseconds, at least 0 */
+static long long xioSSL_rec_elapsed(const struct timespec *then,
+				    const struct timespec *now) {
+   long long usecs;
+   usecs = (long long)(now->tv_sec - then->tv_sec)*1000000 +
+      (now->tv_nsec - then->tv_nsec)/1000;
+   return usecs < 0 ? 0 : usecs;
+}
+
+/* prepares the record sizing policy of a freshly established SSL connection.
+   Without options dynamic-records and coalesce the policy stays inactive
+   (cursize==0) and xiowrite_openssl() passes data to SSL_write() unchanged */
+static void xioSSL_rec_init(struct single *xfd) {
+   struct xio_openssl_rec *rec = &xfd->para.openssl.rec;
+   bool coalesce;
+
+   coalesce =
+      rec->coalesce.tv_sec != 0 || rec->coalesce.tv_usec != 0;
+   if (!rec->dynamic && !coalesce) {
+      rec->cursize = 0;
+      return;
+   }
+   if (rec->maxsize <= 0 || rec->maxsize > XIO_OPENSSL_RECORD_MAX) {
+      if (rec->maxsize != 0) {
+	 Warn2("record-max=%d out of range, using %d",
+	       rec->maxsize, XIO_OPENSSL_RECORD_MAX);
+      }
+      rec->maxsize = XIO_OPENSSL_RECORD_MAX;
+   }
+   if (rec->minsize <= 0 || rec->minsize > rec->maxsize) {
+      if (rec->minsize != 0) {
+	 Warn2("record-size=%d out of range, using %d",
+	       rec->minsize, Min(XIO_OPENSSL_RECORD_MIN, rec->maxsize));
+      }
+      rec->minsize = Min(XIO_OPENSSL_RECORD_MIN, rec->maxsize);
+   }
+   if (rec->idle.tv_sec == 0 && rec->idle.tv_usec == 0) {
+      rec->idle.tv_sec = XIO_OPENSSL_RECORD_IDLE;
+   }
+   /* right after the handshake we start with small records */
+   rec->cursize = rec->dynamic ? rec->minsize : rec->maxsize;
+   rec->smallrecs = 0;
+   xioSSL_rec_now(&rec->lastwrite);
+   if (coalesce) {
+      if ((rec->pendbuf = Malloc(rec->maxsize)) == NULL) {
+	 rec->coalesce.tv_sec = 0;  rec->coalesce.tv_usec = 0;
+      }
+   }
+   rec->pendlen = 0;
+   Info5("SSL record sizing: %s, %d..%d bytes, idle "F_tv_sec"."F_tv_usec,
+	 rec->dynamic?"dynamic":"fixed", rec->minsize, rec->maxsize,
+	 rec->idle.tv_sec, rec->idle.tv_usec);
+}
+
+/* sends exactly one SSL record with len bytes and updates the record sizing
+   state and statistics.
+   returns len on success, or -1 with errno set */
+static ssize_t xioSSL_write_record(struct single *pipe, const void *buff,
+				   size_t len, const struct timespec *now) {
+   struct xio_openssl_rec *rec = &pipe->para.openssl.rec;
+   ssize_t writt;
+
+   if ((writt = xioSSL_write(pipe, buff, len)) < 0) {
+      return -1;
+   }
+   ++rec->records;
+   rec->bytes += writt;
+   if (rec->cursize < rec->maxsize) {
+      ++rec->minrecs;
+   } else {
+      ++rec->maxrecs;
+   }
+   if (rec->smallest == 0 || writt < rec->smallest)  rec->smallest = writt;
+   if (writt > rec->largest)  rec->largest = writt;
+   rec->lastwrite = *now;
+
+   /* sustained transfer: grow to full sized records */
+   if (rec->dynamic && rec->cursize < rec->maxsize &&
+       ++rec->smallrecs >= XIO_OPENSSL_RECORD_BOOST) {
+      Debug2("SSL records on fd %d: growing to %d bytes",
+	     pipe->fd, rec->maxsize);
+      rec->cursize = rec->maxsize;
+   }
+   return writt;
+}
+
+/* writes the coalesced data, if any, as one SSL record.
+   returns 0 on success, or -1 with errno set */
+int xioflush_openssl(struct single *pipe) {
+   struct xio_openssl_rec *rec = &pipe->para.openssl.rec;
+   struct timespec now;
+   size_t pendlen;
+
+   if (rec->pendlen == 0 || pipe->para.openssl.ssl == NULL) {
+      return 0;
+   }
+   xioSSL_rec_now(&now);
+   pendlen = rec->pendlen;
+   rec->pendlen = 0;
+   ++rec->flushes;
+   if (xioSSL_write_record(pipe, rec->pendbuf, pendlen, &now) < 0) {
+      return -1;
+   }
+   return 0;
+}
+
+/* if coalesced data is waiting, stores in delay how long it may still wait
+   and returns 1; otherwise returns 0 */
+int xioflushdelay_openssl(struct single *pipe, struct timeval *delay) {
+   struct xio_openssl_rec *rec = &pipe->para.openssl.rec;
+   struct timespec now;
+   long long left;
+
+   if (rec->pendlen == 0) {
+      return 0;
+   }
+   xioSSL_rec_now(&now);
+   left = (long long)rec->coalesce.tv_sec*1000000 + rec->coalesce.tv_usec -
+      xioSSL_rec_elapsed(&rec->pendsince, &now);
+   if (left < 0)  left = 0;
+   delay->tv_sec  = left / 1000000;
+   delay->tv_usec = left % 1000000;
+   return 1;
+}
+
+/* on result < 0: errno is set (at least to EIO) */
+ssize_t xiowrite_openssl(struct single *pipe, const void *buff, size_t bufsiz) {
+   struct xio_openssl_rec *rec = &pipe->para.openssl.rec;
+   const unsigned char *data = buff;
+   size_t left = bufsiz, chunk;
+   struct timespec now;
+
+   if (rec->cursize == 0) {
+      /* no record sizing policy */
+      return xioSSL_write(pipe, buff, bufsiz);
+   }
+
+   xioSSL_rec_now(&now);
+   if (rec->dynamic && rec->cursize > rec->minsize && rec->pendlen == 0) {
+      long long idle =
+	 (long long)rec->idle.tv_sec*1000000 + rec->idle.tv_usec;
+      if (xioSSL_rec_elapsed(&rec->lastwrite, &now) >= idle) {
+	 /* connection was idle, congestion window might have shrunk */
+	 Debug2("SSL records on fd %d: idle, falling back to %d bytes",
+		pipe->fd, rec->minsize);
+	 rec->cursize = rec->minsize;
+	 rec->smallrecs = 0;
+      }
+   }
+
+   if (rec->pendbuf != NULL) {
+      if (rec->pendlen + left < (size_t)rec->cursize) {
+	 /* hold back small write; data loop flushes it within budget */
+	 if (rec->pendlen == 0)  rec->pendsince = now;
+	 memcpy(rec->pendbuf + rec->pendlen, data, left);
+	 rec->pendlen += left;
+	 ++rec->coalesced;
+	 return bufsiz;
+      }
+      if (rec->pendlen > 0) {
+	 /* top up the pending record and send it */
+	 chunk = rec->cursize - rec->pendlen;
+	 memcpy(rec->pendbuf + rec->pendlen, data, chunk);
+	 rec->pendlen += chunk;
+	 data += chunk;  left -= chunk;
+	 if (xioflush_openssl(pipe) < 0) {
+	    return -1;
+	 }
+      }
+   }
+
+   while (left > 0) {
+      chunk = Min(left, (size_t)rec->cursize);
+      if (xioSSL_write_record(pipe, data, chunk, &now) < 0) {
+	 return -1;
+      }
+      data += chunk;  left -= chunk;
+   }
+   return bufsiz;
+}
+
+/* prints the record statistics of the connection and releases the coalescing
+   buffer */
+void xiorecstat_openssl(struct single *sfd) {
+   struct xio_openssl_rec *rec = &sfd->para.openssl.rec;
+
+   if (rec->cursize == 0) {
+      return;
+   }
+   Info7("SSL records on fd %d: %lu records with %llu bytes, %lu small, %lu full, smallest %d, largest %d",
+	 sfd->fd, rec->records, rec->bytes, rec->minrecs, rec->maxrecs,
+	 rec->smallest, rec->largest);
+   if (rec->pendbuf != NULL) {
+      Info3("SSL records on fd %d: %lu writes coalesced, %lu flushes",
+	    sfd->fd, rec->coalesced, rec->flushes);
+      free(rec->pendbuf);
+      rec->pendbuf = NULL;
+   }
+   rec->cursize = 0;
+}
+
 int xioshutdown_openssl(struct single *sfd, int how)
 {
    int rc;
 
+   xioflush_openssl(sfd);
    if ((rc = sycSSL_shutdown(sfd->para.openssl.ssl)) < 0) {
       Warn1("xioshutdown_openssl(): SSL_shutdown() -> %d", rc);
    }
@@ -2042,4 +2312,439 @@ int xioshutdown_openssl(struct single *sfd, int how)
    return 0;
 }
 
+
+/* signal handler of option openssl-reload; the listener builds a new context
+   before it forks the next child process */
+static void xioSSL_sighup(int signum) {
+   xioSSL_sighup_seen = 1;
+}
+
+/* checks the certificate files of option openssl-reload; returns the index of
+   the first file that changed since the previous call, or -1 */
+static int xioSSL_reload_stat(struct single *xfd) {
+   struct stat buf;
+   int changed = -1;
+   int i;
+
+   for (i = 0; i < sizeof(xfd->para.openssl.reload.files)/sizeof(char *); ++i) {
+      const char *file = xfd->para.openssl.reload.files[i];
+      struct stat *prev = &xfd->para.openssl.reload.stats[i];
+
+      if (file == NULL)  continue;
+      if (Stat(file, &buf) < 0) {
+	 /* might be just replaced; reload when it appears again */
+	 memset(&buf, 0, sizeof(buf));
+      }
+      if (buf.st_dev != prev->st_dev || buf.st_ino != prev->st_ino ||
+	  buf.st_size != prev->st_size || buf.st_mtime != prev->st_mtime) {
+	 if (changed < 0)  changed = i;
+	 *prev = buf;
+      }
+   }
+   return changed;
+}
+
+/* prepares option openssl-reload: keeps a copy of the OpenSSL options for
+   building new contexts, remembers the state of the certificate files, and
+   catches SIGHUP */
+static int xioSSL_reload_setup(struct single *xfd, struct opt *opts) {
+   struct opt *copy;
+   struct sigaction act;
+
+   if ((xfd->para.openssl.reload.opts = copyopts(opts, GROUP_OPENSSL)) == NULL) {
+      return -1;
+   }
+   if ((copy = copyopts(opts, GROUP_OPENSSL)) == NULL) {
+      return -1;
+   }
+   retropt_string(copy, OPT_OPENSSL_CERTIFICATE, &xfd->para.openssl.reload.files[0]);
+   retropt_string(copy, OPT_OPENSSL_KEY,     &xfd->para.openssl.reload.files[1]);
+   retropt_string(copy, OPT_OPENSSL_DHPARAM, &xfd->para.openssl.reload.files[2]);
+   retropt_string(copy, OPT_OPENSSL_CAFILE,  &xfd->para.openssl.reload.files[3]);
+   retropt_string(copy, OPT_OPENSSL_SNITABLE, &xfd->para.openssl.reload.files[4]);
+   freeopts(copy);
+   xioSSL_reload_stat(xfd);
+
+   memset(&act, 0, sizeof(act));
+   sigfillset(&act.sa_mask);
+   act.sa_flags = 0;	/* interrupt accept() */
+   act.sa_handler = xioSSL_sighup;
+   Sigaction(SIGHUP, &act, &xioSSL_sighup_old);
+   xfd->prefork = xioSSL_reload;
+   return 0;
+}
+
+/* option openssl-reload: the listener calls this for a new connection before
+   fork. When SIGHUP was caught or a certificate file changed it builds a new
+   SSL_CTX that serves this and the following connections; on failure the
+   previous one is kept. Existing child processes keep their context.
+   returns 0 when the context is up to date, -1 when reload failed */
+static int xioSSL_reload(struct single *xfd) {
+   SSL_CTX *oldctx = xfd->para.openssl.ctx;
+   SSL_CTX *ctx = NULL;
+   struct opt *opts;
+   char *opt_cert = NULL;
+   bool opt_ver = true;
+   bool use_dtls = xfd->para.openssl.reload.dtls;
+   struct timespec then, now;
+   long long usecs;
+   int exitlevel;
+   int changed;
+   int result;
+
+   changed = xioSSL_reload_stat(xfd);
+   if (changed < 0 && !xioSSL_sighup_seen) {
+      return 0;
+   }
+   if (xioSSL_sighup_seen) {
+      Notice("SIGHUP: reloading certificates");
+   } else {
+      Notice1("\"%s\" changed, reloading certificates",
+	      xfd->para.openssl.reload.files[changed]);
+   }
+   xioSSL_sighup_seen = 0;
+
+   if ((opts = copyopts(xfd->para.openssl.reload.opts, GROUP_ALL)) == NULL) {
+      return -1;
+   }
+   retropt_string(opts, OPT_OPENSSL_CERTIFICATE, &opt_cert);
+
+   xioSSL_rec_now(&then);
+   exitlevel = diag_get_int('e');
+   diag_set_int('e', E_FATAL);	/* errors must not terminate the listener */
+   result =
+      _xioopen_openssl_prepare(opts, xfd, true, &opt_ver, opt_cert, &ctx, &use_dtls);
+   diag_set_int('e', exitlevel);
+   xioSSL_rec_now(&now);
+   usecs = xioSSL_rec_elapsed(&then, &now);
+   free(opt_cert);
+   freeopts(opts);
+
+   if (result != STAT_OK) {
+      if (ctx != NULL)  sycSSL_CTX_free(ctx);
+      xfd->para.openssl.ctx = oldctx;
+      Warn2("reloading certificates failed after %lld.%06llds, keeping the previous ones",
+	    usecs/1000000, usecs%1000000);
+      return -1;
+   }
+   if (xfd->para.openssl.snitable != NULL) {
+      struct xio_openssl_snitab *tab;
+
+      diag_set_int('e', E_FATAL);
+      tab = xioSSL_sni_load(xfd->para.openssl.snitable, ctx);
+      diag_set_int('e', exitlevel);
+      if (tab == NULL) {
+	 Warn1("reloading \"%s\" failed, keeping the previous SNI table",
+	       xfd->para.openssl.snitable);
+      } else {
+	 xioSSL_sni_free(xfd->para.openssl.snitab);
+	 xfd->para.openssl.snitab = tab;
+      }
+      xioSSL_sni_attach(ctx, xfd->para.openssl.snitab);
+   }
+   if (oldctx != NULL)  sycSSL_CTX_free(oldctx);
+   Notice2("reloaded certificates in %lld.%06llds",
+	   usecs/1000000, usecs%1000000);
+   return 0;
+}
+
+
+/* option openssl-snitable: a table, loaded from file, that selects the
+   certificate and optionally the second address by the server name that the
+   client sends in the TLS ClientHello (SNI). File format, one entry per line:
+	<hostname> <certfile> [<keyfile>|- [<address>]]
+   hostname may be "*.domain" (matches exactly one more label) or "*" (matches
+   any name and clients without SNI). Empty lines and lines starting with '#'
+   are ignored */
+struct xioSSL_snient {
+   struct xioSSL_snient *next;	/* hash chain */
+   char *name;		/* lower case */
+   char *cert;
+   char *key;		/* NULL: key is in cert file */
+   char *address;	/* NULL: use the second address */
+   SSL_CTX *ctx;	/* just holds cert, chain, and key of this entry */
+} ;
+
+struct xio_openssl_snitab {
+   unsigned int size;	/* number of buckets, power of 2 */
+   struct xioSSL_snient **bucket;
+   struct xioSSL_snient *match;	/* entry of the current connection */
+} ;
+
+/* FNV-1a */
+static unsigned int xioSSL_sni_hash(const char *name) {
+   unsigned int h = 2166136261U;
+   while (*name) {
+      h ^= (unsigned char)*name++;
+      h *= 16777619U;
+   }
+   return h;
+}
+
+static struct xioSSL_snient *
+   xioSSL_sni_find(struct xio_openssl_snitab *tab, const char *name) {
+   struct xioSSL_snient *ent;
+
+   ent = tab->bucket[xioSSL_sni_hash(name) & (tab->size-1)];
+   while (ent != NULL) {
+      if (!strcmp(ent->name, name))  return ent;
+      ent = ent->next;
+   }
+   return NULL;
+}
+
+/* looks up the entry for the server name, trying the exact name, then the
+   wildcard for its parent domain, then "*". name may be NULL */
+static struct xioSSL_snient *
+   xioSSL_sni_lookup(struct xio_openssl_snitab *tab, const char *name) {
+   char key[256];	/* DNS names have at most 253 chars */
+   struct xioSSL_snient *ent;
+   char *dot;
+   size_t i;
+
+   if (name != NULL && strlen(name) < sizeof(key)-1) {
+      key[0] = '*';
+      for (i = 0; name[i] != '\0'; ++i) {
+	 key[i+1] = tolower((unsigned char)name[i]);
+      }
+      key[i+1] = '\0';
+      if ((ent = xioSSL_sni_find(tab, key+1)) != NULL)  return ent;
+      if ((dot = strchr(key+1, '.')) != NULL) {
+	 *--dot = '*';
+	 if ((ent = xioSSL_sni_find(tab, dot)) != NULL)  return ent;
+      }
+   }
+   return xioSSL_sni_find(tab, "*");
+}
+
+/* creates a context that only holds the certificate, chain, and key of an
+   entry; the callback copies these into the connection, which keeps the
+   verify, cafile, DH, and other settings of the base context */
+static SSL_CTX *xioSSL_sni_ctx(SSL_CTX *basectx, const char *cert,
+			       const char *key) {
+   SSL_CTX *ctx;
+   unsigned long err;
+
+   if ((ctx = sycSSL_CTX_new(SSL_CTX_get_ssl_method(basectx))) == NULL) {
+      if (ERR_peek_error() == 0) Error("SSL_CTX_new()");
+      while (err = ERR_get_error()) {
+	 Error1("SSL_CTX_new(): %s", ERR_error_string(err, NULL));
+      }
+      return NULL;
+   }
+   if (sycSSL_CTX_use_certificate_chain_file(ctx, cert) <= 0) {
+      if (ERR_peek_error() == 0)
+	 Error2("SSL_CTX_use_certificate_file(%p, \"%s\", SSL_FILETYPE_PEM) failed",
+		ctx, cert);
+      while (err = ERR_get_error()) {
+	 Error1("SSL_CTX_use_certificate_file(): %s",
+		ERR_error_string(err, NULL));
+      }
+      sycSSL_CTX_free(ctx);
+      return NULL;
+   }
+   if (sycSSL_CTX_use_PrivateKey_file(ctx, key?key:cert, SSL_FILETYPE_PEM) <= 0) {
+      openssl_SSL_ERROR_SSL(E_ERROR, "SSL_CTX_use_PrivateKey_file");
+      sycSSL_CTX_free(ctx);
+      return NULL;
+   }
+   return ctx;
+}
+
+/* returns a copy of the next whitespace separated field of *linep, or with
+   rest!=0 of the remainder of the line without trailing white space; NULL
+   when there is none */
+static char *xioSSL_sni_field(char **linep, bool rest) {
+   char *p = *linep, *end;
+   char *field;
+
+   p += strspn(p, " \t");
+   if (*p == '\0')  return NULL;
+   if (rest) {
+      end = p + strlen(p);
+      while (end > p && isspace((unsigned char)end[-1]))  --end;
+   } else {
+      end = p + strcspn(p, " \t");
+   }
+   if ((field = Malloc(end-p+1)) == NULL)  return NULL;
+   memcpy(field, p, end-p);  field[end-p] = '\0';
+   *linep = end;
+   return field;
+}
+
+static void xioSSL_sni_freeent(struct xioSSL_snient *ent) {
+   if (ent->ctx != NULL)  sycSSL_CTX_free(ent->ctx);
+   free(ent->name);  free(ent->cert);  free(ent->key);  free(ent->address);
+   free(ent);
+}
+
+/* reads the SNI table file and loads the certificates of all entries.
+   returns the new table, or NULL on error (message printed) */
+static struct xio_openssl_snitab *
+   xioSSL_sni_load(const char *filename, SSL_CTX *basectx) {
+   struct xio_openssl_snitab *tab;
+   struct xioSSL_snient *list = NULL, *ent;
+   unsigned int num = 0, size = 16, h;
+   char line[4096], *lp, *key;
+   int lineno = 0;
+   FILE *fp;
+   bool ok = true;
+
+   if ((fp = fopen(filename, "r")) == NULL) {
+      Error2("fopen(\"%s\", \"r\"): %s", filename, strerror(errno));
+      return NULL;
+   }
+   while (ok && fgets(line, sizeof(line), fp) != NULL) {
+      ++lineno;
+      line[strcspn(line, "\r\n")] = '\0';
+      lp = line + strspn(line, " \t");
+      if (*lp == '\0' || *lp == '#')  continue;
+
+      if ((ent = Calloc(1, sizeof(struct xioSSL_snient))) == NULL) {
+	 ok = false;  break;
+      }
+      ent->name = xioSSL_sni_field(&lp, false);
+      ent->cert = xioSSL_sni_field(&lp, false);
+      key       = xioSSL_sni_field(&lp, false);
+      ent->address = xioSSL_sni_field(&lp, true);
+      if (key != NULL && strcmp(key, "-")) {
+	 ent->key = key;
+      } else {
+	 free(key);
+      }
+      ent->next = list;  list = ent;
+      if (ent->cert == NULL) {
+	 Error2("%s:%d: hostname and certificate file required",
+		filename, lineno);
+	 ok = false;  break;
+      }
+      for (lp = ent->name; *lp; ++lp) {
+	 *lp = tolower((unsigned char)*lp);
+      }
+      if ((ent->ctx = xioSSL_sni_ctx(basectx, ent->cert, ent->key)) == NULL) {
+	 Error2("%s:%d: failed to load certificate", filename, lineno);
+	 ok = false;  break;
+      }
+      ++num;
+   }
+   fclose(fp);
+
+   while (size < 2*num)  size <<= 1;
+   if (!ok ||
+       (tab = Calloc(1, sizeof(struct xio_openssl_snitab))) == NULL) {
+      while (list != NULL) {
+	 ent = list->next;  xioSSL_sni_freeent(list);  list = ent;
+      }
+      return NULL;
+   }
+   if ((tab->bucket = Calloc(size, sizeof(struct xioSSL_snient *))) == NULL) {
+      free(tab);
+      while (list != NULL) {
+	 ent = list->next;  xioSSL_sni_freeent(list);  list = ent;
+      }
+      return NULL;
+   }
+   tab->size = size;
+   while (list != NULL) {
+      ent = list;  list = list->next;
+      if (xioSSL_sni_find(tab, ent->name) != NULL) {
+	 Warn2("%s: duplicate entry \"%s\" ignored", filename, ent->name);
+	 xioSSL_sni_freeent(ent);
+	 continue;
+      }
+      h = xioSSL_sni_hash(ent->name) & (size-1);
+      ent->next = tab->bucket[h];  tab->bucket[h] = ent;
+   }
+   Info2("SNI table \"%s\": %u entries", filename, num);
+   return tab;
+}
+
+static void xioSSL_sni_free(struct xio_openssl_snitab *tab) {
+   struct xioSSL_snient *ent, *next;
+   unsigned int i;
+
+   if (tab == NULL)  return;
+   for (i = 0; i < tab->size; ++i) {
+      for (ent = tab->bucket[i]; ent != NULL; ent = next) {
+	 next = ent->next;
+	 xioSSL_sni_freeent(ent);
+      }
+   }
+   free(tab->bucket);
+   free(tab);
+}
+
+#if defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name)
+/* OpenSSL calls this during the ClientHello; switches the connection to the
+   certificate of the matching entry */
+static int xioSSL_sni_callback(SSL *ssl, int *alert, void *arg) {
+   struct xio_openssl_snitab *tab = arg;
+   struct xioSSL_snient *ent;
+   const char *name;
+
+   name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+   if ((ent = xioSSL_sni_lookup(tab, name)) == NULL) {
+      Notice1("SNI: no entry for \"%s\", using default certificate",
+	      name?name:"");
+      return SSL_TLSEXT_ERR_OK;
+   }
+   Info2("SNI: \"%s\" matches entry \"%s\"", name?name:"", ent->name);
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+   {
+      STACK_OF(X509) *chain = NULL;
+
+      SSL_CTX_get0_chain_certs(ent->ctx, &chain);
+      if (SSL_use_certificate(ssl, SSL_CTX_get0_certificate(ent->ctx)) != 1 ||
+	  SSL_use_PrivateKey(ssl, SSL_CTX_get0_privatekey(ent->ctx)) != 1 ||
+	  SSL_set1_chain(ssl, chain) != 1) {
+	 openssl_SSL_ERROR_SSL(E_ERROR, "SSL_use_certificate");
+	 *alert = SSL_AD_INTERNAL_ERROR;
+	 return SSL_TLSEXT_ERR_ALERT_FATAL;
+      }
+   }
+#else
+   /* no access to the loaded objects; read the files again, without chain */
+   if (SSL_use_certificate_file(ssl, ent->cert, SSL_FILETYPE_PEM) != 1 ||
+       SSL_use_PrivateKey_file(ssl, ent->key?ent->key:ent->cert,
+			       SSL_FILETYPE_PEM) != 1) {
+      openssl_SSL_ERROR_SSL(E_ERROR, "SSL_use_certificate_file");
+      *alert = SSL_AD_INTERNAL_ERROR;
+      return SSL_TLSEXT_ERR_ALERT_FATAL;
+   }
+#endif
+   tab->match = ent;
+   return SSL_TLSEXT_ERR_OK;
+}
+#endif /* defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name) */
+
+static int xioSSL_sni_attach(SSL_CTX *ctx, struct xio_openssl_snitab *tab) {
+#if defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name)
+   SSL_CTX_set_tlsext_servername_callback(ctx, xioSSL_sni_callback);
+   SSL_CTX_set_tlsext_servername_arg(ctx, tab);
+   return 0;
+#else
+   Error("option openssl-snitable: SNI not supported by OpenSSL library");
+   return -1;
+#endif
+}
+
+/* after the handshake: provides the server name to the environment and
+   selects the second address of the matching entry */
+static void xioSSL_sni_route(struct single *xfd) {
+   struct xio_openssl_snitab *tab = xfd->para.openssl.snitab;
+#if defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name)
+   const char *name;
+
+   name = SSL_get_servername(xfd->para.openssl.ssl, TLSEXT_NAMETYPE_host_name);
+   if (name != NULL) {
+      xiosetenv("OPENSSL_SNI", name, 1, NULL);
+   }
+#endif
+   if (tab->match != NULL && tab->match->address != NULL) {
+      Info2("SNI entry \"%s\": using address \"%s\"",
+	    tab->match->name, tab->match->address);
+      xfd->route = tab->match->address;
+   }
+}
+
 #endif /* WITH_OPENSSL */
@@ -10,6 +10,12 @@
 #define SSLIO_BASE 0x53530000	/* "SSxx" */
 #define SSLIO_MASK 0xffff0000
 
+/* defaults of the record sizing policy (options dynamic-records, coalesce) */
+#define XIO_OPENSSL_RECORD_MIN	1400	/* fits into one TCP segment */
+#define XIO_OPENSSL_RECORD_MAX	16384	/* TLS maximum plaintext record */
+#define XIO_OPENSSL_RECORD_BOOST	40	/* small records before growing */
+#define XIO_OPENSSL_RECORD_IDLE	1	/* seconds idle before shrinking */
+
 extern const struct addrdesc xioaddr_openssl;
 extern const struct addrdesc xioaddr_openssl_listen;
 extern const struct addrdesc xioaddr_openssl_dtls_client;
@@ -34,8 +40,15 @@ extern const struct optdesc opt_openssl_compress;
 extern const struct optdesc opt_openssl_fips;
 #endif
 extern const struct optdesc opt_openssl_commonname;
+extern const struct optdesc opt_openssl_dynamic_records;
+extern const struct optdesc opt_openssl_record_size;
+extern const struct optdesc opt_openssl_record_max;
+extern const struct optdesc opt_openssl_record_idle;
+extern const struct optdesc opt_openssl_coalesce;
+extern const struct optdesc opt_openssl_reload;
 extern const struct optdesc opt_openssl_no_sni;
 extern const struct optdesc opt_openssl_snihost;
+extern const struct optdesc opt_openssl_snitable;
 
 extern int
    _xioopen_openssl_prepare(struct opt *opts, struct single *xfd,
@@ -55,6 +68,9 @@ extern int xioshutdown_openssl(struct single *sfd, int how);
 extern ssize_t xioread_openssl(struct single *file, void *buff, size_t bufsiz);
 extern ssize_t xiopending_openssl(struct single *pipe);
 extern ssize_t xiowrite_openssl(struct single *file, const void *buff, size_t bufsiz);
+extern int xioflush_openssl(struct single *pipe);
+extern int xioflushdelay_openssl(struct single *pipe, struct timeval *delay);
+extern void xiorecstat_openssl(struct single *sfd);
 
 #if WITH_FIPS
 extern int xio_reset_fips_mode(void);
@@ -148,7 +148,7 @@ int _xioopen_foxec(int xioflags,	/* XIO_RDONLY etc. */
       }
       fd->flags |= XIO_DOESEXEC;
 
-      free(*copts);
+      freeopts(*copts);
       *copts = moveopts(popts, GROUP_ALL);
 
 #if 0 /*!! */
@@ -263,7 +263,7 @@ int _xioopen_foxec(int xioflags,	/* XIO_RDONLY etc. */
 	 }
       }
 #endif /* HAVE_OPENPTY */
-      free(*copts);
+      freeopts(*copts);
       if ((*copts = moveopts(popts, GROUP_TERMIOS|GROUP_FORK|GROUP_EXEC|GROUP_PROCESS|GROUP_NAMED)) == NULL) {
 	 return -1;
       }
@@ -295,7 +295,7 @@ int _xioopen_foxec(int xioflags,	/* XIO_RDONLY etc. */
       }
       /*0 Info2("pipe({%d,%d})", rdpip[0], rdpip[1]);*/
       /* rdpip[0]: read by socat; rdpip[1]: write by child */
-      free(*copts);
+      freeopts(*copts);
       if ((*copts = moveopts(popts, GROUP_FORK|GROUP_EXEC|GROUP_PROCESS))
 	  == NULL) {
 	 return -1;
@@ -348,7 +348,7 @@ int _xioopen_foxec(int xioflags,	/* XIO_RDONLY etc. */
       }
       /*0 Info5("socketpair(%d, %d, %d, {%d,%d})",
 	d, type, protocol, sv[0], sv[1]);*/
-      free(*copts);
+      freeopts(*copts);
       if ((*copts = moveopts(popts, GROUP_FORK|GROUP_EXEC|GROUP_PROCESS)) == NULL) {
 	 return -1;
       }
@@ -16,6 +16,7 @@
 #include "xio-ascii.h"	/* for base64 encoding of authentication */
 
 #include "xio-proxy.h"
+#include "xiostats.h"
 
 
 #define PROXYPORT "8080"
@@ -213,7 +214,7 @@ static int xioopen_proxy_connect(int argc, const char *argv[], struct opt *opts,
 	 /* parent process */
 	 Close(xfd->fd);
 	 Nanosleep(&xfd->intervall, NULL);
-	 dropopts(opts, PH_ALL);  opts = copyopts(opts0, GROUP_ALL);
+	 opts = recopyopts(opts, opts0, GROUP_ALL);
 	 continue;
       } else
 #endif /* WITH_RETRY */
@@ -329,6 +330,7 @@ int _xioopen_proxy_connect(struct single *xfd,
    char *eol = buff;
    int state;
    ssize_t sresult;
+   struct timespec t0;
 
    /* generate proxy request header - points to final target */
    rv = snprintf(request, CONNLEN, "CONNECT %s:%u HTTP/1.0\r\n",
@@ -342,6 +344,7 @@ int _xioopen_proxy_connect(struct single *xfd,
    * xiosanitize(request, strlen(request), textbuff) = '\0';
    Info1("sending \"%s\"", textbuff);
    /* write errors are assumed to always be hard errors, no retry */
+   xiostats_begin(&t0);
    if (writefull(xfd->fd, request, strlen(request)) < 0) {
       Msg4(level, "write(%d, %p, "F_Zu"): %s",
 	   xfd->fd, request, strlen(request), strerror(errno));
@@ -393,6 +396,7 @@ int _xioopen_proxy_connect(struct single *xfd,
       }
       return STAT_RETRYLATER;
    }
+   XIOPROBE1(proxy_request, xfd->fd);
 
    /* request is kept for later error messages */
    *strstr(request, " HTTP") = '\0';
@@ -527,6 +531,8 @@ int _xioopen_proxy_connect(struct single *xfd,
 
 	 /* skip multiple spaces */
 	 while (*ptr == ' ')  ++ptr;
+	 XIOPROBE2(proxy_reply, xfd->fd, atoi(ptr));
+	 xiostats_end(XIOSTATS_PROXY, &t0);
 
 	 /* HTTP answer */
 	 if (strncmp(ptr, "200", 3)) {
@@ -27,6 +27,9 @@
 #include "xio-listen.h"
 #include "xio-ipapp.h"	/*! not clean */
 #include "xio-tcpwrap.h"
+#include "xio-udp.h"	/* option workers */
+#include "xio-interface.h"	/* PACKET_MMAP rings */
+#include "xiostats.h"
 
 
 static
@@ -195,6 +198,7 @@ const struct optdesc opt_bind        = { "bind",      NULL, OPT_BIND,        GRO
 const struct optdesc opt_connect_timeout = { "connect-timeout", NULL, OPT_CONNECT_TIMEOUT, GROUP_SOCKET, PH_PASTSOCKET, TYPE_TIMEVAL, OFUNC_OFFSET, XIO_OFFSETOF(para.socket.connect_timeout) };
 const struct optdesc opt_protocol_family = { "protocol-family", "pf", OPT_PROTOCOL_FAMILY, GROUP_SOCKET, PH_PRESOCKET,  TYPE_STRING,  OFUNC_SPEC };
 const struct optdesc opt_protocol        = { "protocol",        NULL, OPT_PROTOCOL,        GROUP_SOCKET, PH_PRESOCKET,  TYPE_STRING,  OFUNC_SPEC };
+const struct optdesc opt_dgram_batch     = { "dgram-batch",     NULL, OPT_DGRAM_BATCH,     GROUP_SOCKET, PH_INIT,       TYPE_INT,     OFUNC_OFFSET, XIO_OFFSETOF(dgrambatch) };
 
 /* generic setsockopt() options */
 const struct optdesc opt_setsockopt        = { "setsockopt",        "sockopt",        OPT_SETSOCKOPT_BIN,        GROUP_SOCKET,PH_CONNECTED, TYPE_INT_INT_BIN,     OFUNC_SOCKOPT_GENERIC, 0, 0 };
@@ -767,6 +771,7 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
    char infobuff[256];
    union sockaddr_union la;
    socklen_t lalen = themlen;
+   struct timespec t0;
    int _errno;
    int result;
 
@@ -798,6 +803,8 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
       Fcntl_l(xfd->fd, F_SETFL, fcntl_flags|O_NONBLOCK);
    }
 
+   XIOPROBE2(connect_start, xfd->fd, them->sa_family);
+   xiostats_begin(&t0);
    result = Connect(xfd->fd, them, themlen);
    _errno = errno;
    la.soa.sa_family = them->sa_family;  lalen = sizeof(la);
@@ -829,6 +836,7 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 	       return STAT_RETRYLATER;
 	    }
 	    if (result == 0) {
+	       XIOPROBE2(connect_done, xfd->fd, ETIMEDOUT);
 	       Msg2(level, "connecting to %s: %s",
 		    sockaddr_info(them, themlen, infobuff, sizeof(infobuff)),
 		    strerror(ETIMEDOUT));
@@ -843,6 +851,7 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 		    strerror(errno));
 #else
 	       Connect(xfd->fd, them, themlen);	/* get error message */
+	       XIOPROBE2(connect_done, xfd->fd, errno);
 	       Msg4(level, "connect(%d, %s, "F_Zd"): %s",
 		     xfd->fd, sockaddr_info(them, themlen, infobuff, sizeof(infobuff)),
 		     themlen, strerror(errno));
@@ -859,6 +868,7 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 	    Debug2("getsockopt(%d, SOL_SOCKET, SO_ERROR, { %d }) -> 0",
 		   xfd->fd, err);
 	    if (err != 0) {
+	       XIOPROBE2(connect_done, xfd->fd, err);
 	       Msg4(level, "connect(%d, %s, "F_Zd"): %s",
 		     xfd->fd, sockaddr_info(them, themlen, infobuff, sizeof(infobuff)),
 		     themlen, strerror(err));
@@ -884,6 +894,7 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 	 errno = _errno;
 	 return STAT_RETRYLATER;
       } else {
+	 XIOPROBE2(connect_done, xfd->fd, errno);
 	 /* try to find details about error, especially from ICMP */
 	 xiogetpacketinfo(xfd->fd);
 
@@ -898,6 +909,8 @@ int _xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
       Notice1("successfully connected from local address %s",
 	      sockaddr_info(&la.soa, themlen, infobuff, sizeof(infobuff)));
    }
+   XIOPROBE2(connect_done, xfd->fd, 0);
+   xiostats_end(XIOSTATS_CONNECT, &t0);
 
    applyopts_fchown(xfd->fd, opts);	/* OPT_USER, OPT_GROUP */
    applyopts(xfd->fd, opts, PH_CONNECTED);
@@ -959,7 +972,7 @@ int xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    continue;
 	 }
 	 return STAT_NORETRY;
@@ -984,7 +997,7 @@ int xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 	 while ((pid = xio_fork(false, level)) < 0) {
 	    --xfd->retry;
 	    if (xfd->forever || xfd->retry) {
-	       dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	       opts = recopyopts(opts, opts0, GROUP_ALL);
 	       Nanosleep(&xfd->intervall, NULL); continue;
 	    }
 	    return STAT_RETRYLATER;
@@ -998,7 +1011,7 @@ int xioopen_connect(struct single *xfd, union sockaddr_union *us, size_t uslen,
 	 Close(xfd->fd);
 	 /* with and without retry */
 	 Nanosleep(&xfd->intervall, NULL);
-	 dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	 opts = recopyopts(opts, opts0, GROUP_ALL);
 	 continue;	/* with next socket() bind() connect() */
       } else
 #endif /* WITH_RETRY */
@@ -1056,6 +1069,10 @@ int _xioopen_dgram_sendto(/* them is already in xfd->peersa */
    if (Getsockname(xfd->fd, &la.soa, &lalen) < 0) {
       Warn4("getsockname(%d, %p, {%d}): %s",
 	    xfd->fd, &la.soa, lalen, strerror(errno));
+   } else if (us != NULL) {
+      /* bound; sending packets will not change the local address */
+      memcpy(&xfd->para.socket.la, &la, Min(lalen, sizeof(la)));
+      xfd->para.socket.la_known = true;
    }
 
    applyopts_fchown(xfd->fd, opts);
@@ -1082,12 +1099,13 @@ int _xioopen_dgram_sendto(/* them is already in xfd->peersa */
    again if it calls select()/poll() before the child process reads the
    packet.
    To solve this problem we implement the following mechanism:
-   The sub process sends a SIGUSR1 when it has read the packet (or a SIGCHLD if
-   it dies before). The parent process waits until it receives that signal and
-   only then continues to listen.
+   The sub process sends a SIGUSR1 when it has read the packet (or terminates
+   before). The parent process waits until it receives that signal or has
+   reaped the sub process, and only then continues to listen.
    To prevent a signal from another process to trigger our loop, we pass the
    pid of the sub process to the signal handler in xio_waitingfor. The signal
-   handler sets xio_hashappened if the pid matched.
+   handler, or the child supervision through xiochild_hook, sets
+   xio_hashappened if the pid matched.
 */
 static pid_t xio_waitingfor;	/* info from recv loop to signal handler:
 				   indicates the pid of the child process
@@ -1096,16 +1114,13 @@ static bool xio_hashappened;	/* info from signal handler to loop: child
 				   process has read ("consumed") the packet */
 static int xio_childstatus;
 
-/* this is the signal handler for USR1 and CHLD */
+/* this is the signal handler for USR1 */
 void xiosigaction_hasread(int signum
 #if HAVE_STRUCT_SIGACTION_SA_SIGACTION && defined(SA_SIGINFO)
 			  , siginfo_t *siginfo, void *ucontext
 #endif
 			  ) {
-   pid_t pid;
    int _errno;
-   int status = 0;
-   bool wassig = false;
 
    _errno = errno;
    diag_in_handler = 1;
@@ -1116,46 +1131,6 @@ void xiosigaction_hasread(int signum
 #else
    Debug1("xiosigaction_hasread(%d)", signum);
 #endif
-   if (signum == SIGCHLD) {
-      do {
-	 pid = Waitpid(-1, &status, WNOHANG);
-	 if (pid == 0) {
-	    Msg(wassig?E_INFO:E_WARN,
-		"waitpid(-1, {}, WNOHANG): no child has exited");
-	    Info("xiosigaction_hasread() finished");
-	    Debug("xiosigaction_hasread() ->");
-	    diag_in_handler = 0;
-	    errno = _errno;
-	    return;
-	 } else if (pid < 0 && errno == ECHILD) {
-	    Msg(wassig?E_INFO:E_WARN,
-		 "waitpid(-1, {}, WNOHANG): "F_strerror);
-	    Info("xiosigaction_hasread() finished");
-	    Debug("xiosigaction_hasread() ->");
-	    diag_in_handler = 0;
-	    errno = _errno;
-	    return;
-	 }
-	 wassig = true;
-	 if (pid < 0) {
-	    Warn1("waitpid(-1, {%d}, WNOHANG): "F_strerror, status);
-	    Info("xiosigaction_hasread() finished");
-	    Debug("xiosigaction_hasread() ->");
-	    diag_in_handler = 0;
-	    errno = _errno;
-	    return;
-	 }
-	 if (pid == xio_waitingfor) {
-	    xio_waitingfor = 0; 	/* so this child will not set hashappened again */
-	    xio_hashappened = true;
-            xio_childstatus = WEXITSTATUS(status);
-	    Debug("xiosigaction_hasread() ->");
-	    diag_in_handler = 0;
-	    errno = _errno;
-	    return;
-	 }
-      } while (1);
-   }
 #if HAVE_STRUCT_SIGACTION_SA_SIGACTION && defined(SA_SIGINFO)
    if (xio_waitingfor == siginfo->si_pid) {
       xio_hashappened = true;
@@ -1172,6 +1147,16 @@ void xiosigaction_hasread(int signum
    return;
 }
 
+/* xiochild_hook of the recvfrom loop: the sub process terminated, maybe
+   before it sent SIGUSR1 */
+static void xiochild_hasexited(pid_t pid, int status) {
+   if (pid == xio_waitingfor) {
+      xio_waitingfor = 0; 	/* so this child will not set hashappened again */
+      xio_hashappened = true;
+      xio_childstatus = WEXITSTATUS(status);
+   }
+}
+
 
 /* waits for incoming packet, checks its source address and port. Depending
    on fork option, it may fork a subprocess.
@@ -1218,6 +1203,11 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 
    applyopts_single(xfd, opts, PH_PASTSOCKET);
    applyopts(xfd->fd, opts, PH_PASTSOCKET);
+#if WITH_UDP && defined(SO_REUSEPORT)
+   if (xioworker_socket(xfd) < 0) {
+      return STAT_NORETRY;
+   }
+#endif
 
    applyopts_cloexec(xfd->fd, opts);
 
@@ -1225,6 +1215,11 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 	       opts, pf, 0, level) < 0) {
       return -1;
    }
+#if WITH_UDP && defined(SO_REUSEPORT)
+   if (xioworker_bound(xfd, pf) < 0) {
+      return STAT_NORETRY;
+   }
+#endif
 
    applyopts(xfd->fd, opts, PH_PASTBIND);
 
@@ -1252,6 +1247,20 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
    xio_retropt_tcpwrap(xfd, opts);
 #endif /* && (WITH_TCP || WITH_UDP) && WITH_LIBWRAP */
 
+#if WITH_UDP
+   if (xfd->demux.enable) {
+      if (dofork) {
+	 Error("options fork and demux are mutually exclusive");
+	 return STAT_NORETRY;
+      }
+      /* the application reads the packets of all peers from this socket */
+      xfd->flags |= XIO_DOESDEMUX;
+      if (_xio_openlate(xfd, opts) != 0)
+	 return STAT_NORETRY;
+      return STAT_OK;
+   }
+#endif /* WITH_UDP */
+
    if (xioopts.logopt == 'm') {
       Info("starting recvfrom loop, switching to syslog");
       diag_set('y', xioopts.syslogfac);  xioopts.logopt = 'y';
@@ -1282,20 +1291,19 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
          /*! Linux man does not explicitely say that errno is defined */
          Warn1("sigaction(SIGUSR1, {&xiosigaction_subaddr_ok}, NULL): %s", strerror(errno));
       }
-      if (Sigaction(SIGCHLD, &act, NULL) < 0) {
-         /*! Linux man does not explicitely say that errno is defined */
-         Warn1("sigaction(SIGCHLD, {&xiosigaction_subaddr_ok}, NULL): %s", strerror(errno));
-      }
    }
 #else /* !HAVE_SIGACTION */
    /*!!!*/
       if (Signal(SIGUSR1, xiosigaction_hasread) == SIG_ERR) {
 	 Warn1("signal(SIGUSR1, xiosigaction_hasread): %s", strerror(errno));
       }
-      if (Signal(SIGCHLD, xiosigaction_hasread) == SIG_ERR) {
-	 Warn1("signal(SIGCHLD, xiosigaction_hasread): %s", strerror(errno));
-      }
 #endif /* !HAVE_SIGACTION */
+      /* children are supervised like those of listeners; the recv loop learns
+	 from xiochild_hook when its sub process terminated */
+      if (xiosetchildfd() < 0) {
+	 xiosetchilddied();	/* set SIGCHLD handler */
+      }
+      xiochild_hook = xiochild_hasexited;
    }
 
    while (true) {	/* but we only loop if fork option is set */
@@ -1328,10 +1336,17 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 	 } else {
 	    Notice1("receiving IP protocol %u", proto);
 	 }
-	 readfd.fd = xfd->fd;
-	 readfd.events = POLLIN;
-	 if (xiopoll(&readfd, 1, NULL) > 0) {
-	    break;
+	 if (xiochildfd >= 0) {
+	    /* wait for a packet, reaping terminated children meanwhile */
+	    if (xiochild_wait(xfd->fd, NULL) > 0) {
+	       break;
+	    }
+	 } else {
+	    readfd.fd = xfd->fd;
+	    readfd.events = POLLIN;
+	    if (xiopoll(&readfd, 1, NULL) > 0) {
+	       break;
+	    }
 	 }
 
 	 if (errno == EINTR) {
@@ -1409,7 +1424,9 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 	 }
 
 	 if (pid == 0) {	/* child */
-	    /* no reason to block SIGCHLD in child process */
+	    /* no reason to block SIGCHLD in child process; with signalfd it
+	       was already blocked in oldset */
+	    sigdelset(&oldset, SIGCHLD);
 	    Sigprocmask(SIG_SETMASK, &oldset, NULL);
 	    xfd->ppid = Getppid();	/* send parent a signal when packet has
 					   been consumed */
@@ -1436,15 +1453,36 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 #if HAVE_PSELECT
 	  {
 	    struct timespec timeout = { LONG_MAX, 0 };
-	    Pselect(0, NULL, NULL, NULL, &timeout, &oldset);
-	    Sigprocmask(SIG_SETMASK, &oldset, NULL);
+	    if (xiochildfd >= 0) {
+	       /* SIGCHLD stays blocked and is read from xiochildfd */
+	       fd_set childfds;
+	       FD_ZERO(&childfds);
+	       FD_SET(xiochildfd, &childfds);
+	       if (Pselect(xiochildfd+1, &childfds, NULL, NULL, &timeout,
+			   &oldset) > 0) {
+		  xiochild_reap();
+	       }
+	    } else {
+	       /* the SIGCHLD handler only notes the child; its hook runs in
+		  xiochild_collect(). SIGCHLD and SIGUSR1 stay blocked except
+		  in pselect() */
+	       Pselect(0, NULL, NULL, NULL, &timeout, &oldset);
+	       xiochild_collect();
+	    }
 	  }
 #else /* ! HAVE_PSELECT */
 	  /* now we are ready to handle signals */
 	  Sigprocmask(SIG_SETMASK, &oldset, NULL);
-	  Sleep(1);	/* any signal speeds up return */
+	  if (xiochildfd >= 0) {
+	     struct timeval interval = { 1, 0 };
+	     xiochild_wait(-1, &interval);
+	  } else {
+	     Sleep(1);	/* any signal speeds up return */
+	     xiochild_collect();
+	  }
 #endif /* ! HAVE_PSELECT */
 	 } while (!xio_hashappened) ;
+	 Sigprocmask(SIG_SETMASK, &oldset, NULL);
 	 xio_hashappened = false;
 
          if (xio_childstatus != 0) {
@@ -1480,12 +1518,22 @@ int _xioopen_dgram_recv(struct single *xfd, int xioflags,
 
    applyopts_single(xfd, opts, PH_PASTSOCKET);
    applyopts(xfd->fd, opts, PH_PASTSOCKET);
+#if WITH_UDP && defined(SO_REUSEPORT)
+   if (xioworker_socket(xfd) < 0) {
+      return STAT_NORETRY;
+   }
+#endif
 
    applyopts_cloexec(xfd->fd, opts);
 
    if (xiobind(xfd, (union sockaddr_union *)us, uslen, opts, pf, 0, level) < 0) {
       return -1;
    }
+#if WITH_UDP && defined(SO_REUSEPORT)
+   if (xioworker_bound(xfd, pf) < 0) {
+      return STAT_NORETRY;
+   }
+#endif
 
 #if WITH_UNIX
    if (pf == AF_UNIX && us != NULL) {
@@ -1584,6 +1632,618 @@ int xiogetpacketsrc(int fd, struct msghdr *msgh, int flags) {
 }
 
 
+/* datagram batching (option dgram-batch): xioread() hands out the packets of
+   a ring that one recvmmsg() call fills, xiowrite() queues packets that one
+   sendmmsg() call sends when the queue is full or the data loop flushes it.
+   Every packet keeps its boundaries and its own peer address.
+   With UDP offloads (options udp-gro, udp-gso) the kernel passes several
+   datagrams of one peer as one packet; xiorecv_dgram() splits them up again,
+   xiosend_dgram() joins them. */
+#define XIODGRAM_BATCH_MAX	256	/* upper limit of option dgram-batch */
+#define XIODGRAM_CTRLLEN	256	/* ancillary data per received packet */
+#define XIODGRAM_GRO_BYTES	65536	/* largest coalesced packet (udp-gro) */
+#define XIODGRAM_GSO_BYTES	65000	/* keeps joined packets below 64KiB */
+#define XIODGRAM_GSO_SEGS	64	/* Linux UDP_MAX_SEGMENTS */
+#define XIODGRAM_GSO_CTRLLEN	CMSG_SPACE(sizeof(uint16_t)) /* UDP_SEGMENT */
+#define XIODGRAM_IPHDR_MAX	60	/* longest IPv4 header */
+
+/* raw IPv4 sockets pass the IP header with each packet; with
+   XIOREAD_RECV_SKIPIP xiorecv_dgram() hands out only the payload, without
+   moving it */
+#if WITH_IP4 && HAVE_STRUCT_IP && HAVE_STRUCT_IOVEC
+#  define XIODGRAM_SKIPIP 1
+#endif
+
+struct xiodgram {
+   int num;			/* slots in ring and queue */
+   /* receive ring */
+   size_t rsize;		/* bytes per slot */
+   unsigned char *rbuf;
+   struct mmsghdr *rmsg;
+   struct iovec *riov;
+   union sockaddr_union *rsa;
+   unsigned char *rctrl;
+   int rnext;			/* next packet to hand out */
+   int rcount;			/* packets in ring */
+   /* send queue */
+   unsigned char *sbuf;		/* data of all queued packets */
+   size_t ssize, sused;
+   struct mmsghdr *smsg;
+   struct iovec *siov;
+   union sockaddr_union *ssa;	/* destination of each packet */
+   size_t *soff;		/* offset of each packet in sbuf */
+   int *ssegs;			/* datagrams joined in each packet (udp-gso) */
+   unsigned char *sctrl;	/* UDP_SEGMENT message of each packet */
+   int scount;			/* packets in queue */
+   /* coalesced packet that is handed out segment by segment (udp-gro) */
+   unsigned char *gbuf;		/* receive buffer without dgram-batch */
+   struct iovec giov;
+   union sockaddr_union gsa;
+   unsigned char gctrl[XIODGRAM_CTRLLEN];
+   struct msghdr gmsg;		/* header of the coalesced packet */
+   unsigned char *gptr;		/* next segment */
+   size_t gleft;		/* bytes of this and the following segments */
+   size_t gseg;			/* segment size */
+};
+
+#if HAVE_RECVMMSG || HAVE_SENDMMSG || defined(UDP_GRO)
+static struct xiodgram *xiodgram_get(struct single *pipe) {
+   struct xiodgram *dg;
+
+   if (pipe->dgram != NULL) {
+      return pipe->dgram;
+   }
+   if ((dg = Calloc(1, sizeof(struct xiodgram))) == NULL) {
+      return NULL;
+   }
+   dg->num = Min(pipe->dgrambatch, XIODGRAM_BATCH_MAX);
+   if (dg->num > 1) {
+      Info2("fd %d: up to %d datagrams per system call", pipe->fd, dg->num);
+   }
+   return pipe->dgram = dg;
+}
+#endif /* HAVE_RECVMMSG || HAVE_SENDMMSG || defined(UDP_GRO) */
+
+#if HAVE_RECVMMSG
+/* makes sure the receive ring holds packets; allocates it with slots of size
+   bytes and refills it with one recvmmsg() call when it is empty.
+   returns 0 on success, or -1 with errno set */
+static int xiodgram_fill(struct single *pipe, struct xiodgram *dg,
+			 size_t size) {
+   struct msghdr *slot;
+   int i, _errno;
+
+   if (dg->rbuf == NULL) {
+      dg->rsize = size;
+      if ((dg->rbuf  = Malloc(dg->num*dg->rsize)) == NULL ||
+	  (dg->rmsg  = Calloc(dg->num, sizeof(struct mmsghdr))) == NULL ||
+	  (dg->riov  = Calloc(dg->num, sizeof(struct iovec))) == NULL ||
+	  (dg->rsa   = Calloc(dg->num, sizeof(union sockaddr_union))) == NULL ||
+	  (dg->rctrl = Malloc(dg->num*XIODGRAM_CTRLLEN)) == NULL) {
+	 errno = ENOMEM;  return -1;
+      }
+   }
+   if (dg->rnext < dg->rcount) {
+      return 0;
+   }
+   /* ring is empty, refill it */
+   for (i = 0; i < dg->num; ++i) {
+      slot = &dg->rmsg[i].msg_hdr;
+      dg->riov[i].iov_base = dg->rbuf + i*dg->rsize;
+      dg->riov[i].iov_len  = dg->rsize;
+      slot->msg_name       = &dg->rsa[i];
+      slot->msg_namelen    = sizeof(dg->rsa[i]);
+      slot->msg_iov        = &dg->riov[i];
+      slot->msg_iovlen     = 1;
+      slot->msg_control    = dg->rctrl + i*XIODGRAM_CTRLLEN;
+      slot->msg_controllen = XIODGRAM_CTRLLEN;
+      slot->msg_flags      = 0;
+   }
+   dg->rnext = 0;
+   do {
+      dg->rcount =
+	 Recvmmsg(pipe->fd, dg->rmsg, dg->num, MSG_WAITFORONE);
+   } while (dg->rcount < 0 && errno == EINTR);
+   if (dg->rcount < 0) {
+      _errno = errno;
+      dg->rcount = 0;
+      if (_errno != EAGAIN) {
+	 Error4("recvmmsg(%d, %p, %d, MSG_WAITFORONE): %s",
+		pipe->fd, dg->rmsg, dg->num, strerror(_errno));
+      }
+      errno = _errno;
+      return -1;
+   }
+   Debug2("recvmmsg() on fd %d: %d packets", pipe->fd, dg->rcount);
+   return 0;
+}
+#endif /* HAVE_RECVMMSG */
+
+#if XIODGRAM_SKIPIP
+/* returns the length of the IPv4 header at the start of a packet of bytes,
+   or -1 when the packet is shorter */
+static int xiodgram_iphdrlen(const void *pkt, size_t bytes) {
+   int headlen;
+
+   if (bytes < sizeof(struct ip)) {
+      return -1;
+   }
+#if HAVE_STRUCT_IP_IP_HL
+   headlen = 4*((struct ip *)pkt)->ip_hl;
+#else /* happened on Tru64 */
+   headlen = 4*((struct ip *)pkt)->ip_vhl;
+#endif
+   if (headlen > bytes) {
+      return -1;
+   }
+   return headlen;
+}
+
+/* true when the IP header of a packet is to be skipped */
+static bool xiodgram_skipip(struct single *pipe, const struct msghdr *msgh) {
+   return (pipe->dtype & XIOREAD_RECV_SKIPIP) &&
+      ((struct sockaddr *)msgh->msg_name)->sa_family == AF_INET;
+}
+
+/* recvmsg() has put the first sizeof(struct ip) bytes of a packet into iphdr
+   and the rest into buff. Returns the length of the payload in buff; only
+   IP options, which are rare, make it necessary to move the payload */
+static ssize_t xiodgram_splitip(struct single *pipe, const void *iphdr,
+				void *buff, size_t bufsiz, size_t bytes,
+				struct msghdr *msgh) {
+   const size_t fixed = sizeof(struct ip);
+   size_t rest;
+   int headlen;
+
+   if (!xiodgram_skipip(pipe, msgh)) {
+      /* not an IPv4 packet; put it together again */
+      rest = (bytes > fixed ? Min(bytes-fixed, bufsiz-Min(fixed, bufsiz)) : 0);
+      memmove((char *)buff+Min(fixed, bufsiz), buff, rest);
+      memcpy(buff, iphdr, Min(Min(fixed, bufsiz), bytes));
+      return Min(Min(fixed, bufsiz), bytes) + rest;
+   }
+   if ((headlen = xiodgram_iphdrlen(iphdr, bytes)) < 0) {
+      Warn1("xioread(%d, ...)/IP4: short packet", pipe->fd);
+      return 0;
+   }
+   if (headlen > fixed) {
+      memmove(buff, (char *)buff+(headlen-fixed), bytes-headlen);
+   }
+   return bytes - headlen;
+}
+#endif /* XIODGRAM_SKIPIP */
+
+/* copies source address and ancillary data of a received packet to the
+   callers msghdr */
+static void xiodgram_copyhdr(struct msghdr *msgh, const struct msghdr *from) {
+   msgh->msg_namelen = Min(from->msg_namelen, msgh->msg_namelen);
+   memcpy(msgh->msg_name, from->msg_name, msgh->msg_namelen);
+#if HAVE_STRUCT_MSGHDR_MSGCONTROL && HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
+   if (msgh->msg_control != NULL) {
+      msgh->msg_controllen = Min(from->msg_controllen, msgh->msg_controllen);
+      memcpy(msgh->msg_control, from->msg_control, msgh->msg_controllen);
+   }
+#endif
+#if HAVE_STRUCT_MSGHDR_MSGFLAGS
+   msgh->msg_flags = from->msg_flags;
+#endif
+}
+
+#ifdef UDP_GRO
+/* xiorecv_dgram() for option udp-gro: receives a possibly coalesced packet
+   into a buffer of its own and hands out one segment per call */
+static ssize_t xiorecv_gro(struct single *pipe, void *buff, size_t bufsiz,
+			   struct msghdr *msgh) {
+   struct xiodgram *dg;
+   struct cmsghdr *cmsg;
+   ssize_t bytes;
+   size_t seg;
+   int _errno;
+
+   if ((dg = xiodgram_get(pipe)) == NULL) {
+      errno = ENOMEM;  return -1;
+   }
+   if (dg->gleft == 0) {
+#if HAVE_RECVMMSG
+      if (pipe->dgrambatch > 1 && !(pipe->dtype & XIOREAD_RECV_ONESHOT)) {
+	 if (xiodgram_fill(pipe, dg, Max(bufsiz, XIODGRAM_GRO_BYTES)) < 0) {
+	    return -1;
+	 }
+	 dg->gmsg = dg->rmsg[dg->rnext].msg_hdr;
+	 bytes = dg->rmsg[dg->rnext].msg_len;
+	 ++dg->rnext;
+      } else
+#endif /* HAVE_RECVMMSG */
+      {
+	 if (dg->gbuf == NULL &&
+	     (dg->gbuf = Malloc(XIODGRAM_GRO_BYTES)) == NULL) {
+	    errno = ENOMEM;  return -1;
+	 }
+	 dg->giov.iov_base = dg->gbuf;
+	 dg->giov.iov_len  = XIODGRAM_GRO_BYTES;
+	 memset(&dg->gmsg, 0, sizeof(dg->gmsg));
+	 dg->gmsg.msg_name       = &dg->gsa;
+	 dg->gmsg.msg_namelen    = sizeof(dg->gsa);
+	 dg->gmsg.msg_iov        = &dg->giov;
+	 dg->gmsg.msg_iovlen     = 1;
+	 dg->gmsg.msg_control    = dg->gctrl;
+	 dg->gmsg.msg_controllen = sizeof(dg->gctrl);
+	 do {
+	    bytes = Recvmsg(pipe->fd, &dg->gmsg, 0);
+	 } while (bytes < 0 && errno == EINTR);
+	 if (bytes < 0) {
+	    _errno = errno;
+	    Error4("recvmsg(%d, %p, %d, 0): %s",
+		   pipe->fd, dg->gbuf, XIODGRAM_GRO_BYTES, strerror(_errno));
+	    errno = _errno;
+	    return -1;
+	 }
+      }
+      dg->gptr  = dg->gmsg.msg_iov->iov_base;
+      dg->gleft = bytes;
+      dg->gseg  = bytes;
+      for (cmsg = CMSG_FIRSTHDR(&dg->gmsg); cmsg != NULL;
+	   cmsg = CMSG_NXTHDR(&dg->gmsg, cmsg)) {
+	 if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+	    int gso_size;
+	    memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+	    if (gso_size > 0)  dg->gseg = gso_size;
+	 }
+      }
+      if (dg->gseg < dg->gleft) {
+	 Debug3("fd %d: splitting "F_Zu" bytes into segments of "F_Zu" bytes",
+		pipe->fd, dg->gleft, dg->gseg);
+      }
+   }
+
+   /* hand out the next segment */
+   seg = Min(dg->gseg, dg->gleft);
+   bytes = Min(seg, bufsiz);
+   memcpy(buff, dg->gptr, bytes);
+   xiodgram_copyhdr(msgh, &dg->gmsg);
+   dg->gptr  += seg;
+   dg->gleft -= seg;
+   return bytes;
+}
+#endif /* UDP_GRO */
+
+/* receives one datagram into buff. The caller provides msg_name and
+   msg_control in msgh; they are filled with the source address and the
+   ancillary data of the packet.
+   Without option dgram-batch this costs exactly one recvmsg() call; with it,
+   the packet is taken from the ring and only an empty ring is refilled.
+   Returns the length of the packet, or -1 with errno set */
+ssize_t xiorecv_dgram(struct single *pipe, void *buff, size_t bufsiz,
+		      struct msghdr *msgh) {
+#if HAVE_STRUCT_IOVEC
+   struct iovec iovec;
+#endif
+#if XIODGRAM_SKIPIP
+   unsigned char iphdr[sizeof(struct ip)];
+   struct iovec iov[2];
+#endif
+   ssize_t bytes;
+   int _errno;
+
+#if _WITH_PACKETRING
+   if (pipe->packetring != NULL && pipe->packetring->rbase != NULL) {
+      return xiorecv_packetring(pipe, buff, bufsiz, msgh);
+   }
+#endif /* _WITH_PACKETRING */
+#ifdef UDP_GRO
+   if (pipe->udpgro) {
+      return xiorecv_gro(pipe, buff, bufsiz, msgh);
+   }
+#endif /* UDP_GRO */
+#if HAVE_RECVMMSG
+   if (pipe->dgrambatch > 1 && !(pipe->dtype & XIOREAD_RECV_ONESHOT)) {
+      struct xiodgram *dg;
+      struct msghdr *slot;
+      unsigned char *pkt;
+      size_t len, slotsize = bufsiz;
+
+      if ((dg = xiodgram_get(pipe)) == NULL) {
+	 errno = ENOMEM;  return -1;
+      }
+#if XIODGRAM_SKIPIP
+      if (pipe->dtype & XIOREAD_RECV_SKIPIP) {
+	 slotsize += XIODGRAM_IPHDR_MAX;
+      }
+#endif
+      if (xiodgram_fill(pipe, dg, slotsize) < 0) {
+	 return -1;
+      }
+
+      /* hand out the next packet of the ring */
+      slot = &dg->rmsg[dg->rnext].msg_hdr;
+      pkt = slot->msg_iov->iov_base;
+      len = dg->rmsg[dg->rnext].msg_len;
+#if XIODGRAM_SKIPIP
+      if (xiodgram_skipip(pipe, slot)) {
+	 /* copy only the payload, the header stays in the ring */
+	 int headlen;
+
+	 if ((headlen = xiodgram_iphdrlen(pkt, len)) < 0) {
+	    Warn1("xioread(%d, ...)/IP4: short packet", pipe->fd);
+	    headlen = len;
+	 }
+	 pkt += headlen;
+	 len -= headlen;
+      }
+#endif /* XIODGRAM_SKIPIP */
+      bytes = Min(len, bufsiz);
+      memcpy(buff, pkt, bytes);
+      xiodgram_copyhdr(msgh, slot);
+      ++dg->rnext;
+      return bytes;
+   }
+#endif /* HAVE_RECVMMSG */
+
+#if XIODGRAM_SKIPIP
+   if (pipe->dtype & XIOREAD_RECV_SKIPIP) {
+      /* the fixed part of the IP header goes to iphdr, the payload directly
+	 to buff */
+      iov[0].iov_base = iphdr;
+      iov[0].iov_len  = sizeof(iphdr);
+      iov[1].iov_base = buff;
+      iov[1].iov_len  = bufsiz;
+      msgh->msg_iov = iov;
+      msgh->msg_iovlen = 2;
+   } else
+#endif /* XIODGRAM_SKIPIP */
+   {
+#if HAVE_STRUCT_IOVEC
+      iovec.iov_base = buff;
+      iovec.iov_len  = bufsiz;
+      msgh->msg_iov = &iovec;
+      msgh->msg_iovlen = 1;
+#endif
+   }
+#if HAVE_STRUCT_MSGHDR_MSGFLAGS
+   msgh->msg_flags = 0;
+#endif
+   do {
+      bytes = Recvmsg(pipe->fd, msgh, 0);
+   } while (bytes < 0 && errno == EINTR);
+   if (bytes < 0) {
+      _errno = errno;
+      Error4("recvmsg(%d, %p, "F_Zu", 0): %s",
+	     pipe->fd, buff, bufsiz, strerror(_errno));
+      errno = _errno;
+      return -1;
+   }
+#if XIODGRAM_SKIPIP
+   if (pipe->dtype & XIOREAD_RECV_SKIPIP) {
+      return xiodgram_splitip(pipe, iphdr, buff, bufsiz, bytes, msgh);
+   }
+#endif
+   return bytes;
+}
+
+/* returns the number of received packets that wait in the ring */
+ssize_t xiopending_dgram(struct single *pipe) {
+#if _WITH_PACKETRING
+   if (pipe->packetring != NULL && pipe->packetring->rbase != NULL) {
+      return pipe->packetring->rleft;
+   }
+#endif /* _WITH_PACKETRING */
+   if (pipe->dgram == NULL) {
+      return 0;
+   }
+   return pipe->dgram->rcount - pipe->dgram->rnext +
+      (pipe->dgram->gleft > 0 ? 1 : 0);
+}
+
+/* records the local address of a datagram socket in para.socket.la and logs
+   it. Call it once the socket has sent its first packet; the address does not
+   change afterwards */
+void xiosetlocaladdr(struct single *sfd) {
+   char infobuff[256];
+   socklen_t lalen = sizeof(sfd->para.socket.la);
+
+   sfd->para.socket.la_known = true;
+   if (Getsockname(sfd->fd, &sfd->para.socket.la.soa, &lalen) < 0) {
+      Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
+	    sfd->fd, &sfd->para.socket.la.soa, lalen, strerror(errno));
+      return;
+   }
+   Notice1("local address: %s",
+	   sockaddr_info(&sfd->para.socket.la.soa, lalen,
+			 infobuff, sizeof(infobuff)));
+}
+
+/* returns the number of packets that wait in the send queue */
+int xioqueued_dgram(struct single *pipe) {
+#if _WITH_PACKETRING
+   if (pipe->packetring != NULL && pipe->packetring->tbase != NULL) {
+      return pipe->packetring->tqueued;
+   }
+#endif /* _WITH_PACKETRING */
+   if (pipe->dgram == NULL) {
+      return 0;
+   }
+   return pipe->dgram->scount;
+}
+
+#if HAVE_SENDMMSG
+/* queues a datagram to the current peer address; sends the queue when it is
+   full.
+   returns bytes, or -1 when sending failed (errno set) */
+ssize_t xiosend_dgram(struct single *pipe, const void *buff, size_t bytes) {
+   struct xiodgram *dg;
+   int i;
+
+   if ((dg = xiodgram_get(pipe)) == NULL) {
+      errno = ENOMEM;  return -1;
+   }
+   if (dg->smsg == NULL) {
+      if ((dg->smsg = Calloc(dg->num, sizeof(struct mmsghdr))) == NULL ||
+	  (dg->siov = Calloc(dg->num, sizeof(struct iovec))) == NULL ||
+	  (dg->ssa  = Calloc(dg->num, sizeof(union sockaddr_union))) == NULL ||
+	  (dg->soff = Calloc(dg->num, sizeof(size_t))) == NULL ||
+	  (dg->ssegs = Calloc(dg->num, sizeof(int))) == NULL) {
+	 errno = ENOMEM;  return -1;
+      }
+#ifdef UDP_SEGMENT
+      if (pipe->udpgso > 0 &&
+	  (dg->sctrl = Calloc(dg->num, XIODGRAM_GSO_CTRLLEN)) == NULL) {
+	 errno = ENOMEM;  return -1;
+      }
+#endif /* UDP_SEGMENT */
+   }
+   if (dg->sused + bytes > dg->ssize) {
+      size_t newsize = Max(2*dg->ssize, dg->sused + bytes);
+      unsigned char *newbuf;
+
+      if ((newbuf = Realloc(dg->sbuf, newsize)) == NULL) {
+	 errno = ENOMEM;  return -1;
+      }
+      dg->sbuf = newbuf;
+      dg->ssize = newsize;
+   }
+
+#ifdef UDP_SEGMENT
+   if (pipe->udpgso > 0 && dg->scount > 0 && bytes > 0 &&
+       bytes <= (size_t)pipe->udpgso) {
+      size_t len;
+
+      i = dg->scount-1;
+      len = dg->siov[i].iov_len;
+      if (len == (size_t)dg->ssegs[i] * pipe->udpgso &&
+	  dg->ssegs[i] < XIODGRAM_GSO_SEGS &&
+	  len + bytes <= XIODGRAM_GSO_BYTES &&
+	  dg->smsg[i].msg_hdr.msg_namelen == pipe->salen &&
+	  !memcmp(&dg->ssa[i], &pipe->peersa, pipe->salen)) {
+	 /* the previous packet holds only full segments to the same peer;
+	    append this datagram as its next segment */
+	 memcpy(dg->sbuf + dg->sused, buff, bytes);
+	 dg->siov[i].iov_len += bytes;
+	 dg->sused += bytes;
+	 ++dg->ssegs[i];
+	 return bytes;
+      }
+   }
+#endif /* UDP_SEGMENT */
+
+   i = dg->scount++;
+   memcpy(dg->sbuf + dg->sused, buff, bytes);
+   dg->soff[i] = dg->sused;
+   dg->siov[i].iov_len = bytes;
+   dg->ssegs[i] = 1;
+   dg->sused += bytes;
+   memcpy(&dg->ssa[i], &pipe->peersa, pipe->salen);
+   dg->smsg[i].msg_hdr.msg_namelen = pipe->salen;
+
+   if (dg->scount >= dg->num) {
+      if (xioflush_dgram(pipe) < 0) {
+	 return -1;
+      }
+   }
+   return bytes;
+}
+#endif /* HAVE_SENDMMSG */
+
+/* sends the queued datagrams with as few sendmmsg() calls as possible.
+   returns 0 on success, or -1 on error (errno set); on error the rest of the
+   queue is dropped */
+int xioflush_dgram(struct single *pipe) {
+#if _WITH_PACKETRING
+   if (pipe->packetring != NULL && pipe->packetring->tbase != NULL) {
+      return xioflush_packetring(pipe);
+   }
+#endif /* _WITH_PACKETRING */
+#if HAVE_SENDMMSG
+   struct xiodgram *dg = pipe->dgram;
+   int sent = 0, n, i;
+   int _errno;
+
+   if (dg == NULL || dg->scount == 0) {
+      return 0;
+   }
+   /* sbuf might have moved while the queue grew */
+   for (i = 0; i < dg->scount; ++i) {
+      struct msghdr *slot = &dg->smsg[i].msg_hdr;
+      dg->siov[i].iov_base = dg->sbuf + dg->soff[i];
+      slot->msg_name       = &dg->ssa[i];
+      slot->msg_iov        = &dg->siov[i];
+      slot->msg_iovlen     = 1;
+      slot->msg_control    = NULL;
+      slot->msg_controllen = 0;
+      slot->msg_flags      = 0;
+#ifdef UDP_SEGMENT
+      if (dg->ssegs[i] > 1) {
+	 /* only joined packets are cut by the kernel, into the datagrams they
+	    were joined from */
+	 struct cmsghdr *cmsg;
+	 uint16_t segsize = pipe->udpgso;
+
+	 slot->msg_control    = dg->sctrl + i*XIODGRAM_GSO_CTRLLEN;
+	 slot->msg_controllen = XIODGRAM_GSO_CTRLLEN;
+	 cmsg = CMSG_FIRSTHDR(slot);
+	 cmsg->cmsg_level = SOL_UDP;
+	 cmsg->cmsg_type  = UDP_SEGMENT;
+	 cmsg->cmsg_len   = CMSG_LEN(sizeof(segsize));
+	 memcpy(CMSG_DATA(cmsg), &segsize, sizeof(segsize));
+      }
+#endif /* UDP_SEGMENT */
+   }
+   while (sent < dg->scount) {
+      do {
+	 n = Sendmmsg(pipe->fd, dg->smsg+sent, dg->scount-sent, 0);
+      } while (n < 0 && errno == EINTR);
+      if (n < 0) {
+	 char infobuff[256];
+	 _errno = errno;
+	 Error5("sendmmsg(%d, %p, %d, 0) to %s: %s",
+		pipe->fd, dg->smsg+sent, dg->scount-sent,
+		sockaddr_info(&dg->ssa[sent].soa,
+			      dg->smsg[sent].msg_hdr.msg_namelen,
+			      infobuff, sizeof(infobuff)),
+		strerror(_errno));
+	 dg->scount = 0;  dg->sused = 0;
+	 errno = _errno;
+	 return -1;
+      }
+      for (i = sent; i < sent+n; ++i) {
+	 if (dg->smsg[i].msg_len < dg->siov[i].iov_len) {
+	    Warn3("sendmmsg(%d, ...) only wrote %u of "F_Zu" bytes",
+		  pipe->fd, dg->smsg[i].msg_len, dg->siov[i].iov_len);
+	 }
+      }
+      sent += n;
+   }
+   Debug2("sendmmsg() on fd %d: %d packets", pipe->fd, sent);
+   dg->scount = 0;  dg->sused = 0;
+   if (!pipe->para.socket.la_known) {
+      xiosetlocaladdr(pipe);
+   }
+#endif /* HAVE_SENDMMSG */
+   return 0;
+}
+
+/* sends datagrams that are still queued and releases the batch buffers */
+void xioclose_dgram(struct single *pipe) {
+   struct xiodgram *dg = pipe->dgram;
+
+#if _WITH_PACKETRING
+   xioclose_packetring(pipe);
+#endif
+   if (dg == NULL) {
+      return;
+   }
+   if (pipe->fd >= 0) {
+      xioflush_dgram(pipe);
+   }
+   free(dg->rbuf);  free(dg->rmsg);  free(dg->riov);
+   free(dg->rsa);   free(dg->rctrl);
+   free(dg->sbuf);  free(dg->smsg);  free(dg->siov);
+   free(dg->ssa);   free(dg->soff);  free(dg->ssegs);  free(dg->sctrl);
+   free(dg->gbuf);
+   free(dg);
+   pipe->dgram = NULL;
+}
+
+
 /* works through the ancillary messages found in the given socket header record
    and logs the relevant information (E_DEBUG, E_INFO).
    calls protocol/layer specific functions for handling the messages
@@ -1592,6 +2252,10 @@ int xiodopacketinfo(struct msghdr *msgh, bool withlog, bool withenv) {
 #if defined(HAVE_STRUCT_CMSGHDR) && defined(CMSG_DATA)
    struct cmsghdr *cmsg;
 
+   /* this runs per packet; do not decode what nobody will see */
+   if (withlog && !diag_level(E_INFO))  withlog = false;
+   if (!withlog && !withenv)  return 0;
+
    /* parse ancillary messages */
    cmsg = CMSG_FIRSTHDR(msgh);
    while (cmsg != NULL) {
@@ -1602,10 +2266,11 @@ int xiodopacketinfo(struct msghdr *msgh, bool withlog, bool withenv) {
       char valbuff[256], *valp;
       char envbuff[256], *envp;
 
-      if (withlog) {
-	 xiodump(CMSG_DATA(cmsg),
-		 cmsg->cmsg_len-((char *)CMSG_DATA(cmsg)-(char *)cmsg),
-		 valbuff, sizeof(valbuff)-1, 0);
+      /* some of the type specific functions below use this dump */
+      xiodump(CMSG_DATA(cmsg),
+	      cmsg->cmsg_len-((char *)CMSG_DATA(cmsg)-(char *)cmsg),
+	      valbuff, sizeof(valbuff)-1, 0);
+      if (withlog && diag_level(E_DEBUG)) {
 	 Debug4("ancillary message: len="F_cmsg_len", level=%d, type=%d, data=%s",
 		cmsg->cmsg_len, cmsg->cmsg_level, cmsg->cmsg_type,
 		valbuff);
@@ -1720,9 +2385,11 @@ int xiocheckpeer(xiosingle_t *xfd,
 			     infobuff, sizeof(infobuff)));
 	 return -1;
       }
-      Info1("permitting connection from %s due to range option",
-	    sockaddr_info(&pa->soa, 0,
-			  infobuff, sizeof(infobuff)));
+      if (diag_level(E_INFO)) {
+	 Info1("permitting connection from %s due to range option",
+	       sockaddr_info(&pa->soa, 0,
+			     infobuff, sizeof(infobuff)));
+      }
    }
 #endif /* WITH_IP4 */
 
@@ -1747,9 +2414,11 @@ int xiocheckpeer(xiosingle_t *xfd,
 	 return -1;
       }
 #endif /* WITH_IP6 */
-      Info1("permitting connection from %s due to sourceport option",
-	    sockaddr_info(&pa->soa, 0,
-			  infobuff, sizeof(infobuff)));
+      if (diag_level(E_INFO)) {
+	 Info1("permitting connection from %s due to sourceport option",
+	       sockaddr_info(&pa->soa, 0,
+			     infobuff, sizeof(infobuff)));
+      }
    } else if (xfd->para.socket.ip.lowport) {
       if (pa == NULL)  { return -1; }
       if (pa->soa.sa_family == AF_INET &&
@@ -1769,9 +2438,11 @@ int xiocheckpeer(xiosingle_t *xfd,
 	 return -1;
       }
 #endif /* WITH_IP6 */
-      Info1("permitting connection from %s due to lowport option",
-	    sockaddr_info(&pa->soa, 0,
-			  infobuff, sizeof(infobuff)));
+      if (diag_level(E_INFO)) {
+	 Info1("permitting connection from %s due to lowport option",
+	       sockaddr_info(&pa->soa, 0,
+			     infobuff, sizeof(infobuff)));
+      }
    }
 #endif /* WITH_TCP || WITH_UDP */
 
@@ -1784,9 +2455,11 @@ int xiocheckpeer(xiosingle_t *xfd,
 			  infobuff, sizeof(infobuff)));
       return -1;
    } else if (result > 0) {
-      Info1("permitting connection from %s due to tcpwrapper option",
-	    sockaddr_info(&pa->soa, 0,
-			  infobuff, sizeof(infobuff)));
+      if (diag_level(E_INFO)) {
+	 Info1("permitting connection from %s due to tcpwrapper option",
+	       sockaddr_info(&pa->soa, 0,
+			     infobuff, sizeof(infobuff)));
+      }
    }
 #endif /* (WITH_TCP || WITH_UDP) && WITH_LIBWRAP */
 
@@ -70,6 +70,7 @@ extern const struct optdesc opt_fiosetown;
 extern const struct optdesc opt_siocspgrp;
 extern const struct optdesc opt_bind;
 extern const struct optdesc opt_protocol_family;
+extern const struct optdesc opt_dgram_batch;
 extern const struct optdesc opt_setsockopt;
 extern const struct optdesc opt_setsockopt_int;
 extern const struct optdesc opt_setsockopt_bin;
@@ -118,6 +119,16 @@ int xiodopacketinfo(struct msghdr *msgh, bool withlog, bool withenv);
 extern 
 int xiogetpacketsrc(int fd, struct msghdr *msgh, int flags);
 extern
+ssize_t xiorecv_dgram(struct single *pipe, void *buff, size_t bufsiz,
+		      struct msghdr *msgh);
+extern ssize_t xiopending_dgram(struct single *pipe);
+extern int xioqueued_dgram(struct single *pipe);
+extern void xiosetlocaladdr(struct single *sfd);
+extern
+ssize_t xiosend_dgram(struct single *pipe, const void *buff, size_t bytes);
+extern int xioflush_dgram(struct single *pipe);
+extern void xioclose_dgram(struct single *pipe);
+extern
 int xiocheckpeer(xiosingle_t *xfd,
 		 union sockaddr_union *pa, union sockaddr_union *la);
 extern
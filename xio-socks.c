@@ -15,6 +15,7 @@
 #include "xio-ipapp.h"
 
 #include "xio-socks.h"
+#include "xiostats.h"
 
 
 enum {
@@ -191,7 +192,7 @@ static int xioopen_socks4_connect(int argc, const char *argv[], struct opt *opts
 	 /* parent process */
 	 Close(xfd->fd);
 	 Nanosleep(&xfd->intervall, NULL);
-	 dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	 opts = recopyopts(opts, opts0, GROUP_ALL);
 	 continue;
       } else
 #endif /* WITH_RETRY */
@@ -302,6 +303,7 @@ int _xioopen_socks4_connect(struct single *xfd,
    unsigned char buff[SIZEOF_STRUCT_SOCKS4];
    struct socks4 *replyhead = (struct socks4 *)buff;
    char *destdomname = NULL;
+   struct timespec t0;
 
    /* send socks header (target addr+port, +auth) */
 #if WITH_MSGLEVEL <= E_INFO
@@ -328,6 +330,7 @@ int _xioopen_socks4_connect(struct single *xfd,
       }
    }
 #endif /* WITH_MSGLEVEL <= E_DEBUG */
+   xiostats_begin(&t0);
    if (writefull(xfd->fd, sockhead, headlen) < 0) {
       Msg4(level, "write(%d, %p, "F_Zu"): %s",
 	   xfd->fd, sockhead, headlen, strerror(errno));
@@ -336,6 +339,7 @@ int _xioopen_socks4_connect(struct single *xfd,
       }
       return STAT_RETRYLATER;	/* retry complete open cycle */
    }
+   XIOPROBE1(socks4_request, xfd->fd);
 
    bytes = 0;
    Info("waiting for socks reply");
@@ -379,6 +383,8 @@ int _xioopen_socks4_connect(struct single *xfd,
       return STAT_RETRYLATER;	/* retry complete open cycle */
    }
 
+   XIOPROBE2(socks4_reply, xfd->fd, replyhead->action);
+   xiostats_end(XIOSTATS_SOCKS4, &t0);
    Info7("received socks reply VN=%u CD=%u DSTPORT=%u DSTIP=%u.%u.%u.%u",
 	 replyhead->version, replyhead->action, ntohs(replyhead->port),
 	 ((uint8_t *)&replyhead->dest)[0],
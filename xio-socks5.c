@@ -10,6 +10,7 @@
 #include "xio-ipapp.h"
 
 #include "xio-socks5.h"
+#include "xiostats.h"
 
 
 #if WITH_SOCKS5
@@ -156,7 +157,7 @@ static int xioopen_socks5_connect(int argc, const char *argv[],
 	 return result;
       }
 
-      free(moveopts(opts, GROUP_SOCKS5));
+      freeopts(moveopts(opts, GROUP_SOCKS5));
 
       applyopts(xfd->fd, opts, PH_ALL);
 
@@ -206,7 +207,7 @@ static int xioopen_socks5_connect(int argc, const char *argv[],
          /* parent process */
          Close(xfd->fd);
          Nanosleep(&xfd->intervall, NULL);
-         dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+         opts = recopyopts(opts, opts0, GROUP_ALL);
          continue;
       } else
 #endif /* WITH_RETRY */
@@ -256,6 +257,7 @@ int _xioopen_socks5_connect(struct single *xfd,
    size_t addrlen;
    size_t readpos;
    char *emsg;
+   struct timespec t0;
    int result;
 
    /* prepare */
@@ -272,6 +274,7 @@ int _xioopen_socks5_connect(struct single *xfd,
 
    /* send socks header (target addr+port, +auth) */
    Info("sending socks5 identifier/method selection message");
+   xiostats_begin(&t0);
    do {
       result = Write(xfd->fd, sendmethod, sendlen);
    } while (result < 0 && errno == EINTR);
@@ -283,6 +286,7 @@ int _xioopen_socks5_connect(struct single *xfd,
       }
       return STAT_RETRYLATER;	/* retry complete open cycle */
    }
+   XIOPROBE1(socks5_method, xfd->fd);
 
    Info1("waiting for socks5 select reply ("F_Zu" bytes)", SOCKS5_SELECT_LENGTH);
    if ((result =
@@ -293,6 +297,8 @@ int _xioopen_socks5_connect(struct single *xfd,
       return result;	/* ev. retry complete open cycle */
    }
    recvselect = (struct socks5_select *)recvbuff;
+   XIOPROBE2(socks5_select, xfd->fd, recvselect->method);
+   xiostats_end(XIOSTATS_SOCKS5_SELECT, &t0);
    Info2("socks5 select: {%u, %u}", recvselect->version, recvselect->method);
    if (recvselect->version != 5) {
       Error1("socks5: server protocol version is %u",
@@ -342,6 +348,7 @@ int _xioopen_socks5_connect(struct single *xfd,
 
    /* send socks request (target addr+port, +auth) */
    Info("sending socks5 request selection");
+   xiostats_begin(&t0);
    do {
       result = Write(xfd->fd, sendrequest, sendlen);
    } while (result < 0 && errno == EINTR);
@@ -353,6 +360,7 @@ int _xioopen_socks5_connect(struct single *xfd,
       }
       return STAT_RETRYLATER;	/* retry complete open cycle */
    }
+   XIOPROBE1(socks5_request, xfd->fd);
 
    Info("waiting for socks5 reply");
    recvreply = (struct socks5_reply *)recvbuff;
@@ -362,6 +370,8 @@ int _xioopen_socks5_connect(struct single *xfd,
       /*! close... */
       return result;
    }
+   XIOPROBE2(socks5_reply, xfd->fd, recvreply->reply);
+   xiostats_end(XIOSTATS_SOCKS5_CONNECT, &t0);
    if (recvreply->version != SOCKS5_VERSION) {
       Error1("socks5: version of reply is %d", recvreply->version);
    }
@@ -447,6 +457,7 @@ int xio_socks5_username_password(int level, struct opt *opts,
    char *password = NULL;
    unsigned char recvbuff[2];
    struct socks5_userpass_reply *reply;
+   struct timespec t0;
    int result;
 
    retropt_string(opts, OPT_SOCKS5_USERNAME, (char **)&username);
@@ -469,6 +480,7 @@ int xio_socks5_username_password(int level, struct opt *opts,
    *pos = '\0'; strncat(pos, password, 255);
    pos += strlen(password);
 
+   xiostats_begin(&t0);
    result =
      xio_socks5_dialog(level, xfd, sendbuff, pos-sendbuff,
 		       recvbuff, 2,
@@ -479,6 +491,8 @@ int xio_socks5_username_password(int level, struct opt *opts,
    }
    Info("socks5 username/password authentication succeeded");
    reply = (struct socks5_userpass_reply *)recvbuff;
+   XIOPROBE2(socks5_auth, xfd->fd, reply->status);
+   xiostats_end(XIOSTATS_SOCKS5_AUTH, &t0);
    if (reply->version != SOCKS5_USERPASS_VERSION) {
       Msg(level, "socks5 username/password authentication version mismatch");
       return STAT_NORETRY;
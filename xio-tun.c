@@ -22,6 +22,13 @@ const struct optdesc opt_tun_device    = { "tun-device",     NULL,      OPT_TUN_
 const struct optdesc opt_tun_name      = { "tun-name",       NULL,      OPT_TUN_NAME,        GROUP_INTERFACE, PH_FD,   TYPE_STRING,   OFUNC_SPEC };
 const struct optdesc opt_tun_type      = { "tun-type",       NULL,      OPT_TUN_TYPE,        GROUP_INTERFACE, PH_FD,   TYPE_STRING,   OFUNC_SPEC };
 const struct optdesc opt_iff_no_pi     = { "iff-no-pi",       "no-pi",       OPT_IFF_NO_PI,         GROUP_TUN,       PH_FD,   TYPE_BOOL,   OFUNC_SPEC };
+#ifdef IFF_MULTI_QUEUE
+const struct optdesc opt_iff_multi_queue = { "iff-multi-queue", "multi-queue", OPT_IFF_MULTI_QUEUE,   GROUP_TUN,       PH_FD,   TYPE_BOOL,   OFUNC_SPEC };
+const struct optdesc opt_tun_queues    = { "tun-queues",     NULL,      OPT_TUN_QUEUES,      GROUP_TUN,       PH_FD,   TYPE_INT,      OFUNC_SPEC };
+#endif
+#ifdef IFF_VNET_HDR
+const struct optdesc opt_iff_vnet_hdr  = { "iff-vnet-hdr",   "vnet-hdr", OPT_IFF_VNET_HDR,    GROUP_TUN,       PH_FD,   TYPE_BOOL,     OFUNC_SPEC };
+#endif
 /*0 const struct optdesc opt_interface_addr    = { "interface-addr",    "address", OPT_INTERFACE_ADDR,    GROUP_INTERFACE, PH_FD, TYPE_STRING,   OFUNC_SPEC };*/
 /*0 const struct optdesc opt_interface_netmask = { "interface-netmask", "netmask", OPT_INTERFACE_NETMASK, GROUP_INTERFACE, PH_FD, TYPE_STRING,   OFUNC_SPEC };*/
 const struct optdesc opt_iff_up          = { "iff-up",          "up",          OPT_IFF_UP,          GROUP_INTERFACE, PH_FD,   TYPE_BOOL,     OFUNC_OFFSET_MASKS, XIO_OFFSETOF(para.tun.iff_opts), XIO_SIZEOF(para.tun.iff_opts), IFF_UP };
@@ -64,12 +71,49 @@ static const struct optname xio_route_options[] = {
 } ;
 #endif
 
+#ifdef IFF_MULTI_QUEUE
+/* option tun-queues: workers except the first one (which continues with the
+   queue of the original process) attach a queue of their own to the
+   interface */
+static int xioopen_tun_queue(struct single *sfd, const char *tundevice,
+			     const struct ifreq *tunifr) {
+   struct ifreq ifr;
+   int flags;
+   int fd;
+
+   if ((flags = Fcntl(sfd->fd, F_GETFL)) < 0) {
+      Error2("fcntl(%d, F_GETFL): %s", sfd->fd, strerror(errno));
+      return STAT_RETRYLATER;
+   }
+   if ((fd = Open(tundevice, flags, 0)) < 0) {
+      Error3("open(\"%s\", 0%o, 0): %s", tundevice, flags, strerror(errno));
+      return STAT_RETRYLATER;
+   }
+   ifr = *tunifr;
+   if (Ioctl(fd, TUNSETIFF, &ifr) < 0) {
+      Error3("ioctl(%d, TUNSETIFF, {\"%s\"}: %s",
+	     fd, ifr.ifr_name, strerror(errno));
+      Close(fd);
+      return STAT_RETRYLATER;
+   }
+   Close(sfd->fd);
+   sfd->fd = fd;
+   Info2("worker %d: attached a queue to interface \"%s\"",
+	 sfd->workers.index, ifr.ifr_name);
+   return STAT_OK;
+}
+#endif /* defined(IFF_MULTI_QUEUE) */
+
 static int xioopen_tun(int argc, const char *argv[], struct opt *opts, int xioflags, xiofile_t *xfd, unsigned groups, int dummy1, int dummy2, int dummy3) {
    char *tundevice = NULL;
    char *tunname = NULL, *tuntype = NULL;
    int pf = /*! PF_UNSPEC*/ PF_INET;
    struct xiorange network;
    bool no_pi = false;
+   bool multi_queue = false;
+   int queues = 0;
+   bool vnet_hdr = false;
+   struct ifreq tunifr;
    const char *namedargv[] = { "tun", NULL, NULL };
    int rw = (xioflags & XIO_ACCMODE);
    bool exists;
@@ -131,11 +175,51 @@ static int xioopen_tun(int argc, const char *argv[], struct opt *opts, int xiofl
       }
    }
 
+#ifdef IFF_MULTI_QUEUE
+   /* several processes can attach queues to the same interface, and the
+      kernel spreads the flows over them */
+   retropt_bool(opts, OPT_IFF_MULTI_QUEUE, &multi_queue);
+   retropt_int(opts, OPT_TUN_QUEUES, &queues);
+   if (queues > 1) {
+      if (!(xioflags & XIO_MAYFORK)) {
+	 Error("option tun-queues not allowed here");
+	 return STAT_NORETRY;
+      }
+      multi_queue = true;
+   }
+   if (multi_queue) {
+      ifr.ifr_flags |= IFF_MULTI_QUEUE;
+   }
+#endif
+#ifdef IFF_VNET_HDR
+   /* each packet is preceded by a struct virtio_net_hdr; with it the kernel
+      may pass GSO packets of up to 64KiB instead of single segments */
+   retropt_bool(opts, OPT_IFF_VNET_HDR, &vnet_hdr);
+   if (vnet_hdr) {
+      ifr.ifr_flags |= IFF_VNET_HDR;
+   }
+#endif
+
    if (Ioctl(xfd->stream.fd, TUNSETIFF, &ifr) < 0) {
       Error3("ioctl(%d, TUNSETIFF, {\"%s\"}: %s",
 	     xfd->stream.fd, ifr.ifr_name, strerror(errno));
       Close(xfd->stream.fd);
    }
+   tunifr = ifr;	/* name and flags, for more queues */
+
+#ifdef IFF_VNET_HDR
+   if (vnet_hdr) {
+      unsigned int offload =
+	 TUN_F_CSUM|TUN_F_TSO4|TUN_F_TSO6|TUN_F_TSO_ECN;
+#ifdef TUN_F_USO4
+      offload |= TUN_F_USO4|TUN_F_USO6;
+#endif
+      if (Ioctl_int(xfd->stream.fd, TUNSETOFFLOAD, offload) < 0) {
+	 Warn3("ioctl(%d, TUNSETOFFLOAD, 0x%x): %s",
+	       xfd->stream.fd, offload, strerror(errno));
+      }
+   }
+#endif
 
    /*===================== setting interface properties =====================*/
 
@@ -193,6 +277,22 @@ static int xioopen_tun(int argc, const char *argv[], struct opt *opts, int xiofl
    }
    Debug2("\"%s\": resulting flags: 0x%hx", ifr.ifr_name, ifr.ifr_flags);
 
+#ifdef IFF_MULTI_QUEUE
+   if (queues > 1) {
+      /* the interface is configured; from here on each worker continues
+	 with its own queue */
+      if ((result = xioworkers_start(&xfd->stream, queues)) != STAT_OK)
+	 return result;
+      if (xfd->stream.workers.index > 1) {
+	 if ((result = xioopen_tun_queue(&xfd->stream, tundevice, &tunifr))
+	     != STAT_OK) {
+	    xioworker_ready(&xfd->stream);
+	    return result;
+	 }
+      }
+      xioworker_ready(&xfd->stream);
+   }
+#endif
 
 #if LATER
    applyopts_named(tundevice, opts, PH_FD);
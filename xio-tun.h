@@ -9,6 +9,9 @@ extern const struct optdesc opt_tun_device;
 extern const struct optdesc opt_tun_name;
 extern const struct optdesc opt_tun_type;
 extern const struct optdesc opt_iff_no_pi;
+extern const struct optdesc opt_iff_multi_queue;
+extern const struct optdesc opt_tun_queues;
+extern const struct optdesc opt_iff_vnet_hdr;
 extern const struct optdesc opt_interface_addr;
 extern const struct optdesc opt_interface_netmask;
 extern const struct optdesc opt_iff_up;
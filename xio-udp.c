@@ -73,6 +73,185 @@ const struct addrdesc addr_udp6_recvfrom= { "udp6-recvfrom",   3, xioopen_udp_re
 const struct addrdesc addr_udp6_recv    = { "udp6-recv",       1, xioopen_udp_recv,     GROUP_FD|GROUP_SOCKET|GROUP_SOCK_IP6|GROUP_IP_UDP|GROUP_RANGE,             PF_INET6, SOCK_DGRAM, IPPROTO_UDP  HELP(":<port>") };
 #endif /* WITH_IP6 */
 
+const struct optdesc opt_demux         = { "demux",         NULL, OPT_DEMUX,         GROUP_IP_UDP, PH_INIT, TYPE_BOOL,    OFUNC_OFFSET, XIO_OFFSETOF(demux.enable) };
+const struct optdesc opt_demux_max     = { "demux-max",     NULL, OPT_DEMUX_MAX,     GROUP_IP_UDP, PH_INIT, TYPE_INT,     OFUNC_OFFSET, XIO_OFFSETOF(demux.max) };
+const struct optdesc opt_demux_timeout = { "demux-timeout", NULL, OPT_DEMUX_TIMEOUT, GROUP_IP_UDP, PH_INIT, TYPE_TIMEVAL, OFUNC_OFFSET, XIO_OFFSETOF(demux.timeout) };
+#ifdef UDP_SEGMENT
+const struct optdesc opt_udp_gso       = { "udp-gso",       NULL, OPT_UDP_GSO,       GROUP_IP_UDP, PH_LATE, TYPE_INT,     OFUNC_EXT, SOL_UDP, UDP_SEGMENT };
+#endif
+#ifdef UDP_GRO
+const struct optdesc opt_udp_gro       = { "udp-gro",       NULL, OPT_UDP_GRO,       GROUP_IP_UDP, PH_LATE, TYPE_BOOL,    OFUNC_EXT, SOL_UDP, UDP_GRO };
+#endif
+#ifdef SO_REUSEPORT
+const struct optdesc opt_workers       = { "workers",       NULL, OPT_WORKERS,       GROUP_IP_UDP, PH_PREBIND, TYPE_INT,  OFUNC_SPEC };
+#endif
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && HAVE_LINUX_FILTER_H
+const struct optdesc opt_workers_bpf   = { "workers-bpf",   NULL, OPT_WORKERS_BPF,   GROUP_IP_UDP, PH_PREBIND, TYPE_BOOL, OFUNC_SPEC };
+#endif
+
+
+#ifdef UDP_SEGMENT
+/* option udp-gso: with dgram-batch, xiosend_dgram() joins consecutive
+   datagrams to the same peer into one packet that the kernel cuts again
+   (Linux UDP_SEGMENT, given per packet). The socket option is not set, so
+   other packets are sent unchanged; it is only read to check that the kernel
+   supports it */
+int xioapply_udp_gso(struct single *xfd, struct opt *opt) {
+   int segsize = opt->value.u_int;
+   int cursize;
+   socklen_t optlen = sizeof(cursize);
+
+   if (segsize <= 0 || segsize > USHRT_MAX) {
+      Error1("option udp-gso: invalid segment size %d", segsize);
+      opt->desc = ODESC_ERROR;
+      return -1;
+   }
+   if (Getsockopt(xfd->fd, opt->desc->major, opt->desc->minor,
+		  &cursize, &optlen) < 0) {
+      Error6("getsockopt(%d, %d, %d, %p, {"F_socklen"}): %s",
+	     xfd->fd, opt->desc->major, opt->desc->minor, &cursize,
+	     optlen, strerror(errno));
+      opt->desc = ODESC_ERROR;
+      return -1;
+   }
+   xfd->udpgso = segsize;
+   return 0;
+}
+#endif /* UDP_SEGMENT */
+
+#ifdef UDP_GRO
+/* option udp-gro: the kernel may coalesce datagrams of a peer into one packet
+   (Linux UDP_GRO); xiorecv_dgram() splits it again with the segment size from
+   the ancillary data, so the application still sees each datagram */
+int xioapply_udp_gro(struct single *xfd, struct opt *opt) {
+   int on = opt->value.u_bool;
+
+   if (on && xfd->demux.enable) {
+      Error("option udp-gro cannot be combined with option demux");
+      opt->desc = ODESC_ERROR;
+      return -1;
+   }
+   if (Setsockopt(xfd->fd, opt->desc->major, opt->desc->minor,
+		  &on, sizeof(on)) < 0) {
+      Error6("setsockopt(%d, %d, %d, {%d}, "F_Zu"): %s",
+	     xfd->fd, opt->desc->major, opt->desc->minor, on,
+	     sizeof(on), strerror(errno));
+      opt->desc = ODESC_ERROR;
+      return -1;
+   }
+   xfd->udpgro = on;
+   if (on && (xfd->dtype & XIODATA_READMASK) == XIOREAD_STREAM) {
+      /* connected socket: read() would not tell where the datagrams end */
+      xfd->dtype = (xfd->dtype & ~XIODATA_READMASK) | XIOREAD_RECV;
+   }
+   return 0;
+}
+#endif /* UDP_GRO */
+
+
+#ifdef SO_REUSEPORT
+/* option workers: the original process forks num worker processes (see
+   xioworkers_start()) and then only supervises them. each worker opens the
+   address on its own socket bound to the same port (SO_REUSEPORT), and the
+   kernel spreads the peers over these sockets by a hash of their addresses */
+
+/* call in the open function of the first address before its socket is
+   created. without option workers it returns STAT_OK at once. otherwise the
+   workers are forked one after the other, each after the previous one has
+   bound its socket, so worker i holds the (i-1)th socket of the reuseport
+   group; the workers return STAT_OK and continue the open. the supervisor
+   does not return except on error */
+int xioworkers(struct single *sfd, int xioflags, struct opt *opts) {
+   int num = 0;
+   bool bpf = false;
+
+   retropt_int(opts, OPT_WORKERS, &num);
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && HAVE_LINUX_FILTER_H
+   retropt_bool(opts, OPT_WORKERS_BPF, &bpf);
+#endif
+   if (num <= 1) {
+      if (bpf) {
+	 Warn("option workers-bpf without option workers has no effect");
+      }
+      return STAT_OK;
+   }
+   if (!(xioflags & XIO_MAYFORK)) {
+      Error("option workers not allowed here");
+      return STAT_NORETRY;
+   }
+   sfd->workers.bpf = bpf;
+   return xioworkers_start(sfd, num);
+}
+
+/* call in a worker after socket() and before bind(): joins the reuseport
+   group of the workers */
+int xioworker_socket(struct single *sfd) {
+   int one = 1;
+
+   if (sfd->workers.index <= 0)  return 0;
+   if (Setsockopt(sfd->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+      Error4("setsockopt(%d, SOL_SOCKET, SO_REUSEPORT, {%d}, "F_Zu"): %s",
+	     sfd->fd, one, sizeof(one), strerror(errno));
+      return -1;
+   }
+   return 0;
+}
+
+/* call in a worker after bind(): with option workers-bpf installs the
+   program that selects the worker by the source address and port of a packet
+   (on an unbound socket it would found a group of its own), then lets the
+   supervisor fork the next worker */
+int xioworker_bound(struct single *sfd, int pf) {
+   if (sfd->workers.index <= 0 || sfd->workers.syncfd < 0)  return 0;
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && HAVE_LINUX_FILTER_H
+   if (sfd->workers.bpf) {
+      /* worker = (source address ^ source port) % workers; the index
+	 returned is the position of the socket in the group */
+      struct sock_filter code4[] = {
+	 BPF_STMT(BPF_LDX|BPF_B|BPF_MSH, SKF_NET_OFF),	/* IP header len */
+	 BPF_STMT(BPF_LD|BPF_H|BPF_IND, SKF_NET_OFF),	/* source port */
+	 BPF_STMT(BPF_MISC|BPF_TAX, 0),
+	 BPF_STMT(BPF_LD|BPF_W|BPF_ABS, SKF_NET_OFF+12),	/* source addr */
+	 BPF_STMT(BPF_ALU|BPF_XOR|BPF_X, 0),
+	 BPF_STMT(BPF_ALU|BPF_MOD|BPF_K, sfd->workers.num),
+	 BPF_STMT(BPF_RET|BPF_A, 0),
+      } ;
+      struct sock_filter code6[] = {
+	 BPF_STMT(BPF_LD|BPF_H|BPF_ABS, SKF_NET_OFF+40),	/* source port */
+	 BPF_STMT(BPF_MISC|BPF_TAX, 0),
+	 BPF_STMT(BPF_LD|BPF_W|BPF_ABS, SKF_NET_OFF+8),	/* source addr */
+	 BPF_STMT(BPF_ALU|BPF_XOR|BPF_X, 0),
+	 BPF_STMT(BPF_MISC|BPF_TAX, 0),
+	 BPF_STMT(BPF_LD|BPF_W|BPF_ABS, SKF_NET_OFF+12),
+	 BPF_STMT(BPF_ALU|BPF_XOR|BPF_X, 0),
+	 BPF_STMT(BPF_MISC|BPF_TAX, 0),
+	 BPF_STMT(BPF_LD|BPF_W|BPF_ABS, SKF_NET_OFF+16),
+	 BPF_STMT(BPF_ALU|BPF_XOR|BPF_X, 0),
+	 BPF_STMT(BPF_MISC|BPF_TAX, 0),
+	 BPF_STMT(BPF_LD|BPF_W|BPF_ABS, SKF_NET_OFF+20),
+	 BPF_STMT(BPF_ALU|BPF_XOR|BPF_X, 0),
+	 BPF_STMT(BPF_ALU|BPF_MOD|BPF_K, sfd->workers.num),
+	 BPF_STMT(BPF_RET|BPF_A, 0),
+      } ;
+      struct sock_fprog prog;
+
+      if (pf == PF_INET6) {
+	 prog.len = sizeof(code6)/sizeof(code6[0]);  prog.filter = code6;
+      } else {
+	 prog.len = sizeof(code4)/sizeof(code4[0]);  prog.filter = code4;
+      }
+      if (Setsockopt(sfd->fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+		     &prog, sizeof(prog)) < 0) {
+	 Error4("setsockopt(%d, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, {%u}, "F_Zu"): %s",
+		sfd->fd, prog.len, sizeof(prog), strerror(errno));
+	 return -1;
+      }
+   }
+#endif /* defined(SO_ATTACH_REUSEPORT_CBPF) && HAVE_LINUX_FILTER_H */
+   return xioworker_ready(sfd);
+}
+#endif /* SO_REUSEPORT */
+
 
 int _xioopen_ipdgram_listen(struct single *sfd,
 	int xioflags, union sockaddr_union *us, socklen_t uslen,
@@ -104,6 +283,10 @@ int _xioopen_ipdgram_listen(struct single *sfd,
        Error("option max-children not allowed without option fork");
        return STAT_NORETRY;
    }
+   if (dofork && sfd->demux.enable) {
+      Error("options fork and demux are mutually exclusive");
+      return STAT_NORETRY;
+   }
 
 #if WITH_IP4 /*|| WITH_IP6*/
    if (retropt_string(opts, OPT_RANGE, &rangename) >= 0) {
@@ -126,8 +309,17 @@ int _xioopen_ipdgram_listen(struct single *sfd,
    }
    retropt_bool(opts, OPT_LOWPORT, &sfd->para.socket.ip.lowport);
 
+#ifdef SO_REUSEPORT
+   if ((result = xioworkers(sfd, xioflags, opts)) != STAT_OK) {
+      return result;
+   }
+#endif
+
    if (dofork) {
-      xiosetchilddied();	/* set SIGCHLD handler */
+      /* reap children while waiting for packets; or else by SIGCHLD handler */
+      if (xiosetchildfd() < 0) {
+	 xiosetchilddied();	/* set SIGCHLD handler */
+      }
    }
 
    while (true) {	/* we loop with fork or prohibited packets */
@@ -144,6 +336,11 @@ int _xioopen_ipdgram_listen(struct single *sfd,
       }
       doreuseaddr |= (retropt_int(opts, OPT_SO_REUSEADDR, &reuseaddr) >= 0);
       applyopts(sfd->fd, opts, PH_PASTSOCKET);
+#ifdef SO_REUSEPORT
+      if (xioworker_socket(sfd) < 0) {
+	 return STAT_NORETRY;
+      }
+#endif
       if (doreuseaddr) {
 	 if (Setsockopt(sfd->fd, opt_so_reuseaddr.major,
 			opt_so_reuseaddr.minor, &reuseaddr, sizeof(reuseaddr))
@@ -163,6 +360,11 @@ int _xioopen_ipdgram_listen(struct single *sfd,
 		uslen, strerror(errno));
 	 return STAT_RETRYLATER;
       }
+#ifdef SO_REUSEPORT
+      if (xioworker_bound(sfd, pf) < 0) {
+	 return STAT_NORETRY;
+      }
+#endif
       /* under some circumstances bind() fills sockaddr with interesting info. */
       if (Getsockname(sfd->fd, &us->soa, &uslen) < 0) {
 	 Error4("getsockname(%d, %p, {%d}): %s",
@@ -178,10 +380,25 @@ int _xioopen_ipdgram_listen(struct single *sfd,
 		 sockaddr_info(&us->soa, uslen, infobuff, sizeof(infobuff)));
       }
 
-      readfd.fd = sfd->fd;
-      readfd.events = POLLIN|POLLERR;
-      while (xiopoll(&readfd, 1, NULL) < 0) {
-	 if (errno != EINTR)  break;
+      if (sfd->demux.enable) {
+	 /* the application reads the packets of all peers from this socket */
+	 sfd->flags |= XIO_DOESDEMUX;
+	 sfd->dtype = XIODATA_RECVFROM;
+	 sfd->howtoend = END_NONE;
+	 return _xio_openlate(sfd, opts);
+      }
+
+      if (xiochildfd >= 0) {
+	 /* wait for a packet, reaping terminated children meanwhile */
+	 if (xiochild_wait(sfd->fd, NULL) < 0) {
+	    Warn2("poll({%d,POLLIN}, ...): %s", sfd->fd, strerror(errno));
+	 }
+      } else {
+	 readfd.fd = sfd->fd;
+	 readfd.events = POLLIN|POLLERR;
+	 while (xiopoll(&readfd, 1, NULL) < 0) {
+	    if (errno != EINTR)  break;
+	 }
       }
 
       themlen = socket_init(pf, them);
@@ -214,6 +431,9 @@ int _xioopen_ipdgram_listen(struct single *sfd,
 	    sockaddr_info(&them->soa, themlen, infobuff, sizeof(infobuff)));
 
       if (dofork) {
+	 if (sfd->prefork != NULL) {
+	    (*sfd->prefork)(sfd);	/* e.g. reload certificates */
+	 }
 	 pid = xio_fork(false, E_ERROR);
 	 if (pid < 0) {
 	    return STAT_RETRYLATER;
@@ -232,12 +452,15 @@ int _xioopen_ipdgram_listen(struct single *sfd,
 	    Info2("close(%d): %s", sfd->fd, strerror(errno));
 	 }
 
-	 while (maxchildren) {
-	    if (num_child < maxchildren) break;
+	 if (maxchildren && num_child >= maxchildren) {
 	    Notice("maxchildren are active, waiting");
-	    /* UINT_MAX would even be nicer, but Openindiana works only
-	       with 31 bits */
-	    while (!Sleep(INT_MAX)) ;	/* any signal lets us continue */
+	    /* wakes up when a child terminated */
+	    while (num_child >= maxchildren) {
+	       if (xiochild_wait(-1, NULL) < 0) {
+		  Warn1("poll(): %s", strerror(errno));
+		  Sleep(1);
+	       }
+	    }
 	 }
 	 Info("still listening");
 	 continue;
@@ -541,6 +764,12 @@ int xioopen_udp_recvfrom(int argc, const char *argv[], struct opt *opts,
    }
    retropt_bool(opts, OPT_LOWPORT, &xfd->stream.para.socket.ip.lowport);
 
+#ifdef SO_REUSEPORT
+   if ((result = xioworkers(&xfd->stream, xioflags, opts)) != STAT_OK) {
+      return result;
+   }
+#endif
+
    xfd->stream.dtype = XIODATA_RECVFROM_ONE;
    if ((result =
 	_xioopen_dgram_recvfrom(&xfd->stream, xioflags, &us.soa, uslen,
@@ -636,6 +865,12 @@ int xioopen_udp_recv(int argc, const char *argv[], struct opt *opts,
    }
    retropt_bool(opts, OPT_LOWPORT, &xfd->stream.para.socket.ip.lowport);
 
+#ifdef SO_REUSEPORT
+   if ((result = xioworkers(&xfd->stream, xioflags, opts)) != STAT_OK) {
+      return result;
+   }
+#endif
+
    xfd->stream.dtype = XIODATA_RECV;
    if ((result = _xioopen_dgram_recv(&xfd->stream, xioflags, &us.soa, uslen,
 				     opts, pf, socktype, ipproto, E_ERROR))
@@ -646,4 +881,333 @@ int xioopen_udp_recv(int argc, const char *argv[], struct opt *opts,
    return result;
 }
 
+/* the in-process demultiplexer of option demux: one process reads the
+   datagrams of all peers from the socket of the first address, and opens and
+   relays for each peer (flow) its own instance of the second address */
+
+#define XIODEMUX_MAX	1024	/* default of option demux-max */
+#define XIODEMUX_TIMEOUT	60	/* default of option demux-timeout (s) */
+#define XIODEMUX_BURST	64	/* datagrams per wakeup before serving flows */
+
+/* errors of a flow must not terminate the process with the other flows: the
+   exit level is raised while a single flow is opened, read, written, or
+   closed. returns the previous level for diag_set_int('e', ) right after */
+static int xiodemux_flowerrors(void) {
+   int exitlevel = diag_get_int('e');
+
+   diag_set_int('e', E_FATAL);
+   return exitlevel;
+}
+
+struct xiodemux_flow {
+   struct xiodemux_flow *next;		/* in hash bucket */
+   struct xiodemux_flow *older, *newer;	/* ordered by last activity */
+   unsigned char key[24];		/* peer address and port */
+   size_t keylen;
+   union sockaddr_union peer;
+   socklen_t peerlen;
+   xiofile_t *xfd;			/* the second address of this flow */
+   struct timeval last;
+} ;
+
+struct xiodemux {
+   struct xiodemux_flow **bucket;
+   unsigned int mask;
+   struct xiodemux_flow *oldest, *newest;
+   int nflows;
+} ;
+
+/* the protocol, local address, and local port are the same for all datagrams
+   of the socket, so the peer address and port complete the 5-tuple */
+static size_t xiodemux_key(const union sockaddr_union *pa,
+			   unsigned char *key) {
+   switch (pa->soa.sa_family) {
+#if WITH_IP4
+   case AF_INET:
+      memcpy(key,   &pa->ip4.sin_addr, 4);
+      memcpy(key+4, &pa->ip4.sin_port, 2);
+      return 6;
+#endif
+#if WITH_IP6
+   case AF_INET6:
+      memcpy(key,    &pa->ip6.sin6_addr, 16);
+      memcpy(key+16, &pa->ip6.sin6_port, 2);
+      memcpy(key+18, &pa->ip6.sin6_scope_id, 4);
+      return 22;
+#endif
+   default:
+      return 0;
+   }
+}
+
+static unsigned int xiodemux_hash(const unsigned char *key, size_t keylen) {
+   unsigned int h = 2166136261U;	/* FNV-1a */
+
+   while (keylen--) {
+      h = (h ^ *key++) * 16777619U;
+   }
+   return h;
+}
+
+static struct xiodemux_flow *
+   xiodemux_lookup(struct xiodemux *dm, const unsigned char *key,
+		   size_t keylen) {
+   struct xiodemux_flow *flow;
+
+   flow = dm->bucket[xiodemux_hash(key, keylen) & dm->mask];
+   while (flow != NULL) {
+      if (flow->keylen == keylen && !memcmp(flow->key, key, keylen))
+	 return flow;
+      flow = flow->next;
+   }
+   return NULL;
+}
+
+/* moves the flow to the newest end of the activity list */
+static void xiodemux_touch(struct xiodemux *dm, struct xiodemux_flow *flow) {
+   Gettimeofday(&flow->last, NULL);
+   if (dm->newest == flow)  return;
+   if (flow->older)  flow->older->newer = flow->newer;
+   else if (dm->oldest == flow)  dm->oldest = flow->newer;
+   if (flow->newer)  flow->newer->older = flow->older;
+   flow->older = dm->newest;
+   flow->newer = NULL;
+   if (dm->newest)  dm->newest->newer = flow;
+   dm->newest = flow;
+   if (dm->oldest == NULL)  dm->oldest = flow;
+}
+
+static void xiodemux_close(struct xiodemux *dm, struct xiodemux_flow *flow) {
+   struct xiodemux_flow **pp;
+   int exitlevel;
+   char infobuff[256];
+
+   pp = &dm->bucket[xiodemux_hash(flow->key, flow->keylen) & dm->mask];
+   while (*pp != flow)  pp = &(*pp)->next;
+   *pp = flow->next;
+   if (flow->older)  flow->older->newer = flow->newer;
+   else  dm->oldest = flow->newer;
+   if (flow->newer)  flow->newer->older = flow->older;
+   else  dm->newest = flow->older;
+   --dm->nflows;
+
+   Info2("closing flow of %s, %d flows left",
+	 sockaddr_info(&flow->peer.soa, flow->peerlen,
+		       infobuff, sizeof(infobuff)),
+	 dm->nflows);
+   if (sock[1] == flow->xfd)  sock[1] = NULL;	/* for childdied() */
+   exitlevel = xiodemux_flowerrors();
+   xioclose(flow->xfd);
+   diag_set_int('e', exitlevel);
+   if (flow->xfd->tag == XIO_TAG_DUAL) {
+      free(flow->xfd->dual.stream[0]);
+      free(flow->xfd->dual.stream[1]);
+   }
+   free(flow->xfd);
+   free(flow);
+}
+
+static struct xiodemux_flow *
+   xiodemux_open(struct xiodemux *dm, int max,
+		 const unsigned char *key, size_t keylen,
+		 union sockaddr_union *pa, socklen_t palen,
+		 const char *address2, int xioflags) {
+   struct xiodemux_flow *flow;
+   unsigned int h;
+   int exitlevel;
+   char infobuff[256];
+
+   if (dm->nflows >= max) {
+      Info1("flow table is full (%d), closing least recently used flow", max);
+      xiodemux_close(dm, dm->oldest);
+   }
+   if ((flow = Calloc(1, sizeof(struct xiodemux_flow))) == NULL) {
+      return NULL;
+   }
+   memcpy(flow->key, key, keylen);
+   flow->keylen = keylen;
+   memcpy(&flow->peer, pa, palen);
+   flow->peerlen = palen;
+
+   Notice1("new flow from %s",
+	   sockaddr_info(&pa->soa, palen, infobuff, sizeof(infobuff)));
+   xiosetsockaddrenv("PEER", pa, palen, IPPROTO_UDP);
+   exitlevel = xiodemux_flowerrors();
+   flow->xfd = xioopen(address2, xioflags);
+   diag_set_int('e', exitlevel);
+   if (flow->xfd == NULL) {
+      free(flow);
+      return NULL;
+   }
+
+   h = xiodemux_hash(key, keylen) & dm->mask;
+   flow->next = dm->bucket[h];
+   dm->bucket[h] = flow;
+   ++dm->nflows;
+   xiodemux_touch(dm, flow);
+   return flow;
+}
+
+/* relays datagrams between the peers of the socket of xfd1 (option demux) and
+   per peer instances of address2, until an error occurs on the socket.
+   errors of single flows only close these flows.
+   returns -1 */
+int xiodemux(xiofile_t *xfd1, const char *address2, int xioflags,
+	     size_t bufsiz) {
+   struct single *lis = &xfd1->stream;
+   struct xiodemux dm = { NULL };
+   struct xiodemux_flow **pmap = NULL, *flow;
+   struct pollfd *pfd = NULL;
+   struct timeval timeout, now;
+   union sockaddr_union la, pa;
+   socklen_t lalen = sizeof(la), palen;
+   unsigned char key[24];
+   size_t keylen;
+   unsigned char *buff = NULL;
+   unsigned int nbuckets;
+   int max, exitlevel;
+   int n, i;
+   char infobuff[256];
+
+   max = lis->demux.max > 0 ?
+      lis->demux.max : XIODEMUX_MAX;
+   timeout = lis->demux.timeout;
+   if (timeout.tv_sec == 0 && timeout.tv_usec == 0) {
+      timeout.tv_sec = XIODEMUX_TIMEOUT;
+   }
+   for (nbuckets = 64; nbuckets < (unsigned int)max; nbuckets <<= 1) ;
+   if ((dm.bucket = Calloc(nbuckets, sizeof(struct xiodemux_flow *))) == NULL ||
+       (pfd = Malloc((max+1)*sizeof(struct pollfd))) == NULL ||
+       (pmap = Malloc((max+1)*sizeof(struct xiodemux_flow *))) == NULL ||
+       (buff = Malloc(bufsiz)) == NULL) {
+      free(dm.bucket);  free(pfd);  free(pmap);
+      return -1;
+   }
+   dm.mask = nbuckets-1;
+   if (Getsockname(lis->fd, &la.soa, &lalen) < 0) {
+      Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
+	    lis->fd, &la.soa, lalen, strerror(errno));
+   }
+   Notice3("relaying datagrams on %s in up to %d flows, idle timeout "F_tv_sec"s",
+	   sockaddr_info(&la.soa, lalen, infobuff, sizeof(infobuff)),
+	   max, timeout.tv_sec);
+
+   while (true) {
+      int ms = -1;
+
+      n = 0;
+      pfd[n].fd = lis->fd;  pfd[n].events = POLLIN;  pmap[n++] = NULL;
+      for (flow = dm.oldest; flow != NULL; flow = flow->newer) {
+	 if (!XIO_READABLE(flow->xfd))  continue;
+	 pfd[n].fd = XIO_GETRDFD(flow->xfd);  pfd[n].events = POLLIN;
+	 pmap[n++] = flow;
+      }
+      if (dm.oldest != NULL) {
+	 Gettimeofday(&now, NULL);
+	 ms = (dm.oldest->last.tv_sec + timeout.tv_sec - now.tv_sec) * 1000 +
+	    (dm.oldest->last.tv_usec + timeout.tv_usec - now.tv_usec) / 1000;
+	 if (ms < 0)  ms = 0;
+      }
+      if (Poll(pfd, n, ms) < 0) {
+	 if (errno == EINTR)  continue;
+	 Error2("poll(, %d, ): %s", n, strerror(errno));
+	 break;
+      }
+
+      /* answers first: new peers might close the least recent flows */
+      for (i = 1; i < n; ++i) {
+	 ssize_t bytes;
+
+	 if (pfd[i].revents == 0)  continue;
+	 flow = pmap[i];
+	 exitlevel = xiodemux_flowerrors();
+	 bytes = xioread(flow->xfd, buff, bufsiz);
+	 diag_set_int('e', exitlevel);
+	 if (bytes < 0) {
+	    if (errno == EINTR || errno == EAGAIN)  continue;
+	    xiodemux_close(&dm, flow);
+	    continue;
+	 }
+	 if (bytes == 0) {
+	    xiodemux_close(&dm, flow);
+	    continue;
+	 }
+	 if (Sendto(lis->fd, buff, bytes, 0, &flow->peer.soa, flow->peerlen)
+	     < 0) {
+	    Warn4("sendto(%d, %p, "F_Zd", 0, ...): %s",
+		  lis->fd, buff, bytes, strerror(errno));
+	 }
+	 xiodemux_touch(&dm, flow);
+      }
+
+      if (pfd[0].revents != 0) {
+	 for (i = 0; i < XIODEMUX_BURST; ++i) {
+	    ssize_t bytes;
+
+	    palen = sizeof(pa);
+	    bytes = Recvfrom(lis->fd, buff, bufsiz, MSG_DONTWAIT,
+			     &pa.soa, &palen);
+	    if (bytes < 0) {
+	       if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+		  Warn4("recvfrom(%d, %p, "F_Zu", MSG_DONTWAIT, ...): %s",
+			lis->fd, buff, bufsiz, strerror(errno));
+	       }
+	       break;
+	    }
+	    ++lis->workers.packets;  lis->workers.bytes += bytes;
+	    keylen = xiodemux_key(&pa, key);
+	    if (bytes == 0) {
+	       /* as with RECVFROM: ignore empty packets, or with option
+		  null-eof take them as EOF of the flow */
+	       if (lis->para.socket.null_eof &&
+		   (flow = xiodemux_lookup(&dm, key, keylen)) != NULL) {
+		  xiodemux_close(&dm, flow);
+	       }
+	       continue;
+	    }
+	    if ((flow = xiodemux_lookup(&dm, key, keylen)) == NULL) {
+	       if (xiocheckpeer(lis, &pa, &la) < 0) {
+		  continue;	/* drop packet */
+	       }
+	       if ((flow = xiodemux_open(&dm, max, key, keylen, &pa, palen,
+					 address2, xioflags)) == NULL) {
+		  continue;
+	       }
+	    }
+	    if (XIO_WRITABLE(flow->xfd)) {
+	       exitlevel = xiodemux_flowerrors();
+	       bytes = xiowrite(flow->xfd, buff, bytes);
+	       diag_set_int('e', exitlevel);
+	       if (bytes < 0) {
+		  xiodemux_close(&dm, flow);
+		  continue;
+	       }
+	    }
+	    xiodemux_touch(&dm, flow);
+	 }
+      }
+
+      /* close idle flows */
+      Gettimeofday(&now, NULL);
+      while ((flow = dm.oldest) != NULL) {
+	 struct timeval idle;
+	 idle.tv_sec  = now.tv_sec  - flow->last.tv_sec;
+	 idle.tv_usec = now.tv_usec - flow->last.tv_usec;
+	 if (idle.tv_usec < 0) {
+	    --idle.tv_sec;  idle.tv_usec += 1000000;
+	 }
+	 if (idle.tv_sec < timeout.tv_sec ||
+	     idle.tv_sec == timeout.tv_sec && idle.tv_usec < timeout.tv_usec)
+	    break;
+	 xiodemux_close(&dm, flow);
+      }
+   }
+
+   while (dm.oldest != NULL) {
+      xiodemux_close(&dm, dm.oldest);
+   }
+   free(buff);  free(pmap);  free(pfd);  free(dm.bucket);
+   return -1;
+}
+
 #endif /* WITH_UDP && (WITH_IP4 || WITH_IP6) */
@@ -24,10 +24,30 @@ extern const struct addrdesc addr_udp6_datagram;
 extern const struct addrdesc addr_udp6_recvfrom;
 extern const struct addrdesc addr_udp6_recv;
 
+extern const struct optdesc opt_demux;
+extern const struct optdesc opt_demux_max;
+extern const struct optdesc opt_demux_timeout;
+extern const struct optdesc opt_udp_gso;
+extern const struct optdesc opt_udp_gro;
+extern const struct optdesc opt_workers;
+extern const struct optdesc opt_workers_bpf;
+
 extern int _xioopen_ipdgram_listen(struct single *sfd,
 	int xioflags, union sockaddr_union *us, socklen_t uslen,
 	struct opt *opts, int pf, int socktype, int ipproto);
 
+#ifdef UDP_SEGMENT
+extern int xioapply_udp_gso(struct single *xfd, struct opt *opt);
+#endif
+#ifdef UDP_GRO
+extern int xioapply_udp_gro(struct single *xfd, struct opt *opt);
+#endif
+#ifdef SO_REUSEPORT
+extern int xioworkers(struct single *sfd, int xioflags, struct opt *opts);
+extern int xioworker_socket(struct single *sfd);
+extern int xioworker_bound(struct single *sfd, int pf);
+#endif
+
 extern int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
 				  int rw, xiofile_t *fd,
 			  unsigned groups, int af, int ipproto,
@@ -299,7 +299,7 @@ static int xioopen_unix_connect(int argc, const char *argv[], struct opt *opts,
 	    if (result == STAT_RETRYLATER) {
 	       Nanosleep(&xfd->intervall, NULL);
 	    }
-	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	    opts = recopyopts(opts, opts0, GROUP_ALL);
 	    continue;
 	 }
 	 return STAT_NORETRY;
@@ -324,7 +324,7 @@ static int xioopen_unix_connect(int argc, const char *argv[], struct opt *opts,
 	 while ((pid = xio_fork(false, level)) < 0) {
 	    --xfd->retry;
 	    if (xfd->forever || xfd->retry) {
-	       dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	       opts = recopyopts(opts, opts0, GROUP_ALL);
 	       Nanosleep(&xfd->intervall, NULL); continue;
 	    }
 	    return STAT_RETRYLATER;
@@ -338,7 +338,7 @@ static int xioopen_unix_connect(int argc, const char *argv[], struct opt *opts,
 	 Close(xfd->fd);
 	 /* with and without retry */
 	 Nanosleep(&xfd->intervall, NULL);
-	 dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
+	 opts = recopyopts(opts, opts0, GROUP_ALL);
 	 continue;	/* with next socket() bind() connect() */
       } else
 #endif /* WITH_RETRY */
@@ -8,6 +8,7 @@
 #if 1 /*!*/
 #include "mytypes.h"
 #include "sysutils.h"
+#include "xioprobe.h"
 #endif
 
 #define XIO_MAXSOCK 2
@@ -19,6 +20,9 @@
 #define LINETERM_CR 1
 #define LINETERM_CRNL 2
 
+#define XIOFRAMING_NONE 0
+#define XIOFRAMING_LEN16 1	/* records with 2 byte length, network order */
+
 struct addrdesc;
 struct opt;
 
@@ -38,6 +42,7 @@ struct opt;
 #define XIO_DOESCHILD   XIO_MAYCHILD
 #define XIO_DOESEXEC    XIO_MAYEXEC
 #define XIO_DOESCONVERT XIO_MAYCONVERT
+#define XIO_DOESDEMUX	64	/* relays datagrams of many peers (demux) */
 
 
 /* methods for reading and writing, and for related checks */
@@ -160,6 +165,17 @@ typedef struct single {
    const char *argv[MAXARGV];	/* address keyword, required args */
    struct opt *opts;	/* the options of this address */
    int    lineterm;	/* 0..dont touch; 1..CR; 2..CRNL on extern data */
+   int    framing;	/* option framing: XIOFRAMING_NONE, _LEN16 */
+   struct xioframe *frame;	/* its buffers, see xio-framing.c */
+   struct {
+      int num;			/* number of worker processes (workers,
+				   tun-queues) */
+      bool bpf;			/* steer peers with a BPF program */
+      int index;		/* 1..num in a worker, else 0 */
+      int syncfd;		/* closed when the worker is ready */
+      unsigned long packets;	/* packets read by the worker */
+      unsigned long long bytes;	/* their bytes */
+   } workers;
    int    fd;
    bool   opt_unlink_close;	/* option unlink_close */
    char  *unlink_close;	/* name of a symlink or unix socket to be removed */
@@ -189,9 +205,25 @@ typedef struct single {
    struct termios savetty;	/* save orig tty settings for later restore */
 #endif /* WITH_TERMIOS */
    int (*sigchild)(struct single *);	/* callback after sigchild */
+   int (*prefork)(struct single *);	/* listener callback before fork */
+   const char *route;		/* address selected for the other side */
    pid_t ppid;			/* parent pid, only if we send it signals */
    int escape;			/* escape character; -1 for no escape */
    bool actescape;		/* escape character found in input data */
+#if WITH_UDP
+   struct {
+      bool enable;		/* one process relays all peers (demux) */
+      int  max;			/* maximal number of flows */
+      struct timeval timeout;	/* flows idle this long are closed */
+   } demux;
+#endif /* WITH_UDP */
+#if _WITH_SOCKET
+   int dgrambatch;		/* datagrams per recvmmsg()/sendmmsg() */
+   int udpgso;			/* UDP segment size for sending, or 0 */
+   bool udpgro;			/* split coalesced UDP packets (udp-gro) */
+   struct xiodgram *dgram;	/* their ring and queue, see xio-socket.c */
+   struct xiopacketring *packetring; /* PACKET_MMAP rings, see xio-interface.c */
+#endif /* _WITH_SOCKET */
    union {
       struct {
 	 int fdout;		/* use fd for output */
@@ -216,6 +248,7 @@ typedef struct single {
 	    bool     tight;
 	 } un;
 #endif /* WITH_UNIX */
+	 bool la_known;		/* la holds the final local address */
       } socket;
 #endif /* _WITH_SOCKET */
       struct {
@@ -258,6 +291,36 @@ typedef struct single {
 #if HAVE_SSL_CTX_set_max_proto_version || defined(SSL_CTX_set_max_proto_version)
 	 char *max_proto_version;
 #endif
+	 struct xio_openssl_rec {
+	    bool   dynamic;	/* option openssl-dynamic-records */
+	    int    minsize;	/* record size after handshake or idle */
+	    int    maxsize;	/* record size for sustained transfers */
+	    struct timeval idle;	/* fall back to minsize after so long */
+	    struct timeval coalesce;	/* latency budget for small writes */
+	    int    cursize;	/* current target record size */
+	    unsigned int smallrecs;	/* records sent since last reset */
+	    struct timespec lastwrite;	/* for idle detection */
+	    unsigned char *pendbuf;	/* coalesced data, maxsize bytes */
+	    size_t pendlen;
+	    struct timespec pendsince;	/* when first byte was coalesced */
+	    /* statistics */
+	    unsigned long records;	/* number of SSL_write() records */
+	    unsigned long long bytes;	/* bytes in these records */
+	    unsigned long minrecs;	/* records with minsize target */
+	    unsigned long maxrecs;	/* records with maxsize target */
+	    unsigned long coalesced;	/* writes absorbed into pendbuf */
+	    unsigned long flushes;	/* pendbuf sent as own record */
+	    int    smallest, largest;
+	 } rec;
+	 struct {
+	    bool   enable;	/* option openssl-reload */
+	    bool   dtls;
+	    struct opt *opts;	/* copy of options for rebuilding ctx */
+	    char  *files[5];	/* cert, key, dhparam, cafile, snitable */
+	    struct stat stats[5];	/* to detect changes */
+	 } reload;
+	 char  *snitable;	/* option openssl-snitable */
+	 struct xio_openssl_snitab *snitab;
       } openssl;
 #endif /* WITH_OPENSSL */
 #if WITH_TUN
@@ -420,6 +483,19 @@ extern xiofile_t *sock[XIO_MAXSOCK];
 
 extern int num_child;
 
+/* statistics of the child processes of this process */
+struct xiochildstat {
+   unsigned long forked;	/* registered by xio_fork() */
+   unsigned long exited;	/* terminated with status 0 */
+   unsigned long failed;	/* other status or killed by signal */
+   int laststatus;		/* from waitpid() */
+   struct timeval lifetime;	/* sum of all terminated children */
+   struct timeval maxlifetime;
+} ;
+extern struct xiochildstat xiochildstat;
+extern int xiochildfd;
+extern void (*xiochild_hook)(pid_t pid, int status);
+
 /* return values of xioopensingle */
 #define STAT_OK		0
 #define STAT_WARNING	1
@@ -441,6 +517,8 @@ extern int xioinqopt(char what, char *arg, size_t n);
 extern xiofile_t *xioopen(const char *args, int flags);
 extern int xioopensingle(char *addr, struct single *xfd, int xioflags);
 extern int xioopenhelp(FILE *of, int level);
+extern int xiodemux(xiofile_t *xfd1, const char *address2, int xioflags,
+		    size_t bufsiz);
 
 /* must be outside function for use by childdied handler */
 extern xiofile_t *sock1, *sock2;
@@ -454,12 +532,24 @@ extern int   statunknown[NUMUNKNOWN]; 	/* exit state of unknown dead child */
 
 extern int xiosetsigchild(xiofile_t *xfd, int (*callback)(struct single *));
 extern int xiosetchilddied(void);
+extern int xiosetchildfd(void);
+extern int xiochild_register(pid_t pid);
+extern int xiochild_reap(void);
+extern int xiochild_collect(void);
+extern int xiochild_wait(int fd, const struct timeval *timeout);
+extern void xiochild_forked(void);
+extern int xioworkers_start(struct single *sfd, int num);
+extern int xioworker_ready(struct single *sfd);
 extern int xio_opt_signal(pid_t pid, int signum);
 extern void childdied(int signum);
 
 extern ssize_t xioread(xiofile_t *sock1, void *buff, size_t bufsiz);
+extern ssize_t _xioread(struct single *pipe, void *buff, size_t bufsiz);
 extern ssize_t xiopending(xiofile_t *sock1);
 extern ssize_t xiowrite(xiofile_t *sock1, const void *buff, size_t bufsiz);
+extern ssize_t _xiowrite(struct single *pipe, const void *buff, size_t bytes);
+extern int xioflush(xiofile_t *sock1);
+extern int xioflushdelay(xiofile_t *sock1, struct timeval *delay);
 extern int xioshutdown(xiofile_t *sock, int how);
 
 extern int xioclose(xiofile_t *sock);
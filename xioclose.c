@@ -10,6 +10,9 @@
 #include "xiolockfile.h"
 
 #include "xio-termios.h"
+#include "xio-socket.h"
+#include "xio-openssl.h"
+#include "xio-framing.h"
 
 
 /* close the xio fd; must be valid and "simple" (not dual) */
@@ -21,6 +24,8 @@ int xioclose1(struct single *pipe) {
       return -1;
    }
 
+   /* records still collected by option framing */
+   xioclose_framing(pipe);
 #if WITH_READLINE
    if ((pipe->dtype & XIODATA_MASK) == XIODATA_READLINE) {
       Write_history(pipe->para.readline.history_file);
@@ -31,10 +36,12 @@ int xioclose1(struct single *pipe) {
    if ((pipe->dtype & XIODATA_MASK) == XIODATA_OPENSSL) {
       if (pipe->para.openssl.ssl) {
 	 /* e.g. on TCP connection refused, we do not yet have this set */
+	 xioflush_openssl(pipe);
 	 sycSSL_shutdown(pipe->para.openssl.ssl);
 	 sycSSL_free(pipe->para.openssl.ssl);
 	 pipe->para.openssl.ssl = NULL;
       }
+      xiorecstat_openssl(pipe);
       Close(pipe->fd);  pipe->fd = -1;
       if (pipe->para.openssl.ctx) {
 	 sycSSL_CTX_free(pipe->para.openssl.ctx);
@@ -50,6 +57,10 @@ int xioclose1(struct single *pipe) {
       }
    }
 #endif /* WITH_TERMIOS */
+#if _WITH_SOCKET
+   /* datagrams still queued by option dgram-batch */
+   xioclose_dgram(pipe);
+#endif /* _WITH_SOCKET */
    if (pipe->fd >= 0) {
       switch (pipe->howtoend) {
       case END_KILL: case END_SHUTDOWN_KILL: case END_CLOSE_KILL:
@@ -87,6 +87,18 @@
 #  define _WITH_FILE 1
 #endif
 
+/* PACKET_MMAP rings (TPACKET_V3) of the INTERFACE address */
+#if WITH_INTERFACE && HAVE_LINUX_IF_PACKET_H && HAVE_SYS_MMAN_H
+#  define _WITH_PACKETRING 1
+#endif
+
+/* statistics endpoint (option -S): a server thread and a table in shared
+   memory */
+#if WITH_UNIX && HAVE_PTHREAD_H && HAVE_PTHREAD_CREATE && HAVE_SYS_MMAN_H && \
+    HAVE_CLOCK_GETTIME
+#  define WITH_STATS 1
+#endif
+
 
 #if HAVE_DEV_PTMX && HAVE_GRANTPT && HAVE_UNLOCKPT && HAVE_PROTOTYPE_LIB_ptsname
 #else
@@ -8,6 +8,7 @@
 
 #include "xioopen.h"
 #include "xiolockfile.h"
+#include "xiostats.h"
 
 #include "xio-openssl.h"	/* xio_reset_fips_mode() */
 
@@ -172,7 +173,7 @@ int xio_forked_inchild(void) {
    for (i=0; i<NUMUNKNOWN; ++i) {
       diedunknown[i] = 0;
    }
-   num_child = 0;
+   xiochild_forked();
    xiodroplocks();
 #if WITH_FIPS
    if (xio_reset_fips_mode() != 0) {
@@ -204,15 +205,25 @@ pid_t xio_fork(bool subchild, int level) {
    pid_t pid;
    const char *forkwaitstring;
    int forkwaitsecs = 0;
+   sigset_t mask, oldmask;
+   struct timespec t0;
 
+   /* a SIGCHLD handler must not see the child before it is registered */
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask, &oldmask);
+   xiostats_begin(&t0);
    if ((pid = Fork()) < 0) {
       Msg1(level, "fork(): %s", strerror(errno));
+      Sigprocmask(SIG_SETMASK, &oldmask, NULL);
       return pid;
    }
 
    if (pid == 0) {	/* child process */
       pid_t cpid = Getpid();
 
+      Sigprocmask(SIG_SETMASK, &oldmask, NULL);
+
       Info1("just born: child process "F_pid, cpid);
       if (!subchild) {
 	 /* set SOCAT_PID to new value */
@@ -223,14 +234,24 @@ pid_t xio_fork(bool subchild, int level) {
 	 forkwaitsecs = atoi(forkwaitstring);
 	 Sleep(forkwaitsecs);
       }
+      xiostats_fork(0);
+      if (!subchild) {
+	 xiostats_end(XIOSTATS_FORK, &t0);
+      }
       if (xio_forked_inchild() != 0) {
 	 Exit(1);
       }
       return 0;
    }
 
-   num_child++;
    /* parent process */
+   if (!subchild) {
+      xiostats_fork(pid);
+   }
+   if (xiochild_register(pid) < 0) {
+      Warn1("cannot register child process "F_pid, pid);
+   }
+   Sigprocmask(SIG_SETMASK, &oldmask, NULL);
    Notice1("forked off child process "F_pid, pid);
    /* gdb recommends to have env controlled sleep after fork */
    if (forkwaitstring = getenv("SOCAT_FORK_WAIT")) {
@@ -17,6 +17,7 @@ const struct optdesc opt_readbytes = { "readbytes", "bytes", OPT_READBYTES, GROU
 const struct optdesc opt_lockfile  = { "lockfile",  NULL, OPT_LOCKFILE,  GROUP_APPL, PH_INIT, TYPE_FILENAME, OFUNC_EXT, 0, 0 };
 const struct optdesc opt_waitlock  = { "waitlock",  NULL, OPT_WAITLOCK,  GROUP_APPL, PH_INIT,  TYPE_FILENAME, OFUNC_EXT, 0, 0 };
 const struct optdesc opt_escape    = { "escape",    NULL,    OPT_ESCAPE,    GROUP_APPL, PH_INIT, TYPE_INT,   OFUNC_OFFSET, XIO_OFFSETOF(escape), sizeof(((xiosingle_t *)0)->escape) };
+const struct optdesc opt_framing   = { "framing",   NULL, OPT_FRAMING,   GROUP_APPL, PH_LATE, TYPE_STRING, OFUNC_EXT, XIO_OFFSETOF(framing), XIO_SIZEOF(framing) };
 /****** APPL addresses ******/
 #if WITH_RETRY
 const struct optdesc opt_forever   = { "forever",   NULL, OPT_FOREVER,   GROUP_RETRY, PH_INIT, TYPE_BOOL, OFUNC_EXT, XIO_OFFSETOF(forever),   XIO_SIZEOF(forever) };
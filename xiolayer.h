@@ -12,6 +12,7 @@ extern const struct optdesc opt_readbytes;
 extern const struct optdesc opt_lockfile;
 extern const struct optdesc opt_waitlock;
 extern const struct optdesc opt_escape;
+extern const struct optdesc opt_framing;
 extern const struct optdesc opt_forever;
 extern const struct optdesc opt_intervall;
 extern const struct optdesc opt_retry;
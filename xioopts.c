@@ -11,6 +11,7 @@
 
 #include "xiomodes.h"
 #include "xiolockfile.h"
+#include "xio-framing.h"
 #include "nestlex.h"
 
 bool xioopts_ignoregroups;
@@ -137,6 +138,12 @@ bool xioopts_ignoregroups;
 #  define IF_TUN(a,b)
 #endif
 
+#if WITH_INTERFACE
+#  define IF_INTERFACE(a,b) {a,b},
+#else
+#  define IF_INTERFACE(a,b)
+#endif
+
 #if WITH_UNIX
 #  define IF_UNIX(a,b) {a,b},
 #else
@@ -152,6 +159,65 @@ bool xioopts_ignoregroups;
 
 static int applyopt_offset(struct single *xfd, struct opt *opt);
 
+/* every option array built by parseopts(), copyopts(), and moveopts() is
+   preceded by a hidden plan: order[] lists the array indices sorted by phase,
+   so applyopts() finds the options of the requested phase with a binary
+   search, and hash[] and next[] chain the options by a hash of their optcode,
+   so retropt_*() look at a few options instead of the whole array. The plan
+   is built once when the array is complete; options that are applied or
+   retrieved later are only marked ODESC_DONE, which keeps it valid. Use
+   freeopts() to release such an array. */
+#define OPTPLAN_HASH 32		/* power of 2; few addresses have more options */
+#define OPTPLAN_BUCKET(optcode) ((unsigned int)(optcode)&(OPTPLAN_HASH-1))
+
+struct optplan {
+   unsigned int size;	/* number of struct opt allocated behind the plan */
+   unsigned int nopts;	/* number of options, without ODESC_END */
+   unsigned int norder;	/* number of entries in order[] */
+   unsigned short hash[OPTPLAN_HASH];	/* index+1 of last option in this
+					   bucket, or 0 */
+   unsigned short *order;	/* [size] */
+   unsigned short *phase;	/* [size] phase of option order[i] */
+   unsigned short *next;	/* [size] index+1 of next option in same bucket */
+} ;
+
+#define OPTPLAN_HDRSIZE ((sizeof(struct optplan)+15)&~(size_t)15)
+#define OPTPLAN(opts) ((struct optplan *)((char *)(opts)-OPTPLAN_HDRSIZE))
+
+static struct opt *xioopts_alloc(struct opt *opts, unsigned int size);
+static void xioopts_plan(struct opt *opts);
+
+/* returns the next option of the given phase, or of all options with PH_ALL,
+   in the iteration state *k that starts with 0; NULL at the end.
+   Includes options that were consumed after the plan was built */
+static inline struct opt *xioopts_next(struct opt *opts, enum e_phase phase,
+				       unsigned int *k) {
+   const struct optplan *plan = OPTPLAN(opts);
+   unsigned int i = *k, lo, hi;
+
+   if (phase == PH_ALL) {
+      if (i >= plan->nopts)  return NULL;
+      ++*k;
+      return &opts[i];
+   }
+   if (i == 0) {
+      /* first entry of phase */
+      lo = 0;  hi = plan->norder;
+      while (lo < hi) {
+	 i = (lo+hi)/2;
+	 if (plan->phase[i] < (unsigned int)phase)  lo = i+1;  else  hi = i;
+      }
+      i = lo;
+   } else {
+      --i;
+   }
+   if (i >= plan->norder || plan->phase[i] != (unsigned int)phase) {
+      return NULL;
+   }
+   *k = i+2;
+   return &opts[plan->order[i]];
+}
+
 
 /* address options - keep this array strictly alphabetically sorted for
    binary search! */
@@ -163,6 +229,7 @@ const struct optname optionnames[] = {
 #ifdef TCP_ABORT_THRESHOLD  /* HP_UX */
 	IF_TCP    ("abort-threshold",	&opt_tcp_abort_threshold)
 #endif
+	IF_LISTEN ("accept-batch",	&opt_accept_batch)
 	IF_LISTEN ("accept-timeout",	&opt_accept_timeout)
 #ifdef SO_ACCEPTCONN /* AIX433 */
 	IF_SOCKET ("acceptconn",	&opt_so_acceptconn)
@@ -309,6 +376,7 @@ const struct optname optionnames[] = {
 	IF_ANY    ("cloexec",	&opt_cloexec)
 	IF_ANY    ("close",	&opt_end_close)
 	IF_OPENSSL("cn",		&opt_openssl_commonname)
+	IF_OPENSSL("coalesce",	&opt_openssl_coalesce)
 	IF_OPENSSL("commonname",	&opt_openssl_commonname)
 #if WITH_FS && defined(FS_COMPR_FL)
 	IF_ANY    ("compr",	&opt_fs_compr)
@@ -379,6 +447,9 @@ const struct optname optionnames[] = {
 	IF_OPEN   ("delay",	&opt_o_delay)
 #endif
 	IF_NAMED  ("delete",	&opt_unlink)
+	IF_UDP    ("demux",	&opt_demux)
+	IF_UDP    ("demux-max",	&opt_demux_max)
+	IF_UDP    ("demux-timeout",	&opt_demux_timeout)
 #if WITH_LIBWRAP && defined(HAVE_HOSTS_DENY_TABLE)
 	IF_IPAPP  ("deny-table",	&opt_tcpwrap_hosts_deny_table)
 #endif
@@ -386,6 +457,7 @@ const struct optname optionnames[] = {
 	IF_SOCKET ("detach-filter", &opt_so_detach_filter)
 	IF_SOCKET ("detachfilter",  &opt_so_detach_filter)
 #endif
+	IF_SOCKET ("dgram-batch",	&opt_dgram_batch)
 #ifdef SO_DGRAM_ERRIND
 	IF_SOCKET ("dgram-errind",	&opt_so_dgram_errind)
 	IF_SOCKET ("dgramerrind",	&opt_so_dgram_errind)
@@ -421,6 +493,7 @@ const struct optname optionnames[] = {
 #ifdef O_DSYNC
 	IF_OPEN   ("dsync",	&opt_o_dsync)
 #endif
+	IF_OPENSSL("dynamic-records",	&opt_openssl_dynamic_records)
 	IF_TERMIOS("echo",	&opt_echo)
 	IF_TERMIOS("echoctl",	&opt_echoctl)
 	IF_TERMIOS("echoe",	&opt_echoe)
@@ -548,6 +621,7 @@ const struct optname optionnames[] = {
 	IF_TERMIOS("flusho",	&opt_flusho)
 	IF_RETRY  ("forever",	&opt_forever)
 	IF_LISTEN ("fork",	&opt_fork)
+	IF_ANY    ("framing",	&opt_framing)
 #ifdef IP_FREEBIND
 	IF_IP     ("freebind",	&opt_ip_freebind)
 #endif
@@ -640,6 +714,9 @@ const struct optname optionnames[] = {
 	/*IF_TUN    ("iff-dynamic",	&opt_iff_dynamic)*/
 	IF_TUN    ("iff-loopback",	&opt_iff_loopback)
 	IF_TUN    ("iff-master",	&opt_iff_master)
+#ifdef IFF_MULTI_QUEUE
+	IF_TUN    ("iff-multi-queue",	&opt_iff_multi_queue)
+#endif
 	IF_TUN    ("iff-multicast",	&opt_iff_multicast)
 	IF_TUN    ("iff-no-pi",	&opt_iff_no_pi)
 	IF_TUN    ("iff-noarp",	&opt_iff_noarp)
@@ -650,6 +727,9 @@ const struct optname optionnames[] = {
 	IF_TUN    ("iff-running",	&opt_iff_running)
 	IF_TUN    ("iff-slave",	&opt_iff_slave)
 	IF_TUN    ("iff-up",	&opt_iff_up)
+#ifdef IFF_VNET_HDR
+	IF_TUN    ("iff-vnet-hdr",	&opt_iff_vnet_hdr)
+#endif
 	IF_TERMIOS("ignbrk",	&opt_ignbrk)
 	IF_TERMIOS("igncr",	&opt_igncr)
   /* you might need to terminate socat manually if you use this option: */
@@ -959,6 +1039,9 @@ const struct optname optionnames[] = {
 #endif
 #ifdef IP_MTU_DISCOVER
 	IF_IP     ("mtudiscover",	&opt_ip_mtu_discover)
+#endif
+#ifdef IFF_MULTI_QUEUE
+	IF_TUN    ("multi-queue",	&opt_iff_multi_queue)
 #endif
 	IF_TUN    ("multicast",	&opt_iff_multicast)
 	IF_IP     ("multicast-if",	&opt_ip_multicast_if)
@@ -1172,12 +1255,14 @@ const struct optname optionnames[] = {
 	IF_OPENSSL("openssl-capath",	&opt_openssl_capath)
 	IF_OPENSSL("openssl-certificate",	&opt_openssl_certificate)
 	IF_OPENSSL("openssl-cipherlist",	&opt_openssl_cipherlist)
+	IF_OPENSSL("openssl-coalesce",	&opt_openssl_coalesce)
 	IF_OPENSSL("openssl-commonname",	&opt_openssl_commonname)
 #if OPENSSL_VERSION_NUMBER >= 0x00908000L && !defined(OPENSSL_NO_COMP)
 	IF_OPENSSL("openssl-compress",	&opt_openssl_compress)
 #endif
 	IF_OPENSSL("openssl-dhparam",	&opt_openssl_dhparam)
 	IF_OPENSSL("openssl-dhparams",	&opt_openssl_dhparam)
+	IF_OPENSSL("openssl-dynamic-records",	&opt_openssl_dynamic_records)
 	IF_OPENSSL("openssl-egd",	&opt_openssl_egd)
 #if WITH_FIPS
 	IF_OPENSSL("openssl-fips",	&opt_openssl_fips)
@@ -1196,15 +1281,33 @@ const struct optname optionnames[] = {
 	IF_OPENSSL("openssl-no-sni",	&opt_openssl_no_sni)
 #endif
 	IF_OPENSSL("openssl-pseudo",	&opt_openssl_pseudo)
+	IF_OPENSSL("openssl-record-idle",	&opt_openssl_record_idle)
+	IF_OPENSSL("openssl-record-max",	&opt_openssl_record_max)
+	IF_OPENSSL("openssl-record-size",	&opt_openssl_record_size)
+	IF_OPENSSL("openssl-reload",	&opt_openssl_reload)
 #if defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name)
 	IF_OPENSSL("openssl-snihost",   &opt_openssl_snihost)
 #endif
+	IF_OPENSSL("openssl-snitable",	&opt_openssl_snitable)
 	IF_OPENSSL("openssl-verify",	&opt_openssl_verify)
 	IF_TERMIOS("opost",	&opt_opost)
 #if HAVE_TERMIOS_OSPEED
 	IF_TERMIOS("ospeed",	&opt_ospeed)
 #endif
 	IF_ANY    ("owner",	&opt_user)
+#if _WITH_PACKETRING
+	IF_INTERFACE("packet-block-size",	&opt_packet_block_size)
+	IF_INTERFACE("packet-blocks",	&opt_packet_blocks)
+#endif
+#ifdef PACKET_FANOUT
+	IF_INTERFACE("packet-fanout",	&opt_packet_fanout)
+	IF_INTERFACE("packet-fanout-group",	&opt_packet_fanout_group)
+#endif
+#if _WITH_PACKETRING
+	IF_INTERFACE("packet-frame-size",	&opt_packet_frame_size)
+	IF_INTERFACE("packet-rx-ring",	&opt_packet_rx_ring)
+	IF_INTERFACE("packet-tx-ring",	&opt_packet_tx_ring)
+#endif
 	IF_TERMIOS("parenb",	&opt_parenb)
 	IF_TERMIOS("parmrk",	&opt_parmrk)
 	IF_TERMIOS("parodd",	&opt_parodd)
@@ -1298,6 +1401,9 @@ const struct optname optionnames[] = {
 	IF_OPEN   ("rdonly",	&opt_o_rdonly)
 	IF_OPEN   ("rdwr",	&opt_o_rdwr)
 	IF_ANY    ("readbytes", &opt_readbytes)
+	IF_OPENSSL("record-idle",	&opt_openssl_record_idle)
+	IF_OPENSSL("record-max",	&opt_openssl_record_max)
+	IF_OPENSSL("record-size",	&opt_openssl_record_size)
 #if HAVE_RESOLV_H
 	IF_IP     ("recurse",	&opt_res_recurse)
 #endif /* HAVE_RESOLV_H */
@@ -1334,6 +1440,7 @@ const struct optname optionnames[] = {
 #ifdef IP_RECVTTL
 	IF_IP     ("recvttl",	&opt_ip_recvttl)
 #endif
+	IF_OPENSSL("reload",	&opt_openssl_reload)
 	IF_NAMED  ("remove",	&opt_unlink)
 #ifdef VREPRINT
 	IF_TERMIOS("reprint",	&opt_vreprint)
@@ -1472,6 +1579,7 @@ const struct optname optionnames[] = {
 #if defined(HAVE_SSL_set_tlsext_host_name) || defined(SSL_set_tlsext_host_name)
 	IF_OPENSSL("snihost",    &opt_openssl_snihost)
 #endif
+	IF_OPENSSL("snitable",	&opt_openssl_snitable)
 #ifdef SO_ACCEPTCONN /* AIX433 */
 	IF_SOCKET ("so-acceptconn",	&opt_so_acceptconn)
 #endif /* SO_ACCEPTCONN */
@@ -1753,10 +1861,25 @@ const struct optname optionnames[] = {
 #endif
 	IF_IP     ("ttl",	&opt_ip_ttl)
 	IF_TUN    ("tun-device",	&opt_tun_device)
+#ifdef IFF_MULTI_QUEUE
+	IF_TUN    ("tun-multi-queue",	&opt_iff_multi_queue)
+#endif
 	IF_TUN    ("tun-name",	&opt_tun_name)
 	IF_TUN    ("tun-no-pi",	&opt_iff_no_pi)
+#ifdef IFF_MULTI_QUEUE
+	IF_TUN    ("tun-queues",	&opt_tun_queues)
+#endif
 	IF_TUN    ("tun-type",	&opt_tun_type)
+#ifdef IFF_VNET_HDR
+	IF_TUN    ("tun-vnet-hdr",	&opt_iff_vnet_hdr)
+#endif
 	IF_SOCKET ("type",	&opt_so_type)
+#ifdef UDP_GRO
+	IF_UDP    ("udp-gro",	&opt_udp_gro)
+#endif
+#ifdef UDP_SEGMENT
+	IF_UDP    ("udp-gso",	&opt_udp_gso)
+#endif
 	IF_ANY    ("uid",	&opt_user)
 	IF_NAMED  ("uid-e",	&opt_user_early)
 	IF_ANY    ("uid-l",	&opt_user_late)
@@ -1802,6 +1925,9 @@ const struct optname optionnames[] = {
 	IF_TERMIOS("vkill",	&opt_vkill)
 	IF_TERMIOS("vlnext",	&opt_vlnext)
 	IF_TERMIOS("vmin",	&opt_vmin)
+#ifdef IFF_VNET_HDR
+	IF_TUN    ("vnet-hdr",	&opt_iff_vnet_hdr)
+#endif
 	IF_TERMIOS("vquit",	&opt_vquit)
 #ifdef VREPRINT
 	IF_TERMIOS("vreprint",	&opt_vreprint)
@@ -1838,6 +1964,12 @@ const struct optname optionnames[] = {
 #ifdef TCP_WINDOW_CLAMP	/* Linux 2.4.0 */
 	IF_TCP    ("window-clamp",	&opt_tcp_window_clamp)
 #endif
+#ifdef SO_REUSEPORT
+	IF_UDP    ("workers",	&opt_workers)
+#endif
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && HAVE_LINUX_FILTER_H
+	IF_UDP    ("workers-bpf",	&opt_workers_bpf)
+#endif
 #if WITH_LIBWRAP
 	IF_IPAPP  ("wrap",		&opt_tcpwrappers)
 #endif
@@ -1912,12 +2044,13 @@ int parseopts_table(const char **a, unsigned int groups, struct opt **opts,
    endval[i++] = NULL;
 
    i = 0;
-   *opts = Malloc((i+8)*sizeof(struct opt));
+   *opts = xioopts_alloc(NULL, i+8);
    if (*opts == NULL) {
       return -1;
    }
    if (*a == NULL) {
       (*opts)[i].desc = ODESC_END;
+      xioopts_plan(*opts);
       return 0;
    }
 
@@ -2624,7 +2757,7 @@ int parseopts_table(const char **a, unsigned int groups, struct opt **opts,
 
       ++i;
       if ((i % 8) == 0) {
-	 *opts = Realloc(*opts, (i+8) * sizeof(struct opt));
+	 *opts = xioopts_alloc(*opts, i+8);
 	 if (*opts == NULL) {
 	    return -1;
 	 }
@@ -2633,6 +2766,7 @@ int parseopts_table(const char **a, unsigned int groups, struct opt **opts,
 
    /*(*opts)[i+1].desc = ODESC_END;*/
    (*opts)[i].desc = ODESC_END;
+   xioopts_plan(*opts);
    return 0;
 }
 
@@ -2661,11 +2795,93 @@ const struct opt *searchopt(const struct opt *opts, unsigned int groups, enum e_
    return NULL;
 }
 
+/* allocates an option array for size entries (including ODESC_END) with room
+   for its plan, or resizes the array opts. The plan is left empty until
+   xioopts_plan() is called. Returns NULL on error */
+static struct opt *xioopts_alloc(struct opt *opts, unsigned int size) {
+   struct optplan *plan;
+   size_t len;
+
+   if (size > 0xffff) {
+      Error1("too many options (%u)", size);
+      return NULL;
+   }
+   len = OPTPLAN_HDRSIZE + size*sizeof(struct opt) +
+      3*size*sizeof(unsigned short);
+   if (opts == NULL) {
+      if ((plan = Malloc(len)) == NULL) {
+	 return NULL;
+      }
+      plan->nopts = plan->norder = 0;
+   } else if ((plan = Realloc(OPTPLAN(opts), len)) == NULL) {
+      return NULL;
+   }
+   plan->size = size;
+   opts = (struct opt *)((char *)plan + OPTPLAN_HDRSIZE);
+   plan->order = (unsigned short *)&opts[size];
+   plan->phase = plan->order + size;
+   plan->next  = plan->phase + size;
+   return opts;
+}
+
+/* builds the plan of the complete option array opts */
+static void xioopts_plan(struct opt *opts) {
+   struct optplan *plan = OPTPLAN(opts);
+   unsigned int j, n, k = 0, p, c;
+
+   memset(plan->hash, 0, sizeof(plan->hash));
+   for (n = 0; opts[n].desc != ODESC_END; ++n) {
+      if (opts[n].desc == ODESC_DONE)  continue;
+      /* insertion sort by phase; keeps the order within a phase, and the
+	 arrays are short and mostly sorted already */
+      p = opts[n].desc->phase;
+      for (j = k; j > 0 && plan->phase[j-1] > p; --j) {
+	 plan->order[j] = plan->order[j-1];
+	 plan->phase[j] = plan->phase[j-1];
+      }
+      plan->order[j] = n;
+      plan->phase[j] = p;
+      ++k;
+      /* chains per bucket, highest index first */
+      c = OPTPLAN_BUCKET(opts[n].desc->optcode);
+      plan->next[n] = plan->hash[c];
+      plan->hash[c] = n+1;
+   }
+   plan->nopts = n;
+   plan->norder = k;
+}
+
+/* releases an option array from parseopts(), copyopts(), or moveopts(); the
+   option values are not freed */
+void freeopts(struct opt *opts) {
+   if (opts == NULL)  return;
+   free(OPTPLAN(opts));
+}
+
+/* copies the options of opts matching groups ANY and <groups> to new, which
+   must be large enough, and builds its plan */
+static void _copyopts(struct opt *new, const struct opt *opts,
+		      unsigned int groups) {
+   int i = 0, j = 0;
+
+   while (opts[i].desc != ODESC_END) {
+      if (opts[i].desc == ODESC_DONE) {
+	 new[j].desc = ODESC_DONE;
+      } else if ((opts[i].desc->group & (GROUP_ANY&~GROUP_PROCESS)) ||
+		 (opts[i].desc->group & groups)) {
+	 new[j++] = opts[i];
+      }
+      ++i;
+   }
+   new[j].desc = ODESC_END;
+   xioopts_plan(new);
+}
+
 /* copy the already parsed options for repeated application, but only those
    matching groups ANY and <groups> */
 struct opt *copyopts(const struct opt *opts, unsigned int groups) {
    struct opt *new;
-   int i, j, n;
+   int i, n;
 
    if (!opts)  return NULL;
 
@@ -2675,23 +2891,33 @@ struct opt *copyopts(const struct opt *opts, unsigned int groups) {
    }
    n = i+1;
 
-   new = Malloc(n * sizeof(struct opt));
+   new = xioopts_alloc(NULL, n);
    if (new == NULL) {
       return NULL;
    }
+   _copyopts(new, opts, groups);
+   return new;
+}
 
-   i = 0, j = 0;
-   while (i < n-1) {
-      if (opts[i].desc == ODESC_DONE) {
-	 new[j].desc = ODESC_DONE;
-      } else if ((opts[i].desc->group & (GROUP_ANY&~GROUP_PROCESS)) ||
-		 (opts[i].desc->group & groups)) {
-	 new[j++] = opts[i];
-      }
-      ++i;
+/* like copyopts(), but for retry and fork loops that discard the previous
+   copy: when the array opts is large enough it is overwritten and its plan
+   rebuilt, so no memory is allocated. As with dropopts(opts, PH_ALL), the
+   previous contents of opts are lost. Returns the (new) array, or NULL on
+   error */
+struct opt *recopyopts(struct opt *opts, const struct opt *opts0,
+		       unsigned int groups) {
+   unsigned int n;
+
+   if (opts == NULL || opts == opts0 || opts0 == NULL) {
+      return copyopts(opts0, groups);
    }
-   new[j].desc = ODESC_END;
-   return new;
+   n = OPTPLAN(opts0)->nopts+1;
+   if (OPTPLAN(opts)->size < n) {
+      dropopts(opts, PH_ALL);
+      return copyopts(opts0, groups);
+   }
+   _copyopts(opts, opts0, groups);
+   return opts;
 }
 
 /* move options to a new options list
@@ -2711,7 +2937,7 @@ struct opt *moveopts(struct opt *opts, unsigned int groups) {
    }
    n = i;
 
-   new = Malloc((j+1) * sizeof(struct opt));
+   new = xioopts_alloc(NULL, j+1);
    if (new == NULL) {
       return NULL;
    }
@@ -2728,6 +2954,7 @@ struct opt *moveopts(struct opt *opts, unsigned int groups) {
       ++i;
    }
    new[j].desc = ODESC_END;
+   xioopts_plan(new);
    return new;
 }
 
@@ -2836,16 +3063,24 @@ int retropt(struct opt *opts, int optcode, union integral *result) {
 }
 #endif
 
+/* returns the first unconsumed option with optcode, using the plan's index */
 static struct opt *xio_findopt(struct opt *opts, int optcode) {
-   struct opt *opt = opts;
+   const struct optplan *plan;
+   struct opt *opt = NULL;
+   unsigned int i;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 return opt;
+   if (opts == NULL || optcode < 0 || optcode >= OPT_nocomma) {
+      return NULL;
+   }
+   plan = OPTPLAN(opts);
+   /* the chain runs backwards, so the last match is the first option */
+   for (i = plan->hash[OPTPLAN_BUCKET(optcode)]; i != 0; i = plan->next[i-1]) {
+      if (opts[i-1].desc != ODESC_DONE &&
+	  opts[i-1].desc->optcode == optcode) {
+	 opt = &opts[i-1];
       }
-      ++opt;
    }
-   return NULL;
+   return opt;
 }
 
 int retropt_timespec(struct opt *opts, int optcode, struct timespec *result) {
@@ -2865,17 +3100,14 @@ int retropt_timespec(struct opt *opts, int optcode, struct timespec *result) {
    option, and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_bool(struct opt *opts, int optcode, bool *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 *result = opt->value.u_bool;
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   *result = opt->value.u_bool;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 #if 0	/* currently not used */
@@ -2884,17 +3116,14 @@ int retropt_bool(struct opt *opts, int optcode, bool *result) {
    option, and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_short(struct opt *opts, int optcode, short *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 *result = opt->value.u_short;
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   *result = opt->value.u_short;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 #endif
 
@@ -2903,17 +3132,14 @@ int retropt_short(struct opt *opts, int optcode, short *result) {
    option, and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_ushort(struct opt *opts, int optcode, unsigned short *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 *result = opt->value.u_ushort;
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   *result = opt->value.u_ushort;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 /* Looks for the first option of type <optcode>. If the option is found,
@@ -2921,30 +3147,27 @@ int retropt_ushort(struct opt *opts, int optcode, unsigned short *result) {
    option, and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_int(struct opt *opts, int optcode, int *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
+   char *rest;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 char *rest;
-	 switch (opt->desc->type) {
-	 case TYPE_INT: *result = opt->value.u_int; break;
-	 case TYPE_STRING: *result = strtol(opt->value.u_string, &rest, 0);
-	    if (*rest != '\0') {
-	       Error1("retropts: trailing garbage in numerical arg of option \"%s\"",
-		      opt->desc->defname);
-	    }
-	    break;
-	 default: Error2("cannot convert type %d of option %s to int",
-			 opt->desc->type, opt->desc->defname);
-	    opt->desc = ODESC_ERROR;
-	    return -1;
-	 }
-	 opt->desc = ODESC_DONE;
-	 return 0;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
+   }
+   switch (opt->desc->type) {
+   case TYPE_INT: *result = opt->value.u_int; break;
+   case TYPE_STRING: *result = strtol(opt->value.u_string, &rest, 0);
+      if (*rest != '\0') {
+	 Error1("retropts: trailing garbage in numerical arg of option \"%s\"",
+		opt->desc->defname);
       }
-      ++opt;
+      break;
+   default: Error2("cannot convert type %d of option %s to int",
+		   opt->desc->type, opt->desc->defname);
+      opt->desc = ODESC_ERROR;
+      return -1;
    }
-   return -1;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 /* Looks for the first option of type <optcode>. If the option is found,
@@ -2952,17 +3175,14 @@ int retropt_int(struct opt *opts, int optcode, int *result) {
    option, and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_uint(struct opt *opts, int optcode, unsigned int *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 *result = opt->value.u_uint;
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   *result = opt->value.u_uint;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 /* Looks for the first option of type <optcode>. If the option is found,
@@ -2970,17 +3190,14 @@ int retropt_uint(struct opt *opts, int optcode, unsigned int *result) {
    and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_long(struct opt *opts, int optcode, long *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 *result = opt->value.u_long;
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   *result = opt->value.u_long;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 /* Looks for the first option of type <optcode>. If the option is found,
@@ -2988,17 +3205,14 @@ int retropt_long(struct opt *opts, int optcode, long *result) {
    option, and returns 0.
    If the option is not found, *result is not modified, and -1 is returned. */
 int retropt_ulong(struct opt *opts, int optcode, unsigned long *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 *result = opt->value.u_ulong;
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   *result = opt->value.u_ulong;
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 #if 0	/* currently not used */
@@ -3006,21 +3220,18 @@ int retropt_ulong(struct opt *opts, int optcode, unsigned long *result) {
    bit position. Mark the option as consumed (done). return 0 if options was found and successfully applied,
    or -1 if option was not in opts */
 int retropt_flag(struct opt *opts, int optcode, flags_t *result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 if (opt->value.u_bool) {
-	    *result |= opt->desc->major;
-	 } else {
-	    *result &= ~opt->desc->major;
-	 }
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   if (opt->value.u_bool) {
+      *result |= opt->desc->major;
+   } else {
+      *result &= ~opt->desc->major;
+   }
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 #endif
 
@@ -3032,23 +3243,20 @@ int retropt_flag(struct opt *opts, int optcode, flags_t *result) {
    If the option is not found, *result is not modified, and -1 is returned.
  */
 int retropt_string(struct opt *opts, int optcode, char **result) {
-   struct opt *opt = opts;
+   struct opt *opt;
 
-   while (opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->optcode == optcode) {
-	 if (opt->value.u_string == NULL) {
-	    *result = NULL;
-	 } else if ((*result = strdup(opt->value.u_string)) == NULL) {
-	    Error1("strdup("F_Zu"): out of memory",
-		   strlen(opt->value.u_string));
-	    return -1;
-	 }
-	 opt->desc = ODESC_DONE;
-	 return 0;
-      }
-      ++opt;
+   if (!(opt = xio_findopt(opts, optcode))) {
+      return -1;
    }
-   return -1;
+   if (opt->value.u_string == NULL) {
+      *result = NULL;
+   } else if ((*result = strdup(opt->value.u_string)) == NULL) {
+      Error1("strdup("F_Zu"): out of memory",
+	     strlen(opt->value.u_string));
+      return -1;
+   }
+   opt->desc = ODESC_DONE;
+   return 0;
 }
 
 
@@ -3172,11 +3380,11 @@ int retropt_bind(struct opt *opts,
    OFUNC_TERMIOS_FLAG, OFUNC_TERMIOS_PATTERN, and some OFUNC_SPEC */
 int applyopts(int fd, struct opt *opts, enum e_phase phase) {
    struct opt *opt;
+   unsigned int k = 0;
 
-   opt = opts; while (opt && opt->desc != ODESC_END) {
-      if (opt->desc == ODESC_DONE ||
-	  (phase != PH_ALL && opt->desc->phase != phase)) {
-	 ++opt; continue; }
+   while (opts && (opt = xioopts_next(opts, phase, &k)) != NULL) {
+      if (opt->desc == ODESC_DONE) {
+	 continue; }
 
       if (opt->desc->func == OFUNC_SEEK32) {
 	 if (Lseek(fd, opt->value.u_off, opt->desc->major) < 0) {
@@ -3200,7 +3408,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	 if ((flag = Fcntl(fd, opt->desc->major-1)) < 0) {
 	    Error3("fcntl(%d, %d): %s",
 		   fd, opt->desc->major, strerror(errno));
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 } else {
 	    if (opt->value.u_bool) {
 	       flag |= opt->desc->minor;
@@ -3210,7 +3418,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Fcntl_l(fd, opt->desc->major, flag) < 0) {
 	       Error4("fcntl(%d, %d, %d): %s",
 		      fd, opt->desc->major, flag, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	 }
 
@@ -3218,7 +3426,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	 if (Ioctl(fd, opt->desc->major, (void *)&opt->value) < 0) {
 	    Error4("ioctl(%d, 0x%x, %p): %s",
 		   fd, opt->desc->major, (void *)&opt->value, strerror(errno));
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
       } else if (opt->desc->func == OFUNC_IOCTL_MASK_LONG) {
@@ -3230,14 +3438,14 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	 if (Ioctl(fd, getreq, (void *)&val) < 0) {
 	    Error4("ioctl(%d, 0x%x, %p): %s",
 		   fd, opt->desc->major, (void *)&val, strerror(errno));
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 	 val &= ~mask;
 	 if (opt->value.u_bool)  val |= mask;
 	 if (Ioctl(fd, setreq, (void *)&val) < 0) {
 	    Error4("ioctl(%d, 0x%x, %p): %s",
 		   fd, opt->desc->major, (void *)&val, strerror(errno));
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
       } else if (opt->desc->func == OFUNC_IOCTL_GENERIC) {
@@ -3246,35 +3454,35 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Ioctl(fd, opt->value.u_int, NULL) < 0) {
 	       Error3("ioctl(%d, 0x%x, NULL): %s",
 		      fd, opt->value.u_int, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case TYPE_INT_INT:
 	    if (Ioctl_int(fd, opt->value.u_int, opt->value2.u_int) < 0) {
 	       Error4("ioctl(%d, 0x%x, 0x%x): %s",
 		      fd, opt->value.u_int, opt->value2.u_int, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case TYPE_INT_INTP:
 	    if (Ioctl(fd, opt->value.u_int, (void *)&opt->value2.u_int) < 0) {
 	       Error4("ioctl(%d, 0x%x, %p): %s",
 		      fd, opt->value.u_int, (void *)&opt->value2.u_int, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case TYPE_INT_BIN:
 	    if (Ioctl(fd, opt->value.u_int, (void *)opt->value2.u_bin.b_data) < 0) {
 	       Error4("ioctl(%d, 0x%x, %p): %s",
 		      fd, opt->value.u_int, (void *)opt->value2.u_bin.b_data, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case TYPE_INT_STRING:
 	    if (Ioctl(fd, opt->value.u_int, (void *)opt->value2.u_string) < 0) {
 	       Error4("ioctl(%d, 0x%x, %p): %s",
 		      fd, opt->value.u_int, (void *)opt->value2.u_string, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 default:
@@ -3296,7 +3504,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       Error6("setsockopt(%d, %d, %d, {%d,%d}, "F_Zu,
 		      fd, opt->desc->major, opt->desc->minor, lingstru.l_onoff,
 		      lingstru.l_linger, sizeof(lingstru));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 #endif /* HAVE_STRUCT_LINGER */
 	 } else {
@@ -3309,7 +3517,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_bin.b_data, opt->value.u_bin.b_len,
 			 strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_BOOL:
@@ -3320,7 +3528,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 			 opt->desc->major, opt->desc->minor,
 			 opt->value.u_bool, sizeof(opt->value.u_bool),
 			 strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_BYTE:
@@ -3329,7 +3537,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 		  Error6("setsockopt(%d, %d, %d, {%u}, "F_Zu"): %s",
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_byte, sizeof(uint8_t), strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_INT:
@@ -3338,7 +3546,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 		  Error6("setsockopt(%d, %d, %d, {%d}, "F_Zu"): %s",
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_int, sizeof(int), strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_LONG:
@@ -3347,7 +3555,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 		  Error6("setsockopt(%d, %d, %d, {%ld}, "F_Zu"): %s",
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_long, sizeof(long), strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_STRING:
@@ -3358,7 +3566,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_string, strlen(opt->value.u_string)+1,
 			 strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_UINT:
@@ -3368,7 +3576,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_uint, sizeof(unsigned int),
 			 strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 	    case TYPE_TIMEVAL:
@@ -3378,7 +3586,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 			 fd, opt->desc->major, opt->desc->minor,
 			 opt->value.u_timeval.tv_sec, opt->value.u_timeval.tv_usec,
 			 sizeof(struct timeval), strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       break;
 #if HAVE_STRUCT_LINGER
@@ -3393,7 +3601,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 			    fd, opt->desc->major, opt->desc->minor,
 			    lingstru.l_onoff, lingstru.l_linger,
 			    strerror(errno));
-		     opt->desc = ODESC_ERROR; ++opt; continue;
+		     opt->desc = ODESC_ERROR; continue;
 		  }
 	       }
 	       break;
@@ -3401,7 +3609,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 #if defined(HAVE_STRUCT_IP_MREQ) || defined (HAVE_STRUCT_IP_MREQN)
 	    case TYPE_IP_MREQN:
 	       /* handled in applyopts_single */
-	       ++opt; continue;
+	       continue;
 #endif /* defined(HAVE_STRUCT_IP_MREQ) || defined (HAVE_STRUCT_IP_MREQN) */
 
 	       /*! still many types missing; implement on demand */
@@ -3424,7 +3632,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       Warn1("applyopts(): type %d not implemented",
 			    opt->desc->type);
 #endif
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	 }
 
@@ -3440,7 +3648,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       Error6("getsockopt(%d, %d, %d, %p, {"F_socklen"}): %s",
 		      fd, opt->desc->major, opt->desc->minor, data, oldlen,
 		      strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    memcpy(&data[oldlen], opt->value.u_bin.b_data,
 		   MIN(opt->value.u_bin.b_len, sizeof(data)-oldlen));
@@ -3451,7 +3659,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       Error6("setsockopt(%d, %d, %d, %p, %d): %s",
 		      fd, opt->desc->major, opt->desc->minor, data, newlen,
 		      strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 default:
@@ -3498,7 +3706,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	 if (Flock(fd, opt->desc->major) < 0) {
 	    Error3("flock(%d, %d): %s",
 		   fd, opt->desc->major, strerror(errno));
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 #endif /* defined(HAVE_FLOCK) */
 
@@ -3510,7 +3718,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Fchown(fd, opt->value.u_uidt, -1) < 0) {
 	       Error3("fchown(%d, "F_uid", -1): %s",
 		      fd, opt->value.u_uidt, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case OPT_GROUP:
@@ -3518,7 +3726,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Fchown(fd, -1, opt->value.u_gidt) < 0) {
 	       Error3("fchown(%d, -1, "F_gid"): %s",
 		      fd, opt->value.u_gidt, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case OPT_PERM:
@@ -3526,14 +3734,14 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Fchmod(fd, opt->value.u_modet) < 0) {
 	       Error3("fchmod(%d, %u): %s",
 		      fd, opt->value.u_modet, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case OPT_FTRUNCATE32:
 	    if (Ftruncate(fd, opt->value.u_off) < 0) {
 	       Error3("ftruncate(%d, "F_off"): %s",
 		      fd, opt->value.u_off, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 #if HAVE_FTRUNCATE64
@@ -3541,7 +3749,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Ftruncate64(fd, opt->value.u_off64) < 0) {
 	       Error3("ftruncate64(%d, "F_off64"): %s",
 		      fd, opt->value.u_off64, strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 #endif /* HAVE_FTRUNCATE64 */
 	    break; 
@@ -3558,7 +3766,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       l.l_pid    = 0;	/* hope this uses our current process */
 	       if (Fcntl_lock(fd, opt->desc->major, &l) < 0) {
 		  Error3("fcntl(%d, %d, {type=F_WRLCK,whence=SEEK_SET,start=0,len=LONG_MAX,pid=0}): %s", fd, opt->desc->major, strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	    }
 	    break; 
@@ -3567,7 +3775,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Setuid(opt->value.u_uidt) < 0) {
 	       Error2("setuid("F_uid"): %s", opt->value.u_uidt,
 		      strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case OPT_SETGID_EARLY:
@@ -3575,7 +3783,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Setgid(opt->value.u_gidt) < 0) {
 	       Error2("setgid("F_gid"): %s", opt->value.u_gidt,
 		      strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    break;
 	 case OPT_SUBSTUSER_EARLY:
@@ -3585,22 +3793,22 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       if ((pwd = getpwuid(opt->value.u_uidt)) == NULL) {
 		  Error1("getpwuid("F_uid"): no such user",
 			 opt->value.u_uidt);
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       if (Initgroups(pwd->pw_name, pwd->pw_gid) < 0) {
 		  Error3("initgroups(%s, "F_gid"): %s",
 			 pwd->pw_name, pwd->pw_gid, strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       if (Setgid(pwd->pw_gid) < 0) {
 		  Error2("setgid("F_gid"): %s", pwd->pw_gid,
 			 strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       if (Setuid(opt->value.u_uidt) < 0) {
 		  Error2("setuid("F_uid"): %s", opt->value.u_uidt,
 			 strerror(errno));
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 #if 1
 	       if (setenv("USER", pwd->pw_name, 1) < 0)
@@ -3626,24 +3834,24 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	       if ((pwd = getpwuid(opt->value.u_uidt)) == NULL) {
 		  Error1("getpwuid("F_uid"): no such user",
 			 opt->value.u_uidt);
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       delayeduser_uid = opt->value.u_uidt;
 	       delayeduser_gid = pwd->pw_gid;
 	       if ((delayeduser_name = strdup(pwd->pw_name)) == NULL) {
 		  Error1("strdup("F_Zu"): out of memory",
 			 strlen(pwd->pw_name)+1);
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       if ((delayeduser_dir = strdup(pwd->pw_dir)) == NULL) {
 		  Error1("strdup("F_Zu"): out of memory",
 			 strlen(pwd->pw_dir)+1);
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       if ((delayeduser_shell = strdup(pwd->pw_shell)) == NULL) {
 		  Error1("strdup("F_Zu"): out of memory",
 			 strlen(pwd->pw_shell)+1);
-		  opt->desc = ODESC_ERROR; ++opt; continue;
+		  opt->desc = ODESC_ERROR; continue;
 	       }
 	       /* function to get all supplementary groups of user */
 	       delayeduser_ngids = sizeof(delayeduser_gids)/sizeof(gid_t);
@@ -3658,7 +3866,7 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    if (Chroot(opt->value.u_string) < 0) {
 	       Error2("chroot(\"%s\"): %s", opt->value.u_string,
 		      strerror(errno));
-	       opt->desc = ODESC_ERROR; ++opt; continue;
+	       opt->desc = ODESC_ERROR; continue;
 	    }
 	    if (Chdir("/") < 0) {
 	       Error1("chdir(\"/\"): %s", strerror(errno));
@@ -3715,13 +3923,13 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 
 	 default: Error1("applyopts(): option \"%s\" not implemented",
 			 opt->desc->defname);
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
 #if WITH_TERMIOS
       } else if (opt->desc->func == OFUNC_TERMIOS_FLAG) {
 	 if (xiotermiosflag_applyopt(fd, opt) < 0) {
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
       } else if (opt->desc->func == OFUNC_TERMIOS_VALUE) {
@@ -3729,33 +3937,33 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	     (opt->value.u_uint << opt->desc->arg3)) {
 	    Error2("option %s: invalid value %u",
 		   opt->desc->defname, opt->value.u_uint);
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 	 if (xiotermios_value(fd, opt->desc->major, opt->desc->minor,
 			      (opt->value.u_uint << opt->desc->arg3) & opt->desc->minor) < 0) {
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
       } else if (opt->desc->func == OFUNC_TERMIOS_PATTERN) {
 	 if (xiotermios_value(fd, opt->desc->major,  opt->desc->arg3, opt->desc->minor) < 0) {
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
       } else if (opt->desc->func == OFUNC_TERMIOS_CHAR) {
 	 if (xiotermios_char(fd, opt->desc->major, opt->value.u_byte) < 0) {
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
 #ifdef HAVE_TERMIOS_ISPEED
       } else if (opt->desc->func == OFUNC_TERMIOS_SPEED) {
 	 if (xiotermios_speed(fd, opt->desc->major, opt->value.u_uint) < 0) {
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 #endif /* HAVE_TERMIOS_ISPEED */
 
       } else if (opt->desc->func == OFUNC_TERMIOS_SPEC) {
 	 if (xiotermios_spec(fd, opt->desc->optcode) < 0) {
-	    opt->desc = ODESC_ERROR; ++opt; continue;
+	    opt->desc = ODESC_ERROR; continue;
 	 }
 
 #endif /* WITH_TERMIOS */
@@ -3773,14 +3981,11 @@ int applyopts(int fd, struct opt *opts, enum e_phase phase) {
 	    Error1("applyopts(): option \"%s\" does not apply",
 		   opt->desc->defname);
 	    opt->desc = ODESC_ERROR;
-	    ++opt;
 	    continue;
 	 }
-	 ++opt;
 	 continue;
       }
       opt->desc = ODESC_DONE;
-      ++opt;
    }
 
 #if WITH_TERMIOS
@@ -3925,15 +4130,15 @@ int applyopts_offset(struct single *xfd, struct opt *opts) {
    returns -1 if an error occurred */
 int applyopts_single(struct single *xfd, struct opt *opts, enum e_phase phase) {
    struct opt *opt;
+   unsigned int k = 0;
    int lockrc;
 
    if (!opts)  return 0;
 
-   opt = opts; while (opt->desc != ODESC_END) {
-      if ((opt->desc == ODESC_DONE) ||
-	  (opt->desc->phase != phase && phase != PH_ALL)) {
+   while ((opt = xioopts_next(opts, phase, &k)) != NULL) {
+      if (opt->desc == ODESC_DONE) {
 	 /* option not handled in this function */
-	 ++opt; continue;
+	 continue;
       } else {
      switch (opt->desc->func) {
 
@@ -3958,6 +4163,15 @@ int applyopts_single(struct single *xfd, struct opt *opts, enum e_phase phase) {
 	 xfd->readbytes = opt->value.u_sizet;
 	 xfd->actbytes  = xfd->readbytes;
 	 break;
+      case OPT_FRAMING:
+	 if ((xfd->framing = xioframing_type(opt->value.u_string)) < 0) {
+	    Error1("option framing: unknown framing \"%s\"",
+		   opt->value.u_string);
+	    xfd->framing = XIOFRAMING_NONE;
+	    opt->desc = ODESC_ERROR;
+	    return -1;
+	 }
+	 break;
       case OPT_LOCKFILE:
 	 if (xfd->lock.lockfile) {
 	    Error("only one use of options lockfile and waitlock allowed");
@@ -3991,6 +4205,20 @@ int applyopts_single(struct single *xfd, struct opt *opts, enum e_phase phase) {
 	 }
 	 xfd->havelock = true;
 	 break;
+#if WITH_UDP && defined(UDP_SEGMENT)
+      case OPT_UDP_GSO:
+	 if (xioapply_udp_gso(xfd, opt) < 0) {
+	    return -1;
+	 }
+	 break;
+#endif /* WITH_UDP && defined(UDP_SEGMENT) */
+#if WITH_UDP && defined(UDP_GRO)
+      case OPT_UDP_GRO:
+	 if (xioapply_udp_gro(xfd, opt) < 0) {
+	    return -1;
+	 }
+	 break;
+#endif /* WITH_UDP && defined(UDP_GRO) */
 	 
       default:
 	 /* just store the value in the correct component of struct single */
@@ -4187,17 +4415,15 @@ mc:addr
 #endif /* WITH_IP6 && defined(HAVE_STRUCT_IPV6_MREQ) */
 	default:
 	   /* ignore here */
-	   ++opt; continue;
+	   continue;
 	}
 	break;
 #endif /* _WITH_SOCKET */
 
      default:
-	++opt;
 	continue;
      }
      opt->desc = ODESC_DONE;
-     ++opt;
       }
    }
    return 0;
@@ -4252,17 +4478,21 @@ int _xio_openlate(struct single *fd, struct opt *opts) {
 
 int dropopts(struct opt *opts, unsigned int phase) {
    struct opt *opt;
+   unsigned int k = 0;
 
+   if (opts == NULL)  return 0;
    if (phase == PH_ALL) {
-      opts[0].desc = ODESC_END;
+      /* keep the array and its plan consistent */
+      for (opt = opts; opt->desc != ODESC_END; ++opt) {
+	 opt->desc = ODESC_DONE;
+      }
       return 0;
    }
-   opt = opts; while (opt && opt->desc != ODESC_END) {
-      if (opt->desc != ODESC_DONE && opt->desc->phase == phase) {
+   while ((opt = xioopts_next(opts, phase, &k)) != NULL) {
+      if (opt->desc != ODESC_DONE) {
 	 Debug1("ignoring option \"%s\"", opt->desc->defname);
 	 opt->desc = ODESC_DONE;
       }
-      ++opt;
    }
    return 0;
 }
@@ -271,6 +271,10 @@ enum e_optcode {
    OPT_CSIZE,		/* termios.c_cflag */
    OPT_CSTOPB,		/* termios.c_cflag */
    OPT_DASH,		/* exec() */
+   OPT_DEMUX,		/* udp-listen, udp-recvfrom */
+   OPT_DEMUX_MAX,
+   OPT_DEMUX_TIMEOUT,
+   OPT_DGRAM_BATCH,	/* datagram sockets: recvmmsg(), sendmmsg() */
    OPT_ECHO,		/* termios.c_lflag */
    OPT_ECHOCTL,		/* termios.c_lflag */
    OPT_ECHOE,		/* termios.c_lflag */
@@ -304,6 +308,7 @@ enum e_optcode {
    /*0 OPT_FORCE,*/
    OPT_FOREVER,
    OPT_FORK,
+   OPT_FRAMING,		/* appl: records with length prefix */
    OPT_FS_APPEND,
    OPT_FS_COMPR,
    OPT_FS_DIRSYNC,
@@ -337,6 +342,7 @@ enum e_optcode {
    /*OPT_IFF_DYNAMIC,*/	/* struct ifreq.ifr_flags */
    OPT_IFF_LOOPBACK,	/* struct ifreq.ifr_flags */
    OPT_IFF_MASTER,	/* struct ifreq.ifr_flags */
+   OPT_IFF_MULTI_QUEUE,	/* tun: IFF_MULTI_QUEUE */
    OPT_IFF_MULTICAST,	/* struct ifreq.ifr_flags */
    OPT_IFF_NOARP,	/* struct ifreq.ifr_flags */
    OPT_IFF_NOTRAILERS,	/* struct ifreq.ifr_flags */
@@ -347,6 +353,7 @@ enum e_optcode {
    OPT_IFF_RUNNING,	/* struct ifreq.ifr_flags */
    OPT_IFF_SLAVE,	/* struct ifreq.ifr_flags */
    OPT_IFF_UP,		/* struct ifreq.ifr_flags */
+   OPT_IFF_VNET_HDR,	/* tun: IFF_VNET_HDR */
    OPT_IGNBRK,		/* termios.c_iflag */
    OPT_IGNCR,		/* termios.c_iflag */
    OPT_IGNORECR,	/* HTTP */
@@ -441,6 +448,7 @@ enum e_optcode {
    OPT_IXANY,		/* termios.c_iflag */
    OPT_IXOFF,		/* termios.c_iflag */
    OPT_IXON,		/* termios.c_iflag */
+   OPT_ACCEPT_BATCH,	/* listening socket */
    OPT_ACCEPT_TIMEOUT,	/* listening socket */
    OPT_LOCKFILE,
    OPT_LOWPORT,
@@ -485,11 +493,13 @@ enum e_optcode {
    OPT_OPENSSL_CAPATH,
    OPT_OPENSSL_CERTIFICATE,
    OPT_OPENSSL_CIPHERLIST,
+   OPT_OPENSSL_COALESCE,
    OPT_OPENSSL_COMMONNAME,
 #if OPENSSL_VERSION_NUMBER >= 0x00908000L
    OPT_OPENSSL_COMPRESS,
 #endif
    OPT_OPENSSL_DHPARAM,
+   OPT_OPENSSL_DYNAMIC_RECORDS,
    OPT_OPENSSL_EGD,
    OPT_OPENSSL_FIPS,
    OPT_OPENSSL_KEY,
@@ -498,7 +508,12 @@ enum e_optcode {
    OPT_OPENSSL_MIN_PROTO_VERSION,
    OPT_OPENSSL_NO_SNI,
    OPT_OPENSSL_PSEUDO,
+   OPT_OPENSSL_RECORD_IDLE,
+   OPT_OPENSSL_RECORD_MAX,
+   OPT_OPENSSL_RECORD_SIZE,
+   OPT_OPENSSL_RELOAD,
    OPT_OPENSSL_SNIHOST,
+   OPT_OPENSSL_SNITABLE,
    OPT_OPENSSL_VERIFY,
    OPT_OPOST,		/* termios.c_oflag */
    OPT_OSPEED,		/* termios.c_ospeed */
@@ -559,6 +574,13 @@ enum e_optcode {
    OPT_O_WRONLY,		/* open() */
    OPT_PARENB,		/* termios.c_cflag */
    OPT_PARMRK,		/* termios.c_iflag */
+   OPT_PACKET_BLOCKS,
+   OPT_PACKET_BLOCK_SIZE,
+   OPT_PACKET_FANOUT,
+   OPT_PACKET_FANOUT_GROUP,
+   OPT_PACKET_FRAME_SIZE,
+   OPT_PACKET_RX_RING,
+   OPT_PACKET_TX_RING,
    OPT_PARODD,		/* termios.c_cflag */
    OPT_PATH,
 #ifdef PENDIN
@@ -806,7 +828,10 @@ enum e_optcode {
    OPT_TOSTOP,		/* termios.c_lflag */
    OPT_TUN_DEVICE,	/* tun: /dev/net/tun ... */
    OPT_TUN_NAME,	/* tun: tun0 */
+   OPT_TUN_QUEUES,	/* tun: worker processes with a queue each */
    OPT_TUN_TYPE,	/* tun: tun|tap */
+   OPT_UDP_GRO,		/* udp: UDP_GRO */
+   OPT_UDP_GSO,		/* udp: UDP_SEGMENT */
    OPT_UMASK,
    OPT_UNIX_TIGHTSOCKLEN,	/* UNIX domain sockets */
    OPT_UNLINK,
@@ -848,6 +873,8 @@ enum e_optcode {
    OPT_VWERASE,		/* termios.c_cc */
 #endif
    OPT_WAITLOCK,
+   OPT_WORKERS,		/* udp: worker processes with SO_REUSEPORT */
+   OPT_WORKERS_BPF,	/* udp: SO_ATTACH_REUSEPORT_CBPF */
 #ifdef XCASE
    OPT_XCASE,		/* termios.c_lflag */
 #endif
@@ -954,7 +981,10 @@ extern int parseopts_table(const char **a, unsigned int groups,
 extern const struct opt *searchopt(const struct opt *opts, unsigned int groups, enum e_phase from, enum e_phase to,
 				   enum e_func func);
 extern struct opt *copyopts(const struct opt *opts, unsigned int groups);
+extern struct opt *recopyopts(struct opt *opts, const struct opt *opts0,
+			      unsigned int groups);
 extern struct opt *moveopts(struct opt *opts, unsigned int groups);
+extern void freeopts(struct opt *opts);
 extern int leftopts(const struct opt *opts);
 extern int showleft(const struct opt *opts);
 extern int groupbits(int fd);
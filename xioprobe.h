@@ -0,0 +1,30 @@
+/* source: xioprobe.h */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+#ifndef __xioprobe_h_included
+#define __xioprobe_h_included 1
+
+/* static tracepoints (USDT) of provider "socat", for use with bpftrace,
+   perf, or systemtap on running processes, e.g.:
+      bpftrace -e 'usdt:./socat:socat:transfer_write { @[arg2] = sum(arg1); }'
+   A probe site is a single nop instruction plus an ELF note; the arguments
+   are only evaluated into registers. Without <sys/sdt.h> the macros are
+   empty.
+   The number in the macro name is the number of arguments, like with the
+   Debug macros. The probes and their arguments are listed in doc/socat.yo,
+   section TRACEPOINTS. */
+
+#if WITH_PROBES
+#  define XIOPROBE(n)			DTRACE_PROBE(socat, n)
+#  define XIOPROBE1(n,a1)		DTRACE_PROBE1(socat, n, a1)
+#  define XIOPROBE2(n,a1,a2)		DTRACE_PROBE2(socat, n, a1, a2)
+#  define XIOPROBE3(n,a1,a2,a3)	DTRACE_PROBE3(socat, n, a1, a2, a3)
+#else /* !WITH_PROBES */
+#  define XIOPROBE(n)
+#  define XIOPROBE1(n,a1)
+#  define XIOPROBE2(n,a1,a2)
+#  define XIOPROBE3(n,a1,a2,a3)
+#endif /* !WITH_PROBES */
+
+#endif /* !defined(__xioprobe_h_included) */
@@ -11,17 +11,14 @@
 #include "xio-socket.h"
 #include "xio-readline.h"
 #include "xio-openssl.h"
+#include "xio-framing.h"
 
  
 /* xioread() performs read() or recvfrom()
    If result is < 0, errno is valid */
 ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
-   ssize_t bytes;
-#if WITH_IP6 && 0
-   int nexthead;
-#endif
    struct single *pipe;
-   int _errno;
+   ssize_t bytes;
 
    if (file->tag == XIO_TAG_INVALID) {
       Error1("xioread(): invalid xiofile descriptor %p", file);
@@ -51,6 +48,27 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       }
    }
 
+   if (pipe->framing != XIOFRAMING_NONE) {
+      /* one record per call, see xio-framing.c */
+      bytes = xioread_framing(pipe, buff, bufsiz);
+   } else {
+      bytes = _xioread(pipe, buff, bufsiz);
+   }
+   if (bytes > 0 && pipe->workers.index > 0) {
+      /* for the report of the worker process */
+      ++pipe->workers.packets;  pipe->workers.bytes += bytes;
+   }
+   return bytes;
+}
+
+/* reads from the (single) address without the framing layer */
+ssize_t _xioread(struct single *pipe, void *buff, size_t bufsiz) {
+   ssize_t bytes;
+#if WITH_IP6 && 0
+   int nexthead;
+#endif
+   int _errno;
+
    switch (pipe->dtype & XIODATA_READMASK) {
    case XIOREAD_STREAM:
       do {
@@ -119,7 +137,6 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       socklen_t fromlen = sizeof(from);
       char infobuff[256];
       char ctrlbuff[1024];	/* ancillary messages */
-      int rc;
 
       msgh.msg_name = &from;
       msgh.msg_namelen = fromlen;
@@ -130,29 +147,11 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       msgh.msg_controllen = sizeof(ctrlbuff);
 #endif
 
-      while ((rc = xiogetpacketsrc(pipe->fd, &msgh,
-			  MSG_PEEK
-#ifdef MSG_TRUNC
-			  |MSG_TRUNC
-#endif
-				   )) < 0 &&
-	     errno == EINTR) ;
-      if (rc < 0)  return -1;
-
-      do {
-	 bytes =
-	    Recvfrom(pipe->fd, buff, bufsiz, 0, &from.soa, &fromlen);
-      } while (bytes < 0 && errno == EINTR);
-      if (bytes < 0) {
-	 char infobuff[256];
-	 _errno = errno;
-	 Error6("recvfrom(%d, %p, "F_Zu", 0, %s, {"F_socklen"}): %s",
-		pipe->fd, buff, bufsiz,
-		sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)),
-		fromlen, strerror(errno));
-	 errno = _errno;
+      /* one system call per packet, or less with option dgram-batch */
+      if ((bytes = xiorecv_dgram(pipe, buff, bufsiz, &msgh)) < 0) {
 	 return -1;
       }
+      fromlen = msgh.msg_namelen;
       /* on packet type we also receive outgoing packets, this is not desired
        */
 #if defined(PF_PACKET) && defined(PACKET_OUTGOING)
@@ -164,9 +163,11 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       }
 #endif /* defined(PF_PACKET) && defined(PACKET_OUTGOING) */
 	    
-      Notice2("received packet with "F_Zu" bytes from %s",
-	      bytes,
-	      sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)));
+      if (diag_level(E_NOTICE)) {
+	 Notice2("received packet with "F_Zu" bytes from %s",
+		 bytes,
+		 sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)));
+      }
       if (bytes == 0) {
 	 if (!pipe->para.socket.null_eof) {
 	    errno = EAGAIN; return -1;
@@ -230,29 +231,10 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       }
 
       switch(from.soa.sa_family) {
-#if HAVE_STRUCT_IP
-	 int headlen;
-#endif /* HAVE_STRUCT_IP */
 #if WITH_IP4
       case AF_INET:
-#if HAVE_STRUCT_IP
-	 if (pipe->dtype & XIOREAD_RECV_SKIPIP) {
-	    /* IP4 raw sockets include the header when passing a packet to the
-	       application - we don't need it here. */
-#if HAVE_STRUCT_IP_IP_HL
-	    headlen = 4*((struct ip *)buff)->ip_hl;
-#else /* happened on Tru64 */
-	    headlen = 4*((struct ip *)buff)->ip_vhl;
-#endif
-	    if (headlen > bytes) {
-	       Warn1("xioread(%d, ...)/IP4: short packet", pipe->fd);
-	       bytes = 0;
-	    } else {
-	       memmove(buff, ((char *)buff)+headlen, bytes-headlen);
-	       bytes -= headlen;
-	    }
-	 }
-#endif /* HAVE_STRUCT_IP */
+	 /* IP4 raw sockets include the header when passing a packet to the
+	    application; xiorecv_dgram() already skipped it */
 	 break;
 #endif
 #if WITH_IP6
@@ -322,7 +304,6 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       char infobuff[256];
       struct msghdr msgh = {0};
       char ctrlbuff[1024];	/* ancillary messages */
-      int rc;
 
       socket_init(pipe->para.socket.la.soa.sa_family, &from);
       /* get source address */
@@ -334,41 +315,27 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
 #if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
       msgh.msg_controllen = sizeof(ctrlbuff);
 #endif
-      while ((rc = xiogetpacketsrc(pipe->fd, &msgh,
-			  MSG_PEEK
-#ifdef MSG_TRUNC
-			  |MSG_TRUNC
-#endif
-				   )) < 0 &&
-	     errno == EINTR) ;
-      if (rc < 0)  return -1;
+      /* read the packet in one go; ranges and source ports are checked on
+	 the received copy */
+      if ((bytes = xiorecv_dgram(pipe, buff, bufsiz, &msgh)) < 0) {
+	 return -1;
+      }
+      fromlen = msgh.msg_namelen;
 
       xiodopacketinfo(&msgh, true, false);
       if (xiocheckpeer(pipe, &from, &pipe->para.socket.la) < 0) {
-	 Recvfrom(pipe->fd, buff, bufsiz, 0, &from.soa, &fromlen);  /* drop */
-	 errno = EAGAIN;  return -1;
+	 errno = EAGAIN;  return -1;	/* drop packet */
       }
-      Info1("permitting packet from %s",
-	    sockaddr_info((struct sockaddr *)&from, fromlen,
-			  infobuff, sizeof(infobuff)));
-
-      do {
-	 bytes =
-	    Recvfrom(pipe->fd, buff, bufsiz, 0, &from.soa, &fromlen);
-      } while (bytes < 0 && errno == EINTR);
-      if (bytes < 0) {
-	 char infobuff[256];
-	 _errno = errno;
-	 Error6("recvfrom(%d, %p, "F_Zu", 0, %s, "F_socklen"): %s",
-		pipe->fd, buff, bufsiz,
-		sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)),
-		fromlen, strerror(errno));
-	 errno = _errno;
-	 return -1;
+      if (diag_level(E_INFO)) {
+	 Info1("permitting packet from %s",
+	       sockaddr_info((struct sockaddr *)&from, fromlen,
+			     infobuff, sizeof(infobuff)));
+      }
+      if (diag_level(E_NOTICE)) {
+	 Notice2("received packet with "F_Zu" bytes from %s",
+		 bytes,
+		 sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)));
       }
-      Notice2("received packet with "F_Zu" bytes from %s",
-	      bytes,
-	      sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)));
       if (bytes == 0) {
 	 if (!pipe->para.socket.null_eof) {
 	    errno = EAGAIN; return -1;
@@ -377,29 +344,10 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       }
 
       switch(from.soa.sa_family) {
-#if HAVE_STRUCT_IP
-	 int headlen;
-#endif /* HAVE_STRUCT_IP */
 #if WITH_IP4
       case AF_INET:
-#if HAVE_STRUCT_IP
-	 if (pipe->dtype & XIOREAD_RECV_SKIPIP) {
-	    /* IP4 raw sockets include the header when passing a packet to the
-	       application - we don't need it here. */
-#if HAVE_STRUCT_IP_IP_HL
-	    headlen = 4*((struct ip *)buff)->ip_hl;
-#else /* happened on Tru64 */
-	    headlen = 4*((struct ip *)buff)->ip_vhl;
-#endif
-	    if (headlen > bytes) {
-	       Warn1("xioread(%d, ...)/IP4: short packet", pipe->fd);
-	       bytes = 0;
-	    } else {
-	       memmove(buff, ((char *)buff)+headlen, bytes-headlen);
-	       bytes -= headlen;
-	    }
-	 }
-#endif /* HAVE_STRUCT_IP */
+	 /* IP4 raw sockets include the header when passing a packet to the
+	    application; xiorecv_dgram() already skipped it */
 	 break;
 #endif
 #if WITH_IP6
@@ -426,7 +374,8 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
 
 /* this function is intended only for some special address types where the
    select()/poll() calls cannot strictly determine if (more) read data is
-   available. currently this is for the OpenSSL based addresses.
+   available. currently this is for the OpenSSL based addresses, for
+   datagram sockets with option dgram-batch, and for option framing.
 */
 ssize_t xiopending(xiofile_t *file) {
    struct single *pipe;
@@ -448,11 +397,18 @@ ssize_t xiopending(xiofile_t *file) {
       pipe = &file->stream;
    }
 
+   if (pipe->frame != NULL && xiopending_framing(pipe) > 0) {
+      return 1;
+   }
    switch (pipe->dtype & XIODATA_READMASK) {
 #if WITH_OPENSSL
    case XIOREAD_OPENSSL:
       return xiopending_openssl(pipe);
 #endif /* WITH_OPENSSL */
+#if _WITH_SOCKET
+   case XIOREAD_RECV:
+      return xiopending_dgram(pipe);
+#endif /* _WITH_SOCKET */
    default:
       return 0;
    }
@@ -41,6 +41,12 @@ int xioshutdown(xiofile_t *sock, int how) {
       return result;
    }
 
+   XIOPROBE2(shutdown, sock->stream.fd, how);
+   if ((how+1)&2) {
+      /* write out what the address still holds back, e.g. queued datagrams */
+      xioflush(sock);
+   }
+
    switch (sock->stream.howtoshut) {
       char writenull;
    case XIOSHUT_NONE:
@@ -61,6 +67,7 @@ int xioshutdown(xiofile_t *sock, int how) {
    case XIOSHUT_NULL:
       /* send an empty packet; only useful on datagram sockets? */
       xiowrite(sock, &writenull, 0);
+      xioflush(sock);
       return 0;
 #endif /* _WITH_SOCKET */
    default: ;
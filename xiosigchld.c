@@ -14,6 +14,36 @@ pid_t diedunknown[NUMUNKNOWN];	/* children that died before they were registered
 int   statunknown[NUMUNKNOWN]; 	/* exit state of unknown dead child */
 size_t nextunknown;
 
+/* the live child processes of this process, registered by xio_fork() */
+struct xiochild {
+   pid_t pid;
+   struct timeval born;
+} ;
+static struct xiochild *xiochildren;
+static int xiochildcap;		/* allocated entries */
+/* num_child is the number of used entries */
+
+struct xiochildstat xiochildstat;
+
+/* with supervision by signalfd: SIGCHLD is blocked and can be read from this
+   file descriptor */
+int xiochildfd = -1;
+
+/* when not NULL, called with each reaped child, e.g. by the recvfrom loop that
+   waits for its sub process to consume a packet */
+void (*xiochild_hook)(pid_t pid, int status);
+
+/* children that the SIGCHLD handler reaped; xiochild_collect() does their
+   bookkeeping outside of the handler */
+#define XIOCHILD_DEAD 64
+static struct {
+   pid_t pid;
+   int status;
+} xiochild_dead[XIOCHILD_DEAD];
+static volatile sig_atomic_t xiochild_ndead;	/* used entries */
+static volatile sig_atomic_t xiochild_overflow;	/* handler left children
+						   unreaped */
+
 
 /* register for a xio filedescriptor a callback (handler).
    when a SIGCHLD occurs, the signal handler will ??? */
@@ -62,19 +92,184 @@ static int xio_checkchild(xiofile_t *socket, int socknum, pid_t deadchild) {
    return 0;
 }
 
+/* registers a new child process in the table of live children.
+   returns 0 on success, or -1 when the table could not grow */
+int xiochild_register(pid_t pid) {
+   struct xiochild *child;
+
+   /* frees the entries of children that the SIGCHLD handler reaped */
+   xiochild_collect();
+   if (num_child >= xiochildcap) {
+      int cap = xiochildcap ? 2*xiochildcap : 16;
+      struct xiochild *table;
+      if ((table = Realloc(xiochildren, cap*sizeof(struct xiochild))) == NULL) {
+	 return -1;
+      }
+      xiochildren = table;
+      xiochildcap = cap;
+   }
+   child = &xiochildren[num_child++];
+   child->pid = pid;
+   Gettimeofday(&child->born, NULL);
+   ++xiochildstat.forked;
+   return 0;
+}
+
+/* removes the child from the table and returns its lifetime in *life.
+   returns 0 on success or -1 when the child was not registered */
+static int xiochild_unregister(pid_t pid, struct timeval *life) {
+   int i;
+
+   for (i = 0; i < num_child; ++i) {
+      if (xiochildren[i].pid == pid)  break;
+   }
+   if (i == num_child) {
+      return -1;
+   }
+   Gettimeofday(life, NULL);
+   life->tv_sec  -= xiochildren[i].born.tv_sec;
+   life->tv_usec -= xiochildren[i].born.tv_usec;
+   if (life->tv_usec < 0) {
+      --life->tv_sec;  life->tv_usec += 1000000;
+   }
+   xiochildren[i] = xiochildren[--num_child];
+   return 0;
+}
+
+/* bookkeeping in the table of live children and in xiochildstat for a
+   terminated child process; not in signal handlers */
+static void xiochild_account(pid_t pid, int status) {
+   struct timeval life = { 0, 0 };
+
+   if (xiochild_unregister(pid, &life) == 0) {
+      xiochildstat.lifetime.tv_sec  += life.tv_sec;
+      xiochildstat.lifetime.tv_usec += life.tv_usec;
+      if (xiochildstat.lifetime.tv_usec >= 1000000) {
+	 ++xiochildstat.lifetime.tv_sec;
+	 xiochildstat.lifetime.tv_usec -= 1000000;
+      }
+      if (life.tv_sec > xiochildstat.maxlifetime.tv_sec ||
+	  life.tv_sec == xiochildstat.maxlifetime.tv_sec &&
+	  life.tv_usec > xiochildstat.maxlifetime.tv_usec) {
+	 xiochildstat.maxlifetime = life;
+      }
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+	 ++xiochildstat.exited;
+      } else {
+	 ++xiochildstat.failed;
+      }
+      xiochildstat.laststatus = status;
+      Info4("child "F_pid" lived "F_tv_sec".%06ds, %d children left",
+	    pid, life.tv_sec, (int)life.tv_usec, num_child);
+   }
+   if (xiochild_hook != NULL) {
+      (*xiochild_hook)(pid, status);
+   }
+}
+
+/* callbacks of exec addresses and messages for a terminated child process;
+   is called in the SIGCHLD handler */
+static void xiochild_died(pid_t pid, int status) {
+   int i;
+
+   XIOPROBE2(child_exit, pid, status);
+   /* check if it was a registered child process */
+   i = 0;
+   while (i < XIO_MAXSOCK) {
+      if (xio_checkchild(sock[i], i, pid))  break;
+      ++i;
+   }
+   if (i == XIO_MAXSOCK) {
+      Info1("childdied(): cannot identify child %d", pid);
+      if (nextunknown == NUMUNKNOWN) {
+	 nextunknown = 0;
+      }
+      diedunknown[nextunknown] = pid;
+      statunknown[nextunknown++] = WEXITSTATUS(status);
+      Debug1("saving pid in diedunknown"F_Zu,
+	     nextunknown/*sic, for compatibility*/);
+   }
+
+   if (WIFEXITED(status)) {
+      if (WEXITSTATUS(status) == 0) {
+	 Info2("waitpid(): child %d exited with status %d",
+	       pid, WEXITSTATUS(status));
+      } else {
+	 if (i == XIO_MAXSOCK) {
+	    Info2("waitpid(): child %d exited with status %d",
+		   pid, WEXITSTATUS(status));
+	 } else {
+	    Error2("waitpid(): child %d exited with status %d",
+		   pid, WEXITSTATUS(status));
+	 }
+      }
+   } else if (WIFSIGNALED(status)) {
+      if (i == XIO_MAXSOCK) {
+	 Info2("waitpid(): child %d exited on signal %d",
+	       pid, WTERMSIG(status));
+      } else {
+	 Error2("waitpid(): child %d exited on signal %d",
+	       pid, WTERMSIG(status));
+      }
+   } else if (WIFSTOPPED(status)) {
+      Info2("waitpid(): child %d stopped on signal %d",
+	    pid, WSTOPSIG(status));
+   } else {
+      Warn1("waitpid(): cannot determine status of child %d", pid);
+   }
+}
+
+/* all that is to do for a child process that was reaped outside of the
+   SIGCHLD handler */
+static void xiochild_reaped(pid_t pid, int status) {
+   xiochild_died(pid, status);
+   xiochild_account(pid, status);
+}
+
+/* does the bookkeeping for the children that the SIGCHLD handler reaped, and
+   reaps those that it left when its list was full. call outside of signal
+   handlers, e.g. before reading num_child.
+   returns the number of children */
+int xiochild_collect(void) {
+   sigset_t mask, oldmask;
+   pid_t pid;
+   int status;
+   int i, n;
+
+   if (xiochild_ndead == 0 && !xiochild_overflow)  return 0;
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask, &oldmask);
+   n = xiochild_ndead;
+   for (i = 0; i < n; ++i) {
+      xiochild_account(xiochild_dead[i].pid, xiochild_dead[i].status);
+   }
+   xiochild_ndead = 0;
+   if (xiochild_overflow) {
+      xiochild_overflow = 0;
+      while ((pid = Waitpid(-1, &status, WNOHANG)) > 0) {
+	 xiochild_reaped(pid, status);
+	 ++n;
+      }
+   }
+   Sigprocmask(SIG_SETMASK, &oldmask, NULL);
+   return n;
+}
+
 /* this is the "physical" signal handler for SIGCHLD */
 /* the current socat/xio implementation knows two kinds of children:
    exec/system addresses perform a fork: these children are registered and
    there death influences the parents flow;
    listen-socket with fork children: these children are "anonymous" and their
-   death does not affect the parent process (now; maybe we have a child
-   process counter later) */
+   death does not affect the parent process; they are only removed from the
+   table of live children.
+   the handler only reaps and notes the children; xiochild_collect() updates
+   the table later */
 void childdied(int signum) {
    pid_t pid;
    int _errno;
    int status = 0;
    bool wassig = false;
-   int i;
 
    _errno = errno;	/* save current value; e.g., select() on Cygwin seems
 			   to set it to EINTR _before_ handling the signal, and
@@ -84,6 +279,11 @@ void childdied(int signum) {
    Notice1("childdied(): handling signal %d", signum);
    Info1("childdied(signum=%d)", signum);
    do {
+      if (xiochild_ndead >= XIOCHILD_DEAD) {
+	 /* xiochild_collect() reaps the others */
+	 xiochild_overflow = 1;
+	 break;
+      }
       pid = Waitpid(-1, &status, WNOHANG);
       if (pid == 0) {
 	 Msg(wassig?E_INFO:E_WARN,
@@ -108,52 +308,10 @@ void childdied(int signum) {
 	 errno = _errno;
 	 return;
       }
-   /*! indent */
-   if (num_child) num_child--;
-   /* check if it was a registered child process */
-   i = 0;
-   while (i < XIO_MAXSOCK) {
-      if (xio_checkchild(sock[i], i, pid))  break;
-      ++i;
-   }
-   if (i == XIO_MAXSOCK) {
-	 Info2("childdied(%d): cannot identify child %d", signum, pid);
-	 if (nextunknown == NUMUNKNOWN) {
-	    nextunknown = 0;
-	 }
-	 diedunknown[nextunknown] = pid;
-	 statunknown[nextunknown++] = WEXITSTATUS(status);
-	 Debug1("saving pid in diedunknown"F_Zu,
-		nextunknown/*sic, for compatibility*/);
-      }
-
-   if (WIFEXITED(status)) {
-      if (WEXITSTATUS(status) == 0) {
-	 Info2("waitpid(): child %d exited with status %d",
-	       pid, WEXITSTATUS(status));
-      } else {
-	 if (i == XIO_MAXSOCK) {
-	    Info2("waitpid(): child %d exited with status %d",
-		   pid, WEXITSTATUS(status));
-	 } else {
-	    Error2("waitpid(): child %d exited with status %d",
-		   pid, WEXITSTATUS(status));
-	 }
-      }
-   } else if (WIFSIGNALED(status)) {
-      if (i == XIO_MAXSOCK) {
-	 Info2("waitpid(): child %d exited on signal %d",
-	       pid, WTERMSIG(status));
-      } else {
-	 Error2("waitpid(): child %d exited on signal %d",
-	       pid, WTERMSIG(status));
-      }
-   } else if (WIFSTOPPED(status)) {
-      Info2("waitpid(): child %d stopped on signal %d",
-	    pid, WSTOPSIG(status));
-   } else {
-      Warn1("waitpid(): cannot determine status of child %d", pid);
-   }
+      xiochild_died(pid, status);
+      xiochild_dead[xiochild_ndead].pid = pid;
+      xiochild_dead[xiochild_ndead].status = status;
+      ++xiochild_ndead;
 
 #if !HAVE_SIGACTION
    /* we might need to re-register our handler */
@@ -190,3 +348,291 @@ int xiosetchilddied(void) {
 #endif /* !HAVE_SIGACTION */
    return 0;
 }
+
+
+/* lets the process supervise its children synchronously: SIGCHLD is blocked
+   and read from a signalfd that xiochild_wait() polls, so terminated children
+   are reaped without signal handler and EINTR.
+   returns the file descriptor, or -1 when the system does not support it; the
+   caller should use xiosetchilddied() then */
+int xiosetchildfd(void) {
+#if HAVE_SYS_SIGNALFD_H
+   sigset_t mask;
+
+   if (xiochildfd >= 0)  return xiochildfd;
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask, NULL);
+   /* SIG_IGN would reap children automatically */
+   Signal(SIGCHLD, SIG_DFL);
+   if ((xiochildfd = signalfd(-1, &mask, SFD_NONBLOCK|SFD_CLOEXEC)) < 0) {
+      Info1("signalfd(-1, {SIGCHLD}, SFD_NONBLOCK|SFD_CLOEXEC): %s",
+	    strerror(errno));
+      Sigprocmask(SIG_UNBLOCK, &mask, NULL);
+      return -1;
+   }
+   Info1("supervising child processes with signalfd %d", xiochildfd);
+   return xiochildfd;
+#else /* !HAVE_SYS_SIGNALFD_H */
+   return -1;
+#endif /* !HAVE_SYS_SIGNALFD_H */
+}
+
+/* reaps all terminated children after SIGCHLD became readable on xiochildfd.
+   returns the number of reaped children */
+int xiochild_reap(void) {
+   int n = 0;
+#if HAVE_SYS_SIGNALFD_H
+   struct signalfd_siginfo info;
+   pid_t pid;
+   int status;
+
+   /* the kernel merges pending SIGCHLDs, so waitpid() until no more */
+   while (read(xiochildfd, &info, sizeof(info)) == sizeof(info)) ;
+   while ((pid = Waitpid(-1, &status, WNOHANG)) > 0) {
+      xiochild_reaped(pid, status);
+      ++n;
+   }
+   if (pid < 0 && errno != ECHILD) {
+      Warn1("waitpid(-1, {}, WNOHANG): %s", strerror(errno));
+   }
+#endif /* HAVE_SYS_SIGNALFD_H */
+   return n;
+}
+
+/* without signalfd: collects the children that the SIGCHLD handler reaped,
+   or waits ms milliseconds (-1: forever) for fd and for SIGCHLD. SIGCHLD stays
+   blocked from the check until pselect() waits, so no child is missed.
+   returns 2 when children were collected, 1 when fd is readable, 0 on timeout,
+   or -1 on error */
+static int xiochild_sigwait(int fd, int ms) {
+   sigset_t mask, oldmask;
+   int result, _errno;
+#if HAVE_PSELECT
+   struct timespec ts;
+   fd_set rfds;
+#else
+   struct pollfd pfd;
+#endif
+
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask, &oldmask);
+   if (xiochild_collect() > 0) {
+      Sigprocmask(SIG_SETMASK, &oldmask, NULL);
+      return 2;
+   }
+#if HAVE_PSELECT
+   FD_ZERO(&rfds);
+   if (fd >= 0)  FD_SET(fd, &rfds);
+   ts.tv_sec  = ms/1000;
+   ts.tv_nsec = (ms%1000)*1000000;
+   result = Pselect(fd+1, fd>=0?&rfds:NULL, NULL, NULL, ms<0?NULL:&ts,
+		    &oldmask);
+   _errno = errno;
+   Sigprocmask(SIG_SETMASK, &oldmask, NULL);
+#else
+   /* a SIGCHLD between the check and poll() is seen with the next one */
+   Sigprocmask(SIG_SETMASK, &oldmask, NULL);
+   pfd.fd = fd;  pfd.events = POLLIN;
+   result = Poll(&pfd, fd>=0?1:0, ms);
+   _errno = errno;
+#endif
+   errno = _errno;
+   return result>0 ? 1 : result;
+}
+
+/* waits until fd becomes readable and reaps terminated children meanwhile.
+   with fd < 0 it returns as soon as children have been reaped.
+   timeout may be NULL for no timeout.
+   returns 1 when fd is readable (or children were reaped), 0 on timeout, or
+   -1 on error */
+int xiochild_wait(int fd, const struct timeval *timeout) {
+   struct pollfd pfd[2];
+   struct timeval end, now;
+   int ms = -1;
+   int n, result;
+
+   if (timeout != NULL) {
+      Gettimeofday(&end, NULL);
+      end.tv_sec  += timeout->tv_sec;
+      end.tv_usec += timeout->tv_usec;
+      if (end.tv_usec >= 1000000) {
+	 ++end.tv_sec;  end.tv_usec -= 1000000;
+      }
+   }
+   while (true) {
+      n = 0;
+      if (fd >= 0) {
+	 pfd[n].fd = fd;  pfd[n].events = POLLIN;  ++n;
+      }
+      if (xiochildfd >= 0) {
+	 pfd[n].fd = xiochildfd;  pfd[n].events = POLLIN;  ++n;
+      }
+      if (timeout != NULL) {
+	 Gettimeofday(&now, NULL);
+	 ms = (end.tv_sec-now.tv_sec)*1000 + (end.tv_usec-now.tv_usec)/1000;
+	 if (ms < 0)  ms = 0;
+      }
+      if (xiochildfd < 0) {
+	 result = xiochild_sigwait(fd, ms);
+	 if (result < 0) {
+	    if (errno != EINTR)  return -1;
+	    continue;	/* collects in the next round */
+	 }
+	 if (result == 2 && fd >= 0)  continue;
+	 return result>0 ? 1 : 0;
+      }
+      result = Poll(pfd, n, ms);
+      if (result < 0) {
+	 if (errno != EINTR)  return -1;
+	 continue;
+      }
+      if (result == 0)  return 0;
+      if (xiochildfd >= 0 && pfd[n-1].revents != 0) {
+	 if (xiochild_reap() > 0 && fd < 0)  return 1;
+      }
+      if (fd >= 0 && pfd[0].revents != 0)  return 1;
+   }
+}
+
+/* call in a new child process: it has no children yet, and leaves supervision
+   by signalfd to its parent */
+void xiochild_forked(void) {
+   free(xiochildren);
+   xiochildren = NULL;
+   xiochildcap = 0;
+   num_child = 0;
+   xiochild_hook = NULL;
+   if (xiochildfd >= 0) {
+      sigset_t mask;
+
+      Close(xiochildfd);
+      xiochildfd = -1;
+      sigemptyset(&mask);
+      sigaddset(&mask, SIGCHLD);
+      Sigprocmask(SIG_UNBLOCK, &mask, NULL);
+   }
+}
+
+
+/* worker processes (options workers, tun-queues): the original process forks
+   num workers that each open their part of the address, and then only
+   supervises them */
+
+static pid_t *xioworker_pids;		/* in the supervisor */
+static int xioworker_num;
+static struct single *xioworker_sfd;	/* in a worker, for its report */
+static pid_t xioworker_pid;
+
+/* atexit handler of the supervisor: the workers do not outlive it */
+static void xioworkers_kill(void) {
+   int status;
+   int i;
+
+   for (i = 0; i < xioworker_num; ++i) {
+      if (xioworker_pids[i] > 0 &&
+	  Waitpid(xioworker_pids[i], &status, WNOHANG) == 0) {
+	 Info1("terminating worker process "F_pid, xioworker_pids[i]);
+	 Kill(xioworker_pids[i], SIGTERM);
+      }
+   }
+}
+
+/* atexit handler of a worker; not of the sub processes it forks */
+static void xioworker_report(void) {
+   struct single *sfd = xioworker_sfd;
+
+   if (sfd == NULL || Getpid() != xioworker_pid)  return;
+   if (xiochildstat.forked > 0) {
+      Notice3("worker %d: served %lu peers in sub processes (%lu failed)",
+	      sfd->workers.index, xiochildstat.forked, xiochildstat.failed);
+   } else {
+      Notice3("worker %d: received %lu packets with %llu bytes",
+	      sfd->workers.index, sfd->workers.packets, sfd->workers.bytes);
+   }
+}
+
+/* forks num workers one after the other, each after the previous one has
+   called xioworker_ready() or has terminated. the workers return STAT_OK
+   and continue the open of sfd. the supervisor closes the file descriptor of
+   sfd if it has one already, waits until all workers have terminated, and
+   then exits; it does not return except on error */
+int xioworkers_start(struct single *sfd, int num) {
+   struct timeval interval = { 1, 0 };
+   int syncfds[2];
+   char syncbuf[1];
+   pid_t pid;
+   int i;
+
+   if ((xioworker_pids = Calloc(num, sizeof(pid_t))) == NULL) {
+      return STAT_RETRYLATER;
+   }
+   xioworker_num = num;
+   if (xiosetchildfd() < 0) {
+      xiosetchilddied();	/* set SIGCHLD handler */
+   }
+   if (atexit(xioworkers_kill) != 0) {
+      Warn("atexit(xioworkers_kill) failed");
+   }
+
+   for (i = 1; i <= num; ++i) {
+      if (Pipe(syncfds) < 0) {
+	 Error1("pipe(): %s", strerror(errno));
+	 return STAT_RETRYLATER;
+      }
+      if ((pid = xio_fork(false, E_ERROR)) < 0) {
+	 Close(syncfds[0]);  Close(syncfds[1]);
+	 return STAT_RETRYLATER;
+      }
+      if (pid == 0) {	/* worker */
+	 Close(syncfds[0]);
+	 free(xioworker_pids);
+	 xioworker_pids = NULL;  xioworker_num = 0;
+	 sfd->workers.num    = num;
+	 sfd->workers.index  = i;
+	 sfd->workers.syncfd = syncfds[1];
+	 xioworker_sfd    = sfd;
+	 xioworker_pid    = Getpid();
+	 /* count only the sub processes of this worker */
+	 memset(&xiochildstat, 0, sizeof(xiochildstat));
+	 xiosetenvulong("WORKER", i, 1);
+	 if (atexit(xioworker_report) != 0) {
+	    Warn("atexit(xioworker_report) failed");
+	 }
+	 Info2("worker %d of %d", i, num);
+	 return STAT_OK;
+      }
+      /* supervisor */
+      xioworker_pids[i-1] = pid;
+      Close(syncfds[1]);
+      /* EOF when the worker is ready or has terminated */
+      while (Read(syncfds[0], syncbuf, sizeof(syncbuf)) < 0 &&
+	     errno == EINTR) ;
+      Close(syncfds[0]);
+   }
+   Notice1("started %d worker processes", num);
+   if (sfd->fd >= 0) {
+      Close(sfd->fd);
+      sfd->fd = -1;
+   }
+
+   while (num_child > 0) {
+      if (xiochild_wait(-1, &interval) < 0) {
+	 Warn1("poll(): %s", strerror(errno));
+      }
+   }
+   Notice1("all workers terminated, %lu of them with error",
+	   xiochildstat.failed);
+   Exit(xiochildstat.failed ? 1 : 0);
+   return STAT_NORETRY;	/* not reached */
+}
+
+/* call in a worker when it has opened its part of the address, e.g. has
+   bound its socket: lets the supervisor fork the next worker */
+int xioworker_ready(struct single *sfd) {
+   if (sfd->workers.index <= 0 || sfd->workers.syncfd < 0)  return 0;
+   Close(sfd->workers.syncfd);
+   sfd->workers.syncfd = -1;
+   return 0;
+}
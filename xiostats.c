@@ -0,0 +1,914 @@
+/* source: xiostats.c */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* this file contains the statistics endpoint (option -S), the latency
+   histograms (option -H), and the connection summary records (option -C).
+   The counters of each connection are kept in a table in shared memory, so
+   the children of a forking listener report there. A thread of the master
+   process answers each client of a UNIX domain socket with the table in
+   Prometheus text format or as JSON. The data path only increments counters
+   in memory. */
+
+#include "xiosysincludes.h"
+
+#include "compat.h"
+#include "mytypes.h"
+#include "error.h"
+#include "utils.h"
+#include "sysutils.h"
+#include "sycls.h"
+#include "vsnprintf_r.h"
+
+#include "xio.h"
+#include "xiostats.h"
+
+
+static struct xiostats_conn xiostats_own;	/* without or before a slot */
+struct xiostats_conn *xiostats_cur = &xiostats_own;
+
+#if WITH_STATS
+
+#define XIOSTATS_SLOTS 1024	/* connections that are listed one by one */
+
+struct xiostats_table {
+   struct timespec started;	/* CLOCK_MONOTONIC */
+   unsigned long long opened;	/* connections */
+   unsigned long long closed;	/* connections whose counters are in sum */
+   struct xiostats_conn sum;
+   struct xiostats_conn slot[XIOSTATS_SLOTS];
+   struct xiohist hist[XIOSTATS_SERIES];	/* of all connections */
+} ;
+
+/* a growing text buffer of the server thread */
+struct xiostats_text {
+   char *buff;
+   size_t len;
+   size_t size;
+} ;
+
+static struct xiostats_table *xiostats_table;
+static int xiostats_fd = -1;	/* the listening socket */
+static const char *xiostats_path;
+static pid_t xiostats_owner;	/* the process that removes the socket */
+static bool xiostats_dumping;	/* option -H */
+static struct xiohist xiostats_hist[XIOSTATS_SERIES];	/* of this process */
+static struct timespec xiostats_polltime;
+static int xiostats_sumfd = -1;	/* the file of the summary records */
+static const char *xiostats_addr[2];	/* the address specifications */
+static const char *xiostats_why;	/* why the connection ended */
+static int xiostats_status = -1;	/* exit status, or -1 when unknown */
+static unsigned char xiostats_eofs;	/* directions at EOF */
+
+static const char *xiostats_phasenames[XIOSTATS_SERIES] = {
+   "resolve", "connect", "socks4", "socks5_select", "socks5_auth",
+   "socks5_connect", "proxy", "tls", "fork", "relay"
+} ;
+static const char *xiostats_dirnames[2] = {
+   "left_to_right", "right_to_left"
+} ;
+
+
+static double xiostats_since(const struct timespec *t0,
+			     const struct timespec *now) {
+   return (now->tv_sec - t0->tv_sec) + (now->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/* the histogram of this process is only written by this process; the one in
+   the table is updated with atomic operations instead of a lock */
+static void xiostats_record(int series, unsigned long long ns) {
+   unsigned int i = xiohist_bucket(ns);
+   struct xiohist *h = &xiostats_hist[series];
+
+   ++h->n;  h->sum += ns;  ++h->count[i];
+   h = &xiostats_table->hist[series];
+   __sync_fetch_and_add(&h->n, 1);
+   __sync_fetch_and_add(&h->sum, ns);
+   __sync_fetch_and_add(&h->count[i], 1);
+}
+
+static unsigned long long xiostats_ns(const struct timespec *t0,
+				      const struct timespec *now) {
+   return (now->tv_sec - t0->tv_sec) * 1000000000ULL +
+      now->tv_nsec - t0->tv_nsec;
+}
+
+void xiostats_begin(struct timespec *t0) {
+   if (xiostats_table == NULL)  return;
+   clock_gettime(CLOCK_MONOTONIC, t0);
+}
+
+void xiostats_end(enum xiostats_phase phase, const struct timespec *t0) {
+   struct timespec now;
+   unsigned long long ns;
+
+   if (xiostats_table == NULL)  return;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   ns = xiostats_ns(t0, &now);
+   xiostats_cur->phase_ns[phase] += ns;
+   ++xiostats_cur->phase_n[phase];
+   xiostats_record(phase, ns);
+}
+
+/* call this when poll() returned; the relay delay of data that is written
+   until the next poll() is measured from here */
+void xiostats_polled(void) {
+   if (xiostats_table == NULL)  return;
+   clock_gettime(CLOCK_MONOTONIC, &xiostats_polltime);
+   ++xiostats_cur->polls;
+}
+
+/* call this when data has been written */
+void xiostats_relayed(void) {
+   struct timespec now;
+
+   if (xiostats_table == NULL)  return;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   xiostats_record(XIOSTATS_RELAY, xiostats_ns(&xiostats_polltime, &now));
+}
+
+/* async-signal-safe when called with diag_in_handler set */
+static void xiostats_hist_log(const char *name, const struct xiohist *h) {
+   char text[400];
+   size_t len = 0;
+   unsigned int i, max = 0;
+
+   for (i = 0; i < XIOHIST_BUCKETS; ++i) {
+      if (h->count[i] == 0)  continue;
+      max = i;
+      len += snprintf_r(text+len, sizeof(text)-len, " %llu:%lu",
+			xiohist_upper(i), h->count[i]);
+      if (len > sizeof(text)-48) {
+	 Info2("latency %s buckets (ns:count):%s", name, text);
+	 len = 0;
+      }
+   }
+   if (len > 0) {
+      Info2("latency %s buckets (ns:count):%s", name, text);
+   }
+   Notice8("latency %s: n=%llu mean=%lluns p50=%lluns p90=%lluns p99=%lluns p99.9=%lluns max=%lluns",
+	   name, h->n, h->sum / h->n,
+	   xiohist_percentile(h, 500), xiohist_percentile(h, 900),
+	   xiohist_percentile(h, 990), xiohist_percentile(h, 999),
+	   xiohist_upper(max));
+}
+
+/* logs the histograms: a process that served a connection logs its own
+   ones, the master process of a forking listener the sums of all connections.
+   Called at exit and on SIGUSR2 */
+void xiostats_dump(void) {
+   const struct xiohist *hist;
+   int i;
+
+   if (xiostats_table == NULL)  return;
+   hist = (xiostats_own.pid != 0 ? xiostats_hist : xiostats_table->hist);
+   for (i = 0; i < XIOSTATS_SERIES; ++i) {
+      if (hist[i].n > 0) {
+	 xiostats_hist_log(xiostats_phasenames[i], &hist[i]);
+      }
+   }
+}
+
+static void xiostats_sigusr2(int signum) {
+   int _errno = errno;
+
+   diag_in_handler = 1;
+   xiostats_dump();
+   diag_in_handler = 0;
+   errno = _errno;
+}
+
+/* adds the counters of a terminated connection to the sum; other processes
+   may do the same at the same time */
+static void xiostats_fold(const struct xiostats_conn *c) {
+   struct xiostats_conn *sum = &xiostats_table->sum;
+   int i;
+
+   for (i = 0; i < 2; ++i) {
+      __sync_fetch_and_add(&sum->bytes[i], c->bytes[i]);
+      __sync_fetch_and_add(&sum->chunks[i], c->chunks[i]);
+   }
+   __sync_fetch_and_add(&sum->rdagain, c->rdagain);
+   __sync_fetch_and_add(&sum->wr.partial, c->wr.partial);
+   __sync_fetch_and_add(&sum->wr.again, c->wr.again);
+   for (i = 0; i < XIOSTATS_PHASES; ++i) {
+      __sync_fetch_and_add(&sum->phase_ns[i], c->phase_ns[i]);
+      __sync_fetch_and_add(&sum->phase_n[i], c->phase_n[i]);
+   }
+   __sync_fetch_and_add(&xiostats_table->closed, 1);
+}
+
+/* folds and frees the slot when it still belongs to process pid */
+static void xiostats_release(struct xiostats_conn *c, pid_t pid) {
+   if (!__sync_bool_compare_and_swap(&c->pid, pid, -1)) {
+      return;
+   }
+   xiostats_fold(c);
+   memset(&c->started, 0,
+	  sizeof(*c) - ((char *)&c->started - (char *)c));
+   __sync_synchronize();
+   c->pid = 0;
+}
+
+static void xiostats_summary_write(void);
+
+/* the counters of this process end with it */
+static void xiostats_exit(void) {
+   pid_t pid = Getpid();
+
+   if (xiostats_dumping) {
+      xiostats_dump();
+   }
+   if (xiostats_sumfd >= 0 && xiostats_own.pid == pid) {
+      xiostats_summary_write();
+   }
+   if (xiostats_cur != &xiostats_own) {
+      xiostats_release(xiostats_cur, pid);
+   } else if (xiostats_own.pid == pid) {
+      xiostats_fold(&xiostats_own);
+   }
+   xiostats_own.pid = 0;
+   xiostats_cur = &xiostats_own;
+   writefull_stat = &xiostats_own.wr;
+   if (xiostats_owner == pid && xiostats_path != NULL) {
+      Unlink(xiostats_path);
+   }
+}
+
+/* writes the peer address of the socket of xfd, or "" */
+static void xiostats_peer(xiofile_t *xfd, char *buff, size_t blen) {
+   union sockaddr_union sa;
+   socklen_t salen = sizeof(sa);
+   int fd;
+
+   *buff = '\0';
+   fd = (xfd->tag == XIO_TAG_DUAL ? xfd->dual.stream[0]->fd : xfd->stream.fd);
+   if (fd < 0 || Getpeername(fd, &sa.soa, &salen) < 0) {
+      return;
+   }
+   switch (sa.soa.sa_family) {
+#if WITH_IP4
+   case AF_INET:  sockaddr_inet4_info(&sa.ip4, buff, blen); break;
+#endif
+#if WITH_IP6
+   case AF_INET6: sockaddr_inet6_info(&sa.ip6, buff, blen); break;
+#endif
+   case AF_UNIX:  sockaddr_unix_info(&sa.un, salen, buff, blen); break;
+   }
+}
+
+/* call this when both addresses are open: the connection gets its record in
+   the table, where the counters of the data path are visible to the server */
+void xiostats_open(xiofile_t *sock1, xiofile_t *sock2) {
+   struct xiostats_conn *c;
+   int i;
+
+   if (xiostats_table == NULL)  return;
+   xiostats_own.pid = Getpid();
+   clock_gettime(CLOCK_MONOTONIC, &xiostats_own.started);
+   xiostats_peer(sock1, xiostats_own.peer[0], XIOSTATS_PEERLEN);
+   xiostats_peer(sock2, xiostats_own.peer[1], XIOSTATS_PEERLEN);
+   __sync_fetch_and_add(&xiostats_table->opened, 1);
+   for (i = 0; i < XIOSTATS_SLOTS; ++i) {
+      c = &xiostats_table->slot[i];
+      if (c->pid == 0 && __sync_bool_compare_and_swap(&c->pid, 0, -1)) {
+	 memcpy(&c->started, &xiostats_own.started,
+		sizeof(*c) - ((char *)&c->started - (char *)c));
+	 __sync_synchronize();
+	 c->pid = xiostats_own.pid;
+	 xiostats_cur = c;
+	 writefull_stat = &c->wr;
+	 return;
+      }
+   }
+   Info1("statistics: more than %d connections, this one is only summed up when it terminates",
+	 XIOSTATS_SLOTS);
+}
+
+/* call this after fork() with its return value */
+void xiostats_fork(pid_t pid) {
+   if (xiostats_table == NULL)  return;
+   if (pid == 0) {
+      /* the server thread remains in the parent */
+      if (xiostats_fd >= 0) {
+	 Close(xiostats_fd);
+	 xiostats_fd = -1;
+      }
+      return;
+   }
+   /* handshakes before the fork belong to the child */
+   memset(&xiostats_own, 0, sizeof(xiostats_own));
+   memset(xiostats_hist, 0, sizeof(xiostats_hist));
+}
+
+
+/* the server thread does not log, because the message functions are not
+   thread safe; so it calls the C library directly, not the sycls.c wrappers */
+
+static void xiostats_printf(struct xiostats_text *text,
+			    const char *format, ...) {
+   va_list ap;
+   int n;
+   char *buff;
+   size_t size;
+
+   while (true) {
+      va_start(ap, format);
+      n = vsnprintf(text->buff ? text->buff + text->len : NULL,
+		    text->size - text->len, format, ap);
+      va_end(ap);
+      if (n < 0)  return;
+      if (text->len + n < text->size) {
+	 text->len += n;
+	 return;
+      }
+      size = 2 * (text->len + n + 1);
+      if ((buff = realloc(text->buff, size)) == NULL)  return;
+      text->buff = buff;
+      text->size = size;
+   }
+}
+
+/* copies src with the quotes and backslashes escaped, as needed by both JSON
+   strings and Prometheus label values */
+static char *xiostats_escape(char *buff, size_t blen, const char *src) {
+   char *cp = buff;
+
+   while (*src != '\0' && cp + 2 < buff + blen) {
+      if (*src == '"' || *src == '\\') {
+	 *cp++ = '\\';
+	 *cp++ = *src;
+      } else if ((unsigned char)*src < ' ') {
+	 *cp++ = '?';
+      } else {
+	 *cp++ = *src;
+      }
+      ++src;
+   }
+   *cp = '\0';
+   return buff;
+}
+
+/* the counters of Prometheus output; each one is printed for the sum and for
+   each connection */
+enum xiostats_metric {
+   XIOSTATS_M_BYTES, XIOSTATS_M_CHUNKS, XIOSTATS_M_PARTIAL, XIOSTATS_M_EAGAIN,
+   XIOSTATS_M_HSECONDS, XIOSTATS_M_HCOUNT, XIOSTATS_METRICS
+} ;
+
+static const struct {
+   const char *name;
+   const char *help;
+} xiostats_metrics[XIOSTATS_METRICS] = {
+   { "bytes",		  "Bytes written" },
+   { "chunks",		  "Blocks of data transferred" },
+   { "partial_writes",	  "Writes that took only part of the data" },
+   { "eagain",		  "Reads and writes that failed with EAGAIN or EINTR" },
+   { "handshake_seconds", "Time spent in handshakes" },
+   { "handshakes",	  "Handshakes that were timed" },
+} ;
+
+static void xiostats_prom_sample(struct xiostats_text *text, const char *name,
+				 const char *labels, const char *extra,
+				 const char *value) {
+   bool braces = (*labels != '\0' || *extra != '\0');
+
+   xiostats_printf(text, "%s%s%s%s%s%s %s\n", name, braces?"{":"", labels,
+		   (*labels && *extra)?",":"", extra, braces?"}":"", value);
+}
+
+static void xiostats_prom_metric(struct xiostats_text *text, const char *name,
+				 const char *labels,
+				 const struct xiostats_conn *c,
+				 enum xiostats_metric metric) {
+   char value[32], extra[32];
+   int i;
+
+   switch (metric) {
+   case XIOSTATS_M_BYTES:
+   case XIOSTATS_M_CHUNKS:
+      for (i = 0; i < 2; ++i) {
+	 snprintf(extra, sizeof(extra), "direction=\"%s\"",
+		  xiostats_dirnames[i]);
+	 snprintf(value, sizeof(value), "%llu",
+		  metric == XIOSTATS_M_BYTES ? c->bytes[i] : c->chunks[i]);
+	 xiostats_prom_sample(text, name, labels, extra, value);
+      }
+      break;
+   case XIOSTATS_M_PARTIAL:
+      snprintf(value, sizeof(value), "%lu", c->wr.partial);
+      xiostats_prom_sample(text, name, labels, "", value);
+      break;
+   case XIOSTATS_M_EAGAIN:
+      snprintf(value, sizeof(value), "%lu", c->rdagain);
+      xiostats_prom_sample(text, name, labels, "op=\"read\"", value);
+      snprintf(value, sizeof(value), "%lu", c->wr.again);
+      xiostats_prom_sample(text, name, labels, "op=\"write\"", value);
+      break;
+   case XIOSTATS_M_HSECONDS:
+   case XIOSTATS_M_HCOUNT:
+      for (i = 0; i < XIOSTATS_PHASES; ++i) {
+	 snprintf(extra, sizeof(extra), "phase=\"%s\"",
+		  xiostats_phasenames[i]);
+	 if (metric == XIOSTATS_M_HSECONDS) {
+	    snprintf(value, sizeof(value), "%.6f", c->phase_ns[i] / 1e9);
+	 } else {
+	    snprintf(value, sizeof(value), "%lu", c->phase_n[i]);
+	 }
+	 xiostats_prom_sample(text, name, labels, extra, value);
+      }
+      break;
+   default:
+      break;
+   }
+}
+
+/* the histograms with fixed bounds of powers of two from 1.024us on, so that
+   the buckets of consecutive scrapes match */
+static void xiostats_prom_latency(struct xiostats_text *text) {
+   const struct xiohist *h;
+   unsigned long long cum;
+   unsigned int i, b, e;
+   int s;
+
+   xiostats_printf(text,
+		   "# HELP socat_latency_seconds Durations of the phases of connections, and relay delay of data\n"
+		   "# TYPE socat_latency_seconds histogram\n");
+   for (s = 0; s < XIOSTATS_SERIES; ++s) {
+      h = &xiostats_table->hist[s];
+      if (h->n == 0)  continue;
+      cum = 0;
+      b = 0;
+      for (e = 10; e <= XIOHIST_MAXBITS; ++e) {
+	 for (i = xiohist_bucket(1ULL<<e); b < i; ++b) {
+	    cum += h->count[b];
+	 }
+	 xiostats_printf(text,
+			 "socat_latency_seconds_bucket{phase=\"%s\",le=\"%.9g\"} %llu\n",
+			 xiostats_phasenames[s], (1ULL<<e) / 1e9, cum);
+      }
+      xiostats_printf(text,
+		      "socat_latency_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n"
+		      "socat_latency_seconds_sum{phase=\"%s\"} %.9f\n"
+		      "socat_latency_seconds_count{phase=\"%s\"} %llu\n",
+		      xiostats_phasenames[s], h->n,
+		      xiostats_phasenames[s], h->sum / 1e9,
+		      xiostats_phasenames[s], h->n);
+   }
+}
+
+static void xiostats_prom(struct xiostats_text *text, double uptime,
+			  unsigned long long opened, unsigned long long active,
+			  const struct xiostats_conn *sum,
+			  const struct xiostats_conn *conn, int nconn,
+			  const struct timespec *now) {
+   char name[64], labels[64], peer[2][2*XIOSTATS_PEERLEN];
+   int m, i;
+
+   xiostats_printf(text,
+		   "# HELP socat_uptime_seconds Seconds since socat started\n"
+		   "# TYPE socat_uptime_seconds gauge\n"
+		   "socat_uptime_seconds %.3f\n"
+		   "# HELP socat_connections_total Connections established\n"
+		   "# TYPE socat_connections_total counter\n"
+		   "socat_connections_total %llu\n"
+		   "# HELP socat_connections_active Connections transferring data\n"
+		   "# TYPE socat_connections_active gauge\n"
+		   "socat_connections_active %llu\n",
+		   uptime, opened, active);
+   for (m = 0; m < XIOSTATS_METRICS; ++m) {
+      snprintf(name, sizeof(name), "socat_%s_total", xiostats_metrics[m].name);
+      xiostats_printf(text, "# HELP %s %s\n# TYPE %s counter\n",
+		      name, xiostats_metrics[m].help, name);
+      xiostats_prom_metric(text, name, "", sum, m);
+   }
+
+   xiostats_prom_latency(text);
+
+   if (nconn == 0)  return;
+   xiostats_printf(text,
+		   "# HELP socat_connection_info Peer addresses of a connection\n"
+		   "# TYPE socat_connection_info gauge\n");
+   for (i = 0; i < nconn; ++i) {
+      xiostats_printf(text,
+		      "socat_connection_info{pid=\"%d\",peer1=\"%s\",peer2=\"%s\"} 1\n",
+		      (int)conn[i].pid,
+		      xiostats_escape(peer[0], sizeof(peer[0]), conn[i].peer[0]),
+		      xiostats_escape(peer[1], sizeof(peer[1]), conn[i].peer[1]));
+   }
+   xiostats_printf(text,
+		   "# HELP socat_connection_age_seconds Seconds since the connection was established\n"
+		   "# TYPE socat_connection_age_seconds gauge\n");
+   for (i = 0; i < nconn; ++i) {
+      xiostats_printf(text, "socat_connection_age_seconds{pid=\"%d\"} %.3f\n",
+		      (int)conn[i].pid,
+		      xiostats_since(&conn[i].started, now));
+   }
+   for (m = 0; m < XIOSTATS_METRICS; ++m) {
+      snprintf(name, sizeof(name), "socat_connection_%s",
+	       xiostats_metrics[m].name);
+      xiostats_printf(text, "# HELP %s %s\n# TYPE %s gauge\n",
+		      name, xiostats_metrics[m].help, name);
+      for (i = 0; i < nconn; ++i) {
+	 snprintf(labels, sizeof(labels), "pid=\"%d\"", (int)conn[i].pid);
+	 xiostats_prom_metric(text, name, labels, &conn[i], m);
+      }
+   }
+}
+
+static void xiostats_json_counters(struct xiostats_text *text,
+				   const struct xiostats_conn *c) {
+   int i;
+
+   xiostats_printf(text,
+		   "\"bytes\":{\"left_to_right\":%llu,\"right_to_left\":%llu},"
+		   "\"chunks\":{\"left_to_right\":%llu,\"right_to_left\":%llu},"
+		   "\"partial_writes\":%lu,"
+		   "\"eagain\":{\"read\":%lu,\"write\":%lu},"
+		   "\"handshakes\":{",
+		   c->bytes[0], c->bytes[1], c->chunks[0], c->chunks[1],
+		   c->wr.partial, c->rdagain, c->wr.again);
+   for (i = 0; i < XIOSTATS_PHASES; ++i) {
+      xiostats_printf(text, "%s\"%s\":{\"count\":%lu,\"seconds\":%.6f}",
+		      i?",":"", xiostats_phasenames[i],
+		      c->phase_n[i], c->phase_ns[i] / 1e9);
+   }
+   xiostats_printf(text, "}");
+}
+
+/* the non empty buckets of the histograms as [largest value, count] */
+static void xiostats_json_latency(struct xiostats_text *text) {
+   const struct xiohist *h;
+   bool first = true;
+   unsigned int i, b;
+   int s;
+
+   xiostats_printf(text, ",\"latency\":{");
+   for (s = 0; s < XIOSTATS_SERIES; ++s) {
+      h = &xiostats_table->hist[s];
+      if (h->n == 0)  continue;
+      xiostats_printf(text,
+		      "%s\"%s\":{\"count\":%llu,\"sum_ns\":%llu,\"buckets\":[",
+		      first?"":",", xiostats_phasenames[s], h->n, h->sum);
+      first = false;
+      for (i = 0, b = 0; i < XIOHIST_BUCKETS; ++i) {
+	 if (h->count[i] == 0)  continue;
+	 xiostats_printf(text, "%s[%llu,%lu]", b++?",":"",
+			 xiohist_upper(i), h->count[i]);
+      }
+      xiostats_printf(text, "]}");
+   }
+   xiostats_printf(text, "}");
+}
+
+/* call this when the transfer in direction dir (0 is left to right) ended */
+void xiostats_eof(int dir) {
+   if (xiostats_cur->eof[dir] == 0) {
+      xiostats_cur->eof[dir] = ++xiostats_eofs;
+   }
+}
+
+/* call this with the exit status, or -1, and a short reason why the
+   connection ends, or NULL; the first reason is kept. Async-signal-safe */
+void xiostats_reason(int status, const char *reason) {
+   if (status >= 0)  xiostats_status = status;
+   if (xiostats_why == NULL)  xiostats_why = reason;
+}
+
+/* formats the summary record of the connection of this process as one JSON
+   line and writes it with a single write(), so the O_APPEND records of
+   concurrent processes do not mix */
+static void xiostats_summary_write(void) {
+   const struct xiostats_conn *c = xiostats_cur;
+   struct xiostats_text text = { NULL, 0, 0 };
+   char esc[2][2*XIOSTATS_PEERLEN], addr[1024];
+   struct timespec now;
+   struct timeval end;
+   bool first = true;
+   int i;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   gettimeofday(&end, NULL);
+   xiostats_printf(&text, "{\"time\":%ld.%03ld,\"pid\":%d",
+		   (long)end.tv_sec, (long)end.tv_usec/1000, (int)c->pid);
+   for (i = 0; i < 2; ++i) {
+      xiostats_printf(&text, ",\"address%d\":\"%s\"", i+1,
+		      xiostats_escape(addr, sizeof(addr),
+				      xiostats_addr[i] ? xiostats_addr[i] : ""));
+   }
+   xiostats_printf(&text,
+		   ",\"peer1\":\"%s\",\"peer2\":\"%s\",\"duration\":%.6f,\"phases\":{",
+		   xiostats_escape(esc[0], sizeof(esc[0]), c->peer[0]),
+		   xiostats_escape(esc[1], sizeof(esc[1]), c->peer[1]),
+		   xiostats_since(&c->started, &now));
+   for (i = 0; i < XIOSTATS_PHASES; ++i) {
+      if (c->phase_n[i] == 0)  continue;
+      xiostats_printf(&text, "%s\"%s\":%.6f", first?"":",",
+		      xiostats_phasenames[i], c->phase_ns[i] / 1e9);
+      first = false;
+   }
+   xiostats_printf(&text,
+		   "},\"bytes\":{\"left_to_right\":%llu,\"right_to_left\":%llu},"
+		   "\"chunks\":{\"left_to_right\":%llu,\"right_to_left\":%llu},"
+		   "\"avg_chunk\":{\"left_to_right\":%.1f,\"right_to_left\":%.1f},"
+		   "\"syscalls\":{\"read\":%llu,\"write\":%llu,\"poll\":%llu},"
+		   "\"partial_writes\":%lu,\"eagain\":{\"read\":%lu,\"write\":%lu},"
+		   "\"max_backlog\":"F_Zu",\"eof\":[",
+		   c->bytes[0], c->bytes[1], c->chunks[0], c->chunks[1],
+		   c->chunks[0] ? (double)c->bytes[0] / c->chunks[0] : 0.0,
+		   c->chunks[1] ? (double)c->bytes[1] / c->chunks[1] : 0.0,
+		   c->reads[0] + c->reads[1],
+		   c->writes[0] + c->writes[1] + c->wr.partial + c->wr.again,
+		   c->polls, c->wr.partial, c->rdagain, c->wr.again,
+		   c->wr.backlog);
+   /* the direction that ended first comes first */
+   for (i = 1; i <= 2; ++i) {
+      if (c->eof[0] == i || c->eof[1] == i) {
+	 xiostats_printf(&text, "%s\"%s\"", i>1?",":"",
+			 xiostats_dirnames[c->eof[0] == i ? 0 : 1]);
+      }
+   }
+   if (xiostats_status >= 0) {
+      xiostats_printf(&text, "],\"exit\":{\"status\":%d,", xiostats_status);
+   } else {
+      xiostats_printf(&text, "],\"exit\":{\"status\":null,");
+   }
+   xiostats_printf(&text, "\"reason\":\"%s\"}}\n",
+		   xiostats_why ? xiostats_why : "error");
+   if (text.buff == NULL) {
+      Warn("summary record: out of memory");
+      return;
+   }
+   if (Write(xiostats_sumfd, text.buff, text.len) < (ssize_t)text.len) {
+      Warn2("write(%d, ...): summary record: %s",
+	    xiostats_sumfd, strerror(errno));
+   }
+   free(text.buff);
+}
+
+static void xiostats_json(struct xiostats_text *text, double uptime,
+			  unsigned long long opened, unsigned long long active,
+			  const struct xiostats_conn *sum,
+			  const struct xiostats_conn *conn, int nconn,
+			  const struct timespec *now) {
+   char peer[2][2*XIOSTATS_PEERLEN];
+   int i;
+
+   xiostats_printf(text,
+		   "{\"uptime\":%.3f,"
+		   "\"connections\":{\"total\":%llu,\"active\":%llu},",
+		   uptime, opened, active);
+   xiostats_json_counters(text, sum);
+   xiostats_json_latency(text);
+   xiostats_printf(text, ",\"active\":[");
+   for (i = 0; i < nconn; ++i) {
+      xiostats_printf(text,
+		      "%s{\"pid\":%d,\"peer1\":\"%s\",\"peer2\":\"%s\",\"age\":%.3f,",
+		      i?",":"", (int)conn[i].pid,
+		      xiostats_escape(peer[0], sizeof(peer[0]), conn[i].peer[0]),
+		      xiostats_escape(peer[1], sizeof(peer[1]), conn[i].peer[1]),
+		      xiostats_since(&conn[i].started, now));
+      xiostats_json_counters(text, &conn[i]);
+      xiostats_printf(text, "}");
+   }
+   xiostats_printf(text, "]}\n");
+}
+
+/* sums up the table and formats it */
+static void xiostats_report(struct xiostats_text *text, bool json) {
+   struct xiostats_table *table = xiostats_table;
+   struct xiostats_conn sum, *conn, *c;
+   unsigned long long opened, closed;
+   struct timespec now;
+   int nconn = 0, i;
+
+   /* children that were killed could not fold their counters */
+   for (i = 0; i < XIOSTATS_SLOTS; ++i) {
+      pid_t pid = table->slot[i].pid;
+      if (pid > 0 && kill(pid, 0) < 0 && errno == ESRCH) {
+	 xiostats_release(&table->slot[i], pid);
+      }
+   }
+
+   if ((conn = malloc(XIOSTATS_SLOTS * sizeof(*conn))) == NULL) {
+      return;
+   }
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   opened = table->opened;
+   closed = table->closed;
+   sum = table->sum;
+   for (i = 0; i < XIOSTATS_SLOTS; ++i) {
+      if (table->slot[i].pid <= 0)  continue;
+      c = &conn[nconn];
+      *c = table->slot[i];
+      if (c->pid <= 0)  continue;
+      sum.bytes[0]  += c->bytes[0];   sum.bytes[1]  += c->bytes[1];
+      sum.chunks[0] += c->chunks[0];  sum.chunks[1] += c->chunks[1];
+      sum.rdagain   += c->rdagain;
+      sum.wr.partial += c->wr.partial;
+      sum.wr.again  += c->wr.again;
+      {
+	 int p;
+	 for (p = 0; p < XIOSTATS_PHASES; ++p) {
+	    sum.phase_ns[p] += c->phase_ns[p];
+	    sum.phase_n[p]  += c->phase_n[p];
+	 }
+      }
+      ++nconn;
+   }
+   if (json) {
+      xiostats_json(text, xiostats_since(&table->started, &now),
+		    opened, opened - closed, &sum, conn, nconn, &now);
+   } else {
+      xiostats_prom(text, xiostats_since(&table->started, &now),
+		    opened, opened - closed, &sum, conn, nconn, &now);
+   }
+   free(conn);
+}
+
+/* reads the request line of the client: a line containing "json" asks for
+   JSON, anything else, or nothing within a second, for Prometheus text. An
+   HTTP GET request is answered with an HTTP response */
+static void xiostats_serve(int fd) {
+   char request[256];
+   size_t len = 0;
+   struct pollfd pfd;
+   struct xiostats_text text = { NULL, 0, 0 };
+   char head[128];
+   ssize_t n;
+   size_t headlen = 0, writt;
+   bool json, http;
+
+   pfd.fd = fd;
+   pfd.events = POLLIN;
+   while (len < sizeof(request)-1 && memchr(request, '\n', len) == NULL) {
+      if (poll(&pfd, 1, 1000) <= 0)  break;
+      if ((n = read(fd, request+len, sizeof(request)-1-len)) <= 0)  break;
+      len += n;
+   }
+   request[len] = '\0';
+   json = (strstr(request, "json") != NULL);
+   http = !strncmp(request, "GET ", 4);
+
+   xiostats_report(&text, json);
+   if (text.buff == NULL)  return;
+   if (http) {
+      headlen =
+	 snprintf(head, sizeof(head),
+		  "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Length: "F_Zu"\r\n\r\n",
+		  json ? "application/json" : "text/plain; version=0.0.4",
+		  text.len);
+      if (write(fd, head, headlen) < 0) {
+	 free(text.buff);
+	 return;
+      }
+   }
+   for (writt = 0; writt < text.len; writt += n) {
+      if ((n = write(fd, text.buff+writt, text.len-writt)) < 0) {
+	 if (errno == EINTR)  { n = 0; continue; }
+	 break;
+      }
+   }
+   free(text.buff);
+}
+
+static void *xiostats_server(void *arg) {
+   int listenfd = *(int *)arg;
+   int fd;
+
+   while (true) {
+      if ((fd = accept(listenfd, NULL, NULL)) < 0) {
+	 if (errno == EINTR || errno == ECONNABORTED)  continue;
+	 sleep(1);	/* e.g. EMFILE */
+	 continue;
+      }
+      xiostats_serve(fd);
+      close(fd);
+   }
+   return NULL;
+}
+
+/* creates the table; with path, also the socket and the server thread;
+   with dump, the histograms are logged at exit and on SIGUSR2.
+   returns 0 on success, or -1 after printing an error message */
+int xiostats_init(const char *path, bool dump) {
+   struct sockaddr_un sa;
+   struct sigaction act;
+   pthread_t server;
+   sigset_t all, old;
+   int result;
+
+   if (path != NULL && strlen(path) >= sizeof(sa.sun_path)) {
+      Error1("statistics socket \"%s\": path too long", path);
+      return -1;
+   }
+   xiostats_table = Mmap(NULL, sizeof(struct xiostats_table),
+			 PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+   if (xiostats_table == MAP_FAILED) {
+      Error2("mmap(NULL, "F_Zu", PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0): %s",
+	     sizeof(struct xiostats_table), strerror(errno));
+      xiostats_table = NULL;
+      return -1;
+   }
+   clock_gettime(CLOCK_MONOTONIC, &xiostats_table->started);
+   clock_gettime(CLOCK_MONOTONIC, &xiostats_polltime);
+   writefull_stat = &xiostats_own.wr;
+   xiostats_owner = Getpid();
+   Atexit(xiostats_exit);
+
+   if (dump) {
+      xiostats_dumping = true;
+      memset(&act, 0, sizeof(act));
+      sigfillset(&act.sa_mask);
+      act.sa_flags = 0;	/* interrupt accept() so the messages get out */
+      act.sa_handler = xiostats_sigusr2;
+      Sigaction(SIGUSR2, &act, NULL);
+   }
+   if (path == NULL) {
+      return 0;
+   }
+
+   if ((xiostats_fd = Socket(PF_UNIX, SOCK_STREAM, 0)) < 0) {
+      Error1("socket(PF_UNIX, SOCK_STREAM, 0): %s", strerror(errno));
+      return -1;
+   }
+   socket_un_init(&sa);
+   strcpy(sa.sun_path, path);
+   if (Bind(xiostats_fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+      Error3("bind(%d, \"%s\", ...): %s", xiostats_fd, path, strerror(errno));
+      return -1;
+   }
+   xiostats_path = path;
+   if (Listen(xiostats_fd, 16) < 0) {
+      Error2("listen(%d, 16): %s", xiostats_fd, strerror(errno));
+      return -1;
+   }
+   if (Fcntl_l(xiostats_fd, F_SETFD, FD_CLOEXEC) < 0) {
+      Warn2("fcntl(%d, F_SETFD, FD_CLOEXEC): %s", xiostats_fd, strerror(errno));
+   }
+
+   /* signals must interrupt the main thread, so the server blocks them */
+   sigfillset(&all);
+   pthread_sigmask(SIG_SETMASK, &all, &old);
+   result = pthread_create(&server, NULL, xiostats_server, &xiostats_fd);
+   pthread_sigmask(SIG_SETMASK, &old, NULL);
+   if (result != 0) {
+      Error1("pthread_create(): %s", strerror(result));
+      return -1;
+   }
+   pthread_detach(server);
+   Info1("statistics on \"%s\"", path);
+   return 0;
+}
+
+/* opens the file of the summary records; address1 and address2 are the
+   address specifications of the command line. Call after xiostats_init().
+   returns 0 on success, or -1 after printing an error message */
+int xiostats_summary(const char *path,
+		     const char *address1, const char *address2) {
+   if ((xiostats_sumfd =
+	Open(path, O_WRONLY|O_APPEND|O_CREAT, 0644)) < 0) {
+      Error2("open(\"%s\", O_WRONLY|O_APPEND|O_CREAT, 0644): %s",
+	     path, strerror(errno));
+      return -1;
+   }
+   if (Fcntl_l(xiostats_sumfd, F_SETFD, FD_CLOEXEC) < 0) {
+      Warn2("fcntl(%d, F_SETFD, FD_CLOEXEC): %s",
+	    xiostats_sumfd, strerror(errno));
+   }
+   xiostats_addr[0] = address1;
+   xiostats_addr[1] = address2;
+   Info1("connection summaries to \"%s\"", path);
+   return 0;
+}
+
+#else /* !WITH_STATS */
+
+void xiostats_polled(void) {
+}
+
+void xiostats_relayed(void) {
+}
+
+void xiostats_dump(void) {
+}
+
+void xiostats_begin(struct timespec *t0) {
+}
+
+void xiostats_end(enum xiostats_phase phase, const struct timespec *t0) {
+}
+
+void xiostats_open(xiofile_t *sock1, xiofile_t *sock2) {
+}
+
+void xiostats_fork(pid_t pid) {
+}
+
+void xiostats_eof(int dir) {
+}
+
+void xiostats_reason(int status, const char *reason) {
+}
+
+#endif /* !WITH_STATS */
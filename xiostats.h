@@ -0,0 +1,63 @@
+/* source: xiostats.h */
+/* Copyright Gerhard Rieger and contributors (see file CHANGES) */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+#ifndef __xiostats_h_included
+#define __xiostats_h_included 1
+
+/* the timed phases of opening an address, and the relay delay */
+enum xiostats_phase {
+   XIOSTATS_RESOLVE,	/* getaddrinfo() */
+   XIOSTATS_CONNECT,	/* connect() of a socket */
+   XIOSTATS_SOCKS4,	/* SOCKS4 request and reply */
+   XIOSTATS_SOCKS5_SELECT,	/* SOCKS5 method selection */
+   XIOSTATS_SOCKS5_AUTH,	/* SOCKS5 username/password authentication */
+   XIOSTATS_SOCKS5_CONNECT,	/* SOCKS5 request and reply */
+   XIOSTATS_PROXY,	/* HTTP CONNECT request and reply */
+   XIOSTATS_TLS,	/* SSL_connect() or SSL_accept() */
+   XIOSTATS_FORK,	/* from fork() until the child runs */
+   XIOSTATS_PHASES,
+   XIOSTATS_RELAY = XIOSTATS_PHASES,	/* from poll() until data is written */
+   XIOSTATS_SERIES
+} ;
+
+/* the histograms are struct xiohist of utils.h */
+
+#define XIOSTATS_PEERLEN 112	/* fits a sockaddr_un path */
+
+/* the counters of one connection, i.e. of one socat process that transfers
+   data; index [0] is left to right, [1] is right to left */
+struct xiostats_conn {
+   pid_t pid;		/* 0 when the record is free, -1 while it is folded */
+   struct timespec started;	/* CLOCK_MONOTONIC */
+   char peer[2][XIOSTATS_PEERLEN];	/* peer socket addresses, or "" */
+   unsigned long long bytes[2];	/* bytes written */
+   unsigned long long chunks[2];	/* successful transfers */
+   unsigned long rdagain;	/* reads that failed with EAGAIN */
+   struct writefull_stat wr;	/* partial writes and write retries */
+   unsigned long long phase_ns[XIOSTATS_PHASES];	/* sum of durations */
+   unsigned long phase_n[XIOSTATS_PHASES];	/* number of durations */
+   unsigned long long reads[2];	/* read calls of the transfer loop */
+   unsigned long long writes[2];	/* write calls, without retries */
+   unsigned long long polls;	/* poll calls of the transfer loop */
+   unsigned char eof[2];	/* 1 for the direction that ended first, 2 */
+} ;
+
+/* the data path increments the counters here; without option -S, and until
+   the connection is established, this is a private record */
+extern struct xiostats_conn *xiostats_cur;
+
+extern int xiostats_init(const char *path, bool dump);
+extern void xiostats_fork(pid_t pid);
+extern void xiostats_open(xiofile_t *sock1, xiofile_t *sock2);
+extern void xiostats_begin(struct timespec *t0);
+extern void xiostats_end(enum xiostats_phase phase, const struct timespec *t0);
+extern void xiostats_polled(void);
+extern void xiostats_relayed(void);
+extern void xiostats_dump(void);
+extern int xiostats_summary(const char *path,
+			    const char *address1, const char *address2);
+extern void xiostats_eof(int dir);
+extern void xiostats_reason(int status, const char *reason);
+
+#endif /* !defined(__xiostats_h_included) */
@@ -8,8 +8,11 @@
 #include "xiosysincludes.h"
 #include "xioopen.h"
 
+#include "xio-socket.h"
 #include "xio-readline.h"
 #include "xio-openssl.h"
+#include "xio-framing.h"
+#include "xio-interface.h"
 
 
 /* ...
@@ -18,9 +21,7 @@
    defers the operation.
    on return value < 0: errno reflects the value from write() */
 ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
-   ssize_t writt;
    struct single *pipe;
-   int _errno;
 
    if (file->tag == XIO_TAG_INVALID) {
       Error1("xiowrite(): invalid xiofile descriptor %p", file);
@@ -46,6 +47,18 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
    }
 #endif /* WITH_READLINE */
 
+   if (pipe->framing != XIOFRAMING_NONE) {
+      /* collects records for xioflush(), see xio-framing.c */
+      return xiowrite_framing(pipe, buff, bytes);
+   }
+   return _xiowrite(pipe, buff, bytes);
+}
+
+/* writes to the (single) address without the framing layer */
+ssize_t _xiowrite(struct single *pipe, const void *buff, size_t bytes) {
+   ssize_t writt;
+   int _errno;
+
    switch (pipe->dtype & XIODATA_WRITEMASK) {
 
    case XIOWRITE_STREAM:
@@ -78,6 +91,18 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
 	 } from;*/
       /*socklen_t fromlen;*/
 
+#if _WITH_PACKETRING
+      if (pipe->packetring != NULL && pipe->packetring->tbase != NULL) {
+	 /* copied into the transmit ring; prints its own error messages */
+	 return xiosend_packetring(pipe, buff, bytes);
+      }
+#endif /* _WITH_PACKETRING */
+#if HAVE_SENDMMSG
+      if (pipe->dgrambatch > 1) {
+	 /* queued for sendmmsg(); prints its own error messages */
+	 return xiosend_dgram(pipe, buff, bytes);
+      }
+#endif /* HAVE_SENDMMSG */
       do {
 	 writt = Sendto(pipe->fd, buff, bytes, 0,
 			&pipe->peersa.soa, pipe->salen);
@@ -100,15 +125,10 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
 	       sockaddr_info(&pipe->peersa.soa, pipe->salen,
 			     infobuff, sizeof(infobuff)),
 	       pipe->salen, writt, bytes);
-      } else {
       }
-      {
-	 char infobuff[256];
-	 union sockaddr_union us;
-	 socklen_t uslen = sizeof(us);
-	 Getsockname(pipe->fd, &us.soa, &uslen);
-	 Notice1("local address: %s",
-		 sockaddr_info(&us.soa, uslen, infobuff, sizeof(infobuff)));
+      if (!pipe->para.socket.la_known) {
+	 /* an unbound socket got its address with the first packet */
+	 xiosetlocaladdr(pipe);
       }
       break;
 #endif /* _WITH_SOCKET */
@@ -148,3 +168,83 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
    }
    return writt;
 }
+
+
+/* some address types hold back small writes for a while (OpenSSL option
+   coalesce, datagram option dgram-batch, option framing). xioflush() writes
+   such data out immediately.
+   returns 0 on success or -1 on error (errno set) */
+int xioflush(xiofile_t *file) {
+   struct single *pipe;
+
+   if (file->tag == XIO_TAG_INVALID) {
+      Error1("xioflush(): invalid xiofile descriptor %p", file);
+      errno = EINVAL;
+      return -1;
+   }
+
+   if (file->tag == XIO_TAG_DUAL) {
+      pipe = file->dual.stream[1];
+   } else {
+      pipe = &file->stream;
+   }
+
+   if (pipe->frame != NULL && xioflush_framing(pipe) < 0) {
+      return -1;
+   }
+   switch (pipe->dtype & XIODATA_WRITEMASK) {
+#if WITH_OPENSSL
+   case XIOWRITE_OPENSSL:
+      return xioflush_openssl(pipe);
+#endif /* WITH_OPENSSL */
+#if _WITH_SOCKET
+   case XIOWRITE_SENDTO:
+      return xioflush_dgram(pipe);
+#endif /* _WITH_SOCKET */
+   default:
+      return 0;
+   }
+}
+
+/* if the address holds back write data, stores in delay how long it may still
+   wait and returns 1; the data loop must call xioflush() when it expired.
+   returns 0 when no data is held back */
+int xioflushdelay(xiofile_t *file, struct timeval *delay) {
+   struct single *pipe;
+
+   if (file->tag == XIO_TAG_INVALID) {
+      return 0;
+   }
+
+   if (file->tag == XIO_TAG_DUAL) {
+      pipe = file->dual.stream[1];
+   } else {
+      pipe = &file->stream;
+   }
+   if (pipe->tag == XIO_TAG_INVALID) {
+      return 0;
+   }
+
+   if (xioqueued_framing(pipe) > 0) {
+      /* records go out as soon as the input has no more */
+      delay->tv_sec = 0;  delay->tv_usec = 0;
+      return 1;
+   }
+   switch (pipe->dtype & XIODATA_WRITEMASK) {
+#if WITH_OPENSSL
+   case XIOWRITE_OPENSSL:
+      return xioflushdelay_openssl(pipe, delay);
+#endif /* WITH_OPENSSL */
+#if _WITH_SOCKET
+   case XIOWRITE_SENDTO:
+      /* queued datagrams go out as soon as the input has no more */
+      if (xioqueued_dgram(pipe) == 0) {
+	 return 0;
+      }
+      delay->tv_sec = 0;  delay->tv_usec = 0;
+      return 1;
+#endif /* _WITH_SOCKET */
+   default:
+      return 0;
+   }
+}